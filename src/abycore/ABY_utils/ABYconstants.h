@@ -33,6 +33,8 @@
 
 #define ABY_PARTY_CHANNEL MAX_NUM_COMM_CHANNELS-3
 #define ABY_SETUP_CHANNEL ABY_PARTY_CHANNEL-1
+#define ABY_POOL_CHANNEL ABY_SETUP_CHANNEL-1
+#define SILENT_OT_CHANNEL ABY_POOL_CHANNEL-1
 #define DJN_CHANNEL	32
 #define DGK_CHANNEL DJN_CHANNEL
 
@@ -50,7 +52,11 @@
 //#define USE_KK_OT_FOR_MT
 //#define GETCLEARVALUE_DEBUG
 
+//#define USE_PACKED_GATES //packed gate layout with 48 instead of 72 bytes per gate, see abycircuit.h
+
 #define MAXGATES 32000000
+#define GATE_CHUNK_BITS 16 //log2 of the number of gates that are allocated at once when the circuit grows
+#define GATE_CHUNK_SIZE (1 << GATE_CHUNK_BITS)
 #define USE_MULTI_MUX_GATES
 
 //TODO eventually remove this and prefix all couts, etc with std::
@@ -84,7 +90,18 @@ enum e_mt_gen_alg {
 	MT_OT = 0, /**< Enum for using OT to generate arithmetic MTs */
 	MT_PAILLIER = 1, /**< Enum for using PAILLIER to generate arithmetic MTs */
 	MT_DGK = 2, /**< Enum for using DGK to generate arithmetic MTs */
-	MT_LAST = 3 /**< Dummy enum that is used to indicate the number of enums. DO NOT PUT ANOTHER ENUM AFTER THIS ONE! */
+	MT_OLE = 3, /**< Enum for using oblivious linear evaluation on silent random OTs to generate arithmetic MTs, falls back to MT_OT for fewer than SILENT_OT_MIN_OTS OTs */
+	MT_LAST = 4 /**< Dummy enum that is used to indicate the number of enums. DO NOT PUT ANOTHER ENUM AFTER THIS ONE! */
+};
+
+/**
+ \enum	e_rot_gen_alg
+ \brief	Enumeration which defines the method that is used to generate the random OTs of the Boolean multiplication triples.
+ */
+enum e_rot_gen_alg {
+	ROT_IKNP = 0, /**< Enum for using IKNP OT extension */
+	ROT_SILENT = 1, /**< Enum for using the LPN-based silent OT extension for all tasks that are large enough, see SilentOTExtSnd */
+	ROT_LAST = 2 /**< Dummy enum that is used to indicate the number of enums. DO NOT PUT ANOTHER ENUM AFTER THIS ONE! */
 };
 
 /**
@@ -105,6 +122,7 @@ enum e_gatetype {
 	G_SHARED_OUT = 0x09, /**< Enum for shared output gate, where the output is kept secret-shared between parties after the evaluation*/
 	G_TT = 0x0A, /**< Enum for computing an arbitrary truth table gate. Is needed for the 1ooN OT in SPLUT */
 	G_SHARED_IN = 0x0B, /**< Enum for pre-shared input gate, where the parties dont secret-share (e.g. in outsourcing) */
+	G_REMOVED = 0x0C, /**< Enum for gates that were removed by the circuit optimization and are never evaluated */
 	G_PRINT_VAL = 0x40, /**< Enum gate that reconstructs the shares and prints the plaintext value with the designated string */
 	G_ASSERT = 0x41, /**< Enum gate that reconstructs the shares and compares it to an provided input plaintext value */
 	G_COMBINE = 0x80, /**< Enum for COMBINER gates that combine multiple single-value gates to one multi-value gate  */
@@ -183,7 +201,8 @@ enum ePreCompPhase {
 	ePreCompStore	= 1,
 	ePreCompRead	= 2,
 	ePreCompRAMWrite = 3,
-	ePreCompRAMRead = -3
+	ePreCompRAMRead = -3,
+	ePreCompPool	= 4 // MTs are drawn from the triple pool of the party, see ABYTriplePool
 };
 
 /**
@@ -256,6 +275,7 @@ static string get_gate_type_name(e_gatetype g) {
 	case G_TT: return "Truth-Table";
 	case G_ASSERT: return "Assertion";
 	case G_PRINT_VAL: return "Printer";
+	case G_REMOVED: return "Removed";
 	default: return "NN";
 	}
 }
@@ -0,0 +1,207 @@
+/**
+ \file 		gatevalpool.h
+ \author 	michael.zohner@ec-spride.de
+ \copyright	ABY - A Framework for Efficient Mixed-protocol Secure Two-party Computation
+			Copyright (C) 2015 Engineering Cryptographic Protocols Group, TU Darmstadt
+			This program is free software: you can redistribute it and/or modify
+			it under the terms of the GNU Affero General Public License as published
+			by the Free Software Foundation, either version 3 of the License, or
+			(at your option) any later version.
+			This program is distributed in the hope that it will be useful,
+			but WITHOUT ANY WARRANTY; without even the implied warranty of
+			MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+			GNU Affero General Public License for more details.
+			You should have received a copy of the GNU Affero General Public License
+			along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief		Size-classed pool for the values of instantiated gates
+ */
+
+#ifndef __GATEVALPOOL_H_
+#define __GATEVALPOOL_H_
+
+#include "../ENCRYPTO_utils/typedefs.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <iostream>
+#include <vector>
+
+//#define DEBUGGATEVALPOOL
+
+#define GATEVALPOOL_MIN_CLASS_BITS 4		// smallest block holds 16 bytes
+#define GATEVALPOOL_NUM_CLASSES 13			// largest pooled block holds 64 KiB, larger blocks come from malloc
+#define GATEVALPOOL_SLAB_SIZE 1048576		// bytes that are requested from malloc at once
+
+/*
+ * Gate values are allocated when a gate is instantiated and freed when its last successor was evaluated, which amounts
+ * to millions of small, short-lived allocations of only a few distinct sizes per circuit. The pool rounds every request
+ * up to a power of two, carves blocks out of large slabs and keeps freed blocks in one free list per size class. Every
+ * block is preceded by a 16 byte header that names its pool and size class, so a block can be returned without knowing
+ * where it came from and the returned memory keeps a 16 byte alignment. Reset() hands all blocks back at once and keeps
+ * the slabs for the next execution.
+ *
+ * The pool is not thread-safe. Each sharing owns one pool, and the blocks of a sharing are only allocated and freed by
+ * the thread that currently evaluates this sharing.
+ */
+class GateValuePool {
+public:
+	GateValuePool() {
+		m_nCurSlab = 0;
+		m_nSlabOffset = 0;
+		m_pLarge = NULL;
+		memset(m_pFreeList, 0, sizeof(m_pFreeList));
+	}
+	;
+
+	~GateValuePool() {
+		Reset();
+		for (uint32_t i = 0; i < m_vSlabs.size(); i++) {
+			free(m_vSlabs[i]);
+		}
+	}
+	;
+
+	/**
+	 Allocates a block of at least bytes bytes from the pool.
+	 \param		bytes	number of bytes that are requested
+	 \param		clear	zero the block, as calloc would
+	 \return	pointer to a 16 byte aligned block
+	 */
+	void* Alloc(uint64_t bytes, bool clear = true) {
+		uint32_t sizeclass = GetSizeClass(bytes);
+		BYTE* block;
+
+		if (sizeclass == GATEVALPOOL_NUM_CLASSES) {
+			//large blocks are linked into a list, such that Reset() can free those that were never returned
+			large_block* lblock = (large_block*) malloc(sizeof(large_block) + bytes);
+			if (lblock == NULL) {
+				std::cerr << "Memory allocation not successful for gate value of " << bytes << " bytes" << std::endl;
+				exit(0);
+			}
+			lblock->prev = NULL;
+			lblock->next = m_pLarge;
+			if (m_pLarge) {
+				m_pLarge->prev = lblock;
+			}
+			m_pLarge = lblock;
+			block = (BYTE*) &(lblock->head);
+		} else if (m_pFreeList[sizeclass]) {
+			block = (BYTE*) m_pFreeList[sizeclass];
+			m_pFreeList[sizeclass] = *((void**) (block + sizeof(block_header)));
+		} else {
+			block = CarveBlock(sizeof(block_header) + GetClassSize(sizeclass));
+		}
+
+		((block_header*) block)->pool = this;
+		((block_header*) block)->sizeclass = sizeclass;
+
+		if (clear) {
+			memset(block + sizeof(block_header), 0, bytes);
+		}
+		return block + sizeof(block_header);
+	}
+	;
+
+	/**
+	 Returns a block to the pool that it was allocated from.
+	 \param		ptr		block that was returned by Alloc(), may be NULL
+	 */
+	static void Free(void* ptr) {
+		if (ptr == NULL) {
+			return;
+		}
+		block_header* head = (block_header*) ((BYTE*) ptr - sizeof(block_header));
+		head->pool->Return(head);
+	}
+	;
+
+	/**
+	 Hands back all blocks at once, including those that were never freed. The slabs are kept for subsequent allocations.
+	 */
+	void Reset() {
+#ifdef DEBUGGATEVALPOOL
+		std::cout << "Resetting gate value pool with " << m_vSlabs.size() << " slabs" << std::endl;
+#endif
+		while (m_pLarge) {
+			large_block* next = m_pLarge->next;
+			free(m_pLarge);
+			m_pLarge = next;
+		}
+		memset(m_pFreeList, 0, sizeof(m_pFreeList));
+		m_nCurSlab = 0;
+		m_nSlabOffset = 0;
+	}
+	;
+
+private:
+	struct block_header {
+		GateValuePool* pool;
+		uint64_t sizeclass;
+	};
+
+	struct large_block {
+		large_block* prev;
+		large_block* next;
+		block_header head;
+	};
+
+	static uint32_t GetSizeClass(uint64_t bytes) {
+		uint32_t sizeclass = 0;
+		while (sizeclass < GATEVALPOOL_NUM_CLASSES && GetClassSize(sizeclass) < bytes) {
+			sizeclass++;
+		}
+		return sizeclass;
+	}
+	;
+
+	static uint64_t GetClassSize(uint32_t sizeclass) {
+		return ((uint64_t) 1) << (sizeclass + GATEVALPOOL_MIN_CLASS_BITS);
+	}
+	;
+
+	BYTE* CarveBlock(uint64_t len) {
+		if (m_nCurSlab < m_vSlabs.size() && m_nSlabOffset + len > GATEVALPOOL_SLAB_SIZE) {
+			m_nCurSlab++;
+			m_nSlabOffset = 0;
+		}
+		if (m_nCurSlab == m_vSlabs.size()) {
+			BYTE* slab = (BYTE*) malloc(GATEVALPOOL_SLAB_SIZE);
+			if (slab == NULL) {
+				std::cerr << "Memory allocation not successful for gate value slab" << std::endl;
+				exit(0);
+			}
+			m_vSlabs.push_back(slab);
+		}
+		BYTE* block = m_vSlabs[m_nCurSlab] + m_nSlabOffset;
+		m_nSlabOffset += len;
+		return block;
+	}
+	;
+
+	void Return(block_header* head) {
+		if (head->sizeclass == GATEVALPOOL_NUM_CLASSES) {
+			large_block* lblock = (large_block*) ((BYTE*) head - offsetof(large_block, head));
+			if (lblock->prev) {
+				lblock->prev->next = lblock->next;
+			} else {
+				m_pLarge = lblock->next;
+			}
+			if (lblock->next) {
+				lblock->next->prev = lblock->prev;
+			}
+			free(lblock);
+		} else {
+			*((void**) ((BYTE*) head + sizeof(block_header))) = m_pFreeList[head->sizeclass];
+			m_pFreeList[head->sizeclass] = head;
+		}
+	}
+	;
+
+	std::vector<BYTE*> m_vSlabs;
+	uint32_t m_nCurSlab;
+	uint64_t m_nSlabOffset;
+	void* m_pFreeList[GATEVALPOOL_NUM_CLASSES];
+	large_block* m_pLarge;
+};
+
+#endif /* __GATEVALPOOL_H_ */
@@ -0,0 +1,136 @@
+/**
+ \file 		vecchannel.h
+ \author 	michael.zohner@ec-spride.de
+ \copyright	ABY - A Framework for Efficient Mixed-protocol Secure Two-party Computation
+			Copyright (C) 2015 Engineering Cryptographic Protocols Group, TU Darmstadt
+			This program is free software: you can redistribute it and/or modify
+			it under the terms of the GNU Affero General Public License as published
+			by the Free Software Foundation, either version 3 of the License, or
+			(at your option) any later version.
+			This program is distributed in the hope that it will be useful,
+			but WITHOUT ANY WARRANTY; without even the implied warranty of
+			MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+			GNU Affero General Public License for more details.
+			You should have received a copy of the GNU Affero General Public License
+			along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief		Scatter / gather send and receive of a list of buffers on a channel
+ */
+
+#ifndef __VECCHANNEL_H_
+#define __VECCHANNEL_H_
+
+#include "../ENCRYPTO_utils/typedefs.h"
+#include "../ENCRYPTO_utils/channel.h"
+#include <vector>
+#include <assert.h>
+
+//#define DEBUGVECCHANNEL
+
+/*
+ * The buffer lists of the sending and the receiving party only agree on the total number of bytes, not on the way
+ * the bytes are split into buffers. vec_send therefore first transmits the number and the sizes of the buffers it
+ * is going to send and then hands every buffer to the channel as it is, instead of gathering the layer into one
+ * buffer first. The channel itself still copies each block into the queue of its SndThread, so this saves the
+ * gather copy in ABY, not the copy in the channel. vec_blocking_receive reads the sizes and receives every message
+ * directly into the destination buffer. Only a message that straddles two destination buffers is received into a
+ * temporary buffer and scattered afterwards.
+ * The sizes are sent in the same direction as the data and ahead of it, so they add no round trip, only
+ * 8 * (nmsgs + 1) bytes per call. Nothing is transmitted if the lists contain zero bytes in total.
+ */
+
+static inline uint64_t vec_total_bytes(std::vector<uint64_t>& bytes) {
+	uint64_t total = 0;
+	for (uint32_t i = 0; i < bytes.size(); i++) {
+		total += bytes[i];
+	}
+	return total;
+}
+
+static inline void vec_send(channel* chan, std::vector<BYTE*>& buf, std::vector<uint64_t>& bytes) {
+	std::vector<uint64_t> msgsizes;
+	for (uint32_t i = 0; i < buf.size(); i++) {
+		if (bytes[i] > 0) {
+			msgsizes.push_back(bytes[i]);
+		}
+	}
+	uint64_t nmsgs = msgsizes.size();
+	if (nmsgs == 0) {
+		return;
+	}
+
+	chan->send((uint8_t*) &nmsgs, sizeof(uint64_t));
+	chan->send((uint8_t*) msgsizes.data(), nmsgs * sizeof(uint64_t));
+	for (uint32_t i = 0; i < buf.size(); i++) {
+		if (bytes[i] > 0) {
+			chan->send(buf[i], bytes[i]);
+		}
+	}
+#ifdef DEBUGVECCHANNEL
+	std::cout << "Sent " << nmsgs << " messages with " << vec_total_bytes(bytes) << " bytes in total" << std::endl;
+#endif
+}
+
+/*
+ * Returns false without writing to buf if the sizes sent by the other party do not add up to the expected number of
+ * bytes. The channel is out of sync afterwards, the caller has to abort the evaluation.
+ */
+static inline bool vec_blocking_receive(channel* chan, std::vector<BYTE*>& buf, std::vector<uint64_t>& bytes) {
+	uint64_t total = vec_total_bytes(bytes);
+	if (total == 0) {
+		return true;
+	}
+
+	uint64_t nmsgs;
+	chan->blocking_receive((uint8_t*) &nmsgs, sizeof(uint64_t));
+	//every message holds at least one byte
+	if (nmsgs == 0 || nmsgs > total) {
+		std::cerr << "Received " << nmsgs << " messages for " << total << " bytes" << std::endl;
+		return false;
+	}
+	std::vector<uint64_t> msgsizes(nmsgs);
+	chan->blocking_receive((uint8_t*) msgsizes.data(), nmsgs * sizeof(uint64_t));
+	uint64_t msgtotal = 0;
+	for (uint64_t m = 0; m < nmsgs; m++) {
+		if (msgsizes[m] == 0 || msgsizes[m] > total - msgtotal) {
+			std::cerr << "Received message sizes that do not add up to " << total << " bytes" << std::endl;
+			return false;
+		}
+		msgtotal += msgsizes[m];
+	}
+	if (msgtotal != total) {
+		std::cerr << "Received " << msgtotal << " instead of " << total << " bytes" << std::endl;
+		return false;
+	}
+
+	//current destination buffer and the offset within it
+	uint32_t b = 0;
+	uint64_t off = 0;
+	for (uint64_t m = 0; m < nmsgs; m++) {
+		while (b < buf.size() && off == bytes[b]) {
+			b++;
+			off = 0;
+		}
+		//cannot fail since the message sizes add up to the sizes of the buffers
+		assert(b < buf.size());
+		if (msgsizes[m] <= bytes[b] - off) {
+			chan->blocking_receive(buf[b] + off, msgsizes[m]);
+			off += msgsizes[m];
+		} else {
+			uint8_t* tmpbuf = (uint8_t*) malloc(msgsizes[m]);
+			chan->blocking_receive(tmpbuf, msgsizes[m]);
+			for (uint64_t ctr = 0, len; ctr < msgsizes[m]; ctr += len) {
+				while (off == bytes[b]) {
+					b++;
+					off = 0;
+				}
+				len = std::min(msgsizes[m] - ctr, bytes[b] - off);
+				memcpy(buf[b] + off, tmpbuf + ctr, len);
+				off += len;
+			}
+			free(tmpbuf);
+		}
+	}
+	return true;
+}
+
+#endif /* __VECCHANNEL_H_ */
@@ -110,142 +110,107 @@ DGKParty::~DGKParty() {
 
 /**
  * inputs pre-allocates byte buffers for aMT calculation.
- * numMTs must be the total number of MTs and divisible by 2
+ * a,b,c are the shares of the numMTs MTs whose a and b this party encrypts under its own key.
+ * a1,b1,c1 are the shares of the numMTs1 MTs that are computed from the ciphertexts of the other party, who calls
+ * this routine with the two counts swapped. Unlike DJN, the DGK plaintext space u only fits a single masked
+ * product of 2 * sharelen + 1 bits, hence each MT needs its own ciphertext and no packing is done.
  */
-void DGKParty::preCompBench(BYTE * bA, BYTE * bB, BYTE * bC, BYTE * bA1, BYTE * bB1, BYTE * bC1, UINT numMTs, channel* chan) {
+void DGKParty::preCompBench(BYTE * bA, BYTE * bB, BYTE * bC, BYTE * bA1, BYTE * bB1, BYTE * bC1, UINT numMTs, UINT numMTs1, channel* chan) {
 	struct timespec start, end;
 
-	numMTs = numMTs / 2; // We can be both sender and receiver at the same time.
-
 	UINT shareBytes = m_nShareLength / 8;
-	UINT offset = 0;
+	uint64_t offset = 0;
 
 #if DEBUG
 	cout << "dgkbits: " << m_nDGKbits << " sharelen: " << m_nShareLength << endl;
 #endif
 
-	mpz_t r, x, y, z;
-	mpz_inits(r, x, y, z, NULL);
-
-	// shares for server part
-	mpz_t a[numMTs];
-	mpz_t b[numMTs];
-	mpz_t c[numMTs];
-
-	// shares for client part
-	mpz_t a1[numMTs];
-	mpz_t b1[numMTs];
-	mpz_t c1[numMTs];
+	gmp_randstate_t randstate;
+	initRandState(randstate);
 
-	for (UINT i = 0; i < numMTs; i++) {
-		mpz_inits(a[i], b[i], c[i], a1[i], b1[i], c1[i], NULL);
-	}
+	// the shares of one MT at a time, such that the memory does not grow with numMTs
+	mpz_t r, x, y, z, a, b, c;
+	mpz_inits(r, x, y, z, a, b, c, NULL);
 
-	//allocate buffers for mpz_t ciphertext #numMTs with m_nBuflen
-	BYTE * abuf = (BYTE*) calloc(numMTs * m_nBuflen, 1);
-	BYTE * bbuf = (BYTE*) calloc(numMTs * m_nBuflen, 1);
-	BYTE * zbuf = (BYTE*) calloc(numMTs * m_nBuflen, 1);
+	//allocate buffers for the own and the received ciphertexts with m_nBuflen each
+	BYTE * abuf = (BYTE*) calloc((uint64_t) numMTs * m_nBuflen, 1);
+	BYTE * bbuf = (BYTE*) calloc((uint64_t) numMTs * m_nBuflen, 1);
+	BYTE * abuf1 = (BYTE*) calloc((uint64_t) numMTs1 * m_nBuflen, 1);
+	BYTE * bbuf1 = (BYTE*) calloc((uint64_t) numMTs1 * m_nBuflen, 1);
+	BYTE * zbuf = (BYTE*) calloc((uint64_t) numMTs * m_nBuflen, 1);
+	BYTE * zbuf1 = (BYTE*) calloc((uint64_t) numMTs1 * m_nBuflen, 1);
 
 	clock_gettime(CLOCK_MONOTONIC, &start);
 
-	// read server a,b shares and encrypt them into buffer
+	// read own a,b shares and encrypt them into buffer
 	for (UINT i = 0; i < numMTs; i++) {
 		mpz_import(x, 1, 1, shareBytes, 0, 0, bA + i * shareBytes);
 		mpz_import(y, 1, 1, shareBytes, 0, 0, bB + i * shareBytes);
 
-		dgk_encrypt_crt(r, m_localpub, m_prv, x, m_randstate);
-		mpz_export(abuf + i * m_nBuflen, NULL, -1, 1, 1, 0, r);
-		dgk_encrypt_crt(z, m_localpub, m_prv, y, m_randstate);
-		mpz_export(bbuf + i * m_nBuflen, NULL, -1, 1, 1, 0, z);
-
+		dgk_encrypt_crt(r, m_localpub, m_prv, x, randstate);
+		mpz_export(abuf + (uint64_t) i * m_nBuflen, NULL, -1, 1, 1, 0, r);
+		dgk_encrypt_crt(z, m_localpub, m_prv, y, randstate);
+		mpz_export(bbuf + (uint64_t) i * m_nBuflen, NULL, -1, 1, 1, 0, z);
 	}
 
 	// send & receive encrypted values
-	int window = WINDOWSIZE;
-	int tosend = m_nBuflen * numMTs;
-	offset = 0;
-
-	while (tosend > 0) {
-
-		window = min(window, tosend);
-
-		chan->send(abuf + offset, window);
-		chan->blocking_receive(abuf + offset, window);
-
-		chan->send(bbuf + offset, window);
-		chan->blocking_receive(bbuf + offset, window);
-
-		tosend -= window;
-		offset += window;
-	}
+	exchangeBuffers(chan, abuf, (uint64_t) numMTs * m_nBuflen, abuf1, (uint64_t) numMTs1 * m_nBuflen);
+	exchangeBuffers(chan, bbuf, (uint64_t) numMTs * m_nBuflen, bbuf1, (uint64_t) numMTs1 * m_nBuflen);
 
 	// ----------------#############   ###############-----------------------
-	// pack ALL the packets
+	// compute the masked products for the other party's MTs
 
 	offset = 0;
 
-	//read shares from client byte arrays
-	for (UINT j = 0; j < numMTs; j++) {
-		mpz_import(a1[j], 1, 1, shareBytes, 0, 0, bA1 + offset);
-		mpz_import(b1[j], 1, 1, shareBytes, 0, 0, bB1 + offset);
+	for (UINT j = 0; j < numMTs1; j++) {
+		mpz_import(a, 1, 1, shareBytes, 0, 0, bA1 + offset);
+		mpz_import(b, 1, 1, shareBytes, 0, 0, bB1 + offset);
 
-		mpz_import(x, m_nBuflen, -1, 1, 1, 0, abuf + j * m_nBuflen);
-		mpz_import(y, m_nBuflen, -1, 1, 1, 0, bbuf + j * m_nBuflen);
+		mpz_import(x, m_nBuflen, -1, 1, 1, 0, abuf1 + (uint64_t) j * m_nBuflen);
+		mpz_import(y, m_nBuflen, -1, 1, 1, 0, bbuf1 + (uint64_t) j * m_nBuflen);
 
-		dbpowmod(c1[j], x, b1[j], y, a1[j], m_remotepub->n);
+		dbpowmod(c, x, b, y, a, m_remotepub->n);
 
 		// pick random r for masking
-		mpz_urandomb(x, m_randstate, 2 * m_nShareLength + 1);
+		mpz_urandomb(x, randstate, 2 * m_nShareLength + 1);
 
-		dgk_encrypt_fb(y, m_remotepub, x, m_randstate);
+		dgk_encrypt_fb(y, m_remotepub, x, randstate);
 
 		// "add" encrypted r and add to buffer
-		mpz_mul(z, c1[j], y);
+		mpz_mul(z, c, y);
 		mpz_mod(z, z, m_remotepub->n);
-		mpz_export(zbuf + j * m_nBuflen, NULL, -1, 1, 1, 0, z); // TODO maybe reuse abuf, but make sure it's cleaned properly
+		mpz_export(zbuf1 + (uint64_t) j * m_nBuflen, NULL, -1, 1, 1, 0, z);
 
-		mpz_mul(c1[j], a1[j], b1[j]); //c = a * b
-		mpz_sub(c1[j], c1[j], x); // c = c - x
-		mpz_mod_2exp(c1[j], c1[j], m_nShareLength); // c = c mod 2^shareLength
+		mpz_mul(c, a, b); //c = a * b
+		mpz_sub(c, c, x); // c = c - x
+		mpz_mod_2exp(c, c, m_nShareLength); // c = c mod 2^shareLength
 
-		mpz_export(bC1 + offset, NULL, 1, shareBytes, 0, 0, c1[j]);
+		mpz_export(bC1 + offset, NULL, 1, shareBytes, 0, 0, c);
 
 		offset += shareBytes;
 	}
 
 // ----------------#############   ###############-----------------------
-// all packets packed. exchange these packets
-
-	window = WINDOWSIZE;
-	tosend = m_nBuflen * numMTs;
-	offset = 0;
+// exchange the masked products
 
-	while (tosend > 0) {
-		window = min(window, tosend);
+	exchangeBuffers(chan, zbuf1, (uint64_t) numMTs1 * m_nBuflen, zbuf, (uint64_t) numMTs * m_nBuflen);
 
-		chan->send(zbuf + offset, window);
-		chan->blocking_receive(zbuf + offset, window);
-
-		tosend -= window;
-		offset += window;
-	}
-
-//calculate server c shares
+//calculate own c shares
 
 	offset = 0;
 
 	for (UINT i = 0; i < numMTs; i++) {
 
-		mpz_import(r, m_nBuflen, -1, 1, 1, 0, zbuf + i * m_nBuflen);
+		mpz_import(r, m_nBuflen, -1, 1, 1, 0, zbuf + (uint64_t) i * m_nBuflen);
 		dgk_decrypt(r, m_localpub, m_prv, r);
 
-		mpz_import(a[i], 1, 1, shareBytes, 0, 0, bA + offset);
-		mpz_import(b[i], 1, 1, shareBytes, 0, 0, bB + offset);
+		mpz_import(a, 1, 1, shareBytes, 0, 0, bA + offset);
+		mpz_import(b, 1, 1, shareBytes, 0, 0, bB + offset);
 
-		mpz_mod_2exp(c[i], r, m_nShareLength); // c = x mod 2^shareLength == read the share from least significant bits
-		mpz_addmul(c[i], a[i], b[i]); //c = a*b + c
-		mpz_mod_2exp(c[i], c[i], m_nShareLength); // c = c mod 2^shareLength
-		mpz_export(bC + offset, NULL, 1, shareBytes, 0, 0, c[i]);
+		mpz_mod_2exp(c, r, m_nShareLength); // c = x mod 2^shareLength == read the share from least significant bits
+		mpz_addmul(c, a, b); //c = a*b + c
+		mpz_mod_2exp(c, c, m_nShareLength); // c = c mod 2^shareLength
+		mpz_export(bC + offset, NULL, 1, shareBytes, 0, 0, c);
 		offset += shareBytes;
 
 	}
@@ -256,18 +221,17 @@ void DGKParty::preCompBench(BYTE * bA, BYTE * bB, BYTE * bC, BYTE * bA1, BYTE *
 	mpz_t ai, bi, ci, ai1, bi1, ci1, ta, tb;
 	mpz_inits(ai, bi, ci, ai1, bi1, ci1, ta, tb, NULL);
 
-	chan->send(bA, numMTs * shareBytes);
-	chan->blocking_receive(bA, numMTs * shareBytes);
-	chan->send(bB, numMTs * shareBytes);
-	chan->blocking_receive(bB, numMTs * shareBytes);
-	chan->send(bC, numMTs * shareBytes);
-	chan->blocking_receive(bC, numMTs * shareBytes);
+	// the other party's own shares belong to the MTs of a1,b1,c1
+	BYTE* chkbuf = (BYTE*) malloc(3 * (uint64_t) numMTs1 * shareBytes);
+	exchangeBuffers(chan, bA, (uint64_t) numMTs * shareBytes, chkbuf, (uint64_t) numMTs1 * shareBytes);
+	exchangeBuffers(chan, bB, (uint64_t) numMTs * shareBytes, chkbuf + numMTs1 * shareBytes, (uint64_t) numMTs1 * shareBytes);
+	exchangeBuffers(chan, bC, (uint64_t) numMTs * shareBytes, chkbuf + 2 * numMTs1 * shareBytes, (uint64_t) numMTs1 * shareBytes);
 
-	for (UINT i = 0; i < numMTs; i++) {
+	for (UINT i = 0; i < numMTs1; i++) {
 
-		mpz_import(ai, 1, 1, shareBytes, 0, 0, bA + i * shareBytes);
-		mpz_import(bi, 1, 1, shareBytes, 0, 0, bB + i * shareBytes);
-		mpz_import(ci, 1, 1, shareBytes, 0, 0, bC + i * shareBytes);
+		mpz_import(ai, 1, 1, shareBytes, 0, 0, chkbuf + i * shareBytes);
+		mpz_import(bi, 1, 1, shareBytes, 0, 0, chkbuf + (numMTs1 + i) * shareBytes);
+		mpz_import(ci, 1, 1, shareBytes, 0, 0, chkbuf + (2 * numMTs1 + i) * shareBytes);
 
 		mpz_import(ai1, 1, 1, shareBytes, 0, 0, bA1 + i * shareBytes);
 		mpz_import(bi1, 1, 1, shareBytes, 0, 0, bB1 + i * shareBytes);
@@ -285,25 +249,62 @@ void DGKParty::preCompBench(BYTE * bA, BYTE * bB, BYTE * bC, BYTE * bA1, BYTE *
 		} else {
 			cout << "Error in MT - i:" << i << "| " << ai << " " << bi << " " << ci << " . " << ai1 << " " << bi1 << " " << ci1 << endl;
 		}
-
-		//cout << (mpz_cmp(c1[i], a1[i]) == 0 ? "MT is fine." : "Error in MT!") << endl;
 	}
+	free(chkbuf);
 	mpz_clears(ai, bi, ci, ai1, bi1, ci1, ta, tb, NULL);
 #endif
 
 	clock_gettime(CLOCK_MONOTONIC, &end);
-	printf("generating 2x %u MTs took %f\n", numMTs, getMillies(start, end));
+#ifndef BATCH
+	printf("generating %u + %u MTs took %f\n", numMTs, numMTs1, getMillies(start, end));
+#endif
 
 //clean up after ourselves
-	for (UINT i = 0; i < numMTs; i++) {
-		mpz_clears(a[i], b[i], c[i], a1[i], b1[i], c1[i], NULL);
-	}
-
-	mpz_clears(r, x, y, z, NULL);
+	mpz_clears(r, x, y, z, a, b, c, NULL);
+	gmp_randclear(randstate);
 
 	free(abuf);
 	free(bbuf);
+	free(abuf1);
+	free(bbuf1);
 	free(zbuf);
+	free(zbuf1);
+}
+
+/**
+ * seeds a fresh PRNG state for one thread from m_randstate
+ */
+void DGKParty::initRandState(gmp_randstate_t state) {
+	mpz_t seed;
+	mpz_init(seed);
+
+	m_lock.Lock();
+	mpz_urandomb(seed, m_randstate, 128);
+	m_lock.Unlock();
+
+	gmp_randinit_default(state);
+	gmp_randseed(state, seed);
+	mpz_clear(seed);
+}
+
+/**
+ * sends sndlen bytes and receives rcvlen bytes, both split into windows of at most WINDOWSIZE bytes
+ */
+void DGKParty::exchangeBuffers(channel* chan, BYTE* sndbuf, uint64_t sndlen, BYTE* rcvbuf, uint64_t rcvlen) {
+	uint64_t window, sent = 0, rcvd = 0;
+
+	while (sent < sndlen || rcvd < rcvlen) {
+		if (sent < sndlen) {
+			window = min((uint64_t) WINDOWSIZE, sndlen - sent);
+			chan->send(sndbuf + sent, window);
+			sent += window;
+		}
+		if (rcvd < rcvlen) {
+			window = min((uint64_t) WINDOWSIZE, rcvlen - rcvd);
+			chan->blocking_receive(rcvbuf + rcvd, window);
+			rcvd += window;
+		}
+	}
 }
 
 /**
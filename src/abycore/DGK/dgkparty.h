@@ -26,6 +26,7 @@
 #include "../ENCRYPTO_utils/crypto/dgk.h"
 #include "../ENCRYPTO_utils/powmod.h"
 #include "../ENCRYPTO_utils/channel.h"
+#include "../ENCRYPTO_utils/thread.h"
 
 using namespace std;
 
@@ -37,7 +38,7 @@ public:
 
 	void keyExchange(channel* chan);
 
-	void preCompBench(BYTE * bA, BYTE * bB, BYTE * bC, BYTE * bA1, BYTE * bB1, BYTE * bC1, UINT numMTs, channel* chan);
+	void preCompBench(BYTE * bA, BYTE * bB, BYTE * bC, BYTE * bA1, BYTE * bB1, BYTE * bC1, UINT numMTs, UINT numMTs1, channel* chan);
 
 	void readKey();
 
@@ -55,10 +56,14 @@ private:
 	dgk_pubkey_t *m_localpub, *m_remotepub;
 	dgk_prvkey_t *m_prv;
 	gmp_randstate_t m_randstate;
+	CLock m_lock; // guards m_randstate, from which each call of preCompBench seeds its own state
 
 	void benchPreCompPacking1(channel* chan, BYTE * buf, UINT packlen, UINT numshares, mpz_t * a, mpz_t * b, mpz_t * c, mpz_t * a1, mpz_t * b1, mpz_t * c1, mpz_t r, mpz_t x,
 			mpz_t y, mpz_t z);
 
+	void initRandState(gmp_randstate_t state);
+	void exchangeBuffers(channel* chan, BYTE* sndbuf, uint64_t sndlen, BYTE* rcvbuf, uint64_t rcvlen);
+
 	void sendmpz_t(mpz_t t, channel* chan, BYTE * buf);
 	void receivempz_t(mpz_t t, channel* chan, BYTE * buf);
 
@@ -89,34 +89,39 @@ DJNParty::~DJNParty() {
 
 /**
  * inputs pre-allocates byte buffers for aMT calculation.
- * numMTs must be the total number of MTs and divisible by 2
+ * a,b,c are the shares of the numMTs MTs whose a and b this party encrypts under its own key.
+ * a1,b1,c1 are the shares of the numMTs1 MTs that are computed from the ciphertexts of the other party, who calls
+ * this routine with the two counts swapped. Each call seeds its own PRNG, such that several threads can generate MTs
+ * with the same DJNParty on distinct channels.
  */
-void DJNParty::preCompBench(BYTE * bA, BYTE * bB, BYTE * bC, BYTE * bA1, BYTE * bB1, BYTE * bC1, UINT numMTs, channel* chan) {
+void DJNParty::preCompBench(BYTE * bA, BYTE * bB, BYTE * bC, BYTE * bA1, BYTE * bB1, BYTE * bC1, UINT numMTs, UINT numMTs1, channel* chan) {
 	struct timespec start, end;
 
-	numMTs = numMTs / 2; // We can be both sender and receiver at the same time.
-
 	UINT maxShareLen = 2 * m_nShareLength + 41; // length of one share in the packet, sigma = 40
-	UINT packshares = m_nDJNbits / maxShareLen; // number of shares in one packet
-	UINT numpacks = (numMTs + packshares - 1) / packshares; // total number of packets to send in order to generate numMTs = CEIL(numMTs/2*numshares)
+	// number of shares in one packet, such that the packed shares plus the mask stay below the plaintext modulus n
+	UINT packshares = (m_nDJNbits - 2) / maxShareLen;
+	UINT numpacks = ceil_divide(numMTs, packshares); // packets that are received for the own MTs
+	UINT numpacks1 = ceil_divide(numMTs1, packshares); // packets that are sent for the MTs of the other party
 
 	UINT shareBytes = m_nShareLength / 8;
-	UINT offset = 0;
-	UINT limit = packshares; // upper bound for a package shares, used to handle non-full last packages / alignment
+	uint64_t offset = 0;
+	UINT limit; // number of shares in a package, which is smaller than packshares for the last one
 
 #if DEBUG
 	cout << "djnbits: " << m_nDJNbits << " sharelen: " << m_nShareLength << " packlen: " << maxShareLen << " numshares: " << packshares << " numpacks: " << numpacks << endl;
 #endif
 
+	gmp_randstate_t randstate;
+	initRandState(randstate);
+
 	mpz_t r, x, y, z;
 	mpz_inits(r, x, y, z, NULL);
 
-	// shares for server part
+	// shares of one packet, reused for all packets
 	mpz_t a[packshares];
 	mpz_t b[packshares];
 	mpz_t c[packshares];
 
-	// shares for client part
 	mpz_t a1[packshares];
 	mpz_t b1[packshares];
 	mpz_t c1[packshares];
@@ -125,61 +130,45 @@ void DJNParty::preCompBench(BYTE * bA, BYTE * bB, BYTE * bC, BYTE * bA1, BYTE *
 		mpz_inits(a[i], b[i], c[i], a1[i], b1[i], c1[i], NULL);
 	}
 
-	//allocate buffers for mpz_t ciphertext #numMTs with m_nBuflen
-	BYTE * abuf = (BYTE*) calloc(numMTs * m_nBuflen, 1);
-	BYTE * bbuf = (BYTE*) calloc(numMTs * m_nBuflen, 1);
-	BYTE * zbuf = (BYTE*) calloc(numpacks * m_nBuflen, 1);
+	//allocate buffers for the own and the received ciphertexts with m_nBuflen each
+	BYTE * abuf = (BYTE*) calloc((uint64_t) numMTs * m_nBuflen, 1);
+	BYTE * bbuf = (BYTE*) calloc((uint64_t) numMTs * m_nBuflen, 1);
+	BYTE * abuf1 = (BYTE*) calloc((uint64_t) numMTs1 * m_nBuflen, 1);
+	BYTE * bbuf1 = (BYTE*) calloc((uint64_t) numMTs1 * m_nBuflen, 1);
+	BYTE * zbuf = (BYTE*) calloc((uint64_t) numpacks * m_nBuflen, 1);
+	BYTE * zbuf1 = (BYTE*) calloc((uint64_t) numpacks1 * m_nBuflen, 1);
 
 	clock_gettime(CLOCK_MONOTONIC, &start);
 
-	// read server a,b shares and encrypt them into buffer
+	// read own a,b shares and encrypt them into buffer
 	for (UINT i = 0; i < numMTs; i++) {
 		mpz_import(x, 1, 1, shareBytes, 0, 0, bA + i * shareBytes);
 		mpz_import(y, 1, 1, shareBytes, 0, 0, bB + i * shareBytes);
 
-		djn_encrypt_crt(r, m_localpub, m_prv, x, m_randstate);
-		mpz_export(abuf + i * m_nBuflen, NULL, -1, 1, 1, 0, r);
-		djn_encrypt_crt(z, m_localpub, m_prv, y, m_randstate);
-		mpz_export(bbuf + i * m_nBuflen, NULL, -1, 1, 1, 0, z);
-
+		djn_encrypt_crt(r, m_localpub, m_prv, x, randstate);
+		mpz_export(abuf + (uint64_t) i * m_nBuflen, NULL, -1, 1, 1, 0, r);
+		djn_encrypt_crt(z, m_localpub, m_prv, y, randstate);
+		mpz_export(bbuf + (uint64_t) i * m_nBuflen, NULL, -1, 1, 1, 0, z);
 	}
 
 	// send & receive encrypted values
-	int window = WINDOWSIZE;
-	int tosend = m_nBuflen * numMTs;
-	offset = 0;
-
-	while (tosend > 0) {
-
-		window = min(window, tosend);
-
-		chan->send(abuf + offset, window);
-		chan->blocking_receive(abuf + offset, window);
-
-		chan->send(bbuf + offset, window);
-		chan->blocking_receive(bbuf + offset, window);
-
-		tosend -= window;
-		offset += window;
-	}
+	exchangeBuffers(chan, abuf, (uint64_t) numMTs * m_nBuflen, abuf1, (uint64_t) numMTs1 * m_nBuflen);
+	exchangeBuffers(chan, bbuf, (uint64_t) numMTs * m_nBuflen, bbuf1, (uint64_t) numMTs1 * m_nBuflen);
 
 	// ----------------#############   ###############-----------------------
 	// pack ALL the packets
 
 	offset = 0;
-	for (UINT i = 0; i < numpacks; i++) {
+	for (UINT i = 0; i < numpacks1; i++) {
+		limit = min(packshares, numMTs1 - i * packshares);
 
-		if (i == numpacks - 1) {
-			limit = numMTs % packshares; // if last package, only fill buffers to requested size and discard remaining shares
-		}
-
-		//read shares from client byte arrays
+		//read shares of the other party's MTs
 		for (UINT j = 0; j < limit; j++) {
 			mpz_import(a1[j], 1, 1, shareBytes, 0, 0, bA1 + offset);
 			mpz_import(b1[j], 1, 1, shareBytes, 0, 0, bB1 + offset);
 
-			mpz_import(x, m_nBuflen, -1, 1, 1, 0, abuf + (j + i * packshares) * m_nBuflen);
-			mpz_import(y, m_nBuflen, -1, 1, 1, 0, bbuf + (j + i * packshares) * m_nBuflen);
+			mpz_import(x, m_nBuflen, -1, 1, 1, 0, abuf1 + (uint64_t) (j + i * packshares) * m_nBuflen);
+			mpz_import(y, m_nBuflen, -1, 1, 1, 0, bbuf1 + (uint64_t) (j + i * packshares) * m_nBuflen);
 
 			dbpowmod(c1[j], x, b1[j], y, a1[j], m_remotepub->n_squared); //double base exponentiation
 			offset += shareBytes;
@@ -196,19 +185,19 @@ void DJNParty::preCompBench(BYTE * bA, BYTE * bB, BYTE * bC, BYTE * bA1, BYTE *
 			mpz_mod(z, z, m_remotepub->n_squared);
 		}
 
-		// pick random r for masking
-		mpz_urandomm(x, m_randstate, m_remotepub->n);
-		djn_encrypt_fb(y, m_remotepub, x, m_randstate);
+		// pick random r for masking, sigma bits longer than each share, but not longer than the packet
+		mpz_urandomb(x, randstate, limit * maxShareLen);
+		djn_encrypt_fb(y, m_remotepub, x, randstate);
 
 		// "add" encrypted r and add to buffer
 		mpz_mul(z, z, y);
 		mpz_mod(z, z, m_remotepub->n_squared);
 
-		mpz_export(zbuf + i * m_nBuflen, NULL, -1, 1, 1, 0, z); // TODO maybe reuse abuf, but make sure it's cleaned properly
+		mpz_export(zbuf1 + (uint64_t) i * m_nBuflen, NULL, -1, 1, 1, 0, z);
 
 		offset -= shareBytes * limit;
 
-		// calculate c shares for client part
+		// calculate c shares for the other party's MTs
 		for (UINT j = 0; j < limit; j++) {
 			mpz_mod_2exp(y, x, m_nShareLength); // y = r mod 2^shareLength == read the share from least significant bits
 			mpz_div_2exp(x, x, maxShareLen); // r = r >> maxShareLen
@@ -226,31 +215,15 @@ void DJNParty::preCompBench(BYTE * bA, BYTE * bB, BYTE * bC, BYTE * bA1, BYTE *
 	// ----------------#############   ###############-----------------------
 	// all packets packed. exchange these packets
 
-	window = WINDOWSIZE;
-	tosend = m_nBuflen * numpacks;
-	offset = 0;
-
-	while (tosend > 0) {
-		window = min(window, tosend);
-
-		chan->send(zbuf + offset, window);
-		chan->blocking_receive(zbuf + offset, window);
-
-		tosend -= window;
-		offset += window;
-	}
+	exchangeBuffers(chan, zbuf1, (uint64_t) numpacks1 * m_nBuflen, zbuf, (uint64_t) numpacks * m_nBuflen);
 
-	//unpack and calculate server c shares
-	limit = packshares;
+	//unpack and calculate own c shares
 	offset = 0;
 
 	for (UINT i = 0; i < numpacks; i++) {
+		limit = min(packshares, numMTs - i * packshares);
 
-		if (i == numpacks - 1) {
-			limit = numMTs % packshares; // if last package, only fill buffers to requested size and discard remaining shares
-		}
-
-		mpz_import(r, m_nBuflen, -1, 1, 1, 0, zbuf + i * m_nBuflen);
+		mpz_import(r, m_nBuflen, -1, 1, 1, 0, zbuf + (uint64_t) i * m_nBuflen);
 
 		djn_decrypt(r, m_localpub, m_prv, r);
 
@@ -273,18 +246,17 @@ void DJNParty::preCompBench(BYTE * bA, BYTE * bB, BYTE * bC, BYTE * bA1, BYTE *
 	mpz_t ai, bi, ci, ai1, bi1, ci1, ta, tb;
 	mpz_inits(ai, bi, ci, ai1, bi1, ci1, ta, tb, NULL);
 
-	chan->send(bA, numMTs * shareBytes);
-	chan->blocking_receive(bA, numMTs * shareBytes);
-	chan->send(bB, numMTs * shareBytes);
-	chan->blocking_receive(bB, numMTs * shareBytes);
-	chan->send(bC, numMTs * shareBytes);
-	chan->blocking_receive(bC, numMTs * shareBytes);
+	// the other party's own shares belong to the MTs of a1,b1,c1
+	BYTE* chkbuf = (BYTE*) malloc(3 * (uint64_t) numMTs1 * shareBytes);
+	exchangeBuffers(chan, bA, (uint64_t) numMTs * shareBytes, chkbuf, (uint64_t) numMTs1 * shareBytes);
+	exchangeBuffers(chan, bB, (uint64_t) numMTs * shareBytes, chkbuf + numMTs1 * shareBytes, (uint64_t) numMTs1 * shareBytes);
+	exchangeBuffers(chan, bC, (uint64_t) numMTs * shareBytes, chkbuf + 2 * numMTs1 * shareBytes, (uint64_t) numMTs1 * shareBytes);
 
-	for (UINT i = 0; i < numMTs; i++) {
+	for (UINT i = 0; i < numMTs1; i++) {
 
-		mpz_import(ai, 1, 1, shareBytes, 0, 0, bA + i * shareBytes);
-		mpz_import(bi, 1, 1, shareBytes, 0, 0, bB + i * shareBytes);
-		mpz_import(ci, 1, 1, shareBytes, 0, 0, bC + i * shareBytes);
+		mpz_import(ai, 1, 1, shareBytes, 0, 0, chkbuf + i * shareBytes);
+		mpz_import(bi, 1, 1, shareBytes, 0, 0, chkbuf + (numMTs1 + i) * shareBytes);
+		mpz_import(ci, 1, 1, shareBytes, 0, 0, chkbuf + (2 * numMTs1 + i) * shareBytes);
 
 		mpz_import(ai1, 1, 1, shareBytes, 0, 0, bA1 + i * shareBytes);
 		mpz_import(bi1, 1, 1, shareBytes, 0, 0, bB1 + i * shareBytes);
@@ -302,14 +274,15 @@ void DJNParty::preCompBench(BYTE * bA, BYTE * bB, BYTE * bC, BYTE * bA1, BYTE *
 		} else {
 			cout << "Error in MT - i:" << i << "| " << ai << " " << bi << " " << ci << " . " << ai1 << " " << bi1 << " " << ci1 << endl;
 		}
-
-		//cout << (mpz_cmp(c1[i], a1[i]) == 0 ? "MT is fine." : "Error in MT!") << endl;
 	}
+	free(chkbuf);
 	mpz_clears(ai, bi, ci, ai1, bi1, ci1, ta, tb, NULL);
 #endif
 
 	clock_gettime(CLOCK_MONOTONIC, &end);
-	printf("generating 2x %u MTs took %f\n", numMTs, getMillies(start, end));
+#ifndef BATCH
+	printf("generating %u + %u MTs took %f\n", numMTs, numMTs1, getMillies(start, end));
+#endif
 
 //clean up after ourselves
 	for (UINT i = 0; i < packshares; i++) {
@@ -317,10 +290,50 @@ void DJNParty::preCompBench(BYTE * bA, BYTE * bB, BYTE * bC, BYTE * bA1, BYTE *
 	}
 
 	mpz_clears(r, x, y, z, NULL);
+	gmp_randclear(randstate);
 
 	free(abuf);
 	free(bbuf);
+	free(abuf1);
+	free(bbuf1);
 	free(zbuf);
+	free(zbuf1);
+}
+
+/**
+ * seeds a fresh PRNG state from m_randstate, which is shared by all threads that use this party
+ */
+void DJNParty::initRandState(gmp_randstate_t state) {
+	mpz_t seed;
+	mpz_init(seed);
+
+	m_lock.Lock();
+	mpz_urandomb(seed, m_randstate, 128);
+	m_lock.Unlock();
+
+	gmp_randinit_default(state);
+	gmp_randseed(state, seed);
+	mpz_clear(seed);
+}
+
+/**
+ * sends sndlen bytes and receives rcvlen bytes in interleaved windows of at most WINDOWSIZE bytes
+ */
+void DJNParty::exchangeBuffers(channel* chan, BYTE* sndbuf, uint64_t sndlen, BYTE* rcvbuf, uint64_t rcvlen) {
+	uint64_t window, sent = 0, rcvd = 0;
+
+	while (sent < sndlen || rcvd < rcvlen) {
+		if (sent < sndlen) {
+			window = min((uint64_t) WINDOWSIZE, sndlen - sent);
+			chan->send(sndbuf + sent, window);
+			sent += window;
+		}
+		if (rcvd < rcvlen) {
+			window = min((uint64_t) WINDOWSIZE, rcvlen - rcvd);
+			chan->blocking_receive(rcvbuf + rcvd, window);
+			rcvd += window;
+		}
+	}
 }
 
 /**
@@ -30,13 +30,25 @@ using namespace std;
 
 
 ABYParty::ABYParty(e_role pid, char* addr, uint16_t port, seclvl seclvl, uint32_t bitlen, uint32_t nthreads, e_mt_gen_alg mg_algo, uint32_t maxgates) {
-	StartWatch("Initialization", P_INIT);
+	m_cAddress = addr;
+	m_nPort = port;
+	InitParty(pid, seclvl, bitlen, nthreads, mg_algo, maxgates, NULL);
+}
+
+ABYParty::ABYParty(e_role pid, vector<CSocket*>& sockets, seclvl seclvl, uint32_t bitlen, uint32_t nthreads, e_mt_gen_alg mg_algo, uint32_t maxgates) {
+	m_cAddress = NULL;
+	m_nPort = 0;
+	InitParty(pid, seclvl, bitlen, nthreads, mg_algo, maxgates, &sockets);
+}
+
+void ABYParty::InitParty(e_role pid, seclvl seclvl, uint32_t bitlen, uint32_t nthreads, e_mt_gen_alg mg_algo, uint32_t maxgates,
+		vector<CSocket*>* sockets) {
+	memset(m_vPhases, 0, sizeof(m_vPhases));
+	StartPhase("Initialization", P_INIT);
 
 	m_eRole = pid;
 	//cout << "m_eRole = " << m_eRole << endl;
 
-	m_cAddress = addr;
-	m_nPort = port;
 	m_sSecLvl = seclvl;
 
 	m_eMTGenAlg = mg_algo;
@@ -52,42 +64,45 @@ ABYParty::ABYParty(e_role pid, char* addr, uint16_t port, seclvl seclvl, uint32_
 #endif
 
 	Init();
+	if (sockets) {
+		assert(sockets->size() == m_vSockets.size());
+		m_vSockets = *sockets;
+	}
 
 	m_pCircuit = NULL;
-	StopWatch("Time for initiatlization: ", P_INIT);
+	StopPhase("Time for initiatlization: ", P_INIT);
 
 #ifndef BATCH
 	cout << "Generating circuit" << endl;
 #endif
-	StartWatch("Generating circuit", P_CIRCUIT);
+	StartPhase("Generating circuit", P_CIRCUIT);
 	if (!InitCircuit(bitlen, maxgates)) {
 		cout << "There was an while initializing the circuit, ending! " << endl;
 		exit(0);
 	}
-	StopWatch("Time for circuit generation: ", P_CIRCUIT);
+	StopPhase("Time for circuit generation: ", P_CIRCUIT);
 
 #ifndef BATCH
 	cout << "Establishing network connection" << endl;
 #endif
 	//Establish network connection
-	StartWatch("Establishing network connection: ", P_NETWORK);
-	if (!EstablishConnection()) {
+	StartPhase("Establishing network connection: ", P_NETWORK);
+	if (!EstablishConnection(sockets != NULL)) {
 		cout << "There was an error during establish connection, ending! " << endl;
 		exit(0);
 	}
-	StopWatch("Time for network connect: ", P_NETWORK);
+	StopPhase("Time for network connect: ", P_NETWORK);
 
 #ifndef BATCH
 	cout << "Performing base OTs" << endl;
 #endif
 	/* Pre-Compute Naor-Pinkas base OTs by starting two threads */
-	StartRecording("Starting NP OT", P_BASE_OT, m_vSockets);
+	StartPhase("Starting NP OT", P_BASE_OT, TRUE);
 	m_pSetup->PrepareSetupPhase(m_tComm);
-	StopRecording("Time for NP OT: ", P_BASE_OT, m_vSockets);
+	StopPhase("Time for NP OT: ", P_BASE_OT, TRUE);
 }
 
 ABYParty::~ABYParty() {
-	m_vSharings[S_BOOL]->PreCompFileDelete();
 	Cleanup();
 }
 
@@ -107,14 +122,36 @@ BOOL ABYParty::Init() {
 		m_vThreads[i]->Start();
 	}
 
+	//the first of the threads that evaluate sharings concurrently is the main thread
+	for (uint32_t i = 1; i < min(m_nNumOTThreads, (uint32_t) S_LAST); i++) {
+		m_vEvalThreads.push_back(new CPartyWorkerThread(i, this));
+		m_vEvalThreads.back()->Start();
+	}
+	m_nNextEvalGroup = 0;
+	m_nEvalDepth = 0;
+
 	m_nMyNumInBits = 0;
 
+	m_bPipelinedOnline = FALSE;
+	m_pPhaseScheduler = NULL;
+	m_pTriplePool = NULL;
+
+	m_bOptimizeCircuit = FALSE;
+	m_bCircuitOptimized = FALSE;
+	memset(&m_sOptStats, 0, sizeof(circ_opt_stats));
+	m_nRebalanceSharings = 0;
+	m_nPipeRcvPosted = 0;
+	m_nPipeRcvDone = 0;
+
 	m_tComm = (comm_ctx*) malloc(sizeof(comm_ctx));
 
 	return TRUE;
 }
 
 void ABYParty::Cleanup() {
+	//the pool generates its MTs with the setup and ends its rounds with the other party
+	if (m_pTriplePool)
+		delete m_pTriplePool;
 	if (m_pSetup)
 		delete m_pSetup;
 
@@ -141,6 +178,11 @@ void ABYParty::Cleanup() {
 		m_vThreads[i]->Wait();
 		delete m_vThreads[i];
 	}
+	for (uint32_t i = 0; i < m_vEvalThreads.size(); i++) {
+		m_vEvalThreads[i]->PutJob(e_Party_Stop);
+		m_vEvalThreads[i]->Wait();
+		delete m_vEvalThreads[i];
+	}
 
 	delete m_tComm->snd_std;
 	delete m_tComm->snd_inv;
@@ -163,10 +205,24 @@ CBitVector ABYParty::ExecCircuit() {
 #endif
 
 	CBitVector result;
-	StartRecording("Starting execution", P_TOTAL, m_vSockets);
+	m_cStats.Reset(m_vSharings.size());
+	if (m_pTriplePool) {
+		m_pTriplePool->Pause();
+	}
+
+	if ((m_bOptimizeCircuit || m_nRebalanceSharings) && !m_bCircuitOptimized) {
+		OptimizeCircuit();
+	}
+	m_cStats.SetOptimization(m_sOptStats.nfolded, m_sOptStats.nmerged, m_sOptStats.nremoved, m_sOptStats.nandsbefore,
+			m_sOptStats.nandsafter);
+	m_cStats.SetRebalancing(m_sOptStats.nrebalanced, m_sOptStats.ndepthbefore, m_sOptStats.ndepthafter);
+	StartPhase("Starting execution", P_TOTAL, TRUE);
 
 	//Setup phase
-	StartRecording("Starting setup phase: ", P_SETUP, m_vSockets);
+	if (m_pPhaseScheduler) {
+		m_pPhaseScheduler->EnterPhase(P_SETUP);
+	}
+	StartPhase("Starting setup phase: ", P_SETUP, TRUE);
 	for (uint32_t i = 0; i < m_vSharings.size(); i++) {
 #ifndef BATCH
 		cout << "Preparing setup phase for " << m_vSharings[i]->sharing_type() << " sharing" << endl;
@@ -177,16 +233,17 @@ CBitVector ABYParty::ExecCircuit() {
 #ifndef BATCH
 	cout << "Preforming OT extension" << endl;
 #endif
-	StartRecording("Starting OT Extension", P_OT_EXT, m_vSockets);
+	StartPhase("Starting OT Extension", P_OT_EXT, TRUE);
 	m_pSetup->PerformSetupPhase();
-	StopRecording("Time for OT Extension phase: ", P_OT_EXT, m_vSockets);
+	StopPhase("Time for OT Extension phase: ", P_OT_EXT, TRUE);
+	m_cStats.SetNumOTs(m_pSetup->GetNumIKNPOTs(), m_pSetup->GetNumKKOTs(), m_pSetup->GetNumPKMTs());
 
 	for (uint32_t i = 0; i < m_vSharings.size(); i++) {
 #ifndef BATCH
 		cout << "Performing setup phase for " << m_vSharings[i]->sharing_type() << " sharing" << endl;
 #endif
 		if(i == S_YAO) {
-			StartWatch("Starting Circuit Garbling", P_GARBLE);
+			StartPhase("Starting Circuit Garbling", P_GARBLE);
 			if(m_eRole == SERVER) {
 				m_vSharings[S_YAO]->PerformSetupPhase(m_pSetup);
 				m_vSharings[S_YAO_REV]->PerformSetupPhase(m_pSetup);
@@ -198,7 +255,7 @@ CBitVector ABYParty::ExecCircuit() {
 			m_vSharings[S_YAO_REV]->PerformSetupPhase(m_pSetup);*/
 			m_vSharings[S_YAO]->FinishSetupPhase(m_pSetup);
 			m_vSharings[S_YAO_REV]->FinishSetupPhase(m_pSetup);
-			StopWatch("Time for Circuit garbling: ", P_GARBLE);
+			StopPhase("Time for Circuit garbling: ", P_GARBLE);
 		} else if (i == S_YAO_REV) {
 			//Do nothing, was done in parallel to Yao
 		} else {
@@ -207,21 +264,42 @@ CBitVector ABYParty::ExecCircuit() {
 		}
 
 	}
-	StopRecording("Time for setup phase: ", P_SETUP, m_vSockets);
+	StopPhase("Time for setup phase: ", P_SETUP, TRUE);
+	if (m_pPhaseScheduler) {
+		m_pPhaseScheduler->LeavePhase(P_SETUP);
+	}
 
 #ifndef BATCH
 	cout << "Evaluating circuit" << endl;
 #endif
 
-	//Online phase
-	if(m_vSharings[S_BOOL]->GetPreCompPhaseValue() != ePreCompStore) {
-		StartRecording("Starting online phase: ", P_ONLINE, m_vSockets);
+	//Online phase, which is skipped if the setup values of any sharing were only stored for a later execution
+	BOOL precompstore = FALSE;
+	for (uint32_t i = 0; i < m_vSharings.size(); i++) {
+		precompstore |= m_vSharings[i]->GetPreCompPhaseValue() == ePreCompStore;
+	}
+	if(!precompstore) {
+		if (m_pPhaseScheduler) {
+			m_pPhaseScheduler->EnterPhase(P_ONLINE);
+		}
+		StartPhase("Starting online phase: ", P_ONLINE, TRUE);
 		EvaluateCircuit();
-		StopRecording("Time for online phase: ", P_ONLINE, m_vSockets);
+		StopPhase("Time for online phase: ", P_ONLINE, TRUE);
+		if (m_pPhaseScheduler) {
+			m_pPhaseScheduler->LeavePhase(P_ONLINE);
+		}
 	}
 
 
-	StopRecording("Total Time: ", P_TOTAL, m_vSockets);
+	StopPhase("Total Time: ", P_TOTAL, TRUE);
+
+	for (uint32_t i = 0; i < m_vSharings.size(); i++) {
+		m_cStats.GetSharingStats(i).nnonlinops = m_vSharings[i]->GetNumNonLinearOperations();
+		m_cStats.GetSharingStats(i).plannedbytes = m_vSharings[i]->GetPlannedGateBufferBytes();
+	}
+	for (uint32_t i = P_FIRST; i <= P_LAST; i++) {
+		m_cStats.SetPhase((ABYPHASE) i, GetTiming((ABYPHASE) i), GetSentData((ABYPHASE) i), GetReceivedData((ABYPHASE) i));
+	}
 
 #ifdef PRINT_OUTPUT
 	//Print input and output gates
@@ -236,13 +314,55 @@ CBitVector ABYParty::ExecCircuit() {
 	return result;
 }
 
+void ABYParty::SetPreCompPhaseValue(ePreCompPhase value) {
+	for (uint32_t i = 0; i < m_vSharings.size(); i++) {
+		m_vSharings[i]->SetPreCompPhaseValue(value);
+	}
+}
+
+ABYTriplePool* ABYParty::GetTriplePool() {
+	if (m_pTriplePool == NULL) {
+		m_pTriplePool = new ABYTriplePool(m_eRole, m_pSetup, m_cCrypt, m_tComm);
+		for (uint32_t i = 0; i < m_vSharings.size(); i++) {
+			if (m_vSharings[i]) {
+				m_vSharings[i]->SetTriplePool(m_pTriplePool);
+			}
+		}
+	}
+	return m_pTriplePool;
+}
+
+uint32_t ABYParty::ExecBatch(vector<ABYBatchJob*>& jobs, uint32_t maxjobs) {
+	uint32_t nexecs = 0;
+
+	assert(!m_pCircuit->IsCompiled());
+	if (maxjobs == 0) {
+		maxjobs = jobs.size();
+	}
+
+	for (uint32_t first = 0; first < jobs.size(); first += maxjobs, nexecs++) {
+		uint32_t last = min(first + maxjobs, (uint32_t) jobs.size());
+#ifdef DEBUGABYPARTY
+		cout << "Executing jobs " << first << " to " << last - 1 << " of " << jobs.size() << " in one batch" << endl;
+#endif
+		for (uint32_t i = first; i < last; i++) {
+			jobs[i]->BuildCircuit(this);
+		}
+		ExecCircuit();
+		for (uint32_t i = first; i < last; i++) {
+			jobs[i]->Finish(this);
+		}
+		Reset();
+	}
+	return nexecs;
+}
 
 BOOL ABYParty::InitCircuit(uint32_t bitlen, uint32_t maxgates) {
-	// Specification of maximum amount of gates in constructor in abyparty.h
+	// maxgates no longer bounds the circuit, the gate table grows in chunks with the circuit
 	m_pCircuit = new ABYCircuit(maxgates);
 
 	m_vSharings.resize(S_LAST);
-	m_vSharings[S_BOOL] = new BoolSharing(S_BOOL, m_eRole, 1, m_pCircuit, m_cCrypt);
+	m_vSharings[S_BOOL] = new BoolSharing(S_BOOL, m_eRole, 1, m_pCircuit, m_cCrypt, m_nNumOTThreads);
 	if (m_eRole == SERVER) {
 		m_vSharings[S_YAO] = new YaoServerSharing(S_YAO, SERVER, m_sSecLvl.symbits, m_pCircuit, m_cCrypt);
 		m_vSharings[S_YAO_REV] = new YaoClientSharing(S_YAO_REV, CLIENT, m_sSecLvl.symbits, m_pCircuit, m_cCrypt);
@@ -280,14 +400,7 @@ BOOL ABYParty::InitCircuit(uint32_t bitlen, uint32_t maxgates) {
 }
 
 BOOL ABYParty::EvaluateCircuit() {
-#ifdef BENCHONLINEPHASE
 	timespec tstart, tend;
-	uint32_t num_sharings = m_vSharings.size();
-	double interaction = 0;
-	vector<double> localops(num_sharings,0);
-	vector<double> interactiveops(num_sharings,0);
-	vector<double> fincirclayer(num_sharings,0);
-#endif
 	m_nDepth = 0;
 
 	m_tPartyChan = new channel(ABY_PARTY_CHANNEL, m_tComm->rcv_std, m_tComm->snd_std);
@@ -301,6 +414,7 @@ BOOL ABYParty::EvaluateCircuit() {
 	for (uint32_t i = 0; i < m_vSharings.size(); i++) {
 		maxdepth = max(maxdepth, m_vSharings[i]->GetMaxCommunicationRounds());
 	}
+	InitOnlineStats(maxdepth);
 #ifdef DEBUGABYPARTY
 	cout << "Starting online evaluation with maxdepth = " << maxdepth << endl;
 #endif
@@ -309,163 +423,326 @@ BOOL ABYParty::EvaluateCircuit() {
 #ifdef DEBUGABYPARTY
 		cout << "Starting evaluation on depth " << depth << endl << flush;
 #endif
-		for (uint32_t i = 0; i < m_vSharings.size(); i++) {
+		if(m_bPipelinedOnline) {
+			EvaluateLayerPipelined(depth);
+			continue;
+		}
+		if(m_vEvalThreads.size() > 0 && ScheduleSharingGroups(depth) > 1) {
 #ifdef DEBUGABYPARTY
-			cout << "Evaluating local operations of sharing " << i << " on depth " << depth << endl;
-#endif
-#ifdef BENCHONLINEPHASE
-			clock_gettime(CLOCK_MONOTONIC, &tstart);
-#endif
-			m_vSharings[i]->EvaluateLocalOperations(depth);
-#ifdef BENCHONLINEPHASE
-			clock_gettime(CLOCK_MONOTONIC, &tend);
-			localops[i] += getMillies(tstart, tend);
-			clock_gettime(CLOCK_MONOTONIC, &tstart);
+			cout << "Evaluating " << m_vEvalGroups.size() << " groups of sharings concurrently on depth " << depth << endl;
 #endif
+			EvaluateSharingGroups(depth);
+		} else {
+			for (uint32_t i = 0; i < m_vSharings.size(); i++) {
 #ifdef DEBUGABYPARTY
-			cout << "Evaluating interactive operations of sharing " << i << endl;
-#endif
-			m_vSharings[i]->EvaluateInteractiveOperations(depth);
-#ifdef BENCHONLINEPHASE
-			clock_gettime(CLOCK_MONOTONIC, &tend);
-			interactiveops[i] += getMillies(tstart, tend);
+				cout << "Evaluating operations of sharing " << i << " on depth " << depth << endl;
 #endif
+				EvaluateSharingOnLvl(i, depth);
+			}
 		}
 #ifdef DEBUGABYPARTY
 		cout << "Finished with evaluating operations on depth = " << depth << ", continuing with interactions" << endl;
 #endif
-#ifdef BENCHONLINEPHASE
 		clock_gettime(CLOCK_MONOTONIC, &tstart);
-#endif
-		PerformInteraction();
-#ifdef BENCHONLINEPHASE
+		BOOL interaction = PrepareInteraction();
+		if (interaction) {
+			PerformInteraction();
+		}
 		clock_gettime(CLOCK_MONOTONIC, &tend);
-		interaction += getMillies(tstart, tend);
-#endif
+		m_cStats.AddInteraction(getMillies(tstart, tend), !interaction);
 #ifdef DEBUGABYPARTY
 		cout << "Done performing interaction, having sharings wrap up this circuit layer" << endl;
 #endif
 		for (uint32_t i = 0; i < m_vSharings.size(); i++) {
-#ifdef BENCHONLINEPHASE
-			clock_gettime(CLOCK_MONOTONIC, &tstart);
-#endif
-			//cout << "Finishing circuit layer for sharing "<< i << endl;
-			m_vSharings[i]->FinishCircuitLayer(depth);
-#ifdef BENCHONLINEPHASE
-			clock_gettime(CLOCK_MONOTONIC, &tend);
-			fincirclayer[i] += getMillies(tstart, tend);
-#endif
+			FinishSharingLayer(i, depth);
 		}
 	}
 #ifdef DEBUGABYPARTY
-		cout << "Done with online phase; synchronizing "<< endl;
+		cout << "Done with online phase, skipped " << m_cStats.GetNumSkippedRounds() << " of " << maxdepth << " rounds without interaction; synchronizing "<< endl;
 #endif
 	m_tPartyChan->synchronize_end();
 	delete m_tPartyChan;
 
-#ifdef BENCHONLINEPHASE
-	cout << "Online time is distributed as follows: " << endl;
-	cout << "Bool: local gates: " << localops[S_BOOL] << ", interactive gates: " << interactiveops[S_BOOL] << ", layer finish: " << fincirclayer[S_BOOL] << endl;
-	cout << "Yao: local gates: " << localops[S_YAO] << ", interactive gates: " << interactiveops[S_YAO] << ", layer finish: " << fincirclayer[S_YAO] << endl;
-	cout << "Yao Rev: local gates: " << localops[S_YAO_REV] << ", interactive gates: " << interactiveops[S_YAO_REV] << ", layer finish: " << fincirclayer[S_YAO_REV] << endl;
-	cout << "Arith: local gates: " << localops[S_ARITH] << ", interactive gates: " << interactiveops[S_ARITH] << ", layer finish: " << fincirclayer[S_ARITH] << endl;
-	cout << "SPLUT: local gates: " << localops[S_SPLUT] << ", interactive gates: " << interactiveops[S_SPLUT] << ", layer finish: " << fincirclayer[S_SPLUT] << endl;
-	cout << "Communication: " << interaction << endl;
-#endif
+	m_cStats.ComputeTotals();
+
 	return true;
 }
 
-BOOL ABYParty::PerformInteraction() {
-	WakeupWorkerThreads(e_Party_Comm);
-	BOOL success = WaitWorkerThreads();
-	return success;
+//Allocates the statistics for all layers before the online phase, since the layers may be updated concurrently
+void ABYParty::InitOnlineStats(uint32_t maxdepth) {
+	m_cStats.InitLayers(maxdepth);
+	for (uint32_t i = 0; i < m_vSharings.size(); i++) {
+		Circuit* circ = m_vSharings[i]->GetCircuitBuildRoutine();
+		for (uint32_t d = 0; d < maxdepth; d++) {
+			m_cStats.GetLayerStats(i, d).nlocalgates = circ->GetNumLocalGatesOnLvl(d);
+			m_cStats.GetLayerStats(i, d).ninteractivegates = circ->GetNumInteractiveGatesOnLvl(d);
+		}
+		m_cStats.GetSharingStats(i).nrounds = m_vSharings[i]->GetMaxCommunicationRounds();
+	}
 }
 
-BOOL ABYParty::ThreadSendValues() {
-	vector<vector<BYTE*> >sendbuf(m_vSharings.size());
-	vector<vector<uint64_t> >sndbytes(m_vSharings.size());
+void ABYParty::EvaluateSharingOnLvl(uint32_t sharing, uint32_t depth) {
+	timespec tstart, tmid, tend;
+	layer_stats& stats = m_cStats.GetLayerStats(sharing, depth);
 
-	uint64_t snd_buf_size_total = 0, ctr = 0;
-	for (uint32_t j = 0; j < m_vSharings.size(); j++) {
-		m_vSharings[j]->GetDataToSend(sendbuf[j], sndbytes[j]);
-		for (uint32_t i = 0; i < sendbuf[j].size(); i++) {
-			snd_buf_size_total += sndbytes[j][i];
-			//m_tPartyChan->send(sendbuf[j][i], sndbytes[j][i]);
-#ifdef DEBUGCOMM
-				cout << "(" << m_nDepth << ") Sending " << sndbytes[j][i] << " bytes on socket " << m_eRole << " for sharing " << j << endl;
-#endif
-		}
-		//sendbuf[j].clear();
-		//sndbytes[j].clear();
+	clock_gettime(CLOCK_MONOTONIC, &tstart);
+	m_vSharings[sharing]->EvaluateLocalOperations(depth);
+	clock_gettime(CLOCK_MONOTONIC, &tmid);
+	m_vSharings[sharing]->EvaluateInteractiveOperations(depth);
+	clock_gettime(CLOCK_MONOTONIC, &tend);
+
+	stats.localops += getMillies(tstart, tmid);
+	stats.interactiveops += getMillies(tmid, tend);
+}
+
+void ABYParty::FinishSharingLayer(uint32_t sharing, uint32_t depth) {
+	timespec tstart, tend;
+
+	clock_gettime(CLOCK_MONOTONIC, &tstart);
+	m_vSharings[sharing]->FinishCircuitLayer(depth);
+	clock_gettime(CLOCK_MONOTONIC, &tend);
+
+	m_cStats.GetLayerStats(sharing, depth).fincirclayer += getMillies(tstart, tend);
+}
+
+/*
+ * Groups the sharings that have to be evaluated by the same thread on a layer. A sharing whose gates read gates of
+ * another sharing, e.g., conversion gates, is put in the same group as that sharing, since it may depend on gates of
+ * that sharing on the same layer and both update the use counters of the shared gates. Sharings within a group are
+ * evaluated in the usual order. Returns the number of groups that contain gates on this layer.
+ */
+uint32_t ABYParty::ScheduleSharingGroups(uint32_t depth) {
+	uint32_t nsharings = m_vSharings.size();
+	vector<uint32_t> group(nsharings);
+	vector<BOOL> hasgates(nsharings);
+
+	for (uint32_t i = 0; i < nsharings; i++) {
+		group[i] = i;
+		hasgates[i] = m_vSharings[i]->GetCircuitBuildRoutine()->HasGatesOnLvl(depth);
 	}
-	uint8_t* snd_buf_total = (uint8_t*) malloc(snd_buf_size_total);
-	for (uint32_t j = 0; j < m_vSharings.size(); j++) {
-		for (uint32_t i = 0; i < sendbuf[j].size(); i++) {
-			if(sndbytes[j][i] > 0) {
-				memcpy(snd_buf_total+ctr, sendbuf[j][i], sndbytes[j][i]);
-				ctr+= sndbytes[j][i];
+	for (uint32_t i = 0; i < nsharings; i++) {
+		if (!hasgates[i])
+			continue;
+		uint32_t foreign = m_vSharings[i]->GetCircuitBuildRoutine()->GetForeignInputSharingsOnLvl(depth);
+		for (uint32_t j = 0; j < nsharings; j++) {
+			if ((foreign & (1 << j)) && group[j] != group[i]) {
+				uint32_t merged = group[j];
+				for (uint32_t k = 0; k < nsharings; k++) {
+					if (group[k] == merged)
+						group[k] = group[i];
+				}
 			}
 		}
 	}
-	//gettimeofday(&tstart, NULL);
-	if(snd_buf_size_total > 0) {
-		//m_vSockets[2]->Send(snd_buf_total, snd_buf_size_total);
-		m_tPartyChan->send(snd_buf_total, snd_buf_size_total);
+
+	uint32_t nactive = 0;
+	m_vEvalGroups.clear();
+	for (uint32_t i = 0; i < nsharings; i++) {
+		if (group[i] != i)
+			continue;
+		BOOL active = FALSE;
+		m_vEvalGroups.push_back(vector<uint32_t>());
+		for (uint32_t k = 0; k < nsharings; k++) {
+			if (group[k] == i) {
+				m_vEvalGroups.back().push_back(k);
+				active |= hasgates[k];
+			}
+		}
+		if (active)
+			nactive++;
 	}
+	return nactive;
+}
 
-	free(snd_buf_total);
+//Evaluates the groups of sharings of a layer on the evaluation threads and joins them before the interaction
+BOOL ABYParty::EvaluateSharingGroups(uint32_t depth) {
+	m_nEvalDepth = depth;
+	m_nNextEvalGroup = 0;
 
-	return true;
+	WakeupWorkerThreads(e_Party_Eval);
+	BOOL success = ThreadEvaluateSharings();
+	success &= WaitWorkerThreads();
+
+	return success;
 }
 
-BOOL ABYParty::ThreadReceiveValues() {
-	vector<vector<BYTE*> > rcvbuf(m_vSharings.size());
-	vector<vector<uint64_t> > rcvbytes(m_vSharings.size());
+BOOL ABYParty::ThreadEvaluateSharings() {
+	for (;;) {
+		m_lEvalLock.Lock();
+		uint32_t g = m_nNextEvalGroup++;
+		m_lEvalLock.Unlock();
+		if (g >= m_vEvalGroups.size())
+			return TRUE;
+
+		for (uint32_t i = 0; i < m_vEvalGroups[g].size(); i++) {
+			EvaluateSharingOnLvl(m_vEvalGroups[g][i], m_nEvalDepth);
+		}
+	}
+}
 
-//	timeval tstart, tend;
+/*
+ * Evaluates one circuit layer while overlapping the communication with the local computation. The receiver thread
+ * is started before any gate is evaluated and consumes the messages of the sharings in sharing order as they land.
+ * Each sharing sends its data directly after evaluating its gates on this layer, so that its data is on the wire
+ * while the following sharings are evaluated, and finishes the layer as soon as its own data has arrived, while
+ * the data of the following sharings is still being received.
+ */
+BOOL ABYParty::EvaluateLayerPipelined(uint32_t depth) {
+	uint32_t nsharings = m_vSharings.size();
+
+	m_vPipeRcvBuf.resize(nsharings);
+	m_vPipeRcvBytes.resize(nsharings);
+	for (uint32_t i = 0; i < nsharings; i++) {
+		m_vPipeRcvBuf[i].clear();
+		m_vPipeRcvBytes[i].clear();
+	}
+	m_nPipeRcvPosted = 0;
+	m_nPipeRcvDone = 0;
 
-	uint64_t rcvbytestotal = 0;
-	for (uint32_t j = 0; j < m_vSharings.size(); j++) {
-		m_vSharings[j]->GetBuffersToReceive(rcvbuf[j], rcvbytes[j]);
-		for (uint32_t i = 0; i < rcvbuf[j].size(); i++) {
-			rcvbytestotal += rcvbytes[j][i];
-			//	m_tPartyChan->blocking_receive(sendbuf[j][i], sndbytes[j][i]);
+	WakeupWorkerThreads(e_Party_PipelinedRcv);
+
+	for (uint32_t i = 0; i < nsharings; i++) {
+		EvaluateSharingOnLvl(i, depth);
+
+		//hand the receive buffers of this sharing to the receiver thread
+		m_vSharings[i]->GetBuffersToReceive(m_vPipeRcvBuf[i], m_vPipeRcvBytes[i]);
+		m_lPipeLock.Lock();
+		m_nPipeRcvPosted = i + 1;
+		m_lPipeLock.Unlock();
+		m_evtPipeRcvPosted.Set();
+
+		SendSharingValues(i);
+	}
+
+	timespec tstart, tend;
+	double waiting = 0;
+	for (uint32_t i = 0; i < nsharings; i++) {
+		clock_gettime(CLOCK_MONOTONIC, &tstart);
+		WaitSharingReceived(i);
+		clock_gettime(CLOCK_MONOTONIC, &tend);
+		waiting += getMillies(tstart, tend);
+		FinishSharingLayer(i, depth);
+	}
+	BOOL success = WaitWorkerThreads();
+	m_cStats.AddInteraction(waiting, FALSE);
+
+	return success;
+}
+
+//Sends all data of a sharing on the current layer
+BOOL ABYParty::SendSharingValues(uint32_t sharing) {
+	vector<BYTE*> sendbuf;
+	vector<uint64_t> sndbytes;
+
+	m_vSharings[sharing]->GetDataToSend(sendbuf, sndbytes);
+	m_cStats.GetLayerStats(sharing, m_nDepth).sndbytes += vec_total_bytes(sndbytes);
 #ifdef DEBUGCOMM
-			cout << "(" << m_nDepth << ") Receiving " << rcvbytes[j][i] << " bytes on socket " << (m_eRole^1) << " for sharing " << j << endl;
-#endif
-		}
+	for (uint32_t i = 0; i < sendbuf.size(); i++) {
+		cout << "(" << m_nDepth << ") Sending " << sndbytes[i] << " bytes on socket " << m_eRole << " for sharing " << sharing << endl;
 	}
-	uint8_t* rcvbuftotal = (uint8_t*) malloc(rcvbytestotal);
-	assert(rcvbuftotal != NULL);
-	//gettimeofday(&tstart, NULL);
-	if (rcvbytestotal > 0) {
-		//m_vSockets[2]->Receive(rcvbuftotal, rcvbytestotal);
-		m_tPartyChan->blocking_receive(rcvbuftotal, rcvbytestotal);
+#endif
+	vec_send(m_tPartyChan, sendbuf, sndbytes);
+
+	return true;
+}
+
+//Receives the data of a sharing on the current layer into the buffers that were posted by the main thread
+BOOL ABYParty::ReceiveSharingValues(uint32_t sharing) {
+	m_cStats.GetLayerStats(sharing, m_nDepth).rcvbytes += vec_total_bytes(m_vPipeRcvBytes[sharing]);
+#ifdef DEBUGCOMM
+	for (uint32_t i = 0; i < m_vPipeRcvBuf[sharing].size(); i++) {
+		cout << "(" << m_nDepth << ") Receiving " << m_vPipeRcvBytes[sharing][i] << " bytes on socket " << (m_eRole^1) << " for sharing " << sharing << endl;
 	}
+#endif
+	return vec_blocking_receive(m_tPartyChan, m_vPipeRcvBuf[sharing], m_vPipeRcvBytes[sharing]);
+}
 
-	//gettimeofday(&tend, NULL);
-	//cout << "(" << m_nDepth << ") Time taken for receiving " << rcvbytestotal << " bytes: " << getMillies(tstart, tend) << endl;
+//Blocks the main thread until the receiver thread has received the data of the sharing on the current layer
+void ABYParty::WaitSharingReceived(uint32_t sharing) {
+	for (;;) {
+		m_lPipeLock.Lock();
+		uint32_t n = m_nPipeRcvDone;
+		m_lPipeLock.Unlock();
+		if (n > sharing)
+			return;
+		m_evtPipeRcvDone.Wait();
+	}
+}
 
-	for (uint32_t j = 0, ctr = 0; j < m_vSharings.size(); j++) {
-		for (uint32_t i = 0; i < rcvbuf[j].size(); i++) {
-			if (rcvbytes[j][i] > 0) {
-				memcpy(rcvbuf[j][i], rcvbuftotal + ctr, rcvbytes[j][i]);
-				ctr += rcvbytes[j][i];
-			}
+BOOL ABYParty::ThreadPipelinedReceiveValues() {
+	BOOL success = TRUE;
+	for (uint32_t j = 0; j < m_vSharings.size(); j++) {
+		//wait until the main thread has evaluated sharing j and posted its receive buffers
+		for (;;) {
+			m_lPipeLock.Lock();
+			uint32_t n = m_nPipeRcvPosted;
+			m_lPipeLock.Unlock();
+			if (n > j)
+				break;
+			m_evtPipeRcvPosted.Wait();
 		}
+
+		if(!ReceiveSharingValues(j))
+			success = FALSE;
+
+		m_lPipeLock.Lock();
+		m_nPipeRcvDone = j + 1;
+		m_lPipeLock.Unlock();
+		m_evtPipeRcvDone.Set();
 	}
-	free(rcvbuftotal);
+	return success;
+}
+
+BOOL ABYParty::PerformInteraction() {
+	WakeupWorkerThreads(e_Party_Comm);
+	BOOL success = WaitWorkerThreads();
+	return success;
+}
+
+/*
+ * Collects the buffers that all sharings send and receive on the current layer. The number of bytes one party sends
+ * is the number of bytes the other party receives, hence if neither sends anything, both parties come to the same
+ * conclusion that the layer does not need any interaction and skip it without exchanging a message.
+ */
+BOOL ABYParty::PrepareInteraction() {
+	m_vSndBuf.clear();
+	m_vSndBytes.clear();
+	m_vRcvBuf.clear();
+	m_vRcvBytes.clear();
 
 	for (uint32_t j = 0; j < m_vSharings.size(); j++) {
-		rcvbuf[j].clear();
-		rcvbytes[j].clear();
+#ifdef DEBUGCOMM
+		uint32_t firstsnd = m_vSndBuf.size(), firstrcv = m_vRcvBuf.size();
+#endif
+		uint64_t sndbefore = vec_total_bytes(m_vSndBytes), rcvbefore = vec_total_bytes(m_vRcvBytes);
+		m_vSharings[j]->GetDataToSend(m_vSndBuf, m_vSndBytes);
+		m_vSharings[j]->GetBuffersToReceive(m_vRcvBuf, m_vRcvBytes);
+		m_cStats.GetLayerStats(j, m_nDepth).sndbytes += vec_total_bytes(m_vSndBytes) - sndbefore;
+		m_cStats.GetLayerStats(j, m_nDepth).rcvbytes += vec_total_bytes(m_vRcvBytes) - rcvbefore;
+#ifdef DEBUGCOMM
+		for (uint32_t i = firstsnd; i < m_vSndBuf.size(); i++) {
+			cout << "(" << m_nDepth << ") Sending " << m_vSndBytes[i] << " bytes on socket " << m_eRole << " for sharing " << j << endl;
+		}
+		for (uint32_t i = firstrcv; i < m_vRcvBuf.size(); i++) {
+			cout << "(" << m_nDepth << ") Receiving " << m_vRcvBytes[i] << " bytes on socket " << (m_eRole^1) << " for sharing " << j << endl;
+		}
+#endif
 	}
-	rcvbuf.clear();
-	rcvbytes.clear();
+
+	return vec_total_bytes(m_vSndBytes) > 0 || vec_total_bytes(m_vRcvBytes) > 0;
+}
+
+BOOL ABYParty::ThreadSendValues() {
+	//the buffers of all sharings are handed to the channel directly, without copying them into one buffer
+	vec_send(m_tPartyChan, m_vSndBuf, m_vSndBytes);
 
 	return true;
 }
 
+BOOL ABYParty::ThreadReceiveValues() {
+	return vec_blocking_receive(m_tPartyChan, m_vRcvBuf, m_vRcvBytes);
+}
+
 
 void ABYParty::PrintPerformanceStatistics() {
 	cout << "Complexities: " << endl;
@@ -475,15 +752,18 @@ void ABYParty::PrintPerformanceStatistics() {
 	m_vSharings[S_ARITH]->PrintPerformanceStatistics();
 	m_vSharings[S_SPLUT]->PrintPerformanceStatistics();
 	cout << "Total number of gates: " << m_pCircuit->GetGateHead() << endl;
+	m_cStats.PrintOnlineStatistics();
 	PrintTimings();
 	PrintCommunication();
 }
 
 //=========================================================
 // Connection Routines
-BOOL ABYParty::EstablishConnection() {
+BOOL ABYParty::EstablishConnection(BOOL connected) {
 	BOOL success = false;
-	if (m_eRole == SERVER) {
+	if (connected) {
+		success = TRUE;
+	} else if (m_eRole == SERVER) {
 		/*#ifndef BATCH
 		 cout << "Server starting to listen" << endl;
 		 #endif*/
@@ -552,6 +832,10 @@ void ABYParty::UsedGate(uint32_t gateid) {
 }
 
 void ABYParty::Reset() {
+	//the pool thread generates its MTs with m_pSetup, which must not be reset underneath it
+	if (m_pTriplePool) {
+		m_pTriplePool->Pause();
+	}
 	m_pSetup->Reset();
 	m_nDepth = 0;
 	m_nMyNumInBits = 0;
@@ -562,23 +846,172 @@ void ABYParty::Reset() {
 			m_vSharings[0]->FreeGate(&m_pGates[i]);
 		}
 	}
+	// freed gate values return to the pool of the sharing that allocated them, so no pool is reset before all gates are freed
 	for (uint32_t i = 0; i < m_vSharings.size(); i++) {
+		m_vSharings[i]->ResetGateValuePool();
+		m_vSharings[i]->DiscardGateBufferPlan();
 		m_vSharings[i]->Reset();
 	}
 
-	m_pCircuit->Reset();
+	if(m_pCircuit->IsCompiled()) {
+		m_pCircuit->RestoreCompiled();
+	} else {
+		m_pCircuit->Reset();
+		m_bCircuitOptimized = FALSE;
+		memset(&m_sOptStats, 0, sizeof(circ_opt_stats));
+	}
+	if (m_pTriplePool) {
+		m_pTriplePool->Resume();
+	}
+}
+
+BOOL ABYParty::CompileCircuit() {
+	//the frozen gates are restored after each execution, so they have to be optimized already
+	if ((m_bOptimizeCircuit || m_nRebalanceSharings) && !m_bCircuitOptimized) {
+		OptimizeCircuit();
+	}
+	return m_pCircuit->Compile();
+}
+
+void ABYParty::DiscardCompiledCircuit() {
+	m_pCircuit->DiscardCompiled();
+}
+
+BOOL ABYParty::SaveCompiledCircuit(const char* filename) {
+	if ((m_bOptimizeCircuit || m_nRebalanceSharings) && !m_bCircuitOptimized) {
+		OptimizeCircuit();
+	}
+
+	ofstream out(filename, ios::out | ios::binary | ios::trunc);
+	if (!out.is_open()) {
+		cerr << "Could not open " << filename << " to store the circuit" << endl;
+		return FALSE;
+	}
+	if (m_pCircuit->WriteBinaryCircuit(out) == 0) {
+		return FALSE;
+	}
+	for (uint32_t i = 0; i < m_vSharings.size(); i++) {
+		m_vSharings[i]->GetCircuitBuildRoutine()->WriteState(out);
+	}
+	out.close();
+
+	return !out.fail();
+}
+
+BOOL ABYParty::LoadCompiledCircuit(const char* filename) {
+	uint64_t stateoffset = m_pCircuit->MapBinaryCircuit(filename);
+	if (stateoffset == 0) {
+		return FALSE;
+	}
+
+	ifstream in(filename, ios::in | ios::binary);
+	in.seekg(stateoffset);
+	for (uint32_t i = 0; i < m_vSharings.size(); i++) {
+		if (!m_vSharings[i]->GetCircuitBuildRoutine()->ReadState(in)) {
+			cerr << "Could not read the state of the " << get_sharing_name((e_sharing) i) << " circuit from " << filename << endl;
+			m_pCircuit->DiscardCompiled();
+			Reset();
+			return FALSE;
+		}
+	}
+	//the stored gates were already optimized when the circuit was saved
+	m_bCircuitOptimized = TRUE;
+
+	return TRUE;
+}
+
+void ABYParty::OptimizeCircuit() {
+	vector<bool> removed;
+
+	if (m_bOptimizeCircuit) {
+		m_pCircuit->Optimize(removed, m_sOptStats);
+		//the circuits need the types of the removed gates to update their gate counts
+		for (uint32_t i = 0; i < m_vSharings.size(); i++) {
+			m_vSharings[i]->GetCircuitBuildRoutine()->RemoveGates(removed);
+		}
+		m_pCircuit->RemoveGates(removed);
+
+#ifndef BATCH
+		cout << "Circuit optimization folded " << m_sOptStats.nfolded << ", merged " << m_sOptStats.nmerged << " and removed "
+				<< m_sOptStats.nremoved << " gates, AND gates: " << m_sOptStats.nandsbefore << " -> " << m_sOptStats.nandsafter << endl;
+#endif
+	}
+
+	if (m_nRebalanceSharings) {
+		m_pCircuit->Rebalance(m_nRebalanceSharings, removed, m_sOptStats);
+		for (uint32_t i = 0; i < m_vSharings.size(); i++) {
+			m_vSharings[i]->GetCircuitBuildRoutine()->RemoveGates(removed);
+			if (m_nRebalanceSharings & (1 << i)) {
+				m_vSharings[i]->GetCircuitBuildRoutine()->RequeueGates();
+			}
+		}
+		m_pCircuit->RemoveGates(removed);
+
+#ifndef BATCH
+		cout << "Depth rebalancing rewrote " << m_sOptStats.nrebalanced << " AND trees, depth: " << m_sOptStats.ndepthbefore
+				<< " -> " << m_sOptStats.ndepthafter << endl;
+#endif
+	}
+	m_bCircuitOptimized = TRUE;
+}
+
+uint64_t ABYParty::PlanGateBuffers() {
+	vector<uint32_t> lastuse;
+	m_pCircuit->ComputeLastUse(lastuse);
+
+	uint64_t plannedbytes = 0;
+	for (uint32_t i = 0; i < m_vSharings.size(); i++) {
+		plannedbytes += m_vSharings[i]->PlanGateBuffers(lastuse);
+	}
+	return plannedbytes;
 }
 
 double ABYParty::GetTiming(ABYPHASE phase) {
-	return GetTimeForPhase(phase);
+	return m_vPhases[phase].timing;
 }
 
 uint64_t ABYParty::GetSentData(ABYPHASE phase) {
-	return GetSentDataForPhase(phase);
+	return m_vPhases[phase].snd;
 }
 
 uint64_t ABYParty::GetReceivedData(ABYPHASE phase) {
-	return GetReceivedDataForPhase(phase);
+	return m_vPhases[phase].rcv;
+}
+
+//The timers of ENCRYPTO_utils print the phases but are shared by all parties of the process, which would mix up the
+//numbers of concurrent sessions, therefore every party also keeps its own record
+void ABYParty::StartPhase(const string& msg, ABYPHASE phase, BOOL record) {
+	phase_record& rec = m_vPhases[phase];
+	if (record) {
+		StartRecording(msg, phase, m_vSockets);
+		rec.sndbegin = rec.rcvbegin = 0;
+		for (uint32_t i = 0; i < m_vSockets.size(); i++) {
+			rec.sndbegin += m_vSockets[i]->getSndCnt();
+			rec.rcvbegin += m_vSockets[i]->getRcvCnt();
+		}
+	} else {
+		StartWatch(msg, phase);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &rec.tbegin);
+}
+
+void ABYParty::StopPhase(const string& msg, ABYPHASE phase, BOOL record) {
+	timespec tend;
+	phase_record& rec = m_vPhases[phase];
+	clock_gettime(CLOCK_MONOTONIC, &tend);
+	rec.timing = getMillies(rec.tbegin, tend);
+	if (record) {
+		rec.snd = rec.rcv = 0;
+		for (uint32_t i = 0; i < m_vSockets.size(); i++) {
+			rec.snd += m_vSockets[i]->getSndCnt();
+			rec.rcv += m_vSockets[i]->getRcvCnt();
+		}
+		rec.snd -= rec.sndbegin;
+		rec.rcv -= rec.rcvbegin;
+		StopRecording(msg, phase, m_vSockets);
+	} else {
+		StopWatch(msg, phase);
+	}
 }
 
 //===========================================================================
@@ -586,11 +1019,12 @@ uint64_t ABYParty::GetReceivedData(ABYPHASE phase) {
 BOOL ABYParty::WakeupWorkerThreads(EPartyJobType e) {
 	m_bWorkerThreadSuccess = TRUE;
 
-	m_nWorkingThreads = 2;
+	vector<CPartyWorkerThread*>& threads = (e == e_Party_Eval) ? m_vEvalThreads : m_vThreads;
+	m_nWorkingThreads = (e == e_Party_Eval) ? m_vEvalThreads.size() : 2;
 	uint32_t n = m_nWorkingThreads;
 
 	for (uint32_t i = 0; i < n; i++)
-		m_vThreads[i]->PutJob(e);
+		threads[i]->PutJob(e);
 
 	return TRUE;
 }
@@ -638,6 +1072,18 @@ void ABYParty::CPartyWorkerThread::ThreadMain() {
 				bSuccess = m_pCallback->ThreadReceiveValues();
 			}
 			break;
+		case e_Party_Eval:
+			bSuccess = m_pCallback->ThreadEvaluateSharings();
+			break;
+		case e_Party_PipelinedRcv:
+			//the main thread sends in pipelined mode, only the receiver thread has work to do
+			if (threadid == 0){
+				bSuccess = TRUE;
+			}
+			else{
+				bSuccess = m_pCallback->ThreadPipelinedReceiveValues();
+			}
+			break;
 		case e_Party_Undefined:
 		default:
 			cerr << "Error: Unhandled Thread Job!" << endl;
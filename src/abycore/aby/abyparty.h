@@ -27,6 +27,7 @@
 #include "../ENCRYPTO_utils/thread.h"
 #include "../ENCRYPTO_utils/cbitvector.h"
 #include "abysetup.h"
+#include "abystats.h"
 #include "../sharing/sharing.h"
 #include "../sharing/boolsharing.h"
 #include "../sharing/splut.h"
@@ -39,6 +40,7 @@
 #include "../ENCRYPTO_utils/rcvthread.h"
 
 #include "../ABY_utils/yaokey.h"
+#include "../ABY_utils/vecchannel.h"
 #include "../ENCRYPTO_utils/timer.h"
 
 #include <limits.h>
@@ -47,7 +49,6 @@
 //#define ABYDEBUG
 //#define PRINT_OUTPUT
 //#define DEBUGABYPARTY
-//#define BENCHONLINEPHASE
 //#define PRINT_PERFORMANCE_STATS
 //#define DEBUGCOMM
 
@@ -58,10 +59,43 @@ using namespace std; //TODO eventually remove and prefix couts etc with std::
 //and for the inverse direction (SERVER plays client, CLIENT plays server)
 
 
+/**
+ Admission control for the phases of ExecCircuit. A party that has a scheduler enters the setup and the online phase
+ only when EnterPhase returns, which allows a process that runs many parties to bound the number of parties that
+ compute a phase concurrently, see ABYSessionServer.
+ */
+class ABYPhaseScheduler {
+public:
+	virtual ~ABYPhaseScheduler() {
+	}
+	virtual void EnterPhase(ABYPHASE phase) = 0;
+	virtual void LeavePhase(ABYPHASE phase) = 0;
+};
+
+class ABYParty;
+
+/**
+ Independent computation that is executed together with other jobs, see ABYParty::ExecBatch.
+ */
+class ABYBatchJob {
+public:
+	virtual ~ABYBatchJob() {
+	}
+	//Put the gates of the job into the circuits of the sharings of the party
+	virtual void BuildCircuit(ABYParty* party) = 0;
+	//Read the outputs of the job after its batch was executed, the shares of the job are valid until the party is reset
+	virtual void Finish(ABYParty* party) = 0;
+};
+
 class ABYParty {
 public:
 	ABYParty(e_role pid, char* addr = (char*) "127.0.0.1", uint16_t port = 7766, seclvl seclvl = LT, uint32_t bitlen = 32,
 			uint32_t nthreads =	2, e_mt_gen_alg mg_algo = MT_OT, uint32_t maxgates = 4000000);
+	/* Party on connections that were already established, e.g. by ABYSessionServer: sockets[0] carries the messages of
+	 * the server-to-client direction and sockets[1] those of the inverse direction, as set up by Listen and Connect. The
+	 * party takes ownership of the sockets. */
+	ABYParty(e_role pid, vector<CSocket*>& sockets, seclvl seclvl = LT, uint32_t bitlen = 32, uint32_t nthreads = 2,
+			e_mt_gen_alg mg_algo = MT_OT, uint32_t maxgates = 4000000);
 	~ABYParty();
 
 	vector<Sharing*>& GetSharings() {
@@ -70,25 +104,139 @@ public:
 	CBitVector ExecCircuit();
 	CBitVector ExecSetupPhase();
 
+	/* Execute many independent jobs with few setup phases: the gates of up to maxjobs jobs (0 for all) are put into the
+	 * same circuit, such that the OTs, the garbled circuits and the multiplication triples of all of them are generated
+	 * in one setup phase, and their online phases share the communication rounds. Finish is called for each job after
+	 * its batch was executed, then the party is reset. Gates that were put before are executed with the first batch.
+	 * Both parties have to submit the same jobs in the same order. Cannot be used with a compiled circuit. Returns the
+	 * number of executions. */
+	uint32_t ExecBatch(vector<ABYBatchJob*>& jobs, uint32_t maxjobs = 0);
+
 	void Reset();
 
+	/* Freeze the circuit that was built so far, such that Reset() keeps the gates, the queues and the layer information
+	 * of all sharings and only clears the values of the last execution. To evaluate the circuit on new inputs, put the
+	 * input gates again in the same order as when building the circuit; they are bound to the frozen input gates.
+	 * Input gates that are not put again keep the value they had when the circuit was compiled. Has to be called
+	 * before ExecCircuit. Returns FALSE if the circuit contains gates that cannot be re-evaluated. */
+	BOOL CompileCircuit();
+	//Drop the frozen circuit, the next Reset() clears the circuit such that a new one can be built
+	void DiscardCompiledCircuit();
+
+	/* Store the circuit that was built so far in a versioned binary file, together with the queues and the input and
+	 * output gates of all sharings. The circuit is optimized first if enabled, as in CompileCircuit. Has to be called
+	 * before ExecCircuit; the same restrictions as for CompileCircuit apply, and circuits with callback gates cannot be
+	 * stored. The values of the input gates are not stored. */
+	BOOL SaveCompiledCircuit(const char* filename);
+	/* Map a circuit file written by SaveCompiledCircuit instead of building the circuit. The loaded circuit behaves as a
+	 * compiled circuit: put the input gates in the same order as when building the circuit to bind their values, and
+	 * read the outputs from the output gates of the sharings, see Circuit::GetOutputGatesForParty. The party has to be
+	 * freshly constructed or reset with a discarded compiled circuit, and has to use the same share bit length. */
+	BOOL LoadCompiledCircuit(const char* filename);
+
+	/* Plan ahead of the execution which gate values can share a buffer, based on the layer on which each gate value is
+	 * last read. The gate values of the Boolean, arithmetic and SP-LUT sharings are then placed in the planned buffers,
+	 * such that their memory is bounded by the maximal number of simultaneously live values. Has to be called after the
+	 * circuit was built and before ExecCircuit; the plan is dropped by Reset(). Returns the planned peak memory in bytes
+	 * for the gate values of all sharings. */
+	uint64_t PlanGateBuffers();
+
+	/* Optimize the Boolean circuits (Boolean, Yao and SP-LUT sharing) before the setup phase: XOR and AND gates with
+	 * constant inputs are folded, identical gates are merged and gates whose values are never used are removed. The
+	 * optimization runs in ExecCircuit, or in CompileCircuit for circuits that are compiled. Both parties need to use
+	 * the same setting, since the optimization changes the number of gates. The number of optimized gates and the
+	 * reduction of the AND gates are reported in the statistics. */
+	void SetCircuitOptimization(BOOL enable) {
+		m_bOptimizeCircuit = enable;
+	}
+
+	/* Rebalance the trees of AND gates of a Boolean sharing, as built by chains of AND or OR gates, to minimize the
+	 * multiplicative depth and thus the number of communication rounds of the GMW protocol. Runs after the circuit
+	 * optimization, in ExecCircuit or CompileCircuit. Rebalancing does not change the number of gates. It is disabled
+	 * for all sharings by default and only pays off for S_BOOL, since the AND gates of Yao's garbled circuits are
+	 * evaluated without interaction and S_SPLUT evaluates AND gates as lookup tables. Both parties need to use the
+	 * same setting. */
+	void SetDepthRebalancing(e_sharing sharing, BOOL enable) {
+		if (enable) {
+			m_nRebalanceSharings |= (1 << sharing);
+		} else {
+			m_nRebalanceSharings &= ~(1 << sharing);
+		}
+	}
+
+	/* Switch the online phase between the lock-step and the pipelined layer evaluation. In pipelined mode each
+	 * sharing sends its data as soon as its gates on a layer are evaluated and finishes the layer as soon as its
+	 * data has arrived. Both parties need to use the same mode, since the messages are framed differently. */
+	void SetPipelinedOnlinePhase(BOOL enable) {
+		m_bPipelinedOnline = enable;
+	}
+
+	//Sets the precomputation mode of all sharings, the RAM modes are only supported by the Boolean sharing
+	void SetPreCompPhaseValue(ePreCompPhase value);
+
+	/* Generate the random OTs of the Boolean MTs with the LPN-based silent OT extension instead of IKNP, which needs
+	 * far less communication for large circuits. Only tasks with at least SILENT_OT_MIN_OTS OTs use it, since each
+	 * expansion yields about 10^7 OTs, the remaining OTs of an expansion are kept for the following executions. Both
+	 * parties need to use the same method. A started triple pool keeps the method that was set when it was started. */
+	void SetRandomOTGenAlg(e_rot_gen_alg alg) {
+		m_pSetup->SetRandomOTGenAlg(alg);
+	}
+
+	//Let the scheduler admit the setup and the online phase of ExecCircuit, NULL runs them right away
+	void SetPhaseScheduler(ABYPhaseScheduler* scheduler) {
+		m_pPhaseScheduler = scheduler;
+	}
+
+	/* Pool of multiplication triples that is refilled in the background while the party is idle, created on the first
+	 * call. Add the reservoirs and start the pool on both parties, then set the precomputation mode to ePreCompPool,
+	 * such that the Boolean and the arithmetic sharing take the MTs of each execution from the pool instead of
+	 * generating them in the setup phase. The pool refills with the ABYSetup of the party, therefore ExecCircuit pauses
+	 * the refilling and Reset() resumes it once the setup has been reset. */
+	ABYTriplePool* GetTriplePool();
+
+	/**
+	 Returns the statistics of the last execution: the time spent on each layer in each sharing, the bytes sent and
+	 received, the number of gates, OTs and MTs, and the time and communication of the phases.
+	 */
+	ABYStats& GetStats() {
+		return m_cStats;
+	}
+
+	void PrintPerformanceStatistics();
+
 	double GetTiming(ABYPHASE phase);
 	uint64_t GetSentData(ABYPHASE phase);
 	uint64_t GetReceivedData(ABYPHASE phase);
 
 
 private:
+	void InitParty(e_role pid, seclvl seclvl, uint32_t bitlen, uint32_t nthreads, e_mt_gen_alg mg_algo, uint32_t maxgates,
+			vector<CSocket*>* sockets);
 	BOOL Init();
 	void Cleanup();
 
 	BOOL InitCircuit(uint32_t bitlen, uint32_t maxgates);
 
-	BOOL EstablishConnection();
+	/** Time of a phase and, if it is recorded, the bytes sent and received on the sockets during the phase */
+	struct phase_record {
+		timespec tbegin;
+		double timing;
+		uint64_t sndbegin, rcvbegin;
+		uint64_t snd, rcv;
+	};
+	void StartPhase(const string& msg, ABYPHASE phase, BOOL record = FALSE);
+	void StopPhase(const string& msg, ABYPHASE phase, BOOL record = FALSE);
+
+	BOOL EstablishConnection(BOOL connected);
 
 	BOOL ABYPartyListen();
 	BOOL ABYPartyConnect();
 
 	BOOL EvaluateCircuit();
+	BOOL EvaluateLayerPipelined(uint32_t depth);
+	uint32_t ScheduleSharingGroups(uint32_t depth);
+	BOOL EvaluateSharingGroups(uint32_t depth);
+	BOOL ThreadEvaluateSharings();
 
 	void BuildCircuit();
 	void BuildBoolMult(uint32_t bitlen, uint32_t resbitlen, uint32_t nvals);
@@ -97,15 +245,29 @@ private:
 	void InstantiateGate(uint32_t gateid);
 	void UsedGate(uint32_t gateid);
 
+	BOOL PrepareInteraction();
 	BOOL PerformInteraction();
 	BOOL ThreadSendValues();
 	BOOL ThreadReceiveValues();
+	BOOL ThreadPipelinedReceiveValues();
 
-	void PrintPerformanceStatistics();
+	BOOL SendSharingValues(uint32_t sharing);
+	BOOL ReceiveSharingValues(uint32_t sharing);
+	void WaitSharingReceived(uint32_t sharing);
+
+	void InitOnlineStats(uint32_t maxdepth);
+	void OptimizeCircuit();
+	void EvaluateSharingOnLvl(uint32_t sharing, uint32_t depth);
+	void FinishSharingLayer(uint32_t sharing, uint32_t depth);
 
 	e_mt_gen_alg m_eMTGenAlg;
 	ABYSetup* m_pSetup;
 
+	BOOL m_bOptimizeCircuit;
+	BOOL m_bCircuitOptimized; // the current circuit was already optimized
+	circ_opt_stats m_sOptStats;
+	uint32_t m_nRebalanceSharings; // bit mask of the sharings whose AND trees are rebalanced
+
 	// Network Communication
 	vector<CSocket*> m_vSockets; // sockets for threads
 	e_role m_eRole; // thread id
@@ -123,7 +285,7 @@ private:
 	uint32_t m_nMyNumInBits;
 	// Ciruit
 	ABYCircuit* m_pCircuit;
-	GATE* m_pGates;
+	GateTable m_pGates;
 
 	uint32_t m_nSizeOfVal;
 
@@ -132,10 +294,13 @@ private:
 
 	vector<Sharing*> m_vSharings;
 
+	ABYStats m_cStats;
+	phase_record m_vPhases[P_LAST + 1];
+
 	crypto* m_cCrypt;
 
 	enum EPartyJobType {
-		e_Party_Comm, e_Party_Stop, e_Party_Undefined
+		e_Party_Comm, e_Party_PipelinedRcv, e_Party_Eval, e_Party_Stop, e_Party_Undefined
 	};
 
 	comm_ctx* m_tComm;
@@ -166,12 +331,38 @@ private:
 	BOOL ThreadNotifyTaskDone(BOOL);
 
 	vector<CPartyWorkerThread*> m_vThreads;
+	// Threads that evaluate independent sharings of a layer concurrently, the main thread evaluates sharings as well
+	vector<CPartyWorkerThread*> m_vEvalThreads;
+	// Groups of sharings that depend on each other on the current layer and are evaluated in order by one thread
+	vector<vector<uint32_t> > m_vEvalGroups;
+	uint32_t m_nNextEvalGroup;
+	uint32_t m_nEvalDepth;
+	CLock m_lEvalLock;
 	CEvent m_evt;
 	CLock m_lock;
 
 	uint32_t m_nWorkingThreads;
 	BOOL m_bWorkerThreadSuccess;
 
+	// Buffers that are sent and received on the current layer in the lock-step online phase
+	vector<BYTE*> m_vSndBuf;
+	vector<uint64_t> m_vSndBytes;
+	vector<BYTE*> m_vRcvBuf;
+	vector<uint64_t> m_vRcvBytes;
+
+	// Pipelined online phase: the main thread posts the receive buffers of each sharing, the receiver thread
+	// signals which sharings have received their data on the current layer
+	BOOL m_bPipelinedOnline;
+	ABYPhaseScheduler* m_pPhaseScheduler;
+	ABYTriplePool* m_pTriplePool;
+	vector<vector<BYTE*> > m_vPipeRcvBuf;
+	vector<vector<uint64_t> > m_vPipeRcvBytes;
+	uint32_t m_nPipeRcvPosted;
+	uint32_t m_nPipeRcvDone;
+	CLock m_lPipeLock;
+	CEvent m_evtPipeRcvPosted;
+	CEvent m_evtPipeRcvDone;
+
 };
 
 #endif //__ABYPARTY_H__
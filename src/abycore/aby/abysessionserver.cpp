@@ -0,0 +1,462 @@
+/**
+ \file 		abysessionserver.cpp
+ \author	michael.zohner@ec-spride.de
+ \copyright	ABY - A Framework for Efficient Mixed-protocol Secure Two-party Computation
+			Copyright (C) 2015 Engineering Cryptographic Protocols Group, TU Darmstadt
+			This program is free software: you can redistribute it and/or modify
+			it under the terms of the GNU Affero General Public License as published
+			by the Free Software Foundation, either version 3 of the License, or
+			(at your option) any later version.
+			This program is distributed in the hope that it will be useful,
+			but WITHOUT ANY WARRANTY; without even the implied warranty of
+			MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+			GNU Affero General Public License for more details.
+			You should have received a copy of the GNU Affero General Public License
+			along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief		Server that runs the sessions of many clients on one port and a bounded pool of worker threads.
+ */
+
+#include "abysessionserver.h"
+#include <unistd.h>
+#include <string.h>
+
+//compares in a time that does not depend on the position of the first differing byte
+static BOOL equal_tokens(const uint8_t* a, const uint8_t* b) {
+	uint8_t diff = 0;
+	for (uint32_t i = 0; i < SESSION_TOKEN_BYTES; i++) {
+		diff |= a[i] ^ b[i];
+	}
+	return diff == 0;
+}
+
+ABYSessionServer::ABYSessionServer(char* addr, uint16_t port, uint32_t nworkers, seclvl seclvl, uint32_t bitlen,
+		uint32_t nthreads, e_mt_gen_alg mg_algo, uint32_t maxgates) {
+	m_cAddress = addr;
+	m_nPort = port;
+	m_sSecLvl = seclvl;
+	m_nBitLen = bitlen;
+	m_nNumThreads = nthreads;
+	m_eMTGenAlg = mg_algo;
+	m_nMaxGates = maxgates;
+
+	m_fSession = NULL;
+	m_pSessionArg = NULL;
+	m_cCrypt = new crypto(seclvl.symbits);
+	m_nNextSessionId = 0;
+	m_nAcceptedSessions = 0;
+	m_nAcceptTarget = 0;
+	m_bListening = FALSE;
+	m_nServedSessions = 0;
+	m_bStop = FALSE;
+
+	m_sSetupQueue.limit = 0;
+	m_sSetupQueue.active = 0;
+	m_sOnlineQueue.limit = 0;
+	m_sOnlineQueue.active = 0;
+
+	m_vWorkers.resize(max(nworkers, (uint32_t) 1));
+	for (uint32_t i = 0; i < m_vWorkers.size(); i++) {
+		m_vWorkers[i] = new CSessionWorkerThread(this);
+		m_vWorkers[i]->Start();
+	}
+}
+
+ABYSessionServer::~ABYSessionServer() {
+	vector<CHandshakeThread*> expired;
+
+	//connections whose header is still read may complete a session, which the workers then execute as well
+	m_lock.Lock();
+	while (!m_vHandshakes.empty()) {
+		ReapHandshakes();
+		ExpireHandshakes(expired);
+		m_lock.Unlock();
+		JoinExpiredHandshakes(expired);
+		usleep(SESSION_RETRY_WAIT_MS * 1000);
+		m_lock.Lock();
+	}
+	m_lock.Unlock();
+
+	//the workers finish the queued sessions before they stop
+	m_lock.Lock();
+	m_bStop = TRUE;
+	while (!m_vIdleWorkers.empty()) {
+		m_vIdleWorkers.front()->m_evt.Set();
+		m_vIdleWorkers.pop_front();
+	}
+	m_lock.Unlock();
+
+	for (uint32_t i = 0; i < m_vWorkers.size(); i++) {
+		m_vWorkers[i]->Wait();
+		delete m_vWorkers[i];
+	}
+
+	for (map<uint32_t, session_ctx*>::iterator it = m_mPendingSessions.begin(); it != m_mPendingSessions.end(); it++) {
+		it->second->sockets[0]->Close();
+		delete it->second->sockets[0];
+		delete it->second;
+	}
+	delete m_cCrypt;
+}
+
+void ABYSessionServer::SetPhaseLimits(uint32_t maxsetup, uint32_t maxonline) {
+	m_lPhaseLock.Lock();
+	m_sSetupQueue.limit = maxsetup;
+	m_sOnlineQueue.limit = maxonline;
+	m_lPhaseLock.Unlock();
+}
+
+BOOL ABYSessionServer::Run(aby_session_fn fn, void* arg, uint32_t nsessions) {
+	CSocket listener;
+
+	m_fSession = fn;
+	m_pSessionArg = arg;
+
+	if (!listener.Socket() || !listener.Bind(m_nPort, m_cAddress) || !listener.Listen()) {
+		cerr << "Session server could not listen on " << m_cAddress << ":" << m_nPort << endl;
+		listener.Close();
+		return FALSE;
+	}
+
+	m_lock.Lock();
+	uint32_t target = m_nAcceptedSessions + nsessions;
+	m_nAcceptTarget = nsessions == 0 ? 0 : target;
+	m_bListening = TRUE;
+	while (nsessions == 0 || m_nAcceptedSessions < target) {
+		m_lock.Unlock();
+		AcceptConnection(&listener);
+		m_lock.Lock();
+	}
+	//no handshake wakes up the loop once the listener is closed
+	m_bListening = FALSE;
+	m_lock.Unlock();
+	listener.Close();
+
+	m_lock.Lock();
+	while (m_nServedSessions < target) {
+		m_lock.Unlock();
+		m_evtDone.Wait();
+		m_lock.Lock();
+	}
+	m_lock.Unlock();
+
+	return TRUE;
+}
+
+void ABYSessionServer::AcceptConnection(CSocket* listener) {
+	CSocket* sock = new CSocket();
+	vector<CHandshakeThread*> expired;
+
+	if (!listener->Accept(*sock)) {
+		delete sock;
+		return;
+	}
+
+	m_lock.Lock();
+	ReapHandshakes();
+	ExpireHandshakes(expired);
+	//the connection that wakes up the loop is dropped as well
+	BOOL accept = (m_nAcceptTarget == 0 || m_nAcceptedSessions < m_nAcceptTarget) && m_vHandshakes.size() < SESSION_MAX_HANDSHAKES;
+	if (accept) {
+		CHandshakeThread* handshake = new CHandshakeThread(this, sock);
+		m_vHandshakes.push_back(handshake);
+		handshake->Start();
+	}
+	m_lock.Unlock();
+	JoinExpiredHandshakes(expired);
+
+	if (!accept) {
+		sock->Close();
+		delete sock;
+	}
+}
+
+void ABYSessionServer::Handshake(CSocket* sock, session_hdr* hdr) {
+	session_ctx* session = NULL;
+	BOOL valid = hdr != NULL && hdr->role == (uint32_t) CLIENT && hdr->index <= 1;
+
+	m_lock.Lock();
+	ExpirePendingSessions();
+	if (valid && hdr->index == 0) {
+		valid = hdr->id == SESSION_NEW && m_mPendingSessions.size() < SESSION_MAX_PENDING;
+		if (valid) {
+			session_ctx* pending = new session_ctx;
+			pending->id = m_nNextSessionId++;
+			m_cCrypt->gen_rnd(pending->token, SESSION_TOKEN_BYTES);
+			clock_gettime(CLOCK_MONOTONIC, &(pending->created));
+			pending->sockets.resize(2, NULL);
+			pending->sockets[0] = sock;
+			m_mPendingSessions[pending->id] = pending;
+			//sent under the lock, such that the session cannot expire before the client knows it
+			hdr->id = pending->id;
+			memcpy(hdr->token, pending->token, SESSION_TOKEN_BYTES);
+			sock->Send(hdr, sizeof(session_hdr));
+		}
+	} else if (valid) {
+		map<uint32_t, session_ctx*>::iterator it = m_mPendingSessions.find(hdr->id);
+		valid = it != m_mPendingSessions.end() && equal_tokens(it->second->token, hdr->token);
+		if (valid) {
+			session = it->second;
+			m_mPendingSessions.erase(it);
+			session->sockets[1] = sock;
+			m_nAcceptedSessions++;
+			if (m_bListening && m_nAcceptTarget > 0 && m_nAcceptedSessions >= m_nAcceptTarget) {
+				WakeAcceptLoop();
+			}
+		}
+	}
+	m_lock.Unlock();
+
+	if (!valid) {
+		cerr << "Session server rejected a connection" << endl;
+		sock->Close();
+		delete sock;
+	} else if (session) {
+#ifdef DEBUGSESSION
+		cout << "Accepted session " << session->id << endl;
+#endif
+		PutSession(session);
+	}
+}
+
+void ABYSessionServer::CHandshakeThread::ThreadMain() {
+	session_hdr hdr;
+	int cancelstate;
+
+	m_pServer->m_lock.Lock();
+	m_tThread = pthread_self();
+	clock_gettime(CLOCK_MONOTONIC, &m_tStarted);
+	m_bWaiting = TRUE;
+	m_pServer->m_lock.Unlock();
+
+	//the socket does not time out, so the server cancels the thread in Receive if the header is overdue. A cancellation
+	//that arrives after the header is ignored, the server then leaves the connection to the thread.
+	BOOL received = m_pSock->Receive(&hdr, sizeof(hdr)) == sizeof(hdr);
+	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &cancelstate);
+
+	m_pServer->m_lock.Lock();
+	m_bWaiting = FALSE;
+	m_pServer->m_lock.Unlock();
+
+	m_pServer->Handshake(m_pSock, received ? &hdr : NULL);
+	m_pServer->m_lock.Lock();
+	m_bDone = TRUE;
+	m_pServer->m_lock.Unlock();
+}
+
+void ABYSessionServer::ExpireHandshakes(vector<CHandshakeThread*>& expired) {
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	for (uint32_t i = 0; i < m_vHandshakes.size();) {
+		if (m_vHandshakes[i]->m_bWaiting && getMillies(m_vHandshakes[i]->m_tStarted, now) > SESSION_HANDSHAKE_TIMEOUT_MS) {
+#ifdef DEBUGSESSION
+			cout << "Handshake expired" << endl;
+#endif
+			pthread_cancel(m_vHandshakes[i]->m_tThread);
+			m_vHandshakes[i]->m_bWaiting = FALSE;
+			expired.push_back(m_vHandshakes[i]);
+			m_vHandshakes[i] = m_vHandshakes.back();
+			m_vHandshakes.pop_back();
+		} else {
+			i++;
+		}
+	}
+}
+
+void ABYSessionServer::JoinExpiredHandshakes(vector<CHandshakeThread*>& expired) {
+	for (uint32_t i = 0; i < expired.size(); i++) {
+		expired[i]->Wait();
+		//a thread that was cancelled in Receive did not finish and leaves its connection to the server
+		if (!expired[i]->m_bDone) {
+			expired[i]->m_pSock->Close();
+			delete expired[i]->m_pSock;
+		}
+		delete expired[i];
+	}
+	expired.clear();
+}
+
+void ABYSessionServer::ReapHandshakes() {
+	for (uint32_t i = 0; i < m_vHandshakes.size();) {
+		if (m_vHandshakes[i]->m_bDone) {
+			m_vHandshakes[i]->Wait();
+			delete m_vHandshakes[i];
+			m_vHandshakes[i] = m_vHandshakes.back();
+			m_vHandshakes.pop_back();
+		} else {
+			i++;
+		}
+	}
+}
+
+void ABYSessionServer::ExpirePendingSessions() {
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	for (map<uint32_t, session_ctx*>::iterator it = m_mPendingSessions.begin(); it != m_mPendingSessions.end();) {
+		if (getMillies(it->second->created, now) > SESSION_PENDING_TIMEOUT_MS) {
+#ifdef DEBUGSESSION
+			cout << "Session " << it->first << " expired" << endl;
+#endif
+			it->second->sockets[0]->Close();
+			delete it->second->sockets[0];
+			delete it->second;
+			m_mPendingSessions.erase(it++);
+		} else {
+			it++;
+		}
+	}
+}
+
+//Accept blocks until the next connection arrives, so the server connects to itself once the last session is complete
+void ABYSessionServer::WakeAcceptLoop() {
+	CSocket sock;
+	if (sock.Socket() && sock.Connect(m_cAddress, m_nPort)) {
+		sock.Close();
+	}
+}
+
+void ABYSessionServer::PutSession(session_ctx* session) {
+	CSessionWorkerThread* worker = NULL;
+
+	m_lock.Lock();
+	m_vSessionQueue.push_back(session);
+	if (!m_vIdleWorkers.empty()) {
+		worker = m_vIdleWorkers.front();
+		m_vIdleWorkers.pop_front();
+	}
+	m_lock.Unlock();
+
+	if (worker) {
+		worker->m_evt.Set();
+	}
+}
+
+ABYSessionServer::session_ctx* ABYSessionServer::GetSession(CSessionWorkerThread* worker) {
+	session_ctx* session;
+
+	for (;;) {
+		m_lock.Lock();
+		if (!m_vSessionQueue.empty()) {
+			session = m_vSessionQueue.front();
+			m_vSessionQueue.pop_front();
+			m_lock.Unlock();
+			return session;
+		}
+		if (m_bStop) {
+			m_lock.Unlock();
+			return NULL;
+		}
+		//whoever takes the worker from the idle list wakes it up
+		m_vIdleWorkers.push_back(worker);
+		m_lock.Unlock();
+		worker->m_evt.Wait();
+	}
+}
+
+void ABYSessionServer::ExecSession(session_ctx* session) {
+#ifdef DEBUGSESSION
+	cout << "Executing session " << session->id << endl;
+#endif
+	ABYParty* party = new ABYParty(SERVER, session->sockets, m_sSecLvl, m_nBitLen, m_nNumThreads, m_eMTGenAlg, m_nMaxGates);
+	party->SetPhaseScheduler(this);
+	m_fSession(party, session->id, m_pSessionArg);
+	delete party;
+	delete session;
+
+	m_lock.Lock();
+	m_nServedSessions++;
+	m_lock.Unlock();
+	m_evtDone.Set();
+}
+
+void ABYSessionServer::CSessionWorkerThread::ThreadMain() {
+	session_ctx* session;
+	while ((session = m_pServer->GetSession(this)) != NULL) {
+		m_pServer->ExecSession(session);
+	}
+}
+
+ABYSessionServer::phase_queue* ABYSessionServer::GetPhaseQueue(ABYPHASE phase) {
+	if (phase == P_SETUP) {
+		return &m_sSetupQueue;
+	} else if (phase == P_ONLINE) {
+		return &m_sOnlineQueue;
+	}
+	return NULL;
+}
+
+void ABYSessionServer::EnterPhase(ABYPHASE phase) {
+	phase_queue* queue = GetPhaseQueue(phase);
+	if (queue == NULL) {
+		return;
+	}
+
+	m_lPhaseLock.Lock();
+	if (queue->limit == 0 || (queue->active < queue->limit && queue->waiting.empty())) {
+		queue->active++;
+		m_lPhaseLock.Unlock();
+		return;
+	}
+	//the session that leaves the phase hands its slot over to the first waiting session
+	CEvent admitted;
+	queue->waiting.push_back(&admitted);
+	m_lPhaseLock.Unlock();
+	admitted.Wait();
+}
+
+void ABYSessionServer::LeavePhase(ABYPHASE phase) {
+	phase_queue* queue = GetPhaseQueue(phase);
+	if (queue == NULL) {
+		return;
+	}
+
+	m_lPhaseLock.Lock();
+	if (!queue->waiting.empty() && (queue->limit == 0 || queue->active <= queue->limit)) {
+		queue->waiting.front()->Set();
+		queue->waiting.pop_front();
+	} else {
+		queue->active--;
+	}
+	m_lPhaseLock.Unlock();
+}
+
+ABYParty* ABYSessionServer::ConnectSession(char* addr, uint16_t port, seclvl seclvl, uint32_t bitlen, uint32_t nthreads,
+		e_mt_gen_alg mg_algo, uint32_t maxgates) {
+	vector<CSocket*> sockets(2, (CSocket*) NULL);
+	session_hdr hdr;
+	BOOL success = TRUE;
+
+	hdr.role = (uint32_t) CLIENT;
+	hdr.id = SESSION_NEW;
+	memset(hdr.token, 0, SESSION_TOKEN_BYTES);
+
+	for (uint32_t i = 0; i < sockets.size() && success; i++) {
+		sockets[i] = new CSocket();
+		success = FALSE;
+		//the server might not be listening yet
+		for (uint32_t j = 0; j < SESSION_CONNECT_RETRIES && !success; j++) {
+			success = sockets[i]->Socket() && sockets[i]->Connect(addr, port);
+			if (!success) {
+				sockets[i]->Close();
+				usleep(SESSION_RETRY_WAIT_MS * 1000);
+			}
+		}
+		hdr.index = i;
+		success = success && sockets[i]->Send(&hdr, sizeof(hdr)) == sizeof(hdr);
+		//the reply carries the id and the token of the session, which the second connection sends back
+		if (success && i == 0) {
+			success = sockets[i]->Receive(&hdr, sizeof(hdr)) == sizeof(hdr) && hdr.id != SESSION_NEW;
+		}
+	}
+
+	if (!success) {
+		cerr << "Could not connect to the session server at " << addr << ":" << port << endl;
+		for (uint32_t i = 0; i < sockets.size(); i++) {
+			if (sockets[i]) {
+				sockets[i]->Close();
+				delete sockets[i];
+			}
+		}
+		return NULL;
+	}
+	return new ABYParty(CLIENT, sockets, seclvl, bitlen, nthreads, mg_algo, maxgates);
+}
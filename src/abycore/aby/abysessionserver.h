@@ -0,0 +1,198 @@
+/**
+ \file 		abysessionserver.h
+ \author	michael.zohner@ec-spride.de
+ \copyright	ABY - A Framework for Efficient Mixed-protocol Secure Two-party Computation
+			Copyright (C) 2015 Engineering Cryptographic Protocols Group, TU Darmstadt
+			This program is free software: you can redistribute it and/or modify
+			it under the terms of the GNU Affero General Public License as published
+			by the Free Software Foundation, either version 3 of the License, or
+			(at your option) any later version.
+			This program is distributed in the hope that it will be useful,
+			but WITHOUT ANY WARRANTY; without even the implied warranty of
+			MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+			GNU Affero General Public License for more details.
+			You should have received a copy of the GNU Affero General Public License
+			along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief		Server that runs the sessions of many clients on one port and a bounded pool of worker threads.
+ */
+
+#ifndef __ABYSESSIONSERVER_H__
+#define __ABYSESSIONSERVER_H__
+
+#include "abyparty.h"
+#include <deque>
+#include <map>
+#include <pthread.h>
+
+//#define DEBUGSESSION
+
+#define SESSION_NEW ((uint32_t) -1)
+#define SESSION_TOKEN_BYTES 16 // random secret that identifies the second connection of a session
+#define SESSION_MAX_PENDING 256 // sessions of which only the first connection was accepted
+#define SESSION_MAX_HANDSHAKES 64 // connections whose header is read concurrently
+#define SESSION_HANDSHAKE_TIMEOUT_MS 5000 // time in which a connection has to send its header
+#define SESSION_PENDING_TIMEOUT_MS 30000 // time in which the second connection of a session has to arrive
+#define SESSION_CONNECT_RETRIES 200
+#define SESSION_RETRY_WAIT_MS 50
+
+/**
+ Header of every connection to the session server. The first connection of a session sends the id SESSION_NEW and
+ receives the id and the token of its session in reply, the second connection sends them back.
+ */
+struct session_hdr {
+	uint32_t role;
+	uint32_t index;
+	uint32_t id;
+	uint8_t token[SESSION_TOKEN_BYTES];
+};
+
+/**
+ Computation of a session, called on a worker thread with the server party of the session. The function builds and
+ executes the circuits of the session, the party is deleted when the function returns.
+ */
+typedef void (*aby_session_fn)(ABYParty* party, uint32_t sessionid, void* arg);
+
+/**
+ Accepts the connections of many clients on a single port and runs an independent ABYParty in the server role for each
+ client. The sessions are executed by a fixed number of worker threads in the order in which the clients connected, and
+ the setup and online phases of all sessions are admitted in first-come first-served order, such that at most a given
+ number of sessions computes a phase concurrently. The OT extension and garbling of the setup phase and the interactive
+ online phase thus interleave between sessions instead of competing for all cores at once.
+
+ Clients connect with ConnectSession instead of the ABYParty constructor, since the two connections of a session are
+ matched by a random token that the server hands out on the first connection. The headers of the connections are read
+ on short-lived handshake threads, such that a client that does not send its header cannot stall the other clients. A
+ connection whose header did not arrive within SESSION_HANDSHAKE_TIMEOUT_MS is closed when the next connection is
+ accepted, such that idle connections cannot occupy all handshake threads.
+
+ Each session runs its own base OTs and OT extension threads: the base OTs are shared with one particular client and
+ cannot be reused for the sessions of other clients, and the threads are bounded by the number of workers.
+ */
+class ABYSessionServer: public ABYPhaseScheduler {
+public:
+	/**
+	 \param addr		address to listen on
+	 \param port		port to listen on
+	 \param nworkers	number of sessions that are executed concurrently
+	 \param nthreads	number of threads of each session party, as in the ABYParty constructor
+	 */
+	ABYSessionServer(char* addr, uint16_t port, uint32_t nworkers, seclvl seclvl = LT, uint32_t bitlen = 32,
+			uint32_t nthreads = 2, e_mt_gen_alg mg_algo = MT_OT, uint32_t maxgates = 4000000);
+	/**
+	 Waits until the queued sessions were executed, and until the connections whose header is still read have sent it or
+	 exceeded SESSION_HANDSHAKE_TIMEOUT_MS
+	 */
+	~ABYSessionServer();
+
+	/** Maximal number of sessions that compute their setup and their online phase concurrently, 0 for no limit */
+	void SetPhaseLimits(uint32_t maxsetup, uint32_t maxonline);
+
+	/**
+	 Accepts clients and runs the session function for each of them on the worker threads. Returns when nsessions
+	 sessions were executed, or never if nsessions is 0.
+	 \return FALSE if the server could not listen on its port
+	 */
+	BOOL Run(aby_session_fn fn, void* arg, uint32_t nsessions);
+
+	/** Connects to a session server and returns the client party of a new session, or NULL on failure */
+	static ABYParty* ConnectSession(char* addr, uint16_t port, seclvl seclvl = LT, uint32_t bitlen = 32, uint32_t nthreads = 2,
+			e_mt_gen_alg mg_algo = MT_OT, uint32_t maxgates = 4000000);
+
+	uint32_t GetNumServedSessions() {
+		return m_nServedSessions;
+	}
+
+	void EnterPhase(ABYPHASE phase);
+	void LeavePhase(ABYPHASE phase);
+
+private:
+	/** First-come first-served admission to a phase */
+	struct phase_queue {
+		uint32_t limit;
+		uint32_t active;
+		deque<CEvent*> waiting;
+	};
+
+	struct session_ctx {
+		uint32_t id;
+		uint8_t token[SESSION_TOKEN_BYTES];
+		timespec created;
+		vector<CSocket*> sockets;
+	};
+
+	class CHandshakeThread: public CThread {
+	public:
+		CHandshakeThread(ABYSessionServer* server, CSocket* sock) :
+				m_pServer(server), m_pSock(sock), m_bWaiting(FALSE), m_bDone(FALSE) {
+		}
+		void ThreadMain();
+
+		ABYSessionServer* m_pServer;
+		CSocket* m_pSock;
+		// the following are set under the lock of the server
+		pthread_t m_tThread;
+		timespec m_tStarted; // time at which the thread started to wait for the header
+		BOOL m_bWaiting; // the thread waits for the header and can be cancelled
+		BOOL m_bDone; // the thread has finished
+	};
+
+	class CSessionWorkerThread: public CThread {
+	public:
+		CSessionWorkerThread(ABYSessionServer* server) :
+				m_pServer(server) {
+		}
+		void ThreadMain();
+
+		ABYSessionServer* m_pServer;
+		CEvent m_evt;
+	};
+
+	void AcceptConnection(CSocket* listener);
+	//opens a new session or completes a pending one with the header of a connection, hdr is NULL if it was not received
+	void Handshake(CSocket* sock, session_hdr* hdr);
+	//joins the cancelled handshakes and closes their connections, needs to be called without m_lock held
+	void JoinExpiredHandshakes(vector<CHandshakeThread*>& expired);
+	//the following need to be called with m_lock held
+	void ReapHandshakes();
+	//cancels the handshakes whose header is overdue and moves them to expired
+	void ExpireHandshakes(vector<CHandshakeThread*>& expired);
+	void ExpirePendingSessions();
+	void WakeAcceptLoop();
+	void PutSession(session_ctx* session);
+	//returns the next session of the worker, or NULL if the worker has to stop
+	session_ctx* GetSession(CSessionWorkerThread* worker);
+	void ExecSession(session_ctx* session);
+	phase_queue* GetPhaseQueue(ABYPHASE phase);
+
+	char* m_cAddress;
+	uint16_t m_nPort;
+	seclvl m_sSecLvl;
+	uint32_t m_nBitLen;
+	uint32_t m_nNumThreads;
+	e_mt_gen_alg m_eMTGenAlg;
+	uint32_t m_nMaxGates;
+
+	aby_session_fn m_fSession;
+	void* m_pSessionArg;
+
+	vector<CSessionWorkerThread*> m_vWorkers;
+	deque<CSessionWorkerThread*> m_vIdleWorkers;
+	deque<session_ctx*> m_vSessionQueue;
+	map<uint32_t, session_ctx*> m_mPendingSessions; // sessions of which only the first connection was accepted
+	vector<CHandshakeThread*> m_vHandshakes;
+	crypto* m_cCrypt; // generates the session tokens
+	uint32_t m_nNextSessionId;
+	uint32_t m_nAcceptedSessions;
+	uint32_t m_nAcceptTarget; // Run stops accepting when this number of sessions was accepted, 0 for never
+	BOOL m_bListening;
+	uint32_t m_nServedSessions;
+	BOOL m_bStop;
+	CLock m_lock;
+	CEvent m_evtDone; // set when a worker finished a session
+
+	phase_queue m_sSetupQueue;
+	phase_queue m_sOnlineQueue;
+	CLock m_lPhaseLock;
+};
+
+#endif /* __ABYSESSIONSERVER_H__ */
@@ -23,6 +23,7 @@ ABYSetup::ABYSetup(crypto* crypt, uint32_t numThreads, e_role role, e_mt_gen_alg
 	m_cCrypt = crypt;
 	m_eRole = role;
 	m_eMTGenAlg = mtalgo;
+	m_eROTGenAlg = ROT_IKNP;
 
 	if (!Init()) {
 		cerr << "Error in ABYSetup init" << endl;
@@ -40,6 +41,15 @@ BOOL ABYSetup::Init() {
 
 	m_vIKNPOTTasks.resize(2);
 	m_vKKOTTasks.resize(2);
+	m_vSilentOTTasks.resize(2);
+
+	m_nNumIKNPOTs = 0;
+	m_nNumKKOTs = 0;
+	m_nNumPKMTs = 0;
+	m_nNumSilentOTs = 0;
+
+	silent_ot_sender = NULL;
+	silent_ot_receiver = NULL;
 
 	uint32_t threadsize = 2 * m_nNumOTThreads;
 	m_vThreads.resize(threadsize);
@@ -78,6 +88,14 @@ void ABYSetup::Cleanup() {
 		m_tSetupChan->synchronize_end();
 		delete m_tSetupChan;
 	}
+	//the objects on the std sockets are deleted first, such that the channels of both parties end in the same order
+	if(m_eRole == SERVER) {
+		delete silent_ot_sender;
+		delete silent_ot_receiver;
+	} else {
+		delete silent_ot_receiver;
+		delete silent_ot_sender;
+	}
 	if(iknp_ot_sender) {
 		delete iknp_ot_sender;
 	}
@@ -131,6 +149,21 @@ BOOL ABYSetup::PrepareSetupPhase(comm_ctx* comm) {
 }
 
 BOOL ABYSetup::PerformSetupPhase() {
+	m_nNumIKNPOTs = 0;
+	m_nNumKKOTs = 0;
+	m_nNumPKMTs = 0;
+	m_nNumSilentOTs = 0;
+	for (uint32_t i = 0; i < 2; i++) {
+		for (uint32_t j = 0; j < m_vIKNPOTTasks[i].size(); j++)
+			m_nNumIKNPOTs += m_vIKNPOTTasks[i][j]->numOTs;
+		for (uint32_t j = 0; j < m_vKKOTTasks[i].size(); j++)
+			m_nNumKKOTs += m_vKKOTTasks[i][j]->numOTs;
+		for (uint32_t j = 0; j < m_vSilentOTTasks[i].size(); j++)
+			m_nNumSilentOTs += m_vSilentOTTasks[i][j]->numOTs;
+	}
+	for (uint32_t i = 0; i < m_vPKMTGenTasks.size(); i++)
+		m_nNumPKMTs += m_vPKMTGenTasks[i]->numMTs;
+
 	/* Compute OT extension */
 	WakeupWorkerThreads(e_IKNPOTExt);
 	BOOL success = WaitWorkerThreads();
@@ -140,10 +173,23 @@ BOOL ABYSetup::PerformSetupPhase() {
 	success &= WaitWorkerThreads();
 #endif
 
-	if (m_eMTGenAlg == MT_PAILLIER) {
-		//Start Paillier MT generation
-		WakeupWorkerThreads(e_MTPaillier);
+	//decided by the tasks rather than m_eROTGenAlg, which the party may change while a triple pool runs the setup
+	if (m_vSilentOTTasks[0].size() > 0 || m_vSilentOTTasks[1].size() > 0) {
+		InitSilentOT();
+		WakeupWorkerThreads(e_SilentOTExt);
 		success &= WaitWorkerThreads();
+	}
+
+	/* The homomorphic MT generation runs one task at a time, split among all worker threads: DJNParty holds a single share
+	 * length and the fixed-base tables of the other party's DGK key are global */
+	if (m_eMTGenAlg == MT_PAILLIER) {
+		for (uint32_t i = 0; i < m_vPKMTGenTasks.size(); i++) {
+			m_cPaillierMTGen->setSharelLength(m_vPKMTGenTasks[i]->sharebitlen);
+			m_nPKMTGenTask = i;
+			//Start Paillier MT generation
+			WakeupWorkerThreads(e_MTPaillier);
+			success &= WaitWorkerThreads();
+		}
 	} else if (m_eMTGenAlg == MT_DGK) {
 #ifndef BENCH_PRECOMP
 		m_cDGKMTGen = (DGKParty**) malloc(sizeof(DGKParty*) * m_vPKMTGenTasks.size());
@@ -153,19 +199,62 @@ BOOL ABYSetup::PerformSetupPhase() {
 			m_cDGKMTGen[i] = new DGKParty(m_cCrypt->get_seclvl().ifcbits, m_vPKMTGenTasks[i]->sharebitlen, 1);
 #endif
 			m_cDGKMTGen[i]->keyExchange(m_tSetupChan);
+			m_nPKMTGenTask = i;
+			//Start DGK MT generation
+			WakeupWorkerThreads(e_MTDGK);
+			success &= WaitWorkerThreads();
+			delete m_cDGKMTGen[i];
 		}
-		//Start DGK MT generation
-		WakeupWorkerThreads(e_MTDGK);
+		free(m_cDGKMTGen);
+	} else if (m_eMTGenAlg == MT_OLE && m_vPKMTGenTasks.size() > 0) {
+		InitSilentOT();
+		for (uint32_t i = 0; i < m_vPKMTGenTasks.size(); i++) {
+			for (uint32_t j = 0; j < 2; j++) {
+				m_vOLEShares[j].push_back(new CBitVector());
+				m_vOLEShares[j][i]->Create(m_vPKMTGenTasks[i]->numMTs, m_vPKMTGenTasks[i]->sharebitlen);
+			}
+		}
+		//one OLE on the own b and one on the random a, which the OLE receiver sets
+		WakeupWorkerThreads(e_MTOLE);
 		success &= WaitWorkerThreads();
 
 		for (uint32_t i = 0; i < m_vPKMTGenTasks.size(); i++) {
-			delete m_cDGKMTGen[i];
+			PKMTGenVals* ptask = m_vPKMTGenTasks[i];
+			uint32_t bitlen = ptask->sharebitlen;
+			for (uint32_t k = 0; k < ptask->numMTs; k++) {
+				uint64_t c = ptask->A->Get<uint64_t>(k * bitlen, bitlen) * ptask->B->Get<uint64_t>(k * bitlen, bitlen)
+						+ m_vOLEShares[0][i]->Get<uint64_t>(k * bitlen, bitlen) + m_vOLEShares[1][i]->Get<uint64_t>(k * bitlen, bitlen);
+				ptask->C->Set<uint64_t>(c, k * bitlen, bitlen);
+			}
+			for (uint32_t j = 0; j < 2; j++) {
+				delete m_vOLEShares[j][i];
+			}
 		}
-		free(m_cDGKMTGen);
+		m_vOLEShares[0].clear();
+		m_vOLEShares[1].clear();
+	}
+
+	for (uint32_t i = 0; i < m_vPKMTGenTasks.size(); i++) {
+		free(m_vPKMTGenTasks[i]);
 	}
+	m_vPKMTGenTasks.clear();
+
 	return success;
 }
 
+void ABYSetup::InitSilentOT() {
+	if (silent_ot_sender) {
+		return;
+	}
+	if (m_eRole == SERVER) {
+		silent_ot_sender = new SilentOTExtSnd(m_cCrypt, iknp_ot_sender, m_tComm->rcv_std, m_tComm->snd_std, m_nNumOTThreads);
+		silent_ot_receiver = new SilentOTExtRec(m_cCrypt, iknp_ot_receiver, m_tComm->rcv_inv, m_tComm->snd_inv, m_nNumOTThreads);
+	} else {
+		silent_ot_receiver = new SilentOTExtRec(m_cCrypt, iknp_ot_receiver, m_tComm->rcv_std, m_tComm->snd_std, m_nNumOTThreads);
+		silent_ot_sender = new SilentOTExtSnd(m_cCrypt, iknp_ot_sender, m_tComm->rcv_inv, m_tComm->snd_inv, m_nNumOTThreads);
+	}
+}
+
 BOOL ABYSetup::FinishSetupPhase() {
 	//Do nothing atm
 	return true;
@@ -256,6 +345,56 @@ BOOL ABYSetup::ThreadRunIKNPRcv(uint32_t exec) {
 	return success;
 }
 
+//The silent OTs are computed after the IKNP OTs, since their expansion uses the IKNP sender and receiver
+BOOL ABYSetup::ThreadRunSilentSnd(uint32_t exec) {
+	bool success = true;
+
+	uint32_t inverse = exec ^ m_eRole;
+
+	for (uint32_t i = 0; i < m_vSilentOTTasks[inverse].size(); i++) {
+		SilentOTTask* task = m_vSilentOTTasks[inverse][i];
+
+#ifndef BATCH
+		cout << "Starting silent OT sender routine for " << task->numOTs << " OTs on " << task->bitlen << " bit strings " << endl;
+#endif
+		success &= silent_ot_sender->send(task->numOTs, task->bitlen, task->pval.sndval.X0, task->pval.sndval.X1);
+#ifdef DEBUGSETUP
+		cout << "Silent OT sender results for bitlen = " << task->bitlen << ": " << endl;
+		cout << "X0: ";
+		task->pval.sndval.X0->PrintHex();
+		cout << "X1: ";
+		task->pval.sndval.X1->PrintHex();
+#endif
+		free(task);
+	}
+	m_vSilentOTTasks[inverse].resize(0);
+	return success;
+}
+
+BOOL ABYSetup::ThreadRunSilentRcv(uint32_t exec) {
+	bool success = true;
+
+	uint32_t inverse = exec ^ m_eRole;
+
+	for (uint32_t i = 0; i < m_vSilentOTTasks[inverse].size(); i++) {
+		SilentOTTask* task = m_vSilentOTTasks[inverse][i];
+
+#ifndef BATCH
+		cout << "Starting silent OT receiver routine for " << task->numOTs << " OTs on " << task->bitlen << " bit strings " << endl;
+#endif
+		success &= silent_ot_receiver->receive(task->numOTs, task->bitlen, task->pval.rcvval.C, task->pval.rcvval.R);
+#ifdef DEBUGSETUP
+		cout << "Silent OT receiver results for bitlen = " << task->bitlen << ": " << endl;
+		cout << "C: ";
+		task->pval.rcvval.C->PrintBinary();
+		cout << "R: ";
+		task->pval.rcvval.R->PrintHex();
+#endif
+		free(task);
+	}
+	m_vSilentOTTasks[inverse].resize(0);
+	return success;
+}
 
 //KK13 OT extension sender and receiver routine outsourced in separate threads
 BOOL ABYSetup::ThreadRunKKSnd(uint32_t exec) {
@@ -328,36 +467,46 @@ BOOL ABYSetup::ThreadRunKKRcv(uint32_t exec) {
 }
 
 
-BOOL ABYSetup::ThreadRunPaillierMTGen(uint32_t threadid) {
-
+//Splits the MTs of the current task evenly among all threads. The server encrypts the a and b of the first half of
+//a thread's MTs and the client those of the second half, the other party computes the products on the ciphertexts.
+void ABYSetup::GetPKMTGenPart(PKMTGenVals* ptask, uint32_t threadid, uint64_t* ownpos, uint32_t* numown, uint64_t* otherpos, uint32_t* numother) {
 	uint32_t nthreads = 2 * m_nNumOTThreads;
+	uint32_t sharebytelen = ceil_divide(ptask->sharebitlen, 8);
 
-	channel* djnchan = new channel(DJN_CHANNEL+threadid, m_tComm->rcv_std, m_tComm->snd_std);
-	for (uint32_t i = 0; i < m_vPKMTGenTasks.size(); i++) {
+	uint32_t mynummts = ptask->numMTs / nthreads + (threadid < ptask->numMTs % nthreads);
+	uint64_t mystartpos = (uint64_t) threadid * (ptask->numMTs / nthreads) + min(threadid, ptask->numMTs % nthreads);
 
-		PKMTGenVals* ptask = m_vPKMTGenTasks[i];
+	uint32_t numfirst = mynummts / 2;
+	uint64_t firstpos = mystartpos * sharebytelen;
+	uint64_t secondpos = (mystartpos + numfirst) * sharebytelen;
+
+	if (m_eRole == SERVER) {
+		*ownpos = firstpos;
+		*numown = numfirst;
+		*otherpos = secondpos;
+		*numother = mynummts - numfirst;
+	} else {
+		*ownpos = secondpos;
+		*numown = mynummts - numfirst;
+		*otherpos = firstpos;
+		*numother = numfirst;
+	}
+}
 
-		uint32_t nummtsperthread = ceil_divide(ptask->numMTs, nthreads);
+BOOL ABYSetup::ThreadRunPaillierMTGen(uint32_t threadid) {
+	PKMTGenVals* ptask = m_vPKMTGenTasks[m_nPKMTGenTask];
+	uint64_t ownpos, otherpos;
+	uint32_t numown, numother;
 
-		uint32_t mynummts = nummtsperthread; //times two since we need the number of MTs to be a multiple of 2 internally
-		uint32_t sharebytelen = ceil_divide(ptask->sharebitlen, 8);
-		if (threadid == nthreads - 1) {
-			mynummts = ptask->numMTs - (nthreads-1 ) * nummtsperthread;
-		}
+	GetPKMTGenPart(ptask, threadid, &ownpos, &numown, &otherpos, &numother);
 
-		uint32_t mystartpos = nummtsperthread * threadid * sharebytelen;
-		m_cPaillierMTGen->setSharelLength(ptask->sharebitlen);
+	channel* djnchan = new channel(DJN_CHANNEL+threadid, m_tComm->rcv_std, m_tComm->snd_std);
 
-		UINT32_T roleoffset = mystartpos + sharebytelen * (mynummts / 2);
-		if (m_eRole == SERVER) {
-			m_cPaillierMTGen->preCompBench(ptask->A->GetArr() + mystartpos, ptask->B->GetArr() + mystartpos, ptask->C->GetArr() + mystartpos, ptask->A->GetArr() + roleoffset,
-					ptask->B->GetArr() + roleoffset, ptask->C->GetArr() + roleoffset, mynummts, djnchan);
-		} else {
-			m_cPaillierMTGen->preCompBench(ptask->A->GetArr() + roleoffset, ptask->B->GetArr() + roleoffset, ptask->C->GetArr() + roleoffset, ptask->A->GetArr() + mystartpos,
-					ptask->B->GetArr() + mystartpos, ptask->C->GetArr() + mystartpos, mynummts, djnchan);
-		}
-		free(ptask);
+	if (numown + numother > 0) {
+		m_cPaillierMTGen->preCompBench(ptask->A->GetArr() + ownpos, ptask->B->GetArr() + ownpos, ptask->C->GetArr() + ownpos, ptask->A->GetArr() + otherpos,
+				ptask->B->GetArr() + otherpos, ptask->C->GetArr() + otherpos, numown, numother, djnchan);
 	}
+
 	djnchan->synchronize_end();
 	delete djnchan;
 
@@ -365,42 +514,50 @@ BOOL ABYSetup::ThreadRunPaillierMTGen(uint32_t threadid) {
 }
 
 BOOL ABYSetup::ThreadRunDGKMTGen(uint32_t threadid) {
+	PKMTGenVals* ptask = m_vPKMTGenTasks[m_nPKMTGenTask];
+	uint64_t ownpos, otherpos;
+	uint32_t numown, numother;
 
-	uint32_t nthreads = 2 * m_nNumOTThreads;
+	GetPKMTGenPart(ptask, threadid, &ownpos, &numown, &otherpos, &numother);
 
 	channel* dgkchan = new channel(DGK_CHANNEL+threadid, m_tComm->rcv_std, m_tComm->snd_std);
 
-	for (uint32_t i = 0; i < m_vPKMTGenTasks.size(); i++) {
-		PKMTGenVals* ptask = m_vPKMTGenTasks[i];
-
-		//times two since we need the number of MTs to be a multiple of 2 internally
-		uint32_t nummtsperthread = ceil_divide(ptask->numMTs, nthreads);
-		uint32_t mynummts = nummtsperthread;
-		uint32_t sharebytelen = ceil_divide(ptask->sharebitlen, 8);
+	if (numown + numother > 0) {
+		m_cDGKMTGen[m_nPKMTGenTask]->preCompBench(ptask->A->GetArr() + ownpos, ptask->B->GetArr() + ownpos, ptask->C->GetArr() + ownpos,
+				ptask->A->GetArr() + otherpos, ptask->B->GetArr() + otherpos, ptask->C->GetArr() + otherpos, numown, numother, dgkchan);
+	}
 
-		//if the number of MTs is not evenly divisible among all threads
-		if (threadid == nthreads - 1) {
-			mynummts = ptask->numMTs - (nthreads-1 ) * nummtsperthread;
-		}
+	dgkchan->synchronize_end();
+	delete dgkchan;
 
-		uint32_t mystartpos = nummtsperthread * threadid * sharebytelen;
+	return true;
+}
 
-		//add an offset depending on the role of the party
-		UINT32_T roleoffset = mystartpos + sharebytelen * (mynummts / 2);
+//The sender thread multiplies the own b with the other party's a, the receiver thread the other party's b with the own a
+BOOL ABYSetup::ThreadRunOLEMTGenSnd(uint32_t exec) {
+	BOOL success = TRUE;
 
-		if (m_eRole == SERVER) {
-			m_cDGKMTGen[i]->preCompBench(ptask->A->GetArr() + mystartpos, ptask->B->GetArr() + mystartpos, ptask->C->GetArr() + mystartpos, ptask->A->GetArr() + roleoffset,
-					ptask->B->GetArr() + roleoffset, ptask->C->GetArr() + roleoffset, mynummts, dgkchan);
-		} else {
-			m_cDGKMTGen[i]->preCompBench(ptask->A->GetArr() + roleoffset, ptask->B->GetArr() + roleoffset, ptask->C->GetArr() + roleoffset, ptask->A->GetArr() + mystartpos,
-					ptask->B->GetArr() + mystartpos, ptask->C->GetArr() + mystartpos, mynummts, dgkchan);
-		}
-		free(ptask);
+	for (uint32_t i = 0; i < m_vPKMTGenTasks.size(); i++) {
+		PKMTGenVals* ptask = m_vPKMTGenTasks[i];
+#ifndef BATCH
+		cout << "Starting OLE sender routine for " << ptask->numMTs << " MTs on " << ptask->sharebitlen << " bit shares" << endl;
+#endif
+		success &= silent_ot_sender->send_ole(ptask->numMTs, ptask->sharebitlen, ptask->B, m_vOLEShares[0][i]);
 	}
-	dgkchan->synchronize_end();
-	delete dgkchan;
+	return success;
+}
 
-	return true;
+BOOL ABYSetup::ThreadRunOLEMTGenRcv(uint32_t exec) {
+	BOOL success = TRUE;
+
+	for (uint32_t i = 0; i < m_vPKMTGenTasks.size(); i++) {
+		PKMTGenVals* ptask = m_vPKMTGenTasks[i];
+#ifndef BATCH
+		cout << "Starting OLE receiver routine for " << ptask->numMTs << " MTs on " << ptask->sharebitlen << " bit shares" << endl;
+#endif
+		success &= silent_ot_receiver->receive_ole(ptask->numMTs, ptask->sharebitlen, ptask->A, m_vOLEShares[1][i]);
+	}
+	return success;
 }
 
 //starts a new sending thread but may stop if there is a thread already running
@@ -501,6 +658,12 @@ void ABYSetup::CWorkerThread::ThreadMain() {
 			else
 				bSuccess = m_pCallback->ThreadRunKKRcv(threadid);
 			break;
+		case e_SilentOTExt:
+			if (threadid == SERVER)
+				bSuccess = m_pCallback->ThreadRunSilentSnd(threadid);
+			else
+				bSuccess = m_pCallback->ThreadRunSilentRcv(threadid);
+			break;
 		case e_NP:
 			if (threadid == SERVER)
 				bSuccess = m_pCallback->ThreadRunNPSnd(threadid);
@@ -513,6 +676,12 @@ void ABYSetup::CWorkerThread::ThreadMain() {
 		case e_MTDGK:
 			bSuccess = m_pCallback->ThreadRunDGKMTGen(threadid);
 			break;
+		case e_MTOLE:
+			if (threadid == SERVER)
+				bSuccess = m_pCallback->ThreadRunOLEMTGenSnd(threadid);
+			else
+				bSuccess = m_pCallback->ThreadRunOLEMTGenRcv(threadid);
+			break;
 		case e_Send:
 			bSuccess = m_pCallback->ThreadSendData(threadid);
 			break;
@@ -537,4 +706,7 @@ void ABYSetup::Reset() {
 	for (uint32_t i = 0; i < m_vKKOTTasks.size(); i++) {
 		m_vKKOTTasks[i].clear();
 	}
+	for (uint32_t i = 0; i < m_vSilentOTTasks.size(); i++) {
+		m_vSilentOTTasks[i].clear();
+	}
 }
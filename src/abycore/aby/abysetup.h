@@ -30,6 +30,7 @@
 #include "../ot/iknp-ot-ext-rec.h"
 #include "../ot/kk-ot-ext-snd.h"
 #include "../ot/kk-ot-ext-rec.h"
+#include "silentot.h"
 #include "../DJN/djnparty.h"
 #include "../DGK/dgkparty.h"
 #include "../ENCRYPTO_utils/constants.h"
@@ -103,6 +104,13 @@ struct KK_OTTask {
 	KKPartyValues pval;   //contains the sender and receivers input and output
 };
 
+/* Random OTs of the silent OT extension, see SilentOTExtSnd */
+struct SilentOTTask {
+	uint32_t numOTs;	//number of OTs that are performed
+	uint32_t bitlen; //bitlen in the OTs, at most SILENT_OT_MAX_BITLEN
+	IKNPPartyValues pval;   //contains the sender's outputs X0 and X1 or the receiver's random choice bits C and outputs R
+};
+
 struct SendTask {
 	uint64_t sndbytes; 	//number of bytes to be sent
 	BYTE* sndbuf; 	  	//buffer for the result
@@ -135,6 +143,11 @@ public:
 	}
 	;
 
+	void AddSilentOTTask(SilentOTTask* task, uint32_t inverse) {
+		m_vSilentOTTasks[inverse].push_back(task);
+	}
+	;
+
 	void AddPKMTGenTask(PKMTGenVals* task) {
 		m_vPKMTGenTasks.push_back(task);
 	}
@@ -146,6 +159,32 @@ public:
 
 	BOOL WaitForTransmissionEnd();
 
+	//Number of OTs and public-key MTs that were generated in the last setup phase
+	uint64_t GetNumIKNPOTs() {
+		return m_nNumIKNPOTs;
+	}
+	uint64_t GetNumKKOTs() {
+		return m_nNumKKOTs;
+	}
+	uint64_t GetNumPKMTs() {
+		return m_nNumPKMTs;
+	}
+	uint64_t GetNumSilentOTs() {
+		return m_nNumSilentOTs;
+	}
+
+	//Method that generates the random OTs of tasks that have the choice between IKNP and silent OT. Has to be the same for both parties
+	void SetRandomOTGenAlg(e_rot_gen_alg alg) {
+		m_eROTGenAlg = alg;
+	}
+	e_rot_gen_alg GetRandomOTGenAlg() {
+		return m_eROTGenAlg;
+	}
+	//Whether numOTs random OTs on bitlen bit strings should be added as SilentOTTask instead of IKNP_OTTask
+	BOOL UseSilentOT(uint32_t numOTs, uint32_t bitlen) {
+		return m_eROTGenAlg == ROT_SILENT && bitlen <= SILENT_OT_MAX_BITLEN && numOTs >= SILENT_OT_MIN_OTS;
+	}
+
 private:
 	BOOL Init();
 	void Cleanup();
@@ -159,11 +198,22 @@ private:
 	BOOL ThreadRunKKSnd(uint32_t exec);
 	BOOL ThreadRunKKRcv(uint32_t exec);
 
+	BOOL ThreadRunSilentSnd(uint32_t exec);
+	BOOL ThreadRunSilentRcv(uint32_t exec);
+
 	BOOL ThreadSendData(uint32_t exec);
 	BOOL ThreadReceiveData(uint32_t exec);
 
 	BOOL ThreadRunPaillierMTGen(uint32_t exec);
 	BOOL ThreadRunDGKMTGen(uint32_t threadid);
+	//the byte positions and numbers of the MTs of the current PK task that the thread computes with the own and with the other party's key
+	void GetPKMTGenPart(PKMTGenVals* ptask, uint32_t threadid, uint64_t* ownpos, uint32_t* numown, uint64_t* otherpos, uint32_t* numother);
+
+	BOOL ThreadRunOLEMTGenSnd(uint32_t exec);
+	BOOL ThreadRunOLEMTGenRcv(uint32_t exec);
+
+	//creates the silent OT sender and receiver on their first use
+	void InitSilentOT();
 
 	// IKNP OTTask values
 	vector<vector<IKNP_OTTask*> > m_vIKNPOTTasks;
@@ -171,17 +221,29 @@ private:
 	// KK OTTask values
 	vector<vector<KK_OTTask*> > m_vKKOTTasks;
 
+	// Silent OTTask values
+	vector<vector<SilentOTTask*> > m_vSilentOTTasks;
+
 	vector<PKMTGenVals*> m_vPKMTGenTasks;
 	DJNParty* m_cPaillierMTGen;
 	DGKParty** m_cDGKMTGen;
+	uint32_t m_nPKMTGenTask; // task of m_vPKMTGenTasks that the worker threads currently compute
+	//the shares of a*b of the other party's a and of the other party's b for each MT generation task in the MT_OLE mode
+	vector<CBitVector*> m_vOLEShares[2];
 
 	uint32_t m_nNumOTThreads;
 	e_role m_eRole;
 
+	uint64_t m_nNumIKNPOTs;
+	uint64_t m_nNumKKOTs;
+	uint64_t m_nNumPKMTs;
+	uint64_t m_nNumSilentOTs;
+
 	SendTask m_tsndtask;
 	ReceiveTask m_trcvtask;
 
 	e_mt_gen_alg m_eMTGenAlg;
+	e_rot_gen_alg m_eROTGenAlg;
 
 	crypto* m_cCrypt;
 
@@ -191,6 +253,10 @@ private:
 	OTExtSnd *kk_ot_sender;
 	OTExtRec *kk_ot_receiver;
 
+	//created in the first setup phase with silent OT tasks on the sockets of the respective IKNP object
+	SilentOTExtSnd *silent_ot_sender;
+	SilentOTExtRec *silent_ot_receiver;
+
 	comm_ctx* m_tComm;
 
 	channel* m_tSetupChan;
@@ -200,7 +266,7 @@ private:
 	/* Thread information */
 
 	enum EJobType {
-		e_IKNPOTExt, e_KKOTExt, e_NP, e_Send, e_Receive, e_Transmit, e_Stop, e_MTPaillier, e_MTDGK, e_Undefined
+		e_IKNPOTExt, e_KKOTExt, e_SilentOTExt, e_NP, e_Send, e_Receive, e_Transmit, e_Stop, e_MTPaillier, e_MTDGK, e_MTOLE, e_Undefined
 	};
 
 	BOOL WakeupWorkerThreads(EJobType);
@@ -0,0 +1,157 @@
+/**
+ \file 		abystats.cpp
+ \author	michael.zohner@ec-spride.de
+ \copyright	ABY - A Framework for Efficient Mixed-protocol Secure Two-party Computation
+			Copyright (C) 2015 Engineering Cryptographic Protocols Group, TU Darmstadt
+			This program is free software: you can redistribute it and/or modify
+			it under the terms of the GNU Affero General Public License as published
+			by the Free Software Foundation, either version 3 of the License, or
+			(at your option) any later version.
+			This program is distributed in the hope that it will be useful,
+			but WITHOUT ANY WARRANTY; without even the implied warranty of
+			MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+			GNU Affero General Public License for more details.
+			You should have received a copy of the GNU Affero General Public License
+			along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief		Runtime statistics of an ABYParty execution.
+ */
+
+#include "abystats.h"
+#include <sstream>
+#include <iostream>
+#include <cstring>
+
+static const char* get_phase_json_name(uint32_t phase) {
+	switch (phase) {
+	case P_TOTAL: return "total";
+	case P_INIT: return "init";
+	case P_CIRCUIT: return "circuit";
+	case P_NETWORK: return "network";
+	case P_BASE_OT: return "base_ot";
+	case P_SETUP: return "setup";
+	case P_OT_EXT: return "ot_ext";
+	case P_GARBLE: return "garble";
+	case P_ONLINE: return "online";
+	default: return "unknown";
+	}
+}
+
+void ABYStats::Reset(uint32_t nsharings) {
+	m_vSharings.clear();
+	m_vSharings.resize(nsharings);
+	InitLayers(0);
+	for (uint32_t i = 0; i < nsharings; i++) {
+		m_vSharings[i].nnonlinops = 0;
+		m_vSharings[i].nrounds = 0;
+		m_vSharings[i].plannedbytes = 0;
+	}
+	m_nInteractionTime = 0;
+	m_nRounds = 0;
+	m_nSkippedRounds = 0;
+	m_nIKNPOTs = 0;
+	m_nKKOTs = 0;
+	m_nPKMTs = 0;
+	SetOptimization(0, 0, 0, 0, 0);
+	SetRebalancing(0, 0, 0);
+	for (uint32_t i = 0; i <= P_LAST; i++) {
+		m_vPhaseTime[i] = 0;
+		m_vPhaseSent[i] = 0;
+		m_vPhaseReceived[i] = 0;
+	}
+}
+
+void ABYStats::InitLayers(uint32_t maxdepth) {
+	for (uint32_t i = 0; i < m_vSharings.size(); i++) {
+		m_vSharings[i].layers.resize(maxdepth);
+		if (maxdepth > 0) {
+			memset(m_vSharings[i].layers.data(), 0, maxdepth * sizeof(layer_stats));
+		}
+		memset(&(m_vSharings[i].total), 0, sizeof(layer_stats));
+	}
+	m_nInteractionTime = 0;
+	m_nRounds = 0;
+	m_nSkippedRounds = 0;
+}
+
+void ABYStats::ComputeTotals() {
+	for (uint32_t i = 0; i < m_vSharings.size(); i++) {
+		layer_stats& total = m_vSharings[i].total;
+		memset(&total, 0, sizeof(layer_stats));
+		for (uint32_t d = 0; d < m_vSharings[i].layers.size(); d++) {
+			layer_stats& layer = m_vSharings[i].layers[d];
+			total.localops += layer.localops;
+			total.interactiveops += layer.interactiveops;
+			total.fincirclayer += layer.fincirclayer;
+			total.sndbytes += layer.sndbytes;
+			total.rcvbytes += layer.rcvbytes;
+			total.nlocalgates += layer.nlocalgates;
+			total.ninteractivegates += layer.ninteractivegates;
+		}
+	}
+}
+
+void ABYStats::AddInteraction(double time, BOOL skipped) {
+	m_nInteractionTime += time;
+	m_nRounds++;
+	if (skipped) {
+		m_nSkippedRounds++;
+	}
+}
+
+void ABYStats::SetPhase(ABYPHASE phase, double time, uint64_t sent, uint64_t received) {
+	m_vPhaseTime[phase] = time;
+	m_vPhaseSent[phase] = sent;
+	m_vPhaseReceived[phase] = received;
+}
+
+void ABYStats::PrintOnlineStatistics() {
+	cout << "Online time is distributed as follows: " << endl;
+	for (uint32_t i = 0; i < m_vSharings.size(); i++) {
+		cout << get_sharing_name((e_sharing) i) << ": local gates: " << m_vSharings[i].total.localops << ", interactive gates: "
+				<< m_vSharings[i].total.interactiveops << ", layer finish: " << m_vSharings[i].total.fincirclayer << endl;
+	}
+	cout << "Communication: " << m_nInteractionTime << ", rounds without interaction: " << m_nSkippedRounds << " of " << m_nRounds << endl;
+}
+
+static void layer_to_json(stringstream& out, layer_stats& layer) {
+	out << "{\"localops_ms\": " << layer.localops << ", \"interactiveops_ms\": " << layer.interactiveops
+			<< ", \"fincirclayer_ms\": " << layer.fincirclayer << ", \"sent_bytes\": " << layer.sndbytes
+			<< ", \"received_bytes\": " << layer.rcvbytes << ", \"local_gates\": " << layer.nlocalgates
+			<< ", \"interactive_gates\": " << layer.ninteractivegates << "}";
+}
+
+string ABYStats::ToJSON(BOOL perlayer) {
+	stringstream out;
+
+	out << "{\"phases\": {";
+	for (uint32_t i = 0; i <= P_LAST; i++) {
+		out << (i > 0 ? ", " : "") << "\"" << get_phase_json_name(i) << "\": {\"time_ms\": " << m_vPhaseTime[i]
+				<< ", \"sent_bytes\": " << m_vPhaseSent[i] << ", \"received_bytes\": " << m_vPhaseReceived[i] << "}";
+	}
+	out << "}, \"optimization\": {\"folded_gates\": " << m_nOptFolded << ", \"merged_gates\": " << m_nOptMerged
+			<< ", \"removed_gates\": " << m_nOptRemoved << ", \"ands_before\": " << m_nOptANDsBefore << ", \"ands_after\": "
+			<< m_nOptANDsAfter << "}";
+	out << ", \"rebalancing\": {\"rebalanced_trees\": " << m_nRebalancedTrees << ", \"depth_before\": "
+			<< m_nDepthBeforeRebalancing << ", \"depth_after\": " << m_nDepthAfterRebalancing << "}";
+	out << ", \"setup\": {\"iknp_ots\": " << m_nIKNPOTs << ", \"kk_ots\": " << m_nKKOTs << ", \"pk_mts\": " << m_nPKMTs << "}";
+	out << ", \"online\": {\"interaction_ms\": " << m_nInteractionTime << ", \"rounds\": " << m_nRounds
+			<< ", \"skipped_rounds\": " << m_nSkippedRounds << ", \"sharings\": {";
+	for (uint32_t i = 0; i < m_vSharings.size(); i++) {
+		out << (i > 0 ? ", " : "") << "\"" << get_sharing_name((e_sharing) i) << "\": {\"nonlinear_ops\": "
+				<< m_vSharings[i].nnonlinops << ", \"rounds\": " << m_vSharings[i].nrounds << ", \"planned_gate_bytes\": "
+				<< m_vSharings[i].plannedbytes << ", \"total\": ";
+		layer_to_json(out, m_vSharings[i].total);
+		if (perlayer) {
+			out << ", \"layers\": [";
+			for (uint32_t d = 0; d < m_vSharings[i].layers.size(); d++) {
+				out << (d > 0 ? ", " : "");
+				layer_to_json(out, m_vSharings[i].layers[d]);
+			}
+			out << "]";
+		}
+		out << "}";
+	}
+	out << "}}}";
+
+	return out.str();
+}
@@ -0,0 +1,178 @@
+/**
+ \file 		abystats.h
+ \author	michael.zohner@ec-spride.de
+ \copyright	ABY - A Framework for Efficient Mixed-protocol Secure Two-party Computation
+			Copyright (C) 2015 Engineering Cryptographic Protocols Group, TU Darmstadt
+			This program is free software: you can redistribute it and/or modify
+			it under the terms of the GNU Affero General Public License as published
+			by the Free Software Foundation, either version 3 of the License, or
+			(at your option) any later version.
+			This program is distributed in the hope that it will be useful,
+			but WITHOUT ANY WARRANTY; without even the implied warranty of
+			MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+			GNU Affero General Public License for more details.
+			You should have received a copy of the GNU Affero General Public License
+			along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief		Runtime statistics of an ABYParty execution.
+ */
+
+#ifndef __ABYSTATS_H__
+#define __ABYSTATS_H__
+
+#include "../ENCRYPTO_utils/typedefs.h"
+#include "../ENCRYPTO_utils/constants.h"
+#include "../ABY_utils/ABYconstants.h"
+#include <vector>
+#include <string>
+
+using namespace std;
+
+/** Statistics of one sharing on one layer of the online phase, times are given in ms */
+typedef struct aby_layer_stats {
+	double localops; //time spent in EvaluateLocalOperations
+	double interactiveops; //time spent in EvaluateInteractiveOperations
+	double fincirclayer; //time spent in FinishCircuitLayer
+	uint64_t sndbytes; //bytes sent by the sharing
+	uint64_t rcvbytes; //bytes received by the sharing
+	uint64_t nlocalgates; //gates in the local queue
+	uint64_t ninteractivegates; //gates in the interactive queue
+} layer_stats;
+
+/** Statistics of one sharing over the whole online phase */
+typedef struct aby_sharing_stats {
+	vector<layer_stats> layers; //statistics for each layer
+	layer_stats total; //sum over all layers
+	uint64_t nnonlinops; //number of non-linear operations (AND / MUL gates)
+	uint32_t nrounds; //number of communication rounds of the sharing
+	uint64_t plannedbytes; //bytes reserved for the gate values by ABYParty::PlanGateBuffers, 0 if no plan was made
+} sharing_stats;
+
+/**
+ Collects per-sharing and per-layer statistics of the online phase, the number of OTs and MTs of the setup phase and
+ the timing and communication of the phases. Is always filled by ABYParty and can be exported as JSON.
+ */
+class ABYStats {
+public:
+	ABYStats() {
+		Reset(0);
+	}
+
+	/** Clears all statistics */
+	void Reset(uint32_t nsharings);
+
+	/**
+	 Allocates and clears the statistics of the layers. Has to be called before the layers are updated concurrently.
+	 */
+	void InitLayers(uint32_t maxdepth);
+
+	layer_stats& GetLayerStats(uint32_t sharing, uint32_t depth) {
+		return m_vSharings[sharing].layers[depth];
+	}
+
+	sharing_stats& GetSharingStats(uint32_t sharing) {
+		return m_vSharings[sharing];
+	}
+
+	uint32_t GetNumSharings() {
+		return m_vSharings.size();
+	}
+
+	/** Sums up the layers of every sharing, needs to be called at the end of the online phase */
+	void ComputeTotals();
+
+	/** Adds the time of one interaction round or notes that a round without interaction was skipped */
+	void AddInteraction(double time, BOOL skipped);
+
+	double GetInteractionTime() {
+		return m_nInteractionTime;
+	}
+
+	uint32_t GetNumRounds() {
+		return m_nRounds;
+	}
+
+	uint32_t GetNumSkippedRounds() {
+		return m_nSkippedRounds;
+	}
+
+	void SetNumOTs(uint64_t iknpots, uint64_t kkots, uint64_t pkmts) {
+		m_nIKNPOTs = iknpots;
+		m_nKKOTs = kkots;
+		m_nPKMTs = pkmts;
+	}
+
+	uint64_t GetNumIKNPOTs() {
+		return m_nIKNPOTs;
+	}
+
+	uint64_t GetNumKKOTs() {
+		return m_nKKOTs;
+	}
+
+	uint64_t GetNumPKMTs() {
+		return m_nPKMTs;
+	}
+
+	/** Stores the result of the circuit optimization, see ABYParty::SetCircuitOptimization */
+	void SetOptimization(uint32_t nfolded, uint32_t nmerged, uint32_t nremoved, uint64_t nandsbefore, uint64_t nandsafter) {
+		m_nOptFolded = nfolded;
+		m_nOptMerged = nmerged;
+		m_nOptRemoved = nremoved;
+		m_nOptANDsBefore = nandsbefore;
+		m_nOptANDsAfter = nandsafter;
+	}
+
+	uint64_t GetNumANDsBeforeOptimization() {
+		return m_nOptANDsBefore;
+	}
+
+	uint64_t GetNumANDsAfterOptimization() {
+		return m_nOptANDsAfter;
+	}
+
+	/** Stores the result of the depth rebalancing, see ABYParty::SetDepthRebalancing */
+	void SetRebalancing(uint32_t nrebalanced, uint32_t ndepthbefore, uint32_t ndepthafter) {
+		m_nRebalancedTrees = nrebalanced;
+		m_nDepthBeforeRebalancing = ndepthbefore;
+		m_nDepthAfterRebalancing = ndepthafter;
+	}
+
+	uint32_t GetDepthBeforeRebalancing() {
+		return m_nDepthBeforeRebalancing;
+	}
+
+	uint32_t GetDepthAfterRebalancing() {
+		return m_nDepthAfterRebalancing;
+	}
+
+	/** Stores the time and communication of the phases, as also returned by ABYParty::GetTiming / GetSentData */
+	void SetPhase(ABYPHASE phase, double time, uint64_t sent, uint64_t received);
+
+	/** Prints the distribution of the online time over the sharings */
+	void PrintOnlineStatistics();
+
+	/** \param perlayer also export the statistics of the single layers */
+	string ToJSON(BOOL perlayer = TRUE);
+
+private:
+	vector<sharing_stats> m_vSharings;
+	double m_nInteractionTime;
+	uint32_t m_nRounds;
+	uint32_t m_nSkippedRounds;
+	uint64_t m_nIKNPOTs;
+	uint64_t m_nKKOTs;
+	uint64_t m_nPKMTs;
+	uint32_t m_nOptFolded;
+	uint32_t m_nOptMerged;
+	uint32_t m_nOptRemoved;
+	uint64_t m_nOptANDsBefore;
+	uint64_t m_nOptANDsAfter;
+	uint32_t m_nRebalancedTrees;
+	uint32_t m_nDepthBeforeRebalancing;
+	uint32_t m_nDepthAfterRebalancing;
+	double m_vPhaseTime[P_LAST + 1];
+	uint64_t m_vPhaseSent[P_LAST + 1];
+	uint64_t m_vPhaseReceived[P_LAST + 1];
+};
+
+#endif //__ABYSTATS_H__
@@ -0,0 +1,478 @@
+/**
+ \file 		abytriplepool.cpp
+ \author	michael.zohner@ec-spride.de
+ \copyright	ABY - A Framework for Efficient Mixed-protocol Secure Two-party Computation
+			Copyright (C) 2015 Engineering Cryptographic Protocols Group, TU Darmstadt
+			This program is free software: you can redistribute it and/or modify
+			it under the terms of the GNU Affero General Public License as published
+			by the Free Software Foundation, either version 3 of the License, or
+			(at your option) any later version.
+			This program is distributed in the hope that it will be useful,
+			but WITHOUT ANY WARRANTY; without even the implied warranty of
+			MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+			GNU Affero General Public License for more details.
+			You should have received a copy of the GNU Affero General Public License
+			along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief		Pool of multiplication triples that is refilled in the background while the party is idle.
+ */
+
+#include "abytriplepool.h"
+#include <cstdio>
+#include <cstring>
+
+//copies len bits, whole bytes are copied at once if both positions are byte aligned
+static void copy_bits(CBitVector* dst, uint64_t dstpos, CBitVector& src, uint64_t srcpos, uint64_t len) {
+	if ((dstpos & 0x07) == 0 && (srcpos & 0x07) == 0) {
+		memcpy(dst->GetArr() + dstpos / 8, src.GetArr() + srcpos / 8, len / 8);
+		dstpos += len & ~((uint64_t) 0x07);
+		srcpos += len & ~((uint64_t) 0x07);
+		len &= 0x07;
+	}
+	if (len > 0) {
+		dst->SetBitsPosOffset(src.GetArr(), srcpos, dstpos, len);
+	}
+}
+
+ABYTriplePool::ABYTriplePool(e_role role, ABYSetup* setup, crypto* crypt, comm_ctx* comm) {
+	m_eRole = role;
+	m_pSetup = setup;
+	m_cCrypt = crypt;
+	m_tComm = comm;
+	m_tPoolChan = NULL;
+
+	m_nChunkSize = TRIPLE_POOL_CHUNK_SIZE;
+	m_eROTGenAlg = ROT_IKNP;
+	m_nMemCapacity = 0;
+	m_pSpillStore = NULL;
+
+	m_pThread = NULL;
+	m_bStarted = FALSE;
+	m_bStop = FALSE;
+	m_bPaused = FALSE;
+	m_bRoundPending = FALSE;
+}
+
+ABYTriplePool::~ABYTriplePool() {
+	Stop();
+	for (uint32_t i = 0; i < m_vReservoirs.size(); i++) {
+		for (uint32_t j = 0; j < m_vReservoirs[i]->chunks.size(); j++) {
+			delete m_vReservoirs[i]->chunks[j];
+		}
+		delete m_vReservoirs[i];
+	}
+	if (m_pSpillStore) {
+		delete m_pSpillStore;
+		remove(m_sSpillFile.c_str());
+	}
+}
+
+void ABYTriplePool::AddReservoir(e_sharing sharing, uint32_t bitlen, uint64_t capacity) {
+	assert(!m_bStarted && GetReservoir(sharing, bitlen) == NULL);
+	assert(sharing == S_BOOL || (sharing == S_ARITH && (bitlen == 8 || bitlen == 16 || bitlen == 32 || bitlen == 64)));
+
+	mt_reservoir* res = new mt_reservoir;
+	res->sharing = sharing;
+	res->bitlen = bitlen;
+	res->abits = sharing == S_BOOL ? 1 : bitlen;
+	res->bbits = bitlen;
+	res->capacity = capacity;
+	res->nmts = 0;
+	res->nmemmts = 0;
+	m_vReservoirs.push_back(res);
+}
+
+void ABYTriplePool::SetChunkSize(uint64_t nmts) {
+	m_nChunkSize = max(PadToMultiple(nmts, 8), (uint64_t) 8);
+}
+
+void ABYTriplePool::SetSpillFile(const string& prefix, uint64_t memcapacity) {
+	assert(!m_bStarted);
+	m_sSpillFile = prefix + (m_eRole == SERVER ? "_server.store" : "_client.store");
+	m_nMemCapacity = memcapacity;
+}
+
+void ABYTriplePool::Start() {
+	if (m_bStarted) {
+		return;
+	}
+	if (!m_sSpillFile.empty()) {
+		//records of an earlier pool would be taken instead of the MTs of this pool
+		remove(m_sSpillFile.c_str());
+		m_pSpillStore = new PreCompStore(m_sSpillFile, m_eRole);
+	}
+	m_tPoolChan = new channel(ABY_POOL_CHANNEL, m_tComm->rcv_std, m_tComm->snd_std);
+	//the party may change the algorithm while the thread refills
+	m_eROTGenAlg = m_pSetup->GetRandomOTGenAlg();
+
+	m_bStarted = TRUE;
+	m_bStop = FALSE;
+	m_bPaused = FALSE;
+	m_bRoundPending = TRUE;
+	m_pThread = new CTriplePoolThread(this);
+	m_pThread->Start();
+	m_evtRound.Set();
+}
+
+void ABYTriplePool::Stop() {
+	if (!m_bStarted) {
+		return;
+	}
+	Pause();
+	m_lock.Lock();
+	m_bStop = TRUE;
+	m_lock.Unlock();
+	m_evtRound.Set();
+	m_pThread->Wait();
+	delete m_pThread;
+	m_pThread = NULL;
+
+	m_tPoolChan->synchronize_end();
+	delete m_tPoolChan;
+	m_tPoolChan = NULL;
+	m_bStarted = FALSE;
+}
+
+void ABYTriplePool::Fill() {
+	if (!m_bStarted) {
+		return;
+	}
+	Pause();
+	Resume();
+	WaitRoundDone();
+}
+
+void ABYTriplePool::Pause() {
+	m_lock.Lock();
+	m_bPaused = TRUE;
+	m_lock.Unlock();
+	WaitRoundDone();
+}
+
+void ABYTriplePool::WaitRoundDone() {
+	m_lock.Lock();
+	while (m_bRoundPending) {
+		m_lock.Unlock();
+		m_evtRoundDone.Wait();
+		m_lock.Lock();
+	}
+	m_lock.Unlock();
+}
+
+void ABYTriplePool::Resume() {
+	if (!m_bStarted) {
+		return;
+	}
+	m_lock.Lock();
+	m_bPaused = FALSE;
+	m_bRoundPending = TRUE;
+	m_lock.Unlock();
+	m_evtRound.Set();
+}
+
+void ABYTriplePool::CTriplePoolThread::ThreadMain() {
+	ABYTriplePool* pool = m_pPool;
+	BOOL round, stop;
+
+	for (;;) {
+		pool->m_evtRound.Wait();
+		pool->m_lock.Lock();
+		round = pool->m_bRoundPending;
+		stop = pool->m_bStop;
+		pool->m_lock.Unlock();
+
+		if (round) {
+			pool->RunRound();
+			pool->m_lock.Lock();
+			pool->m_bRoundPending = FALSE;
+			pool->m_lock.Unlock();
+			pool->m_evtRoundDone.Set();
+		}
+		if (stop) {
+			return;
+		}
+	}
+}
+
+//Each round ends with an exchange in which at least one party declines, such that the rounds of both parties end together
+void ABYTriplePool::RunRound() {
+	BYTE cont, othercont;
+
+	for (;;) {
+		mt_reservoir* res = GetNextReservoir();
+		m_lock.Lock();
+		cont = !m_bPaused && res != NULL;
+		m_lock.Unlock();
+
+		m_tPoolChan->send(&cont, 1);
+		m_tPoolChan->blocking_receive(&othercont, 1);
+		if (!cont || !othercont) {
+			return;
+		}
+		GenerateChunk(res, min(m_nChunkSize, res->capacity - res->nmts));
+	}
+}
+
+mt_reservoir* ABYTriplePool::GetNextReservoir() {
+	mt_reservoir* next = NULL;
+	uint64_t level, minlevel = 0;
+
+	for (uint32_t i = 0; i < m_vReservoirs.size(); i++) {
+		if (m_vReservoirs[i]->nmts >= m_vReservoirs[i]->capacity) {
+			continue;
+		}
+		//integer permille of the capacity, such that both parties choose the same reservoir
+		level = m_vReservoirs[i]->nmts * 1000 / m_vReservoirs[i]->capacity;
+		if (next == NULL || level < minlevel) {
+			next = m_vReservoirs[i];
+			minlevel = level;
+		}
+	}
+	return next;
+}
+
+mt_reservoir* ABYTriplePool::GetReservoir(e_sharing sharing, uint32_t bitlen) {
+	for (uint32_t i = 0; i < m_vReservoirs.size(); i++) {
+		if (m_vReservoirs[i]->sharing == sharing && m_vReservoirs[i]->bitlen == bitlen) {
+			return m_vReservoirs[i];
+		}
+	}
+	return NULL;
+}
+
+void ABYTriplePool::GenerateChunk(mt_reservoir* res, uint64_t nmts) {
+	mt_chunk* chunk = new mt_chunk;
+	chunk->nmts = PadToMultiple(nmts, 8);
+	chunk->first = 0;
+	chunk->spilled = FALSE;
+
+#ifdef DEBUGTRIPLEPOOL
+	cout << "Generating " << chunk->nmts << " MTs for the " << get_sharing_name(res->sharing) << " reservoir on " << res->bitlen
+			<< " bits, " << res->nmts << " of " << res->capacity << " MTs are in the reservoir" << endl;
+#endif
+	if (res->sharing == S_BOOL) {
+		GenerateBoolMTs(chunk, res->bitlen);
+	} else {
+		switch (res->bitlen) {
+		case 8:
+			GenerateArithMTs<UINT8_T>(chunk);
+			break;
+		case 16:
+			GenerateArithMTs<UINT16_T>(chunk);
+			break;
+		case 32:
+			GenerateArithMTs<UINT32_T>(chunk);
+			break;
+		default:
+			GenerateArithMTs<UINT64_T>(chunk);
+			break;
+		}
+	}
+	PutChunk(res, chunk);
+}
+
+//The OT tasks and the computation of C are the same as in BoolSharing::PrepareSetupPhaseMTs and BoolSharing::ComputeMTs
+void ABYTriplePool::GenerateBoolMTs(mt_chunk* chunk, uint32_t bitlen) {
+	uint64_t nmts = chunk->nmts;
+	uint64_t mtbitlen = bitlen == 1 ? 1 : PadToMultiple(bitlen, 8);
+	uint64_t stringbytelen = ceil_divide(nmts * bitlen, 8);
+	CBitVector S, temp;
+
+	chunk->A.Create(nmts, m_cCrypt);
+	chunk->B.Create(nmts * mtbitlen, m_cCrypt);
+	chunk->C.Create(nmts * mtbitlen);
+	S.Create(nmts * mtbitlen);
+
+	//the silent OT expansions are amortized over all chunks, hence it is used regardless of SILENT_OT_MIN_OTS
+	BOOL silent = m_eROTGenAlg == ROT_SILENT && bitlen <= SILENT_OT_MAX_BITLEN;
+	for (uint32_t j = 0; j < 2; j++) {
+		IKNPPartyValues pval;
+		if ((m_eRole ^ j) == SERVER) {
+			pval.sndval.X0 = &(chunk->C);
+			pval.sndval.X1 = &(chunk->B);
+		} else {
+			pval.rcvval.C = &(chunk->A);
+			pval.rcvval.R = &S;
+		}
+		if (silent) {
+			SilentOTTask* task = (SilentOTTask*) malloc(sizeof(SilentOTTask));
+			task->bitlen = bitlen;
+			task->numOTs = nmts;
+			task->pval = pval;
+			m_pSetup->AddSilentOTTask(task, j);
+		} else {
+			IKNP_OTTask* task = (IKNP_OTTask*) malloc(sizeof(IKNP_OTTask));
+			task->bitlen = bitlen;
+			task->snd_flavor = Snd_R_OT;
+			task->rec_flavor = Rec_OT;
+			task->numOTs = nmts;
+			task->mskfct = new XORMasking(bitlen);
+			task->delete_mskfct = TRUE;
+			task->pval = pval;
+			m_pSetup->AddOTTask(task, j);
+		}
+	}
+	m_pSetup->PerformSetupPhase();
+
+	chunk->B.XORBytes(chunk->C.GetArr(), 0, stringbytelen);
+	temp.Create(stringbytelen * 8);
+	temp.Reset();
+	if (bitlen == 1) {
+		temp.SetAND(chunk->A.GetArr(), chunk->B.GetArr(), 0, ceil_divide(nmts, 8));
+	} else {
+		for (uint64_t j = 0, bitidx = 0; j < nmts; j++, bitidx += bitlen) {
+			if (chunk->A.GetBitNoMask(j)) {
+				temp.SetBitsPosOffset(chunk->B.GetArr(), bitidx, bitidx, bitlen);
+			}
+		}
+	}
+	chunk->C.XORBytes(temp.GetArr(), 0, stringbytelen);
+	chunk->C.XORBytes(S.GetArr(), 0, stringbytelen);
+}
+
+//The OT tasks and the computation of C are the same as in ArithSharing::PrepareSetupPhase and ArithSharing::ComputeMTsFromOTs
+template<typename T>
+void ABYTriplePool::GenerateArithMTs(mt_chunk* chunk) {
+	uint32_t bitlen = sizeof(T) * 8;
+	uint64_t nmts = chunk->nmts;
+	CBitVector S;
+	T tmp;
+
+	chunk->A.Create(nmts, bitlen, m_cCrypt);
+	chunk->B.Create(nmts, bitlen, m_cCrypt);
+	chunk->C.Create(nmts, bitlen);
+	S.Create(nmts, bitlen);
+
+	for (uint32_t i = 0; i < 2; i++) {
+		IKNP_OTTask* task = (IKNP_OTTask*) malloc(sizeof(IKNP_OTTask));
+		task->bitlen = bitlen;
+		task->snd_flavor = Snd_C_OT;
+		task->rec_flavor = Rec_OT;
+		task->numOTs = nmts * bitlen;
+		task->mskfct = new ArithMTMasking<T>(1, &(chunk->B));
+		task->delete_mskfct = TRUE;
+		if ((m_eRole ^ i) == SERVER) {
+			task->pval.sndval.X0 = &(chunk->C);
+			task->pval.sndval.X1 = &(chunk->C);
+		} else {
+			task->pval.rcvval.C = &(chunk->A);
+			task->pval.rcvval.R = &S;
+		}
+		m_pSetup->AddOTTask(task, i);
+	}
+	m_pSetup->PerformSetupPhase();
+
+	for (uint64_t i = 0; i < nmts; i++) {
+		tmp = chunk->A.template Get<T>(i * bitlen, bitlen) * chunk->B.template Get<T>(i * bitlen, bitlen);
+		tmp += chunk->C.template Get<T>(i * bitlen, bitlen);
+		tmp += S.template Get<T>(i * bitlen, bitlen);
+		chunk->C.template Set<T>(tmp, i * bitlen, bitlen);
+	}
+}
+
+string ABYTriplePool::GetSlotName(mt_reservoir* res) {
+	return string(get_sharing_name(res->sharing)) + " pool";
+}
+
+//Chunks that exceed the memory capacity are appended to the spill file, whose records are in the same order as the chunks
+void ABYTriplePool::PutChunk(mt_reservoir* res, mt_chunk* chunk) {
+	uint64_t abytes = ceil_divide(chunk->nmts * res->abits, 8);
+	uint64_t bbytes = ceil_divide(chunk->nmts * res->bbits, 8);
+
+	res->nmts += chunk->nmts;
+	res->chunks.push_back(chunk);
+	if (m_pSpillStore && res->nmemmts + chunk->nmts > m_nMemCapacity) {
+		vector<BYTE> buf(abytes + 2 * bbytes);
+		memcpy(buf.data(), chunk->A.GetArr(), abytes);
+		memcpy(buf.data() + abytes, chunk->B.GetArr(), bbytes);
+		memcpy(buf.data() + abytes + bbytes, chunk->C.GetArr(), bbytes);
+		if (m_pSpillStore->Append(GetSlotName(res), res->bitlen, buf.data(), buf.size())) {
+			chunk->spilled = TRUE;
+			chunk->A.delCBitVector();
+			chunk->B.delCBitVector();
+			chunk->C.delCBitVector();
+			return;
+		}
+	}
+	res->nmemmts += chunk->nmts;
+}
+
+BOOL ABYTriplePool::LoadSpilledChunk(mt_reservoir* res, mt_chunk* chunk) {
+	uint64_t abytes = ceil_divide(chunk->nmts * res->abits, 8);
+	uint64_t bbytes = ceil_divide(chunk->nmts * res->bbits, 8);
+	uint64_t len;
+
+	const BYTE* buf = m_pSpillStore->Consume(GetSlotName(res), res->bitlen, len);
+	if (buf == NULL || len != abytes + 2 * bbytes) {
+		cerr << "Error: The spilled MTs of the " << get_sharing_name(res->sharing) << " reservoir on " << res->bitlen
+				<< " bits are missing in " << m_sSpillFile << endl;
+		m_pSpillStore->Release();
+		return FALSE;
+	}
+	chunk->A.CreateBytes(abytes);
+	chunk->B.CreateBytes(bbytes);
+	chunk->C.CreateBytes(bbytes);
+	memcpy(chunk->A.GetArr(), buf, abytes);
+	memcpy(chunk->B.GetArr(), buf + abytes, bbytes);
+	memcpy(chunk->C.GetArr(), buf + abytes + bbytes, bbytes);
+	m_pSpillStore->Release();
+
+	chunk->spilled = FALSE;
+	res->nmemmts += chunk->nmts;
+	return TRUE;
+}
+
+uint64_t ABYTriplePool::GetNumMTs(e_sharing sharing, uint32_t bitlen) {
+	mt_reservoir* res = GetReservoir(sharing, bitlen);
+	return res ? res->nmts : 0;
+}
+
+BOOL ABYTriplePool::CanTakeMTs(e_sharing sharing, uint32_t bitlen, uint64_t nmts) {
+	mt_reservoir* res = GetReservoir(sharing, bitlen);
+	mt_chunk* chunk;
+	uint64_t n;
+
+	if (res == NULL || res->nmts < nmts) {
+		return FALSE;
+	}
+	n = 0;
+	for (uint32_t i = 0; n < nmts; i++) {
+		chunk = res->chunks[i];
+		if (chunk->spilled && !LoadSpilledChunk(res, chunk)) {
+			return FALSE;
+		}
+		n += chunk->nmts - chunk->first;
+	}
+	return TRUE;
+}
+
+BOOL ABYTriplePool::TakeMTs(e_sharing sharing, uint32_t bitlen, uint64_t nmts, CBitVector* A, CBitVector* B, CBitVector* C) {
+	mt_reservoir* res = GetReservoir(sharing, bitlen);
+	mt_chunk* chunk;
+	uint64_t n;
+
+	//the spilled chunks are loaded before any MTs are taken, such that a missing record takes none of them
+	if (!CanTakeMTs(sharing, bitlen, nmts)) {
+		return FALSE;
+	}
+
+	for (uint64_t pos = 0; pos < nmts; pos += n) {
+		chunk = res->chunks.front();
+		n = min(nmts - pos, chunk->nmts - chunk->first);
+		copy_bits(A, pos * res->abits, chunk->A, chunk->first * res->abits, n * res->abits);
+		copy_bits(B, pos * res->bbits, chunk->B, chunk->first * res->bbits, n * res->bbits);
+		copy_bits(C, pos * res->bbits, chunk->C, chunk->first * res->bbits, n * res->bbits);
+		chunk->first += n;
+		if (chunk->first == chunk->nmts) {
+			res->chunks.pop_front();
+			delete chunk;
+		}
+	}
+	res->nmts -= nmts;
+	res->nmemmts -= nmts;
+
+#ifdef DEBUGTRIPLEPOOL
+	cout << "Took " << nmts << " MTs from the " << get_sharing_name(sharing) << " reservoir on " << bitlen << " bits, "
+			<< res->nmts << " MTs are left" << endl;
+#endif
+	return TRUE;
+}
@@ -0,0 +1,163 @@
+/**
+ \file 		abytriplepool.h
+ \author	michael.zohner@ec-spride.de
+ \copyright	ABY - A Framework for Efficient Mixed-protocol Secure Two-party Computation
+			Copyright (C) 2015 Engineering Cryptographic Protocols Group, TU Darmstadt
+			This program is free software: you can redistribute it and/or modify
+			it under the terms of the GNU Affero General Public License as published
+			by the Free Software Foundation, either version 3 of the License, or
+			(at your option) any later version.
+			This program is distributed in the hope that it will be useful,
+			but WITHOUT ANY WARRANTY; without even the implied warranty of
+			MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+			GNU Affero General Public License for more details.
+			You should have received a copy of the GNU Affero General Public License
+			along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief		Pool of multiplication triples that is refilled in the background while the party is idle.
+ */
+
+#ifndef __ABYTRIPLEPOOL_H__
+#define __ABYTRIPLEPOOL_H__
+
+#include "abysetup.h"
+#include "../sharing/precompstore.h"
+#include <deque>
+
+//#define DEBUGTRIPLEPOOL
+
+#define TRIPLE_POOL_CHUNK_SIZE 65536 //default number of MTs that are generated at once
+
+/** MTs that were generated at once, the values of a spilled chunk are in the spill file until they are needed */
+struct mt_chunk {
+	uint64_t nmts;
+	uint64_t first; // MTs before first were already taken
+	BOOL spilled;
+	CBitVector A, B, C;
+};
+
+/**
+ Multiplication triples of the Boolean sharing for AND gates on bitlen bit values, or of the arithmetic sharing for
+ bitlen bit shares. A triple consists of abits bits of A and bbits bits of each B and C, which are packed in the
+ same layout as in the sharings.
+ */
+struct mt_reservoir {
+	e_sharing sharing;
+	uint32_t bitlen;
+	uint32_t abits;
+	uint32_t bbits;
+	uint64_t capacity; // MTs that are generated at most
+	uint64_t nmts; // MTs in all chunks
+	uint64_t nmemmts; // MTs in the chunks that are not spilled
+	deque<mt_chunk*> chunks; // in the order in which the MTs are taken
+};
+
+/**
+ Pool of multiplication triples for the Boolean and the arithmetic sharing, which a background thread refills with
+ OT extension while the party is idle, the Boolean MTs with silent OT if it was set with ABYSetup::SetRandomOTGenAlg
+ before the pool was started. The arithmetic MTs are generated from OTs for all e_mt_gen_alg. ExecCircuit pauses the
+ thread until ABYParty::Reset has reset the ABYSetup that the thread shares with the party, and the sharings draw the
+ triples of an execution from the pool in the ePreCompPool mode, such that the setup phase of the execution generates
+ no MTs.
+
+ The threads of both parties refill in lockstep: before each chunk of MTs, the parties exchange whether they want to
+ continue, and a round of refilling ends as soon as one of them is paused or all reservoirs are full. A round starts
+ when the pool is started and after each reset of the party, therefore both parties have to add the same reservoirs, start
+ the pool at the same point and execute the same sequence of circuits. MTs that exceed the memory capacity of a
+ reservoir are spilled to a precomputation store file, which is removed when the pool is deleted.
+ */
+class ABYTriplePool {
+public:
+	ABYTriplePool(e_role role, ABYSetup* setup, crypto* crypt, comm_ctx* comm);
+	~ABYTriplePool();
+
+	/**
+	 Adds a reservoir that holds up to capacity MTs. Has to be called before Start.
+	 \param sharing	S_BOOL for the MTs of AND gates on bitlen bit values, or S_ARITH for the MTs of bitlen bit shares
+	 */
+	void AddReservoir(e_sharing sharing, uint32_t bitlen, uint64_t capacity);
+	/** Number of MTs that are generated at once, which bounds the time until a refill round reacts to a pause */
+	void SetChunkSize(uint64_t nmts);
+	/** Keeps at most memcapacity MTs of each reservoir in memory and spills the others to the file prefix_server.store or prefix_client.store */
+	void SetSpillFile(const string& prefix, uint64_t memcapacity);
+
+	/** Starts the background thread, which begins with a refill round */
+	void Start();
+	/** Ends the current refill round and stops the background thread */
+	void Stop();
+
+	/** Fills all reservoirs in a new refill round and waits until they are full, unless the other party pauses first */
+	void Fill();
+	/**
+	 Waits until the current refill round has ended and keeps the thread from refilling until Resume. The rounds of
+	 both parties are paired, therefore both have to call Pause, Resume and Fill at the same points, as ExecCircuit and
+	 ABYParty::Reset do.
+	 */
+	void Pause();
+	/** Starts a new refill round */
+	void Resume();
+
+	/** Number of MTs that are currently in the reservoir, or 0 if there is none for the sharing and bit length */
+	uint64_t GetNumMTs(e_sharing sharing, uint32_t bitlen);
+	/**
+	 Checks that the reservoir holds nmts MTs and loads the spilled chunks among them, such that a following TakeMTs of
+	 nmts MTs cannot fail. Has to be called while the pool is paused.
+	 */
+	BOOL CanTakeMTs(e_sharing sharing, uint32_t bitlen, uint64_t nmts);
+	/**
+	 Moves the first nmts MTs of the reservoir to the beginning of A, B and C. Has to be called while the pool is paused.
+	 \return FALSE if the reservoir holds fewer MTs, in which case none are taken
+	 */
+	BOOL TakeMTs(e_sharing sharing, uint32_t bitlen, uint64_t nmts, CBitVector* A, CBitVector* B, CBitVector* C);
+
+	BOOL IsStarted() {
+		return m_bStarted;
+	}
+
+private:
+	class CTriplePoolThread: public CThread {
+	public:
+		CTriplePoolThread(ABYTriplePool* pool) :
+				m_pPool(pool) {
+		}
+		void ThreadMain();
+
+		ABYTriplePool* m_pPool;
+	};
+
+	void WaitRoundDone();
+	//refills in chunks until one of the parties ends the round
+	void RunRound();
+	//the reservoir with the lowest fill level that is not full, the same for both parties
+	mt_reservoir* GetNextReservoir();
+	mt_reservoir* GetReservoir(e_sharing sharing, uint32_t bitlen);
+	void GenerateChunk(mt_reservoir* res, uint64_t nmts);
+	void GenerateBoolMTs(mt_chunk* chunk, uint32_t bitlen);
+	template<typename T> void GenerateArithMTs(mt_chunk* chunk);
+	void PutChunk(mt_reservoir* res, mt_chunk* chunk);
+	BOOL LoadSpilledChunk(mt_reservoir* res, mt_chunk* chunk);
+	string GetSlotName(mt_reservoir* res);
+
+	e_role m_eRole;
+	ABYSetup* m_pSetup;
+	crypto* m_cCrypt;
+	comm_ctx* m_tComm;
+	channel* m_tPoolChan;
+
+	vector<mt_reservoir*> m_vReservoirs;
+	uint64_t m_nChunkSize;
+	e_rot_gen_alg m_eROTGenAlg; // taken from the setup when the pool is started
+	uint64_t m_nMemCapacity;
+	PreCompStore* m_pSpillStore;
+	string m_sSpillFile;
+
+	CTriplePoolThread* m_pThread;
+	BOOL m_bStarted;
+	BOOL m_bStop;
+	BOOL m_bPaused;
+	BOOL m_bRoundPending; // a round was started and has not ended yet
+	CLock m_lock;
+	CEvent m_evtRound; // set when a round is started or the thread has to stop
+	CEvent m_evtRoundDone;
+};
+
+#endif /* __ABYTRIPLEPOOL_H__ */
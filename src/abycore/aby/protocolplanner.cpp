@@ -0,0 +1,496 @@
+/**
+ \file 		protocolplanner.cpp
+ \author	michael.zohner@ec-spride.de
+ \copyright	ABY - A Framework for Efficient Mixed-protocol Secure Two-party Computation
+			Copyright (C) 2015 Engineering Cryptographic Protocols Group, TU Darmstadt
+			This program is free software: you can redistribute it and/or modify
+			it under the terms of the GNU Affero General Public License as published
+			by the Free Software Foundation, either version 3 of the License, or
+			(at your option) any later version.
+			This program is distributed in the hope that it will be useful,
+			but WITHOUT ANY WARRANTY; without even the implied warranty of
+			MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+			GNU Affero General Public License for more details.
+			You should have received a copy of the GNU Affero General Public License
+			along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief		Cost-model-driven assignment of operations to the Bool, Yao and Arithmetic sharing.
+ */
+
+#include "protocolplanner.h"
+#include <fstream>
+#include <sstream>
+#include <float.h>
+
+#define PLANNER_MAX_PASSES 64
+
+static const e_sharing m_vPlanSharings[] = { S_BOOL, S_YAO, S_ARITH };
+#define PLANNER_NUM_SHARINGS (sizeof(m_vPlanSharings) / sizeof(e_sharing))
+
+//computation time in ms per AND gate in GMW and per garbled AND gate, used when an operation was not measured
+#define EST_BOOL_AND_TIME 0.00002
+#define EST_YAO_AND_TIME 0.0001
+
+op_cost ProtocolCostModel::GetCost(e_operation op, e_sharing sharing, uint32_t bitlen) {
+	map<uint64_t, op_cost>::iterator it = m_mCosts.find(GetKey(op, sharing, bitlen));
+	if (it != m_mCosts.end()) {
+		return it->second;
+	}
+
+	//derive the cost from the closest measured bit length, a subtraction costs as much as an addition
+	e_operation ops[2] = { op, op == OP_SUB ? OP_ADD : op };
+	for (uint32_t o = 0; o < 2; o++) {
+		map<uint64_t, op_cost>::iterator closest = m_mCosts.end();
+		for (it = m_mCosts.lower_bound(GetKey(ops[o], sharing, 0)); it != m_mCosts.end() && it->first <= GetKey(ops[o], sharing, 0xFFFFFFFF); it++) {
+			if (closest == m_mCosts.end() || abs((int64_t) (it->first & 0xFFFFFFFF) - (int64_t) bitlen)
+							< abs((int64_t) (closest->first & 0xFFFFFFFF) - (int64_t) bitlen)) {
+				closest = it;
+			}
+		}
+		if (closest != m_mCosts.end()) {
+			double factor = ((double) bitlen) / (closest->first & 0xFFFFFFFF);
+			//Boolean multiplication circuits grow quadratically in the bit length
+			if (ops[o] == OP_MUL && sharing != S_ARITH) {
+				factor *= factor;
+			}
+			op_cost cost = closest->second;
+			cost.bytes *= factor;
+			cost.time *= factor;
+			return cost;
+		}
+	}
+	return EstimateCost(op, sharing, bitlen);
+}
+
+/*
+ * Rough estimates from the number of AND gates and the AND depth of the circuits that ABY builds: an AND gate in GMW
+ * costs one multiplication triple of two random OTs, a garbled AND gate two ciphertexts, a Yao input bit on average
+ * two keys and an arithmetic multiplication one triple of bitlen OTs of bitlen bits.
+ */
+op_cost ProtocolCostModel::EstimateCost(e_operation op, e_sharing sharing, uint32_t bitlen) {
+	op_cost cost = { 0, 0, 0 };
+	double l = bitlen, logl = ceil_log2(bitlen), kappa = m_nSymBits;
+	double nands = 0, depth = 0;
+
+	switch (op) {
+	case OP_AND:
+		nands = l;
+		depth = 1;
+		break;
+	case OP_ADD:
+	case OP_SUB:
+		nands = sharing == S_BOOL ? l * (logl + 1) : l;
+		depth = logl + 1;
+		break;
+	case OP_MUL:
+		nands = 2 * l * l;
+		depth = 2 * l;
+		break;
+	case OP_CMP:
+		nands = sharing == S_BOOL ? 3 * l : l;
+		depth = logl + 1;
+		break;
+	case OP_EQ:
+		nands = l;
+		depth = logl;
+		break;
+	case OP_MUX:
+		nands = l;
+		depth = 1;
+		break;
+	default:
+		break;
+	}
+
+	switch (sharing) {
+	case S_BOOL:
+		cost.bytes = nands * (kappa / 4 + 0.5);
+		cost.rounds = depth;
+		cost.time = nands * EST_BOOL_AND_TIME;
+		if (op == OP_IN || op == OP_OUT) {
+			cost.bytes = op == OP_IN ? l / 8 : l / 4;
+			cost.rounds = 1;
+		} else if (op == OP_B2Y) {
+			cost.bytes = l * 3 * kappa / 8;
+			cost.rounds = 1;
+		} else if (op == OP_B2A) {
+			cost.bytes = l * (kappa + l) / 8;
+			cost.rounds = 1;
+		}
+		break;
+	case S_YAO:
+		cost.bytes = nands * kappa / 4;
+		cost.time = nands * EST_YAO_AND_TIME;
+		if (op == OP_IN) {
+			cost.bytes = l * kappa / 4;
+			cost.rounds = 1;
+		} else if (op == OP_OUT) {
+			cost.bytes = l / 8;
+			cost.rounds = 1;
+		}
+		break;
+	case S_ARITH:
+		if (op == OP_MUL) {
+			cost.bytes = 2 * l * (kappa + l) / 8 + l / 2;
+			cost.rounds = 1;
+			cost.time = l * EST_BOOL_AND_TIME;
+		} else if (op == OP_IN || op == OP_OUT) {
+			cost.bytes = op == OP_IN ? l / 8 : l / 4;
+			cost.rounds = 1;
+		} else if (op == OP_A2Y) {
+			//both parties input their share into a garbled adder
+			cost.bytes = 3 * l * kappa / 4;
+			cost.rounds = 1;
+			cost.time = l * EST_YAO_AND_TIME;
+		}
+		break;
+	default:
+		break;
+	}
+	return cost;
+}
+
+BOOL ProtocolCostModel::LoadFromFile(const char* filename) {
+	ifstream file(filename);
+	if (!file.is_open()) {
+		cerr << "Could not open cost model " << filename << endl;
+		return FALSE;
+	}
+	string line;
+	while (getline(file, line)) {
+		if (line.size() == 0 || line[0] == '#') {
+			continue;
+		}
+		istringstream entry(line);
+		uint32_t op, sharing, bitlen;
+		op_cost cost;
+		if (!(entry >> op >> sharing >> bitlen >> cost.bytes >> cost.rounds >> cost.time)) {
+			cerr << "Malformed line in cost model " << filename << ": " << line << endl;
+			return FALSE;
+		}
+		SetCost((e_operation) op, (e_sharing) sharing, bitlen, cost);
+	}
+	return TRUE;
+}
+
+BOOL ProtocolCostModel::WriteToFile(const char* filename) {
+	ofstream file(filename);
+	if (!file.is_open()) {
+		cerr << "Could not write cost model " << filename << endl;
+		return FALSE;
+	}
+	file << "#op sharing bitlen bytes rounds time_ms" << endl;
+	for (map<uint64_t, op_cost>::iterator it = m_mCosts.begin(); it != m_mCosts.end(); it++) {
+		file << (it->first >> 40) << " " << ((it->first >> 32) & 0xFF) << " " << (it->first & 0xFFFFFFFF) << " "
+				<< it->second.bytes << " " << it->second.rounds << " " << it->second.time << endl;
+	}
+	return TRUE;
+}
+
+uint32_t OperationGraph::AddNode(e_operation op, uint32_t bitlen, uint32_t nvals, e_role role) {
+	plan_node node;
+	node.op = op;
+	node.bitlen = bitlen;
+	node.nvals = nvals;
+	node.role = role;
+	node.vals = NULL;
+	m_vNodes.push_back(node);
+	return m_vNodes.size() - 1;
+}
+
+uint32_t OperationGraph::PutINNode(uint32_t nvals, uint64_t* vals, uint32_t bitlen, e_role role) {
+	uint32_t id = AddNode(OP_IN, bitlen, nvals, role);
+	m_vNodes[id].vals = vals;
+	return id;
+}
+
+uint32_t OperationGraph::PutOpNode(e_operation op, uint32_t a, uint32_t b) {
+	assert(op == OP_XOR || op == OP_AND || op == OP_ADD || op == OP_SUB || op == OP_MUL || op == OP_CMP || op == OP_EQ);
+	assert(m_vNodes[a].bitlen == m_vNodes[b].bitlen && m_vNodes[a].nvals == m_vNodes[b].nvals);
+	uint32_t bitlen = (op == OP_CMP || op == OP_EQ) ? 1 : m_vNodes[a].bitlen;
+	uint32_t id = AddNode(op, bitlen, m_vNodes[a].nvals, ALL);
+	m_vNodes[id].in.push_back(a);
+	m_vNodes[id].in.push_back(b);
+	return id;
+}
+
+uint32_t OperationGraph::PutMUXNode(uint32_t a, uint32_t b, uint32_t sel) {
+	assert(m_vNodes[a].bitlen == m_vNodes[b].bitlen && m_vNodes[sel].bitlen == 1);
+	uint32_t id = AddNode(OP_MUX, m_vNodes[a].bitlen, m_vNodes[a].nvals, ALL);
+	m_vNodes[id].in.push_back(a);
+	m_vNodes[id].in.push_back(b);
+	m_vNodes[id].in.push_back(sel);
+	return id;
+}
+
+uint32_t OperationGraph::PutOUTNode(uint32_t a, e_role dst) {
+	uint32_t id = AddNode(OP_OUT, m_vNodes[a].bitlen, m_vNodes[a].nvals, dst);
+	m_vNodes[id].in.push_back(a);
+	return id;
+}
+
+BOOL ProtocolPlanner::IsSupported(plan_node& node, e_sharing sharing) {
+	if (sharing != S_ARITH) {
+		return TRUE;
+	}
+	return (node.op == OP_IN || node.op == OP_OUT || node.op == OP_ADD || node.op == OP_SUB || node.op == OP_MUL)
+			&& node.bitlen == m_nArithBitLen;
+}
+
+op_cost ProtocolPlanner::GetConvCost(e_sharing src, e_sharing dst, uint32_t bitlen) {
+	op_cost cost = { 0, 0, 0 };
+	vector<pair<e_operation, e_sharing> > steps;
+
+	if (src == S_BOOL && dst == S_YAO) {
+		steps.push_back(make_pair(OP_B2Y, S_BOOL));
+	} else if (src == S_BOOL && dst == S_ARITH) {
+		steps.push_back(make_pair(OP_B2A, S_BOOL));
+	} else if (src == S_YAO && dst == S_BOOL) {
+		steps.push_back(make_pair(OP_Y2B, S_YAO));
+	} else if (src == S_YAO && dst == S_ARITH) {
+		steps.push_back(make_pair(OP_Y2B, S_YAO));
+		steps.push_back(make_pair(OP_B2A, S_BOOL));
+	} else if (src == S_ARITH && dst == S_YAO) {
+		steps.push_back(make_pair(OP_A2Y, S_ARITH));
+	} else if (src == S_ARITH && dst == S_BOOL) {
+		steps.push_back(make_pair(OP_A2Y, S_ARITH));
+		steps.push_back(make_pair(OP_Y2B, S_YAO));
+	}
+	for (uint32_t i = 0; i < steps.size(); i++) {
+		op_cost step = m_pModel->GetCost(steps[i].first, steps[i].second, bitlen);
+		cost.bytes += step.bytes;
+		cost.rounds += step.rounds;
+		cost.time += step.time;
+	}
+	return cost;
+}
+
+double ProtocolPlanner::GetWork(op_cost& cost, uint32_t nvals) {
+	//MBit/s are 1000 bits per ms
+	return nvals * (cost.bytes * 8 / (m_sNet.bandwidth * 1000) + cost.time);
+}
+
+double ProtocolPlanner::PredictTime(OperationGraph& graph, vector<e_sharing>& assignment) {
+	uint32_t nnodes = graph.GetNumNodes();
+	vector<double> ready(nnodes, 0);
+	//a value is converted once per destination sharing, regardless of its number of consumers
+	vector<uint32_t> convdone(nnodes, 0);
+	double work = 0, rounds = 0;
+
+	for (uint32_t i = 0; i < nnodes; i++) {
+		plan_node& node = graph.GetNode(i);
+		if (!IsSupported(node, assignment[i])) {
+			return DBL_MAX;
+		}
+		op_cost cost = m_pModel->GetCost(node.op, assignment[i], node.bitlen);
+		work += GetWork(cost, node.nvals);
+		for (uint32_t j = 0; j < node.in.size(); j++) {
+			uint32_t in = node.in[j];
+			double inready = ready[in];
+			if (assignment[in] != assignment[i]) {
+				op_cost conv = GetConvCost(assignment[in], assignment[i], graph.GetNode(in).bitlen);
+				if (!(convdone[in] & (1 << assignment[i]))) {
+					work += GetWork(conv, graph.GetNode(in).nvals);
+					convdone[in] |= (1 << assignment[i]);
+				}
+				inready += conv.rounds;
+			}
+			ready[i] = max(ready[i], inready);
+		}
+		ready[i] += cost.rounds;
+		rounds = max(rounds, ready[i]);
+	}
+	return work + rounds * m_sNet.rtt;
+}
+
+double ProtocolPlanner::Plan(OperationGraph& graph, vector<e_sharing>& assignment) {
+	uint32_t nnodes = graph.GetNumNodes();
+	vector<vector<double> > best(nnodes, vector<double>(PLANNER_NUM_SHARINGS, DBL_MAX));
+
+	//cost of the subgraph below each node if the node is computed in each sharing, counting shared inputs repeatedly
+	for (uint32_t i = 0; i < nnodes; i++) {
+		plan_node& node = graph.GetNode(i);
+		for (uint32_t s = 0; s < PLANNER_NUM_SHARINGS; s++) {
+			if (!IsSupported(node, m_vPlanSharings[s])) {
+				continue;
+			}
+			op_cost cost = m_pModel->GetCost(node.op, m_vPlanSharings[s], node.bitlen);
+			double total = GetWork(cost, node.nvals) + cost.rounds * m_sNet.rtt;
+			for (uint32_t j = 0; j < node.in.size(); j++) {
+				double inbest = DBL_MAX;
+				for (uint32_t t = 0; t < PLANNER_NUM_SHARINGS; t++) {
+					if (best[node.in[j]][t] == DBL_MAX) {
+						continue;
+					}
+					op_cost conv = GetConvCost(m_vPlanSharings[t], m_vPlanSharings[s], graph.GetNode(node.in[j]).bitlen);
+					inbest = min(inbest, best[node.in[j]][t] + GetWork(conv, node.nvals) + conv.rounds * m_sNet.rtt);
+				}
+				total += inbest;
+			}
+			best[i][s] = total;
+		}
+	}
+
+	//pick the sharings from the outputs downwards, a node that is read by several nodes follows its last consumer
+	vector<bool> assigned(nnodes, false);
+	assignment.assign(nnodes, S_BOOL);
+	for (uint32_t i = nnodes; i-- > 0;) {
+		if (!assigned[i]) {
+			double nodebest = DBL_MAX;
+			for (uint32_t s = 0; s < PLANNER_NUM_SHARINGS; s++) {
+				if (best[i][s] < nodebest) {
+					nodebest = best[i][s];
+					assignment[i] = m_vPlanSharings[s];
+				}
+			}
+			assigned[i] = true;
+		}
+		plan_node& node = graph.GetNode(i);
+		for (uint32_t j = 0; j < node.in.size(); j++) {
+			uint32_t in = node.in[j];
+			if (assigned[in]) {
+				continue;
+			}
+			double inbest = DBL_MAX;
+			for (uint32_t t = 0; t < PLANNER_NUM_SHARINGS; t++) {
+				if (best[in][t] == DBL_MAX) {
+					continue;
+				}
+				op_cost conv = GetConvCost(m_vPlanSharings[t], assignment[i], graph.GetNode(in).bitlen);
+				double total = best[in][t] + GetWork(conv, node.nvals) + conv.rounds * m_sNet.rtt;
+				if (total < inbest) {
+					inbest = total;
+					assignment[in] = m_vPlanSharings[t];
+				}
+			}
+			assigned[in] = true;
+		}
+	}
+
+	//re-assign single nodes as long as this reduces the exact prediction
+	double predicted = PredictTime(graph, assignment);
+	BOOL improved = TRUE;
+	for (uint32_t pass = 0; pass < PLANNER_MAX_PASSES && improved; pass++) {
+		improved = FALSE;
+		for (uint32_t i = 0; i < nnodes; i++) {
+			e_sharing cur = assignment[i];
+			for (uint32_t s = 0; s < PLANNER_NUM_SHARINGS; s++) {
+				if (m_vPlanSharings[s] == cur || !IsSupported(graph.GetNode(i), m_vPlanSharings[s])) {
+					continue;
+				}
+				assignment[i] = m_vPlanSharings[s];
+				double t = PredictTime(graph, assignment);
+				if (t < predicted) {
+					predicted = t;
+					cur = assignment[i];
+					improved = TRUE;
+				}
+			}
+			assignment[i] = cur;
+		}
+	}
+
+#ifdef DEBUGPLANNER
+	for (uint32_t i = 0; i < nnodes; i++) {
+		cout << "Node " << i << " (" << get_op_name(graph.GetNode(i).op) << ") in " << get_sharing_name(assignment[i]) << endl;
+	}
+	cout << "Predicted runtime: " << predicted << " ms" << endl;
+#endif
+	return predicted;
+}
+
+share* ProtocolPlanner::GetInput(uint32_t id, e_sharing src, e_sharing dst, vector<share*>& shares,
+		map<uint64_t, share*>& converted, vector<Sharing*>& sharings) {
+	if (src == dst) {
+		return shares[id];
+	}
+	uint64_t key = (((uint64_t) id) << 32) | dst;
+	map<uint64_t, share*>::iterator it = converted.find(key);
+	if (it != converted.end()) {
+		return it->second;
+	}
+
+	Circuit* bc = sharings[S_BOOL]->GetCircuitBuildRoutine();
+	Circuit* yc = sharings[S_YAO]->GetCircuitBuildRoutine();
+	Circuit* ac = sharings[S_ARITH]->GetCircuitBuildRoutine();
+	share* conv;
+	if (dst == S_YAO) {
+		conv = src == S_BOOL ? yc->PutB2YGate(shares[id]) : yc->PutA2YGate(shares[id]);
+	} else if (dst == S_BOOL) {
+		conv = src == S_YAO ? bc->PutY2BGate(shares[id]) : bc->PutA2BGate(shares[id], yc);
+	} else {
+		conv = src == S_BOOL ? ac->PutB2AGate(shares[id]) : ac->PutY2AGate(shares[id], bc);
+	}
+	converted[key] = conv;
+	return conv;
+}
+
+vector<share*> ProtocolPlanner::Build(OperationGraph& graph, vector<e_sharing>& assignment, ABYParty* party) {
+	vector<Sharing*>& sharings = party->GetSharings();
+	uint32_t nnodes = graph.GetNumNodes();
+	vector<share*> shares(nnodes, NULL);
+	map<uint64_t, share*> converted;
+	vector<share*> outputs;
+
+	for (uint32_t i = 0; i < nnodes; i++) {
+		plan_node& node = graph.GetNode(i);
+		e_sharing sharing = assignment[i];
+		Circuit* circ = sharings[sharing]->GetCircuitBuildRoutine();
+		vector<share*> in(node.in.size());
+		for (uint32_t j = 0; j < node.in.size(); j++) {
+			in[j] = GetInput(node.in[j], assignment[node.in[j]], sharing, shares, converted, sharings);
+		}
+
+		switch (node.op) {
+		case OP_IN:
+			shares[i] = node.vals ? circ->PutSIMDINGate(node.nvals, node.vals, node.bitlen, node.role) :
+					circ->PutDummySIMDINGate(node.nvals, node.bitlen);
+			break;
+		case OP_OUT:
+			shares[i] = circ->PutOUTGate(in[0], node.role);
+			outputs.push_back(shares[i]);
+			break;
+		case OP_XOR:
+			shares[i] = circ->PutXORGate(in[0], in[1]);
+			break;
+		case OP_AND:
+			shares[i] = circ->PutANDGate(in[0], in[1]);
+			break;
+		case OP_ADD:
+			shares[i] = circ->PutADDGate(in[0], in[1]);
+			break;
+		case OP_SUB:
+			shares[i] = circ->PutSUBGate(in[0], in[1]);
+			break;
+		case OP_MUL:
+			shares[i] = circ->PutMULGate(in[0], in[1]);
+			break;
+		case OP_CMP:
+			shares[i] = circ->PutGTGate(in[0], in[1]);
+			break;
+		case OP_EQ:
+			shares[i] = circ->PutEQGate(in[0], in[1]);
+			break;
+		case OP_MUX:
+			shares[i] = circ->PutMUXGate(in[0], in[1], in[2]);
+			break;
+		default:
+			cerr << "Operation " << get_op_name(node.op) << " is not supported by the protocol planner" << endl;
+			exit(0);
+		}
+		//Boolean circuits would otherwise append a carry to the results of additions and multiplications
+		if (sharing != S_ARITH && node.op != OP_OUT) {
+			shares[i]->set_max_bitlength(node.bitlen);
+		}
+	}
+
+	//only the output shares are handed out
+	for (uint32_t i = 0; i < nnodes; i++) {
+		if (graph.GetNode(i).op != OP_OUT) {
+			delete shares[i];
+		}
+	}
+	for (map<uint64_t, share*>::iterator it = converted.begin(); it != converted.end(); it++) {
+		delete it->second;
+	}
+	return outputs;
+}
@@ -0,0 +1,165 @@
+/**
+ \file 		protocolplanner.h
+ \author	michael.zohner@ec-spride.de
+ \copyright	ABY - A Framework for Efficient Mixed-protocol Secure Two-party Computation
+			Copyright (C) 2015 Engineering Cryptographic Protocols Group, TU Darmstadt
+			This program is free software: you can redistribute it and/or modify
+			it under the terms of the GNU Affero General Public License as published
+			by the Free Software Foundation, either version 3 of the License, or
+			(at your option) any later version.
+			This program is distributed in the hope that it will be useful,
+			but WITHOUT ANY WARRANTY; without even the implied warranty of
+			MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+			GNU Affero General Public License for more details.
+			You should have received a copy of the GNU Affero General Public License
+			along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief		Cost-model-driven assignment of operations to the Bool, Yao and Arithmetic sharing.
+ */
+
+#ifndef __PROTOCOLPLANNER_H__
+#define __PROTOCOLPLANNER_H__
+
+#include "abyparty.h"
+#include <map>
+#include <vector>
+#include <string>
+
+using namespace std;
+
+//#define DEBUGPLANNER
+
+/** Costs of one operation on a single value of a given bit length */
+typedef struct op_cost_ctx {
+	double bytes; //bytes sent and received in the setup and online phase
+	double rounds; //communication rounds of the online phase
+	double time; //local computation time in ms, measured as CPU time so that waiting on the network is not counted twice
+} op_cost;
+
+/** Network between the parties, the planner predicts a runtime of bytes / bandwidth + rounds * rtt + computation time */
+typedef struct network_profile_ctx {
+	double rtt; //round-trip time in ms
+	double bandwidth; //bandwidth in MBit/s
+} network_profile;
+
+/**
+ Costs of the operations in the Bool, Yao and Arithmetic sharing. The model starts out with rough analytic estimates
+ and is refined by entries measured with bench_operations, which can be stored in and loaded from a file. A missing bit
+ length is derived from the closest measured bit length of the same operation. Conversions are stored under their
+ source sharing, as in bench_operations: OP_Y2B for S_YAO, OP_B2A and OP_B2Y for S_BOOL and OP_A2Y for S_ARITH.
+ Both parties need to use the same model, since the model decides which circuit is built.
+ */
+class ProtocolCostModel {
+public:
+	/** \param symbits symmetric security parameter of the analytic estimates */
+	ProtocolCostModel(uint32_t symbits = 128) :
+			m_nSymBits(symbits) {
+	}
+
+	void SetCost(e_operation op, e_sharing sharing, uint32_t bitlen, op_cost cost) {
+		m_mCosts[GetKey(op, sharing, bitlen)] = cost;
+	}
+
+	/** Returns the measured cost or, if the operation was not measured, an estimate */
+	op_cost GetCost(e_operation op, e_sharing sharing, uint32_t bitlen);
+
+	/**
+	 Reads the measured costs from a file with one line "op sharing bitlen bytes rounds time" per entry, where op and
+	 sharing are given by their enum values. Lines starting with # are ignored.
+	 */
+	BOOL LoadFromFile(const char* filename);
+	/** Writes the measured costs in the format that is read by LoadFromFile */
+	BOOL WriteToFile(const char* filename);
+
+private:
+	static uint64_t GetKey(e_operation op, e_sharing sharing, uint32_t bitlen) {
+		return (((uint64_t) op) << 40) | (((uint64_t) sharing) << 32) | bitlen;
+	}
+	op_cost EstimateCost(e_operation op, e_sharing sharing, uint32_t bitlen);
+
+	uint32_t m_nSymBits;
+	map<uint64_t, op_cost> m_mCosts;
+};
+
+/** Node of an operation graph, see OperationGraph */
+typedef struct plan_node_ctx {
+	e_operation op;
+	vector<uint32_t> in; //ids of the input nodes
+	uint32_t bitlen; //bit length of the output
+	uint32_t nvals; //number of SIMD values
+	e_role role; //owner of an OP_IN node, receiver of an OP_OUT node
+	uint64_t* vals; //values of an OP_IN node, only needed by the owner
+} plan_node;
+
+/**
+ Sharing-independent description of a computation. The nodes are created in topological order. Supported are inputs,
+ outputs, OP_XOR, OP_AND, OP_ADD, OP_SUB, OP_MUL, OP_CMP (a > b), OP_EQ and OP_MUX (sel ? a : b), where the results
+ are computed modulo 2^bitlen and both operands need the same bit length.
+ */
+class OperationGraph {
+public:
+	uint32_t PutINNode(uint32_t nvals, uint64_t* vals, uint32_t bitlen, e_role role);
+	uint32_t PutOpNode(e_operation op, uint32_t a, uint32_t b);
+	uint32_t PutMUXNode(uint32_t a, uint32_t b, uint32_t sel);
+	uint32_t PutOUTNode(uint32_t a, e_role dst);
+
+	plan_node& GetNode(uint32_t id) {
+		return m_vNodes[id];
+	}
+
+	uint32_t GetNumNodes() {
+		return m_vNodes.size();
+	}
+
+private:
+	uint32_t AddNode(e_operation op, uint32_t bitlen, uint32_t nvals, e_role role);
+
+	vector<plan_node> m_vNodes;
+};
+
+/**
+ Assigns every node of an operation graph to the Bool, Yao or Arithmetic sharing such that the predicted runtime under
+ a cost model and a network profile is minimal, and builds the mixed-protocol circuit with the required conversions.
+ A LAN with a small round-trip time thus tends to GMW and arithmetic sharing, a WAN to Yao's garbled circuits.
+
+ The assignment is found by a dynamic program over the graph, which treats every node as if its inputs were computed
+ independently, followed by a local search that evaluates the exact prediction and re-assigns single nodes until no
+ change reduces the predicted runtime. The arithmetic sharing is only used for OP_ADD, OP_SUB and OP_MUL on values of
+ the bit length of the arithmetic circuit, since it computes modulo 2^sharebitlen.
+ */
+class ProtocolPlanner {
+public:
+	ProtocolPlanner(ProtocolCostModel* model, network_profile net, uint32_t arithbitlen) :
+			m_pModel(model), m_sNet(net), m_nArithBitLen(arithbitlen) {
+	}
+
+	/**
+	 Computes the assignment with the minimal predicted runtime.
+	 \param graph		operation graph
+	 \param assignment	is filled with the sharing of each node
+	 \return predicted runtime in ms
+	 */
+	double Plan(OperationGraph& graph, vector<e_sharing>& assignment);
+
+	/** Predicted runtime in ms of the graph under the assignment */
+	double PredictTime(OperationGraph& graph, vector<e_sharing>& assignment);
+
+	/**
+	 Builds the circuit of the graph in the circuits of the party and inserts the conversions between the sharings.
+	 \return the output shares, in the order of the OP_OUT nodes
+	 */
+	vector<share*> Build(OperationGraph& graph, vector<e_sharing>& assignment, ABYParty* party);
+
+private:
+	BOOL IsSupported(plan_node& node, e_sharing sharing);
+	op_cost GetConvCost(e_sharing src, e_sharing dst, uint32_t bitlen);
+	//time in ms for the bytes and the computation of a cost, the rounds are accounted for on the critical path
+	double GetWork(op_cost& cost, uint32_t nvals);
+	share* GetInput(uint32_t id, e_sharing src, e_sharing dst, vector<share*>& shares, map<uint64_t, share*>& converted,
+			vector<Sharing*>& sharings);
+
+	ProtocolCostModel* m_pModel;
+	network_profile m_sNet;
+	uint32_t m_nArithBitLen;
+};
+
+#endif /* __PROTOCOLPLANNER_H__ */
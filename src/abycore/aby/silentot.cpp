@@ -0,0 +1,492 @@
+/**
+ \file 		silentot.cpp
+ \author	michael.zohner@ec-spride.de
+ \copyright	ABY - A Framework for Efficient Mixed-protocol Secure Two-party Computation
+			Copyright (C) 2015 Engineering Cryptographic Protocols Group, TU Darmstadt
+			This program is free software: you can redistribute it and/or modify
+			it under the terms of the GNU Affero General Public License as published
+			by the Free Software Foundation, either version 3 of the License, or
+			(at your option) any later version.
+			This program is distributed in the hope that it will be useful,
+			but WITHOUT ANY WARRANTY; without even the implied warranty of
+			MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+			GNU Affero General Public License for more details.
+			You should have received a copy of the GNU Affero General Public License
+			along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief		Silent random OT extension from LPN.
+ */
+
+#include "silentot.h"
+
+//fixed keys of the two halves of the GGM PRG and of the correlation robust hash, long enough for every security level
+static const uint8_t silent_ot_key_seeds[3][32] = {
+	{ 0x3c, 0x91, 0x5e, 0x07, 0xa2, 0x4b, 0xd8, 0x16, 0x6f, 0xe3, 0x29, 0xc4, 0x80, 0x5d, 0x1a, 0xb7,
+	  0x72, 0x0e, 0xf9, 0x34, 0xcb, 0x68, 0x95, 0x2d, 0x41, 0xbe, 0x03, 0xda, 0x57, 0x8c, 0xe6, 0x1f },
+	{ 0xa8, 0x25, 0x7d, 0xf0, 0x1c, 0x93, 0x4e, 0xb9, 0x02, 0x6a, 0xd5, 0x38, 0xef, 0x47, 0x8b, 0x60,
+	  0x19, 0xc7, 0x54, 0xaa, 0x3f, 0x0d, 0x92, 0x7b, 0xe8, 0x26, 0xb3, 0x5f, 0x84, 0xcd, 0x11, 0x6e },
+	{ 0x5b, 0xe0, 0x37, 0x8f, 0xc2, 0x14, 0x69, 0xad, 0x73, 0x08, 0xfb, 0x4c, 0x96, 0x21, 0xde, 0x3a,
+	  0xb5, 0x62, 0x0f, 0xc9, 0x4d, 0x87, 0x1e, 0xf4, 0x2b, 0x98, 0x50, 0xe7, 0x0a, 0x7c, 0xa3, 0x36 } };
+
+static const uint64_t silent_ot_zero_block[2] = { 0, 0 };
+
+SilentOTExt::SilentOTExt(crypto* crypt, RcvThread* rcvthread, SndThread* sndthread, uint32_t nthreads) {
+	m_cCrypt = crypt;
+	m_nThreads = nthreads;
+	m_tChan = new channel(SILENT_OT_CHANNEL, rcvthread, sndthread);
+
+	for (uint32_t i = 0; i < 2; i++) {
+		m_kGGM[i] = (AES_KEY_CTX*) malloc(sizeof(AES_KEY_CTX));
+		m_cCrypt->init_aes_key(m_kGGM[i], (uint8_t*) silent_ot_key_seeds[i]);
+	}
+	m_kHash = (AES_KEY_CTX*) malloc(sizeof(AES_KEY_CTX));
+	m_cCrypt->init_aes_key(m_kHash, (uint8_t*) silent_ot_key_seeds[2]);
+	m_kLPN = (AES_KEY_CTX*) malloc(sizeof(AES_KEY_CTX));
+	m_bLPNKeySet = FALSE;
+
+	m_nNextCOT = 0;
+	m_nHashCtr = 0;
+	m_nNumExpansions = 0;
+
+	for (uint32_t i = 0; i < 3; i++) {
+		m_vTmp[i].resize(2 * SILENT_OT_BATCH);
+	}
+	//four indices are computed from each AES block
+	m_vCtr.resize(2 * ceil_divide(SILENT_OT_BATCH * SILENT_OT_LPN_D, 4));
+	m_vIdx.resize(4 * ceil_divide(SILENT_OT_BATCH * SILENT_OT_LPN_D, 4));
+}
+
+SilentOTExt::~SilentOTExt() {
+	m_tChan->synchronize_end();
+	delete m_tChan;
+
+	for (uint32_t i = 0; i < 2; i++) {
+		m_cCrypt->clean_aes_key(m_kGGM[i]);
+		free(m_kGGM[i]);
+	}
+	m_cCrypt->clean_aes_key(m_kHash);
+	free(m_kHash);
+	if (m_bLPNKeySet) {
+		m_cCrypt->clean_aes_key(m_kLPN);
+	}
+	free(m_kLPN);
+}
+
+void SilentOTExt::ExpandGGMLevel(uint64_t* nodes, uint32_t nnodes) {
+	uint64_t* par = m_vTmp[0].data();
+	uint64_t* left = m_vTmp[1].data();
+	uint64_t* right = m_vTmp[2].data();
+
+	//the children of the last nodes are computed first, such that no node is overwritten before it was expanded
+	for (uint32_t hi = nnodes; hi > 0;) {
+		uint32_t lo = hi > SILENT_OT_BATCH ? hi - SILENT_OT_BATCH : 0;
+		uint32_t n = hi - lo;
+
+		memcpy(par, nodes + 2 * lo, n * AES_BYTES);
+		m_cCrypt->encrypt(m_kGGM[0], (BYTE*) left, (BYTE*) par, n * AES_BYTES);
+		m_cCrypt->encrypt(m_kGGM[1], (BYTE*) right, (BYTE*) par, n * AES_BYTES);
+		for (uint32_t i = 0; i < n; i++) {
+			uint64_t* child = nodes + 4 * (lo + i);
+			child[0] = left[2 * i] ^ par[2 * i];
+			child[1] = left[2 * i + 1] ^ par[2 * i + 1];
+			child[2] = right[2 * i] ^ par[2 * i];
+			child[3] = right[2 * i + 1] ^ par[2 * i + 1];
+		}
+		hi = lo;
+	}
+}
+
+void SilentOTExt::InitLPNCode(BYTE* seed) {
+	if (m_bLPNKeySet) {
+		m_cCrypt->clean_aes_key(m_kLPN);
+	}
+	m_cCrypt->init_aes_key(m_kLPN, (uint8_t*) seed);
+	m_bLPNKeySet = TRUE;
+}
+
+void SilentOTExt::ComputeLPNIndices(uint32_t* idx, uint64_t first, uint32_t nrows) {
+	uint32_t nblocks = ceil_divide(nrows * SILENT_OT_LPN_D, 4);
+	uint64_t ctr = first * SILENT_OT_LPN_D / 4;
+
+	for (uint32_t i = 0; i < nblocks; i++) {
+		m_vCtr[2 * i] = ctr + i;
+		m_vCtr[2 * i + 1] = 0;
+	}
+	m_cCrypt->encrypt(m_kLPN, (BYTE*) idx, (BYTE*) m_vCtr.data(), nblocks * AES_BYTES);
+	for (uint32_t i = 0; i < nrows * SILENT_OT_LPN_D; i++) {
+		idx[i] %= SILENT_OT_K;
+	}
+}
+
+void SilentOTExt::HashBlocks(uint64_t* blocks, uint32_t n, const uint64_t* offset, uint32_t bitlen, CBitVector* out, uint64_t pos) {
+	uint64_t* in = m_vTmp[0].data();
+	uint64_t* h = m_vTmp[1].data();
+
+	//H(i, x) = pi(x ^ i) ^ x ^ i for the fixed-key AES permutation pi and the index i of the OT
+	for (uint32_t i = 0; i < n; i++) {
+		in[2 * i] = blocks[2 * i] ^ offset[0] ^ (m_nHashCtr + i);
+		in[2 * i + 1] = blocks[2 * i + 1] ^ offset[1];
+	}
+	m_cCrypt->encrypt(m_kHash, (BYTE*) h, (BYTE*) in, n * AES_BYTES);
+	for (uint32_t i = 0; i < n; i++) {
+		h[2 * i] ^= in[2 * i];
+		h[2 * i + 1] ^= in[2 * i + 1];
+		if (bitlen == 1) {
+			out->SetBit(pos + i, h[2 * i] & 0x01);
+		} else {
+			out->SetBits((BYTE*) (h + 2 * i), (pos + i) * bitlen, bitlen);
+		}
+	}
+}
+
+SilentOTExtSnd::SilentOTExtSnd(crypto* crypt, OTExtSnd* iknpsnd, RcvThread* rcvthread, SndThread* sndthread, uint32_t nthreads) :
+		SilentOTExt(crypt, rcvthread, sndthread, nthreads) {
+	m_pIKNPSnd = iknpsnd;
+	m_cCrypt->gen_rnd((BYTE*) m_vDelta, AES_BYTES);
+}
+
+BOOL SilentOTExtSnd::send(uint32_t numOTs, uint32_t bitlen, CBitVector* X0, CBitVector* X1) {
+	BOOL success = TRUE;
+	if (bitlen > SILENT_OT_MAX_BITLEN) {
+		cerr << "Silent OT on " << bitlen << " bit strings is not supported" << endl;
+		return FALSE;
+	}
+
+	for (uint64_t done = 0; done < numOTs;) {
+		if (m_nNextCOT == m_vCOTs.size() / 2) {
+			success &= Expand();
+		}
+		uint32_t n = min((uint64_t) SILENT_OT_BATCH, min(numOTs - done, m_vCOTs.size() / 2 - m_nNextCOT));
+		uint64_t* z = &m_vCOTs[2 * m_nNextCOT];
+
+		HashBlocks(z, n, silent_ot_zero_block, bitlen, X0, done);
+		HashBlocks(z, n, m_vDelta, bitlen, X1, done);
+
+		m_nHashCtr += n;
+		m_nNextCOT += n;
+		done += n;
+	}
+	return success;
+}
+
+BOOL SilentOTExtSnd::send_ole(uint32_t numOLEs, uint32_t bitlen, CBitVector* B, CBitVector* S) {
+	BOOL success = TRUE;
+	CBitVector X0, X1, U;
+	uint64_t mask = bitlen < 64 ? (((uint64_t) 1) << bitlen) - 1 : ~((uint64_t) 0);
+
+	X0.Create(SILENT_OLE_BATCH * bitlen * bitlen);
+	X1.Create(SILENT_OLE_BATCH * bitlen * bitlen);
+	U.Create(SILENT_OLE_BATCH * bitlen * (bitlen + 1) / 2);
+
+	for (uint64_t done = 0; done < numOLEs;) {
+		uint32_t n = min((uint64_t) SILENT_OLE_BATCH, numOLEs - done);
+		success &= send(n * bitlen, bitlen, &X0, &X1);
+
+		//the receiver with choice bit c_j obtains r0_j + c_j * b, such that the sum over 2^j times it is r0 + a * b
+		uint64_t upos = 0;
+		for (uint32_t i = 0; i < n; i++) {
+			uint64_t b = B->Get<uint64_t>((done + i) * bitlen, bitlen);
+			uint64_t s = 0;
+			for (uint32_t j = 0; j < bitlen; j++) {
+				uint64_t otpos = ((uint64_t) i * bitlen + j) * bitlen;
+				uint64_t r0 = X0.Get<uint64_t>(otpos, bitlen);
+				uint64_t u = X1.Get<uint64_t>(otpos, bitlen) - r0 - b;
+				U.SetBits((BYTE*) &u, upos, bitlen - j);
+				upos += bitlen - j;
+				s -= r0 << j;
+			}
+			S->Set<uint64_t>(s & mask, (done + i) * bitlen, bitlen);
+		}
+		m_tChan->send(U.GetArr(), ceil_divide(upos, 8));
+		done += n;
+	}
+	return success;
+}
+
+BOOL SilentOTExtSnd::InitBase() {
+	CBitVector X0, X1;
+	X0.Create(SILENT_OT_K * SILENT_OT_MAX_BITLEN);
+	X1.Create(SILENT_OT_K * SILENT_OT_MAX_BITLEN);
+	CBitVector* X[2] = { &X0, &X1 };
+
+	XORMasking* mskfct = new XORMasking(SILENT_OT_MAX_BITLEN);
+	BOOL success = m_pIKNPSnd->send(SILENT_OT_K, SILENT_OT_MAX_BITLEN, 2, X, Snd_R_OT, Rec_OT, m_nThreads, mskfct);
+	delete mskfct;
+
+	//the receiver corrects its output with X0 ^ X1 ^ Delta to X0 ^ b * Delta
+	uint64_t* x0 = (uint64_t*) X0.GetArr();
+	uint64_t* x1 = (uint64_t*) X1.GetArr();
+	m_vBase.assign(x0, x0 + 2 * SILENT_OT_K);
+	for (uint64_t i = 0; i < 2 * SILENT_OT_K; i++) {
+		x1[i] ^= x0[i] ^ m_vDelta[i & 0x01];
+	}
+	m_tChan->send(X1.GetArr(), SILENT_OT_K * AES_BYTES);
+
+	return success;
+}
+
+BOOL SilentOTExtSnd::Expand() {
+	BOOL success = TRUE;
+	uint32_t nleaves = 1 << SILENT_OT_TREE_DEPTH;
+	uint32_t nggmots = SILENT_OT_T * SILENT_OT_TREE_DEPTH;
+
+#ifdef DEBUGSILENTOT
+	cout << "Silent OT sender expansion " << m_nNumExpansions << endl;
+#endif
+
+	if (m_vBase.size() == 0) {
+		success &= InitBase();
+	}
+
+	BYTE seed[32];
+	m_cCrypt->gen_rnd(seed, sizeof(seed));
+	m_tChan->send(seed, sizeof(seed));
+	InitLPNCode(seed);
+
+	//the XORs of the left and right nodes of each level of each tree, of which the receiver obtains the ones off its path
+	CBitVector K0, K1;
+	K0.Create(nggmots * SILENT_OT_MAX_BITLEN);
+	K1.Create(nggmots * SILENT_OT_MAX_BITLEN);
+	K0.Reset();
+	K1.Reset();
+	uint64_t* k0 = (uint64_t*) K0.GetArr();
+	uint64_t* k1 = (uint64_t*) K1.GetArr();
+	vector<uint64_t> c(2 * SILENT_OT_T);
+
+	m_vCOTs.resize(2 * (uint64_t) SILENT_OT_N);
+	for (uint32_t j = 0; j < SILENT_OT_T; j++) {
+		uint64_t* nodes = &m_vCOTs[2 * (uint64_t) j * nleaves];
+		m_cCrypt->gen_rnd((BYTE*) nodes, AES_BYTES);
+		for (uint32_t l = 0; l < SILENT_OT_TREE_DEPTH; l++) {
+			ExpandGGMLevel(nodes, 1 << l);
+			uint64_t* kl0 = k0 + 2 * (j * SILENT_OT_TREE_DEPTH + l);
+			uint64_t* kl1 = k1 + 2 * (j * SILENT_OT_TREE_DEPTH + l);
+			for (uint32_t i = 0; i < (2u << l); i += 2) {
+				kl0[0] ^= nodes[2 * i];
+				kl0[1] ^= nodes[2 * i + 1];
+				kl1[0] ^= nodes[2 * i + 2];
+				kl1[1] ^= nodes[2 * i + 3];
+			}
+		}
+		c[2 * j] = m_vDelta[0];
+		c[2 * j + 1] = m_vDelta[1];
+		for (uint32_t i = 0; i < nleaves; i++) {
+			c[2 * j] ^= nodes[2 * i];
+			c[2 * j + 1] ^= nodes[2 * i + 1];
+		}
+	}
+
+	CBitVector* X[2] = { &K0, &K1 };
+	XORMasking* mskfct = new XORMasking(SILENT_OT_MAX_BITLEN);
+	success &= m_pIKNPSnd->send(nggmots, SILENT_OT_MAX_BITLEN, 2, X, Snd_OT, Rec_OT, m_nThreads, mskfct);
+	delete mskfct;
+	m_tChan->send((BYTE*) c.data(), SILENT_OT_T * AES_BYTES);
+
+	//z = v ^ q * A for the public code A
+	for (uint64_t first = 0; first < SILENT_OT_N; first += SILENT_OT_BATCH) {
+		uint32_t nrows = min((uint64_t) SILENT_OT_BATCH, SILENT_OT_N - first);
+		ComputeLPNIndices(m_vIdx.data(), first, nrows);
+		for (uint32_t i = 0; i < nrows; i++) {
+			uint64_t* z = &m_vCOTs[2 * (first + i)];
+			for (uint32_t d = 0; d < SILENT_OT_LPN_D; d++) {
+				uint32_t idx = m_vIdx[i * SILENT_OT_LPN_D + d];
+				z[0] ^= m_vBase[2 * idx];
+				z[1] ^= m_vBase[2 * idx + 1];
+			}
+		}
+	}
+
+	m_vBase.assign(m_vCOTs.begin(), m_vCOTs.begin() + 2 * SILENT_OT_K);
+	m_nNextCOT = SILENT_OT_K;
+	m_nNumExpansions++;
+
+	return success;
+}
+
+SilentOTExtRec::SilentOTExtRec(crypto* crypt, OTExtRec* iknprec, RcvThread* rcvthread, SndThread* sndthread, uint32_t nthreads) :
+		SilentOTExt(crypt, rcvthread, sndthread, nthreads) {
+	m_pIKNPRec = iknprec;
+}
+
+BOOL SilentOTExtRec::receive(uint32_t numOTs, uint32_t bitlen, CBitVector* C, CBitVector* R) {
+	BOOL success = TRUE;
+	if (bitlen > SILENT_OT_MAX_BITLEN) {
+		cerr << "Silent OT on " << bitlen << " bit strings is not supported" << endl;
+		return FALSE;
+	}
+
+	for (uint64_t done = 0; done < numOTs;) {
+		if (m_nNextCOT == m_vCOTs.size() / 2) {
+			success &= Expand();
+		}
+		uint32_t n = min((uint64_t) SILENT_OT_BATCH, min(numOTs - done, m_vCOTs.size() / 2 - m_nNextCOT));
+
+		HashBlocks(&m_vCOTs[2 * m_nNextCOT], n, silent_ot_zero_block, bitlen, R, done);
+		for (uint32_t i = 0; i < n; i++) {
+			C->SetBit(done + i, m_vChoices.GetBit(m_nNextCOT + i));
+		}
+
+		m_nHashCtr += n;
+		m_nNextCOT += n;
+		done += n;
+	}
+	return success;
+}
+
+BOOL SilentOTExtRec::receive_ole(uint32_t numOLEs, uint32_t bitlen, CBitVector* A, CBitVector* T) {
+	BOOL success = TRUE;
+	CBitVector C, R, U;
+	uint64_t mask = bitlen < 64 ? (((uint64_t) 1) << bitlen) - 1 : ~((uint64_t) 0);
+
+	C.Create(SILENT_OLE_BATCH * bitlen);
+	R.Create(SILENT_OLE_BATCH * bitlen * bitlen);
+	U.Create(SILENT_OLE_BATCH * bitlen * (bitlen + 1) / 2);
+
+	for (uint64_t done = 0; done < numOLEs;) {
+		uint32_t n = min((uint64_t) SILENT_OLE_BATCH, numOLEs - done);
+		success &= receive(n * bitlen, bitlen, &C, &R);
+		m_tChan->blocking_receive(U.GetArr(), ceil_divide((uint64_t) n * bitlen * (bitlen + 1) / 2, 8));
+
+		//the random choice bits of the bitlen OTs of an OLE are the bits of a
+		uint64_t upos = 0;
+		for (uint32_t i = 0; i < n; i++) {
+			uint64_t a = 0, t = 0;
+			for (uint32_t j = 0; j < bitlen; j++) {
+				uint64_t otidx = (uint64_t) i * bitlen + j;
+				uint64_t r = R.Get<uint64_t>(otidx * bitlen, bitlen);
+				if (C.GetBit(otidx)) {
+					r -= U.Get<uint64_t>(upos, bitlen - j);
+					a |= ((uint64_t) 1) << j;
+				}
+				upos += bitlen - j;
+				t += r << j;
+			}
+			A->Set<uint64_t>(a, (done + i) * bitlen, bitlen);
+			T->Set<uint64_t>(t & mask, (done + i) * bitlen, bitlen);
+		}
+		done += n;
+	}
+	return success;
+}
+
+BOOL SilentOTExtRec::InitBase() {
+	CBitVector R;
+	R.Create(SILENT_OT_K * SILENT_OT_MAX_BITLEN);
+	m_vBaseChoices.Create(SILENT_OT_K, m_cCrypt);
+
+	XORMasking* mskfct = new XORMasking(SILENT_OT_MAX_BITLEN);
+	BOOL success = m_pIKNPRec->receive(SILENT_OT_K, SILENT_OT_MAX_BITLEN, 2, &m_vBaseChoices, &R, Snd_R_OT, Rec_OT, m_nThreads, mskfct);
+	delete mskfct;
+
+	vector<uint64_t> d(2 * SILENT_OT_K);
+	m_tChan->blocking_receive((BYTE*) d.data(), SILENT_OT_K * AES_BYTES);
+
+	uint64_t* r = (uint64_t*) R.GetArr();
+	m_vBase.assign(r, r + 2 * SILENT_OT_K);
+	for (uint64_t i = 0; i < SILENT_OT_K; i++) {
+		if (m_vBaseChoices.GetBit(i)) {
+			m_vBase[2 * i] ^= d[2 * i];
+			m_vBase[2 * i + 1] ^= d[2 * i + 1];
+		}
+	}
+
+	return success;
+}
+
+BOOL SilentOTExtRec::Expand() {
+	BOOL success = TRUE;
+	uint32_t nleaves = 1 << SILENT_OT_TREE_DEPTH;
+	uint32_t nggmots = SILENT_OT_T * SILENT_OT_TREE_DEPTH;
+
+#ifdef DEBUGSILENTOT
+	cout << "Silent OT receiver expansion " << m_nNumExpansions << endl;
+#endif
+
+	if (m_vBase.size() == 0) {
+		success &= InitBase();
+	}
+
+	BYTE seed[32];
+	m_tChan->blocking_receive(seed, sizeof(seed));
+	InitLPNCode(seed);
+
+	//the receiver learns all leaves of tree j but the one at its noise position alpha_j
+	vector<uint32_t> alpha(SILENT_OT_T);
+	m_cCrypt->gen_rnd((BYTE*) alpha.data(), SILENT_OT_T * sizeof(uint32_t));
+	CBitVector choices, K;
+	choices.Create(nggmots);
+	K.Create(nggmots * SILENT_OT_MAX_BITLEN);
+	for (uint32_t j = 0; j < SILENT_OT_T; j++) {
+		alpha[j] &= nleaves - 1;
+		for (uint32_t l = 0; l < SILENT_OT_TREE_DEPTH; l++) {
+			choices.SetBit(j * SILENT_OT_TREE_DEPTH + l, !((alpha[j] >> (SILENT_OT_TREE_DEPTH - 1 - l)) & 0x01));
+		}
+	}
+
+	XORMasking* mskfct = new XORMasking(SILENT_OT_MAX_BITLEN);
+	success &= m_pIKNPRec->receive(nggmots, SILENT_OT_MAX_BITLEN, 2, &choices, &K, Snd_OT, Rec_OT, m_nThreads, mskfct);
+	delete mskfct;
+	vector<uint64_t> c(2 * SILENT_OT_T);
+	m_tChan->blocking_receive((BYTE*) c.data(), SILENT_OT_T * AES_BYTES);
+
+	uint64_t* k = (uint64_t*) K.GetArr();
+	m_vCOTs.resize(2 * (uint64_t) SILENT_OT_N);
+	m_vChoices.Create(SILENT_OT_N);
+	m_vChoices.Reset();
+	for (uint32_t j = 0; j < SILENT_OT_T; j++) {
+		uint64_t* nodes = &m_vCOTs[2 * (uint64_t) j * nleaves];
+		nodes[0] = 0;
+		nodes[1] = 0;
+		for (uint32_t l = 0; l < SILENT_OT_TREE_DEPTH; l++) {
+			//expands the level including the unknown node on the path, whose children are replaced afterwards
+			ExpandGGMLevel(nodes, 1 << l);
+			uint32_t path = alpha[j] >> (SILENT_OT_TREE_DEPTH - 1 - l);
+			uint32_t sib = path ^ 0x01;
+			uint64_t* kl = k + 2 * (j * SILENT_OT_TREE_DEPTH + l);
+			uint64_t s0 = kl[0], s1 = kl[1];
+			for (uint32_t i = sib & 0x01; i < (2u << l); i += 2) {
+				if (i != sib) {
+					s0 ^= nodes[2 * i];
+					s1 ^= nodes[2 * i + 1];
+				}
+			}
+			nodes[2 * sib] = s0;
+			nodes[2 * sib + 1] = s1;
+			nodes[2 * path] = 0;
+			nodes[2 * path + 1] = 0;
+		}
+		//the leaf at alpha becomes the sender's leaf ^ Delta
+		uint64_t s0 = c[2 * j], s1 = c[2 * j + 1];
+		for (uint32_t i = 0; i < nleaves; i++) {
+			s0 ^= nodes[2 * i];
+			s1 ^= nodes[2 * i + 1];
+		}
+		nodes[2 * alpha[j]] = s0;
+		nodes[2 * alpha[j] + 1] = s1;
+		m_vChoices.SetBit((uint64_t) j * nleaves + alpha[j], 1);
+	}
+
+	//y = w ^ t * A and x = e ^ u * A for the public code A
+	for (uint64_t first = 0; first < SILENT_OT_N; first += SILENT_OT_BATCH) {
+		uint32_t nrows = min((uint64_t) SILENT_OT_BATCH, SILENT_OT_N - first);
+		ComputeLPNIndices(m_vIdx.data(), first, nrows);
+		for (uint32_t i = 0; i < nrows; i++) {
+			uint64_t* y = &m_vCOTs[2 * (first + i)];
+			BYTE x = m_vChoices.GetBit(first + i);
+			for (uint32_t d = 0; d < SILENT_OT_LPN_D; d++) {
+				uint32_t idx = m_vIdx[i * SILENT_OT_LPN_D + d];
+				y[0] ^= m_vBase[2 * idx];
+				y[1] ^= m_vBase[2 * idx + 1];
+				x ^= m_vBaseChoices.GetBit(idx);
+			}
+			m_vChoices.SetBit(first + i, x);
+		}
+	}
+
+	m_vBase.assign(m_vCOTs.begin(), m_vCOTs.begin() + 2 * SILENT_OT_K);
+	m_vBaseChoices.Create(SILENT_OT_K);
+	m_vBaseChoices.SetBits(m_vChoices.GetArr(), (uint64_t) 0, (uint64_t) SILENT_OT_K);
+	m_nNextCOT = SILENT_OT_K;
+	m_nNumExpansions++;
+
+	return success;
+}
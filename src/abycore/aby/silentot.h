@@ -0,0 +1,136 @@
+/**
+ \file 		silentot.h
+ \author	michael.zohner@ec-spride.de
+ \copyright	ABY - A Framework for Efficient Mixed-protocol Secure Two-party Computation
+			Copyright (C) 2015 Engineering Cryptographic Protocols Group, TU Darmstadt
+			This program is free software: you can redistribute it and/or modify
+			it under the terms of the GNU Affero General Public License as published
+			by the Free Software Foundation, either version 3 of the License, or
+			(at your option) any later version.
+			This program is distributed in the hope that it will be useful,
+			but WITHOUT ANY WARRANTY; without even the implied warranty of
+			MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+			GNU Affero General Public License for more details.
+			You should have received a copy of the GNU Affero General Public License
+			along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief		Silent random OT extension from LPN, in the style of Ferret (Yang et al. CCS'20), for semi-honest parties.
+ */
+
+#ifndef __SILENTOT_H__
+#define __SILENTOT_H__
+
+#include "../ENCRYPTO_utils/typedefs.h"
+#include "../ENCRYPTO_utils/crypto/crypto.h"
+#include "../ENCRYPTO_utils/cbitvector.h"
+#include "../ENCRYPTO_utils/channel.h"
+#include "../ABY_utils/ABYconstants.h"
+#include "../ot/iknp-ot-ext-snd.h"
+#include "../ot/iknp-ot-ext-rec.h"
+#include "../ot/xormasking.h"
+#include <vector>
+
+//#define DEBUGSILENTOT
+
+/* LPN parameters of one expansion, the set for 2^23 OTs of Ferret with regular noise: the t noise positions fall into
+ * t blocks of 2^depth COTs, one GGM tree each */
+#define SILENT_OT_N 10805248 // COTs of one expansion
+#define SILENT_OT_K 589760 // LPN dimension, the COTs of the expansion that are the base of the next one
+#define SILENT_OT_T 1319 // noise weight
+#define SILENT_OT_TREE_DEPTH 13 // depth of the GGM trees, SILENT_OT_N = SILENT_OT_T * 2^SILENT_OT_TREE_DEPTH
+#define SILENT_OT_LPN_D 10 // non-zero entries in each row of the local linear code
+#define SILENT_OT_MAX_BITLEN 128 // bit length of the random OTs that are hashed from one COT
+#define SILENT_OT_MIN_OTS 1048576 // tasks with fewer OTs are computed with IKNP, since an expansion yields 10^7 OTs
+#define SILENT_OT_BATCH 4096 // COTs that are encoded or hashed at once
+#define SILENT_OLE_BATCH 1024 // OLEs whose random OTs are computed at once
+
+/**
+ Common routines of the silent OT sender and receiver. Both parties hold correlated OTs (COTs) with a global offset
+ Delta of the sender: the sender holds a block q and the receiver a choice bit u and the block q ^ u * Delta. An
+ expansion turns the K base COTs into N COTs: the parties puncture T GGM trees with T * depth chosen OTs, which gives
+ COTs with a sparse choice vector, and add the base COTs to them under a public local linear code, which makes the
+ choice bits pseudorandom under LPN. The first K COTs of an expansion are the base of the next one, such that only the
+ first base and the OTs of the GGM trees need IKNP OT extension. The COTs are hashed into random OTs on bitlen bit
+ strings. There are no consistency checks, which ABY does not need against semi-honest parties.
+ */
+class SilentOTExt {
+public:
+	SilentOTExt(crypto* crypt, RcvThread* rcvthread, SndThread* sndthread, uint32_t nthreads);
+	virtual ~SilentOTExt();
+
+	uint64_t GetNumExpansions() {
+		return m_nNumExpansions;
+	}
+
+protected:
+	//computes the children of the first nnodes GGM nodes in place, node i becomes the nodes 2i and 2i+1
+	void ExpandGGMLevel(uint64_t* nodes, uint32_t nnodes);
+	//sets the key of the local linear code of an expansion
+	void InitLPNCode(BYTE* seed);
+	//computes the SILENT_OT_LPN_D base indices of each of the rows first to first + nrows - 1, first is a multiple of SILENT_OT_BATCH
+	void ComputeLPNIndices(uint32_t* idx, uint64_t first, uint32_t nrows);
+	//hashes the blocks xor offset into bitlen bit strings at the positions pos to pos + n - 1 of out
+	void HashBlocks(uint64_t* blocks, uint32_t n, const uint64_t* offset, uint32_t bitlen, CBitVector* out, uint64_t pos);
+
+	crypto* m_cCrypt;
+	channel* m_tChan;
+	uint32_t m_nThreads;
+	AES_KEY_CTX* m_kGGM[2];
+	AES_KEY_CTX* m_kHash;
+	AES_KEY_CTX* m_kLPN;
+	BOOL m_bLPNKeySet;
+
+	vector<uint64_t> m_vBase; // base blocks, two words each
+	vector<uint64_t> m_vCOTs; // COTs of the last expansion
+	uint64_t m_nNextCOT; // first COT of the last expansion that was not used yet
+	uint64_t m_nHashCtr; // tweak of the hash, which is distinct for each OT
+	uint64_t m_nNumExpansions;
+
+	vector<uint64_t> m_vTmp[3];
+	vector<uint64_t> m_vCtr;
+	vector<uint32_t> m_vIdx;
+};
+
+class SilentOTExtSnd: public SilentOTExt {
+public:
+	/** The IKNP sender and the threads have to be those of the same direction */
+	SilentOTExtSnd(crypto* crypt, OTExtSnd* iknpsnd, RcvThread* rcvthread, SndThread* sndthread, uint32_t nthreads);
+
+	/** Random OTs: X0 and X1 receive numOTs random strings of bitlen bits each, of which the receiver learns one */
+	BOOL send(uint32_t numOTs, uint32_t bitlen, CBitVector* X0, CBitVector* X1);
+	/**
+	 Oblivious linear evaluation over Z_2^bitlen with Gilboa's multiplication on bitlen random OTs per OLE: for the
+	 sender's input b_i and the receiver's random a_i, the sender obtains S_i and the receiver T_i with S_i + T_i = a_i * b_i.
+	 Sends bitlen * (bitlen + 1) / 2 bits per OLE, since the correction of the j-th OT only needs bitlen - j bits.
+	 \param B	numOLEs values of bitlen <= 64 bits
+	 \param S	receives the numOLEs values of the sender's share
+	 */
+	BOOL send_ole(uint32_t numOLEs, uint32_t bitlen, CBitVector* B, CBitVector* S);
+
+private:
+	BOOL InitBase();
+	BOOL Expand();
+
+	OTExtSnd* m_pIKNPSnd;
+	uint64_t m_vDelta[2];
+};
+
+class SilentOTExtRec: public SilentOTExt {
+public:
+	/** The IKNP receiver and the threads have to be those of the same direction */
+	SilentOTExtRec(crypto* crypt, OTExtRec* iknprec, RcvThread* rcvthread, SndThread* sndthread, uint32_t nthreads);
+
+	/** Random OTs: C receives numOTs random choice bits and R the numOTs strings of bitlen bits that were chosen */
+	BOOL receive(uint32_t numOTs, uint32_t bitlen, CBitVector* C, CBitVector* R);
+	/** Receiver side of SilentOTExtSnd::send_ole: A receives the numOLEs random values a_i and T the receiver's share */
+	BOOL receive_ole(uint32_t numOLEs, uint32_t bitlen, CBitVector* A, CBitVector* T);
+
+private:
+	BOOL InitBase();
+	BOOL Expand();
+
+	OTExtRec* m_pIKNPRec;
+	CBitVector m_vBaseChoices;
+	CBitVector m_vChoices; // choice bits of the COTs of the last expansion
+};
+
+#endif /* __SILENTOT_H__ */
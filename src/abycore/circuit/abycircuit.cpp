@@ -17,33 +17,69 @@
  */
 
 #include "abycircuit.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <map>
+#include <queue>
 
 void ABYCircuit::Cleanup() {
+	DiscardCompiled();
 	Reset();
-	free(m_pGates);
+	FreeGateChunks();
+	free(m_pGateChunks);
 }
 
 ABYCircuit::ABYCircuit(uint32_t maxgates) {
-	m_nMaxGates = maxgates;
-	m_pGates = (GATE*) calloc(maxgates, sizeof(GATE));
+	//one chunk pointer for every possible gate id, the chunks themselves are allocated by AllocGateChunks
+	m_pGateChunks = (GATE**) calloc(((uint64_t) UINT_MAX >> GATE_CHUNK_BITS) + 1, sizeof(GATE*));
+	m_nGateChunks = 0;
+	m_pGates = GateTable(m_pGateChunks);
+	if (!AllocGateChunks(1)) {
+		cerr << "Could not allocate memory for the gates" << endl;
+	}
+
 	m_nNextFreeGate = 0;
 	m_nMaxVectorSize = 1;
+	m_pCompiledGates = NULL;
+	m_nCompiledGates = 0;
+	m_nNextCompiledINGate = 0;
+	m_pMappedCircuit = NULL;
+	m_nMappedBytes = 0;
+}
+
+//Returns the first unused gate, the gate table grows by a chunk if it is full
+inline GATE* ABYCircuit::NextFreeGate() {
+	if (!AllocGateChunks(m_nNextFreeGate + 1)) {
+		cout << "I have more gates than available" << endl;
+		assert(m_nNextFreeGate < (uint64_t) m_nGateChunks * GATE_CHUNK_SIZE);
+	}
+	return m_pGates + m_nNextFreeGate;
 }
 
 inline void ABYCircuit::InitGate(GATE* gate, e_gatetype type) {
 #ifdef DEBUG_CIRCUIT_CONSTRUCTION
 	cout << "Putting new gate with type " << type << endl;
 #endif
-	if(m_nNextFreeGate >= m_nMaxGates) {
-		cout << "I have more gates than available" << endl;
-	}
-	assert(m_nNextFreeGate < m_nMaxGates);
+	assert(m_nNextFreeGate < (uint64_t) m_nGateChunks * GATE_CHUNK_SIZE);
+	//a frozen circuit cannot be extended
+	assert(!IsCompiled());
 
 	gate->type = type;
 	gate->nused = 0;
 	gate->nrounds = 0;
 }
 
+//The packed gate layout only has 8 bits for the rounds, a value that does not fit is reported instead of truncated
+inline void ABYCircuit::SetRounds(GATE* gate, uint32_t rounds) {
+	gate->nrounds = rounds;
+	if (gate->nrounds != rounds) {
+		cerr << "Gate with " << rounds << " rounds exceeds the round count that the gate layout can store" << endl;
+		assert(gate->nrounds == rounds);
+	}
+}
+
 inline void ABYCircuit::InitGate(GATE* gate, e_gatetype type, uint32_t ina) {
 	InitGate(gate, type);
 
@@ -112,12 +148,12 @@ inline void ABYCircuit::InitGate(GATE* gate, e_gatetype type, vector<uint32_t>&
 //Add a gate to m_pGates, increase the gateptr, used for G_LIN or G_NON_LIN
 uint32_t ABYCircuit::PutPrimitiveGate(e_gatetype type, uint32_t inleft, uint32_t inright, uint32_t rounds) {
 
-	GATE* gate = m_pGates + m_nNextFreeGate;
+	GATE* gate = NextFreeGate();
 	InitGate(gate, type, inleft, inright);
 
 	gate->nvals = min(m_pGates[inleft].nvals, m_pGates[inright].nvals);
 
-	gate->nrounds = rounds;
+	SetRounds(gate, rounds);
 
 #ifdef DEBUG_CIRCUIT_CONSTRUCTION
 	cout << "New primitive gate with id: " << m_nNextFreeGate << ", left in = " << inleft << ", right in = " << inright << ", nvals = " << gate->nvals <<
@@ -129,14 +165,14 @@ uint32_t ABYCircuit::PutPrimitiveGate(e_gatetype type, uint32_t inleft, uint32_t
 
 //add a vector-MT gate, mostly the same as a standard primitive gate but with explicit choiceinput / vectorinput
 uint32_t ABYCircuit::PutNonLinearVectorGate(e_gatetype type, uint32_t choiceinput, uint32_t vectorinput, uint32_t rounds) {
-	GATE* gate = m_pGates + m_nNextFreeGate;
+	GATE* gate = NextFreeGate();
 	InitGate(gate, type, choiceinput, vectorinput);
 
 	assert((m_pGates[vectorinput].nvals % m_pGates[choiceinput].nvals) == 0);
 
 	gate->nvals = m_pGates[vectorinput].nvals;
 
-	gate->nrounds = rounds;
+	SetRounds(gate, rounds);
 
 	gate->gs.avs.bitlen = m_pGates[vectorinput].nvals / m_pGates[choiceinput].nvals;
 
@@ -144,7 +180,7 @@ uint32_t ABYCircuit::PutNonLinearVectorGate(e_gatetype type, uint32_t choiceinpu
 }
 
 uint32_t ABYCircuit::PutCombinerGate(vector<uint32_t> input) {
-	GATE* gate = m_pGates + m_nNextFreeGate;
+	GATE* gate = NextFreeGate();
 	InitGate(gate, G_COMBINE, input);
 
 	gate->nvals = 0;
@@ -164,7 +200,7 @@ uint32_t ABYCircuit::PutCombinerGate(vector<uint32_t> input) {
 
 //gatelenghts is defaulted to NULL
 uint32_t ABYCircuit::PutSplitterGate(uint32_t input, uint32_t pos, uint32_t bitlen) {
-	GATE* gate = m_pGates + m_nNextFreeGate;
+	GATE* gate = NextFreeGate();
 	InitGate(gate, G_SPLIT, input);
 
 	gate->gs.sinput.pos = pos;
@@ -207,7 +243,7 @@ vector<uint32_t> ABYCircuit::PutSplitterGate(uint32_t input, vector<uint32_t> bi
 }
 
 uint32_t ABYCircuit::PutCombineAtPosGate(vector<uint32_t> input, uint32_t pos) {
-	GATE* gate = m_pGates + m_nNextFreeGate;
+	GATE* gate = NextFreeGate();
 	InitGate(gate, G_COMBINEPOS, input);
 
 	gate->nvals = input.size();
@@ -226,7 +262,7 @@ uint32_t ABYCircuit::PutCombineAtPosGate(vector<uint32_t> input, uint32_t pos) {
 
 
 uint32_t ABYCircuit::PutSubsetGate(uint32_t input, uint32_t* posids, uint32_t nvals_out, bool copy_posids) {
-	GATE* gate = m_pGates + m_nNextFreeGate;
+	GATE* gate = NextFreeGate();
 	InitGate(gate, G_SUBSET, input);
 
 	gate->nvals = nvals_out;
@@ -260,7 +296,7 @@ uint32_t ABYCircuit::PutSubsetGate(uint32_t input, uint32_t* posids, uint32_t nv
 }
 
 uint32_t ABYCircuit::PutStructurizedCombinerGate(vector<uint32_t> input, uint32_t pos_start, uint32_t pos_incr, uint32_t nvals) {
-	GATE* gate = m_pGates + m_nNextFreeGate;
+	GATE* gate = NextFreeGate();
 	InitGate(gate, G_STRUCT_COMBINE, input);
 
 	gate->nvals = nvals;
@@ -284,7 +320,7 @@ uint32_t ABYCircuit::PutStructurizedCombinerGate(vector<uint32_t> input, uint32_
 
 
 uint32_t ABYCircuit::PutRepeaterGate(uint32_t input, uint32_t nvals) {
-	GATE* gate = m_pGates + m_nNextFreeGate;
+	GATE* gate = NextFreeGate();
 	InitGate(gate, G_REPEAT, input);
 
 	gate->nvals = nvals;
@@ -304,7 +340,7 @@ vector<uint32_t> ABYCircuit::PutRepeaterGate(vector<uint32_t> input, uint32_t nv
 }
 
 uint32_t ABYCircuit::PutPermutationGate(vector<uint32_t> input, uint32_t* positions) {
-	GATE* gate = m_pGates + m_nNextFreeGate;
+	GATE* gate = NextFreeGate();
 	InitGate(gate, G_PERM, input);
 
 	gate->nvals = input.size();
@@ -323,20 +359,20 @@ uint32_t ABYCircuit::PutPermutationGate(vector<uint32_t> input, uint32_t* positi
 }
 
 uint32_t ABYCircuit::PutOUTGate(uint32_t in, e_role dst, uint32_t rounds) {
-	GATE* gate = m_pGates + m_nNextFreeGate;
+	GATE* gate = NextFreeGate();
 	InitGate(gate, G_OUT, in);
 
 	gate->nvals = m_pGates[in].nvals;
 
 	gate->gs.oshare.dst = dst;
 
-	gate->nrounds = rounds;
+	SetRounds(gate, rounds);
 
 	return m_nNextFreeGate++;
 }
 
 uint32_t ABYCircuit::PutSharedOUTGate(uint32_t in) {
-	GATE* gate = m_pGates + m_nNextFreeGate;
+	GATE* gate = NextFreeGate();
 	InitGate(gate, G_SHARED_OUT, in);
 
 	gate->nvals = m_pGates[in].nvals;
@@ -347,7 +383,7 @@ uint32_t ABYCircuit::PutSharedOUTGate(uint32_t in) {
 }
 
 uint32_t ABYCircuit::PutINGate(e_sharing context, uint32_t nvals, uint32_t sharebitlen, e_role src, uint32_t rounds) {
-	GATE* gate = m_pGates + m_nNextFreeGate;
+	GATE* gate = NextFreeGate();
 	InitGate(gate, G_IN);
 	gate->nvals = nvals;
 	gate->depth = 0;
@@ -356,7 +392,7 @@ uint32_t ABYCircuit::PutINGate(e_sharing context, uint32_t nvals, uint32_t share
 	gate->sharebitlen = sharebitlen;
 	gate->gs.ishare.src = src;
 
-	gate->nrounds = rounds;
+	SetRounds(gate, rounds);
 
 	if (gate->nvals > m_nMaxVectorSize)
 		m_nMaxVectorSize = gate->nvals;
@@ -365,7 +401,7 @@ uint32_t ABYCircuit::PutINGate(e_sharing context, uint32_t nvals, uint32_t share
 }
 
 uint32_t ABYCircuit::PutSharedINGate(e_sharing context, uint32_t nvals, uint32_t sharebitlen) {
-	GATE* gate = m_pGates + m_nNextFreeGate;
+	GATE* gate = NextFreeGate();
 	InitGate(gate, G_SHARED_IN);
 	gate->nvals = nvals;
 	gate->depth = 0;
@@ -383,7 +419,7 @@ uint32_t ABYCircuit::PutSharedINGate(e_sharing context, uint32_t nvals, uint32_t
 
 uint32_t ABYCircuit::PutConstantGate(e_sharing context, UGATE_T val, uint32_t nvals, uint32_t sharebitlen) {
 	assert(nvals > 0 && sharebitlen > 0);
-	GATE* gate = m_pGates + m_nNextFreeGate;
+	GATE* gate = NextFreeGate();
 	InitGate(gate, G_CONSTANT);
 	gate->gs.constval = val;
 	gate->depth = 0;
@@ -399,7 +435,7 @@ uint32_t ABYCircuit::PutConstantGate(e_sharing context, UGATE_T val, uint32_t nv
 }
 
 uint32_t ABYCircuit::PutINVGate(uint32_t in) {
-	GATE* gate = m_pGates + m_nNextFreeGate;
+	GATE* gate = NextFreeGate();
 	InitGate(gate, G_INV, in);
 
 	gate->nvals = m_pGates[in].nvals;
@@ -408,12 +444,12 @@ uint32_t ABYCircuit::PutINVGate(uint32_t in) {
 }
 
 uint32_t ABYCircuit::PutCONVGate(vector<uint32_t> in, uint32_t nrounds, e_sharing dst, uint32_t sharebitlen) {
-	GATE* gate = m_pGates + m_nNextFreeGate;
+	GATE* gate = NextFreeGate();
 	InitGate(gate, G_CONV, in);
 
 	gate->sharebitlen = sharebitlen;
 	gate->context = dst;
-	gate->nrounds = nrounds;
+	SetRounds(gate, nrounds);
 	gate->nvals = m_pGates[in[0]].nvals;
 
 	for (uint32_t i = 0; i < in.size(); i++) {
@@ -440,13 +476,13 @@ vector<uint32_t> ABYCircuit::PutSharedOUTGate(vector<uint32_t> in) {
 
 uint32_t ABYCircuit::PutCallbackGate(vector<uint32_t> in, uint32_t rounds, void (*callback)(GATE*, void*), void* infos,
 		uint32_t nvals) {
-	GATE* gate = m_pGates + m_nNextFreeGate;
+	GATE* gate = NextFreeGate();
 	InitGate(gate, G_CALLBACK, in);
 
 	gate->gs.cbgate.callback = callback;
 	gate->gs.cbgate.infos = infos;
 
-	gate->nrounds = rounds;
+	SetRounds(gate, rounds);
 
 	gate->nvals = nvals;
 
@@ -455,7 +491,7 @@ uint32_t ABYCircuit::PutCallbackGate(vector<uint32_t> in, uint32_t rounds, void
 
 uint32_t ABYCircuit::PutTruthTableGate(vector<uint32_t> in, uint32_t rounds, uint32_t out_bits,
 		uint64_t* truth_table) {
-	GATE* gate = m_pGates + m_nNextFreeGate;
+	GATE* gate = NextFreeGate();
 	InitGate(gate, G_TT, in);
 
 	assert(in.size() < 32);
@@ -466,7 +502,7 @@ uint32_t ABYCircuit::PutTruthTableGate(vector<uint32_t> in, uint32_t rounds, uin
 	gate->gs.tt.table = (uint64_t*) malloc(bits_in_bytes(pad_to_multiple(tt_len, sizeof(UGATE_T)) * out_bits));
 	memcpy(gate->gs.tt.table, truth_table, bits_in_bytes(pad_to_multiple(tt_len, sizeof(UGATE_T)) * out_bits));
 
-	gate->nrounds = rounds;
+	SetRounds(gate, rounds);
 
 	gate->nvals = m_pGates[in[0]].nvals*out_bits;
 	for(uint32_t i = 1; i < in.size(); i++) {
@@ -486,7 +522,7 @@ uint32_t ABYCircuit::PutTruthTableGate(vector<uint32_t> in, uint32_t rounds, uin
 }
 
 uint32_t ABYCircuit::PutPrintValGate(vector<uint32_t> in, string infostr) {
-	GATE* gate = m_pGates + m_nNextFreeGate;
+	GATE* gate = NextFreeGate();
 	InitGate(gate, G_PRINT_VAL, in);
 
 	gate->nvals = m_pGates[in[0]].nvals;
@@ -504,7 +540,7 @@ uint32_t ABYCircuit::PutPrintValGate(vector<uint32_t> in, string infostr) {
 
 
 uint32_t ABYCircuit::PutAssertGate(vector<uint32_t> in, uint32_t bitlen, UGATE_T* assert_val) {
-	GATE* gate = m_pGates + m_nNextFreeGate;
+	GATE* gate = NextFreeGate();
 	InitGate(gate, G_ASSERT, in);
 
 	gate->nvals = m_pGates[in[0]].nvals;
@@ -799,7 +835,891 @@ uint32_t FindBitLenPositionInVec(uint32_t bitlen, non_lin_vec_ctx* list, uint32_
 }
 
 void ABYCircuit::Reset() {
-	memset(m_pGates, 0, sizeof(GATE) * m_nMaxGates);
+	//Gates are only written below the gate head, all gates above it are still zero
+	for (uint32_t i = 0; i < m_nNextFreeGate; i += GATE_CHUNK_SIZE) {
+		memset(m_pGates + i, 0, sizeof(GATE) * min(m_nNextFreeGate - i, (uint32_t) GATE_CHUNK_SIZE));
+	}
 	m_nNextFreeGate = 0;
 	m_nMaxVectorSize = 1;
+	//keep the first chunk for the next circuit and return the memory of the others
+	while (m_nGateChunks > 1) {
+		m_nGateChunks--;
+		free(m_pGateChunks[m_nGateChunks]);
+		m_pGateChunks[m_nGateChunks] = NULL;
+	}
+}
+
+//Allocate chunks until the gate table holds at least ngates gates, the new gates are zero
+bool ABYCircuit::AllocGateChunks(uint32_t ngates) {
+	while ((uint64_t) m_nGateChunks * GATE_CHUNK_SIZE < ngates) {
+		GATE* chunk = (GATE*) calloc(GATE_CHUNK_SIZE, sizeof(GATE));
+		if (chunk == NULL) {
+			cerr << "Could not allocate memory for " << ngates << " gates" << endl;
+			return false;
+		}
+		m_pGateChunks[m_nGateChunks] = chunk;
+		m_nGateChunks++;
+	}
+	return true;
 }
+
+void ABYCircuit::FreeGateChunks() {
+	for (uint32_t i = 0; i < m_nGateChunks; i++) {
+		free(m_pGateChunks[i]);
+		m_pGateChunks[i] = NULL;
+	}
+	m_nGateChunks = 0;
+}
+
+//Vector gates store the ids of their input gates in an array that is freed during the evaluation
+inline bool ABYCircuit::HasParentsArray(e_gatetype type) {
+	switch (type) {
+	case G_COMBINE:
+	case G_COMBINEPOS:
+	case G_STRUCT_COMBINE:
+	case G_PERM:
+	case G_CONV:
+	case G_CALLBACK:
+	case G_TT:
+	case G_PRINT_VAL:
+	case G_ASSERT:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static inline void* copy_gate_buf(const void* src, uint64_t bytes) {
+	void* dst = malloc(bytes);
+	memcpy(dst, src, bytes);
+	return dst;
+}
+
+//dst is a flat copy of src. Replace all memory that src references and that is freed during the evaluation by a copy.
+void ABYCircuit::CopyGateData(GATE* dst, GATE* src) {
+	if (HasParentsArray(src->type) && src->ingates.ningates > 0) {
+		dst->ingates.inputs.parents = (uint32_t*) copy_gate_buf(src->ingates.inputs.parents, sizeof(uint32_t) * src->ingates.ningates);
+	}
+
+	switch (src->type) {
+	case G_SUBSET:
+		//positions that were not copied when building the gate are owned by the developer
+		if (src->gs.sub_pos.copy_posids) {
+			dst->gs.sub_pos.posids = (uint32_t*) copy_gate_buf(src->gs.sub_pos.posids, sizeof(uint32_t) * src->nvals);
+		}
+		break;
+	case G_PERM:
+		dst->gs.perm.posids = (uint32_t*) copy_gate_buf(src->gs.perm.posids, sizeof(uint32_t) * src->nvals);
+		break;
+	case G_PRINT_VAL:
+		dst->gs.infostr = (const char*) copy_gate_buf(src->gs.infostr, strlen(src->gs.infostr) + 1);
+		break;
+	case G_ASSERT:
+		dst->gs.assertval = (UGATE_T*) copy_gate_buf(src->gs.assertval, sizeof(UGATE_T) * src->nvals *
+				ceil_divide(src->context == S_ARITH ? src->sharebitlen : src->ingates.ningates, GATE_T_BITS));
+		break;
+	case G_IN:
+		if (src->instantiated) {
+			dst->gs.ishare.inval = (UGATE_T*) copy_gate_buf(src->gs.ishare.inval, sizeof(UGATE_T) *
+					ceil_divide(src->nvals * src->sharebitlen, GATE_T_BITS));
+		}
+		break;
+	case G_SHARED_IN:
+		if (src->instantiated) {
+			dst->gs.val = (UGATE_T*) copy_gate_buf(src->gs.val, sizeof(UGATE_T) * ceil_divide(src->nvals * src->sharebitlen, GATE_T_BITS));
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void ABYCircuit::FreeGateData(GATE* gate) {
+	if (HasParentsArray(gate->type) && gate->ingates.ningates > 0) {
+		free(gate->ingates.inputs.parents);
+	}
+
+	switch (gate->type) {
+	case G_SUBSET:
+		if (gate->gs.sub_pos.copy_posids) {
+			free(gate->gs.sub_pos.posids);
+		}
+		break;
+	case G_PERM:
+		free(gate->gs.perm.posids);
+		break;
+	case G_PRINT_VAL:
+		free((char*) gate->gs.infostr);
+		break;
+	case G_ASSERT:
+		free(gate->gs.assertval);
+		break;
+	case G_IN:
+		if (gate->instantiated) {
+			free(gate->gs.ishare.inval);
+		}
+		break;
+	case G_SHARED_IN:
+		if (gate->instantiated) {
+			free(gate->gs.val);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+bool ABYCircuit::Compile() {
+	if (IsCompiled()) {
+		return true;
+	}
+
+	for (uint32_t i = 0; i < m_nNextFreeGate; i++) {
+		if (m_pGates[i].type == G_TT || (m_pGates[i].type == G_SHARED_IN && (m_pGates[i].context == S_YAO ||
+				m_pGates[i].context == S_YAO_REV))) {
+			cerr << "Circuit contains a " << get_gate_type_name(m_pGates[i].type) << " gate (" << i <<
+					") that cannot be re-evaluated, the circuit is not compiled" << endl;
+			return false;
+		}
+	}
+
+	m_nCompiledGates = m_nNextFreeGate;
+	m_pCompiledGates = (GATE*) malloc(sizeof(GATE) * max(m_nCompiledGates, (uint32_t) 1));
+	for (uint32_t i = 0; i < m_nCompiledGates; i += GATE_CHUNK_SIZE) {
+		memcpy(m_pCompiledGates + i, m_pGates + i, sizeof(GATE) * min(m_nCompiledGates - i, (uint32_t) GATE_CHUNK_SIZE));
+	}
+
+	m_vCompiledINGates.clear();
+	for (uint32_t i = 0; i < m_nCompiledGates; i++) {
+		CopyGateData(m_pCompiledGates + i, m_pGates + i);
+		if (m_pGates[i].type == G_IN || m_pGates[i].type == G_SHARED_IN) {
+			m_vCompiledINGates.push_back(i);
+		}
+	}
+	m_nNextCompiledINGate = 0;
+
+	return true;
+}
+
+void ABYCircuit::DiscardCompiled() {
+	if (!IsCompiled()) {
+		return;
+	}
+	if (m_pMappedCircuit) {
+		//the buffers of the frozen gates lie in the mapping
+		munmap(m_pMappedCircuit, m_nMappedBytes);
+		m_pMappedCircuit = NULL;
+		m_nMappedBytes = 0;
+	} else {
+		for (uint32_t i = 0; i < m_nCompiledGates; i++) {
+			FreeGateData(m_pCompiledGates + i);
+		}
+		free(m_pCompiledGates);
+	}
+	m_pCompiledGates = NULL;
+	m_nCompiledGates = 0;
+	m_vCompiledINGates.clear();
+	m_nNextCompiledINGate = 0;
+}
+
+void ABYCircuit::RestoreCompiled() {
+	assert(IsCompiled());
+	//Reset returned all but the first chunk
+	if (!AllocGateChunks(m_nCompiledGates)) {
+		assert(false);
+	}
+	for (uint32_t i = 0; i < m_nCompiledGates; i += GATE_CHUNK_SIZE) {
+		memcpy(m_pGates + i, m_pCompiledGates + i, sizeof(GATE) * min(m_nCompiledGates - i, (uint32_t) GATE_CHUNK_SIZE));
+	}
+	for (uint32_t i = 0; i < m_nCompiledGates; i++) {
+		CopyGateData(m_pGates + i, m_pCompiledGates + i);
+	}
+	m_nNextFreeGate = m_nCompiledGates;
+	m_nNextCompiledINGate = 0;
+}
+
+uint32_t ABYCircuit::RebindINGate(e_gatetype type, e_sharing context, uint32_t nvals, e_role src) {
+	assert(IsCompiled());
+	if (m_nNextCompiledINGate >= m_vCompiledINGates.size()) {
+		cerr << "More input gates were put than the compiled circuit has" << endl;
+		assert(m_nNextCompiledINGate < m_vCompiledINGates.size());
+	}
+	uint32_t gateid = m_vCompiledINGates[m_nNextCompiledINGate++];
+	GATE* gate = m_pGates + gateid;
+
+	//the input gates have to be put in the same order and with the same sizes as when the circuit was built
+	assert(gate->type == type && gate->context == context && gate->nvals == nvals);
+	assert(type != G_IN || gate->gs.ishare.src == src);
+
+	//drop the value of the previous execution, the caller assigns the new one
+	if (gate->instantiated) {
+		if (type == G_IN) {
+			free(gate->gs.ishare.inval);
+		} else {
+			free(gate->gs.val);
+		}
+		gate->instantiated = false;
+	}
+
+	return gateid;
+}
+
+void ABYCircuit::GetGateDescription(uint32_t gateid, vector<uint64_t>& desc) {
+	GATE* gate = m_pGates + gateid;
+	desc.clear();
+
+	if (HasParentsArray(gate->type)) {
+		for (uint32_t j = 0; j < gate->ingates.ningates; j++) {
+			desc.push_back(gate->ingates.inputs.parents[j]);
+		}
+	} else if (gate->ingates.ningates == 1) {
+		desc.push_back(gate->ingates.inputs.parent);
+	} else if (gate->ingates.ningates == 2) {
+		desc.push_back(gate->ingates.inputs.twin.left);
+		desc.push_back(gate->ingates.inputs.twin.right);
+	}
+
+	switch (gate->type) {
+	case G_CONSTANT:
+		desc.push_back(gate->gs.constval);
+		break;
+	case G_SPLIT:
+		desc.push_back(gate->gs.sinput.pos);
+		break;
+	case G_COMBINEPOS:
+		desc.push_back(gate->gs.combinepos.pos);
+		break;
+	case G_STRUCT_COMBINE:
+		desc.push_back(gate->gs.struct_comb.pos_start);
+		desc.push_back(gate->gs.struct_comb.pos_incr);
+		break;
+	case G_NON_LIN_VEC:
+		desc.push_back(gate->gs.avs.bitlen);
+		break;
+	case G_SUBSET:
+		desc.insert(desc.end(), gate->gs.sub_pos.posids, gate->gs.sub_pos.posids + gate->nvals);
+		break;
+	case G_PERM:
+		desc.insert(desc.end(), gate->gs.perm.posids, gate->gs.perm.posids + gate->nvals);
+		break;
+	case G_TT: {
+		//the table is allocated with byte granularity, as in PutTruthTableGate
+		uint64_t ttbytes = bits_in_bytes(pad_to_multiple(1 << gate->ingates.ningates, sizeof(UGATE_T)) * gate->gs.tt.noutputs);
+		desc.push_back(gate->gs.tt.noutputs);
+		for (uint64_t b = 0; b < ttbytes; b += sizeof(uint64_t)) {
+			uint64_t word = 0;
+			memcpy(&word, ((BYTE*) gate->gs.tt.table) + b, min((uint64_t) sizeof(uint64_t), ttbytes - b));
+			desc.push_back(word);
+		}
+		break;
+	}
+	case G_IN:
+		desc.push_back(gate->gs.ishare.src);
+		break;
+	case G_OUT:
+		desc.push_back(gate->gs.oshare.dst);
+		break;
+	default:
+		break;
+	}
+}
+
+//Collects the pointer fields of a gate that are stored in a circuit file, together with the sizes of their buffers. Input
+//values are not stored, they are bound again by RebindINGate. While the pointers of a mapped gate still hold file
+//offsets, the length of its string is not known and is returned as 0.
+void ABYCircuit::GetGateBuffers(GATE* gate, vector<pair<void**, uint64_t> >& bufs, bool mapped) {
+	bufs.clear();
+	if (HasParentsArray(gate->type) && gate->ingates.ningates > 0) {
+		bufs.push_back(make_pair((void**) &(gate->ingates.inputs.parents), sizeof(uint32_t) * gate->ingates.ningates));
+	}
+
+	switch (gate->type) {
+	case G_SUBSET:
+		bufs.push_back(make_pair((void**) &(gate->gs.sub_pos.posids), sizeof(uint32_t) * gate->nvals));
+		break;
+	case G_PERM:
+		bufs.push_back(make_pair((void**) &(gate->gs.perm.posids), sizeof(uint32_t) * gate->nvals));
+		break;
+	case G_PRINT_VAL:
+		bufs.push_back(make_pair((void**) &(gate->gs.infostr), mapped ? 0 : strlen(gate->gs.infostr) + 1));
+		break;
+	case G_ASSERT:
+		bufs.push_back(make_pair((void**) &(gate->gs.assertval), sizeof(UGATE_T) * gate->nvals *
+				ceil_divide(gate->context == S_ARITH ? gate->sharebitlen : gate->ingates.ningates, GATE_T_BITS)));
+		break;
+	default:
+		break;
+	}
+}
+
+uint64_t ABYCircuit::WriteBinaryCircuit(ofstream& out) {
+	vector<pair<void**, uint64_t> > bufs;
+	circ_file_header head;
+	uint64_t databytes = 0;
+
+	for (uint32_t i = 0; i < m_nNextFreeGate; i++) {
+		GATE* gate = m_pGates + i;
+		if (gate->type == G_TT || gate->type == G_CALLBACK || (gate->type == G_SHARED_IN && (gate->context == S_YAO ||
+				gate->context == S_YAO_REV))) {
+			cerr << "Circuit contains a " << get_gate_type_name(gate->type) << " gate (" << i << ") that cannot be stored" << endl;
+			return 0;
+		}
+		if (gate->instantiated && gate->type != G_IN && gate->type != G_SHARED_IN) {
+			cerr << "Circuit was already evaluated and cannot be stored" << endl;
+			return 0;
+		}
+		GetGateBuffers(gate, bufs);
+		for (uint32_t j = 0; j < bufs.size(); j++) {
+			databytes += PadToMultiple(bufs[j].second, sizeof(uint64_t));
+		}
+	}
+
+	memset(&head, 0, sizeof(circ_file_header));
+	memcpy(head.magic, CIRC_FILE_MAGIC, sizeof(head.magic));
+	head.version = CIRC_FILE_VERSION;
+	head.gatesize = sizeof(GATE);
+	head.ngates = m_nNextFreeGate;
+	head.maxvectorsize = m_nMaxVectorSize;
+	head.gateoffset = PadToMultiple((uint64_t) sizeof(circ_file_header), (uint64_t) 64);
+	head.dataoffset = head.gateoffset + PadToMultiple((uint64_t) sizeof(GATE) * m_nNextFreeGate, sizeof(uint64_t));
+	head.stateoffset = head.dataoffset + databytes;
+
+	const char padding[64] = { 0 };
+	out.write((char*) &head, sizeof(circ_file_header));
+	out.write(padding, head.gateoffset - sizeof(circ_file_header));
+
+	//the gates reference their buffers by offsets into the data section
+	uint64_t offset = 0;
+	for (uint32_t i = 0; i < m_nNextFreeGate; i++) {
+		GATE gate = m_pGates[i];
+		GetGateBuffers(&gate, bufs);
+		for (uint32_t j = 0; j < bufs.size(); j++) {
+			*(bufs[j].first) = (void*) offset;
+			offset += PadToMultiple(bufs[j].second, sizeof(uint64_t));
+		}
+		//positions that are owned by the developer are stored with the gate and thus become owned by the circuit
+		if (gate.type == G_SUBSET) {
+			gate.gs.sub_pos.copy_posids = true;
+		}
+		if (gate.type == G_IN) {
+			gate.gs.ishare.inval = NULL;
+			gate.instantiated = false;
+		} else if (gate.type == G_SHARED_IN) {
+			gate.gs.val = NULL;
+			gate.instantiated = false;
+		}
+		out.write((char*) &gate, sizeof(GATE));
+	}
+	out.write(padding, head.dataoffset - head.gateoffset - sizeof(GATE) * m_nNextFreeGate);
+
+	for (uint32_t i = 0; i < m_nNextFreeGate; i++) {
+		GetGateBuffers(m_pGates + i, bufs);
+		for (uint32_t j = 0; j < bufs.size(); j++) {
+			out.write((char*) *(bufs[j].first), bufs[j].second);
+			out.write(padding, PadToMultiple(bufs[j].second, sizeof(uint64_t)) - bufs[j].second);
+		}
+	}
+	return out.good() ? head.stateoffset : 0;
+}
+
+/*
+ * Checks a gate of a mapped circuit file before anything dereferences it and relocates its buffers: the sharing, the
+ * buffers and the input gates are taken from the file and have to lie within the data section and the gate array.
+ */
+bool ABYCircuit::CheckMappedGate(GATE* gate, uint32_t ngates, BYTE* data, uint64_t databytes, vector<pair<void**, uint64_t> >& bufs) {
+	if (gate->context >= S_LAST || gate->type == G_TT || gate->type == G_CALLBACK) {
+		return false;
+	}
+	if (!HasParentsArray(gate->type) && gate->ingates.ningates > 2) {
+		return false;
+	}
+
+	GetGateBuffers(gate, bufs, true);
+	for (uint32_t j = 0; j < bufs.size(); j++) {
+		uint64_t offset = (uint64_t) *(bufs[j].first);
+		if (offset % sizeof(uint64_t) != 0 || offset > databytes || bufs[j].second > databytes - offset) {
+			return false;
+		}
+		//strings have to be terminated inside the data section
+		if (gate->type == G_PRINT_VAL && (offset == databytes || memchr(data + offset, 0, databytes - offset) == NULL)) {
+			return false;
+		}
+		*(bufs[j].first) = data + offset;
+	}
+
+	if (HasParentsArray(gate->type)) {
+		for (uint32_t j = 0; j < gate->ingates.ningates; j++) {
+			if (gate->ingates.inputs.parents[j] >= ngates) {
+				return false;
+			}
+		}
+	} else if (gate->ingates.ningates == 1) {
+		if (gate->ingates.inputs.parent >= ngates) {
+			return false;
+		}
+	} else if (gate->ingates.ningates == 2) {
+		if (gate->ingates.inputs.twin.left >= ngates || gate->ingates.inputs.twin.right >= ngates) {
+			return false;
+		}
+	}
+
+	//input values are never stored, whatever the file holds in their place
+	if (gate->type == G_IN) {
+		gate->gs.ishare.inval = NULL;
+		gate->instantiated = false;
+	} else if (gate->type == G_SHARED_IN) {
+		gate->gs.val = NULL;
+		gate->instantiated = false;
+	}
+	return true;
+}
+
+uint64_t ABYCircuit::MapBinaryCircuit(const char* filename) {
+	vector<pair<void**, uint64_t> > bufs;
+	struct stat filestat;
+
+	if (m_nNextFreeGate > 0 || IsCompiled()) {
+		cerr << "A circuit file can only be loaded into an empty circuit" << endl;
+		return 0;
+	}
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0 || fstat(fd, &filestat) != 0 || (uint64_t) filestat.st_size < sizeof(circ_file_header)) {
+		cerr << "Could not open circuit file " << filename << endl;
+		if (fd >= 0) {
+			close(fd);
+		}
+		return 0;
+	}
+	//private mapping: the relocated pointers are only written to the pages of this process
+	BYTE* base = (BYTE*) mmap(NULL, filestat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		cerr << "Could not map circuit file " << filename << endl;
+		return 0;
+	}
+
+	//the sections have to be ordered and lie within the file, the subtractions cannot overflow after the checks before them
+	circ_file_header* head = (circ_file_header*) base;
+	if (memcmp(head->magic, CIRC_FILE_MAGIC, sizeof(head->magic)) != 0 || head->version != CIRC_FILE_VERSION
+			|| head->gatesize != sizeof(GATE) || head->gateoffset < sizeof(circ_file_header)
+			|| head->gateoffset % sizeof(uint64_t) != 0 || head->stateoffset > (uint64_t) filestat.st_size
+			|| head->dataoffset > head->stateoffset || head->gateoffset > head->dataoffset
+			|| (head->dataoffset - head->gateoffset) / sizeof(GATE) < head->ngates || !AllocGateChunks(head->ngates)) {
+		cerr << "Circuit file " << filename << " was written by an incompatible version or does not fit into the circuit" << endl;
+		munmap(base, filestat.st_size);
+		return 0;
+	}
+
+	GATE* gates = (GATE*) (base + head->gateoffset);
+	BYTE* data = base + head->dataoffset;
+	uint64_t databytes = head->stateoffset - head->dataoffset;
+	for (uint32_t i = 0; i < head->ngates; i++) {
+		if (!CheckMappedGate(gates + i, head->ngates, data, databytes, bufs)) {
+			cerr << "Circuit file " << filename << " is corrupt at gate " << i << endl;
+			munmap(base, filestat.st_size);
+			return 0;
+		}
+	}
+
+	m_pMappedCircuit = base;
+	m_nMappedBytes = filestat.st_size;
+	m_pCompiledGates = gates;
+	m_nCompiledGates = head->ngates;
+	m_nMaxVectorSize = head->maxvectorsize;
+	m_vCompiledINGates.clear();
+	for (uint32_t i = 0; i < m_nCompiledGates; i++) {
+		if (gates[i].type == G_IN || gates[i].type == G_SHARED_IN) {
+			m_vCompiledINGates.push_back(i);
+		}
+	}
+	RestoreCompiled();
+
+	return head->stateoffset;
+}
+
+void ABYCircuit::ComputeLastUse(vector<uint32_t>& lastuse) {
+	lastuse.assign(m_nNextFreeGate, 0);
+
+	for (uint32_t i = 0; i < m_nNextFreeGate; i++) {
+		GATE* gate = m_pGates + i;
+		//a gate reads its inputs until the end of its last round
+		uint32_t end = gate->depth + gate->nrounds;
+
+		//values that nobody consumes are kept until the circuit is reset, since they might be read afterwards
+		if (gate->nused == 0 || gate->type == G_OUT || gate->type == G_SHARED_OUT) {
+			lastuse[i] = GATE_LIVE_FOREVER;
+		}
+
+		if (HasParentsArray(gate->type)) {
+			for (uint32_t j = 0; j < gate->ingates.ningates; j++) {
+				uint32_t parent = gate->ingates.inputs.parents[j];
+				lastuse[parent] = max(lastuse[parent], end);
+			}
+		} else if (gate->ingates.ningates == 1) {
+			uint32_t parent = gate->ingates.inputs.parent;
+			lastuse[parent] = max(lastuse[parent], end);
+		} else if (gate->ingates.ningates == 2) {
+			uint32_t left = gate->ingates.inputs.twin.left;
+			uint32_t right = gate->ingates.inputs.twin.right;
+			lastuse[left] = max(lastuse[left], end);
+			lastuse[right] = max(lastuse[right], end);
+		}
+	}
+}
+
+//Gates of the Boolean circuits whose only effect is their value, such that they can be folded, merged or removed
+inline bool ABYCircuit::IsOptimizable(GATE* gate) {
+	if (gate->context != S_BOOL && gate->context != S_YAO && gate->context != S_YAO_REV && gate->context != S_SPLUT) {
+		return false;
+	}
+	switch (gate->type) {
+	case G_LIN:
+	case G_NON_LIN:
+	case G_INV:
+	case G_CONSTANT:
+	case G_COMBINE:
+	case G_SPLIT:
+	case G_REPEAT:
+	case G_PERM:
+	case G_COMBINEPOS:
+	case G_SUBSET:
+	case G_STRUCT_COMBINE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*
+ * A constant zero has the value 0 in every sharing. A constant one is assigned differently: the Boolean sharing sets
+ * all values of a gate with a non-zero constant, whereas Yao takes the i-th bit of the constant as i-th value. The
+ * constants of the SP-LUT sharing are only folded if they are zero.
+ */
+inline bool ABYCircuit::IsConstantGate(uint32_t gateid, bool one) {
+	GATE* gate = m_pGates + gateid;
+	if (gate->type != G_CONSTANT) {
+		return false;
+	}
+	if (!one) {
+		return gate->gs.constval == 0;
+	}
+	if (gate->context == S_BOOL) {
+		return gate->gs.constval != 0;
+	}
+	if ((gate->context == S_YAO || gate->context == S_YAO_REV) && gate->nvals <= GATE_T_BITS) {
+		UGATE_T mask = gate->nvals == GATE_T_BITS ? ~((UGATE_T) 0) : (((UGATE_T) 1) << gate->nvals) - 1;
+		return (gate->gs.constval & mask) == mask;
+	}
+	return false;
+}
+
+//Returns the gate that computes the same value as gateid, or gateid if it cannot be folded
+uint32_t ABYCircuit::FoldGate(uint32_t gateid) {
+	GATE* gate = m_pGates + gateid;
+
+	if (gate->type == G_INV) {
+		//double inversion
+		uint32_t parent = gate->ingates.inputs.parent;
+		if (m_pGates[parent].type == G_INV && m_pGates[m_pGates[parent].ingates.inputs.parent].nvals == gate->nvals) {
+			return m_pGates[parent].ingates.inputs.parent;
+		}
+		return gateid;
+	}
+	if ((gate->type != G_LIN && gate->type != G_NON_LIN) || gate->ingates.ningates != 2) {
+		return gateid;
+	}
+
+	uint32_t left = gate->ingates.inputs.twin.left;
+	uint32_t right = gate->ingates.inputs.twin.right;
+	if (gate->type == G_NON_LIN && left == right && m_pGates[left].nvals == gate->nvals) {
+		return left;
+	}
+	for (uint32_t i = 0; i < 2; i++) {
+		uint32_t in = i == 0 ? left : right;
+		uint32_t cons = i == 0 ? right : left;
+		if (IsConstantGate(cons, false)) {
+			//x ^ 0 = x and x & 0 = 0
+			uint32_t res = gate->type == G_LIN ? in : cons;
+			if (m_pGates[res].nvals == gate->nvals) {
+				return res;
+			}
+		} else if (gate->type == G_NON_LIN && IsConstantGate(cons, true) && m_pGates[in].nvals == gate->nvals) {
+			//x & 1 = x
+			return in;
+		}
+	}
+	return gateid;
+}
+
+inline void ABYCircuit::RemapInput(uint32_t& input, vector<uint32_t>& replace) {
+	if (replace[input] != input) {
+		m_pGates[input].nused--;
+		input = replace[input];
+		m_pGates[input].nused++;
+	}
+}
+
+void ABYCircuit::Optimize(vector<bool>& removed, circ_opt_stats& stats) {
+	uint32_t ngates = m_nNextFreeGate;
+	vector<uint32_t> replace(ngates);
+	//structure of the gates that were seen so far: type, context and nvals, followed by the inputs or the constant
+	map<pair<uint64_t, uint64_t>, uint32_t> seen;
+
+	memset(&stats, 0, sizeof(circ_opt_stats));
+
+	for (uint32_t i = 0; i < ngates; i++) {
+		GATE* gate = m_pGates + i;
+		replace[i] = i;
+		if (gate->type == G_NON_LIN && IsOptimizable(gate)) {
+			stats.nandsbefore += gate->nvals;
+		}
+
+		//rewire the gate to the replacements of its inputs, which have a smaller id and were already processed
+		if (HasParentsArray(gate->type)) {
+			for (uint32_t j = 0; j < gate->ingates.ningates; j++) {
+				RemapInput(gate->ingates.inputs.parents[j], replace);
+			}
+		} else if (gate->ingates.ningates == 1) {
+			RemapInput(gate->ingates.inputs.parent, replace);
+		} else if (gate->ingates.ningates == 2) {
+			RemapInput(gate->ingates.inputs.twin.left, replace);
+			RemapInput(gate->ingates.inputs.twin.right, replace);
+		}
+
+		if (!IsOptimizable(gate)) {
+			continue;
+		}
+
+		replace[i] = FoldGate(i);
+		if (replace[i] != i) {
+			stats.nfolded++;
+			continue;
+		}
+
+		uint64_t structure = ((uint64_t) gate->type << 56) | ((uint64_t) gate->context << 48) | gate->nvals;
+		uint64_t inputs;
+		if (gate->type == G_CONSTANT) {
+			inputs = gate->gs.constval;
+		} else if (gate->type == G_INV) {
+			inputs = gate->ingates.inputs.parent;
+		} else if (gate->type == G_LIN || gate->type == G_NON_LIN) {
+			//XOR and AND are commutative
+			uint32_t left = gate->ingates.inputs.twin.left;
+			uint32_t right = gate->ingates.inputs.twin.right;
+			inputs = ((uint64_t) min(left, right) << 32) | max(left, right);
+		} else {
+			continue;
+		}
+		map<pair<uint64_t, uint64_t>, uint32_t>::iterator it = seen.find(make_pair(structure, inputs));
+		if (it != seen.end()) {
+			replace[i] = it->second;
+			stats.nmerged++;
+		} else {
+			seen[make_pair(structure, inputs)] = i;
+		}
+	}
+
+	//a gate is needed if it cannot be optimized or if a needed gate consumes it
+	vector<bool> needed(ngates, false);
+	removed.assign(ngates, false);
+	for (uint32_t i = ngates; i-- > 0;) {
+		GATE* gate = m_pGates + i;
+		if (!needed[i] && IsOptimizable(gate)) {
+			removed[i] = true;
+			stats.nremoved++;
+			continue;
+		}
+		if (gate->type == G_NON_LIN && IsOptimizable(gate)) {
+			stats.nandsafter += gate->nvals;
+		}
+		if (HasParentsArray(gate->type)) {
+			for (uint32_t j = 0; j < gate->ingates.ningates; j++) {
+				needed[gate->ingates.inputs.parents[j]] = true;
+			}
+		} else if (gate->ingates.ningates == 1) {
+			needed[gate->ingates.inputs.parent] = true;
+		} else if (gate->ingates.ningates == 2) {
+			needed[gate->ingates.inputs.twin.left] = true;
+			needed[gate->ingates.inputs.twin.right] = true;
+		}
+	}
+}
+
+void ABYCircuit::RemoveGates(vector<bool>& removed) {
+	for (uint32_t i = 0; i < removed.size(); i++) {
+		if (!removed[i]) {
+			continue;
+		}
+		GATE* gate = m_pGates + i;
+		if (HasParentsArray(gate->type)) {
+			for (uint32_t j = 0; j < gate->ingates.ningates; j++) {
+				m_pGates[gate->ingates.inputs.parents[j]].nused--;
+			}
+		} else if (gate->ingates.ningates == 1) {
+			m_pGates[gate->ingates.inputs.parent].nused--;
+		} else if (gate->ingates.ningates == 2) {
+			m_pGates[gate->ingates.inputs.twin.left].nused--;
+			m_pGates[gate->ingates.inputs.twin.right].nused--;
+		}
+		FreeGateData(gate);
+		gate->type = G_REMOVED;
+		gate->ingates.ningates = 0;
+		gate->nused = 0;
+	}
+}
+
+//The layer on which all inputs of the gate are available
+inline uint32_t ABYCircuit::GetMaxInputReady(GATE* gate) {
+	uint32_t ready = 0;
+	if (HasParentsArray(gate->type)) {
+		for (uint32_t j = 0; j < gate->ingates.ningates; j++) {
+			ready = max(ready, ComputeDepth(m_pGates[gate->ingates.inputs.parents[j]]));
+		}
+	} else if (gate->ingates.ningates == 1) {
+		ready = ComputeDepth(m_pGates[gate->ingates.inputs.parent]);
+	} else if (gate->ingates.ningates == 2) {
+		ready = max(ComputeDepth(m_pGates[gate->ingates.inputs.twin.left]), ComputeDepth(m_pGates[gate->ingates.inputs.twin.right]));
+	}
+	return ready;
+}
+
+//An AND gate that can be moved within the tree of root, since root is its only consumer
+inline bool ABYCircuit::IsTreeNode(uint32_t gateid, GATE* root) {
+	GATE* gate = m_pGates + gateid;
+	return gate->type == G_NON_LIN && gate->ingates.ningates == 2 && gate->context == root->context && gate->nvals == root->nvals
+			&& gate->nused == 1;
+}
+
+/*
+ * Returns the AND gate of the tree that the input of a tree node stands for or GATE_NO_TREE_CHILD if the input is a
+ * leaf. Since a OR b = INV(AND(INV(a), INV(b))), an OR chain contains double inversions between its AND gates, which are
+ * skipped and collected in invs.
+ */
+#define GATE_NO_TREE_CHILD 0xFFFFFFFF
+uint32_t ABYCircuit::GetTreeChild(uint32_t input, GATE* root, vector<uint32_t>& invs) {
+	if (IsTreeNode(input, root)) {
+		return input;
+	}
+	GATE* outer = m_pGates + input;
+	if (outer->type == G_INV && outer->nused == 1) {
+		uint32_t inner = outer->ingates.inputs.parent;
+		if (m_pGates[inner].type == G_INV && m_pGates[inner].nused == 1 && IsTreeNode(m_pGates[inner].ingates.inputs.parent, root)) {
+			invs.push_back(input);
+			invs.push_back(inner);
+			return m_pGates[inner].ingates.inputs.parent;
+		}
+	}
+	return GATE_NO_TREE_CHILD;
+}
+
+void ABYCircuit::Rebalance(uint32_t contexts, vector<bool>& removed, circ_opt_stats& stats) {
+	struct and_tree {
+		vector<uint32_t> leaves;
+		vector<uint32_t> nodes;	// AND gates of the tree besides the root
+		vector<uint32_t> invs;	// double inversions between the AND gates
+	};
+	uint32_t ngates = m_nNextFreeGate;
+	//depth that a gate has on top of the layer on which its inputs are available, e.g., for Y2B conversions
+	vector<uint32_t> extra(ngates, 0);
+	vector<bool> intree(ngates, false);
+	map<uint32_t, and_tree> trees;
+
+	removed.assign(ngates, false);
+	stats.nrebalanced = 0;
+	stats.ndepthbefore = 0;
+	stats.ndepthafter = 0;
+
+	//find the maximal trees, starting from the last gate such that a root is found before the rest of its tree
+	for (uint32_t i = ngates; i-- > 0;) {
+		GATE* gate = m_pGates + i;
+		if (!(contexts & (1 << gate->context)) || gate->type == G_REMOVED) {
+			continue;
+		}
+		uint32_t ready = GetMaxInputReady(gate);
+		extra[i] = gate->depth > ready ? gate->depth - ready : 0;
+		stats.ndepthbefore = max(stats.ndepthbefore, ComputeDepth(*gate));
+
+		if (gate->type != G_NON_LIN || gate->ingates.ningates != 2 || intree[i]) {
+			continue;
+		}
+		and_tree tree;
+		vector<uint32_t> stack(1, i);
+		while (stack.size() > 0) {
+			GATE* node = m_pGates + stack.back();
+			stack.pop_back();
+			uint32_t inputs[2] = { node->ingates.inputs.twin.left, node->ingates.inputs.twin.right };
+			for (uint32_t j = 0; j < 2; j++) {
+				uint32_t child = GetTreeChild(inputs[j], gate, tree.invs);
+				if (child == GATE_NO_TREE_CHILD) {
+					tree.leaves.push_back(inputs[j]);
+				} else {
+					intree[child] = true;
+					tree.nodes.push_back(child);
+					stack.push_back(child);
+				}
+			}
+		}
+		if (tree.nodes.size() > 0) {
+			trees[i] = tree;
+		}
+	}
+
+	//recompute the depths in the order of the gates and rebuild each tree when its root is reached, since all leaves
+	//of the tree have smaller ids than its root and thus already have their final depth
+	for (uint32_t i = 0; i < ngates; i++) {
+		GATE* gate = m_pGates + i;
+		if (!(contexts & (1 << gate->context)) || gate->type == G_REMOVED) {
+			continue;
+		}
+		if (gate->ingates.ningates > 0) {
+			gate->depth = GetMaxInputReady(gate) + extra[i];
+		}
+
+		map<uint32_t, and_tree>::iterator it = trees.find(i);
+		if (it != trees.end()) {
+			and_tree& tree = it->second;
+			//always combine the two values that are available first, the last combination is done by the root
+			priority_queue<pair<uint32_t, uint32_t>, vector<pair<uint32_t, uint32_t> >, greater<pair<uint32_t, uint32_t> > > avail;
+			vector<uint32_t> left, right, depth;
+			for (uint32_t j = 0; j < tree.leaves.size(); j++) {
+				avail.push(make_pair(ComputeDepth(m_pGates[tree.leaves[j]]), tree.leaves[j]));
+			}
+			tree.nodes.push_back(i);
+			for (uint32_t j = 0; j < tree.nodes.size(); j++) {
+				pair<uint32_t, uint32_t> a = avail.top();
+				avail.pop();
+				pair<uint32_t, uint32_t> b = avail.top();
+				avail.pop();
+				left.push_back(a.second);
+				right.push_back(b.second);
+				depth.push_back(max(a.first, b.first));
+				avail.push(make_pair(depth[j] + gate->nrounds, tree.nodes[j]));
+			}
+
+			//gate->depth now holds the depth of the root in the original tree, given the new depths of the leaves
+			if (depth.back() < gate->depth) {
+				for (uint32_t j = 0; j < tree.nodes.size(); j++) {
+					GATE* node = m_pGates + tree.nodes[j];
+					node->ingates.inputs.twin.left = left[j];
+					node->ingates.inputs.twin.right = right[j];
+					node->depth = depth[j];
+				}
+				//the AND gate below a double inversion is now consumed by its new parent instead of the inversion,
+				//compensate for the use that is dropped when the inversion is removed
+				for (uint32_t j = 0; j < tree.invs.size(); j += 2) {
+					removed[tree.invs[j]] = true;
+					removed[tree.invs[j + 1]] = true;
+					m_pGates[m_pGates[tree.invs[j + 1]].ingates.inputs.parent].nused++;
+				}
+				stats.nrebalanced++;
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < ngates; i++) {
+		if ((contexts & (1 << m_pGates[i].context)) && m_pGates[i].type != G_REMOVED && !removed[i]) {
+			stats.ndepthafter = max(stats.ndepthafter, ComputeDepth(m_pGates[i]));
+		}
+	}
+}
+
@@ -24,6 +24,7 @@
 #include <iostream>
 #include <fstream>
 #include <limits.h>
+#include <stddef.h>
 #include <deque>
 #include "../ENCRYPTO_utils/constants.h"
 #include "../ENCRYPTO_utils/utils.h"
@@ -33,9 +34,13 @@
 //A macro that defines whether a gate requires interaction
 #define IsInteractive(gatetype, gatecontext) (!((gatecontext == C_ARITH && gatetype == G_ADD) || ((gatecontext == C_BOOL || gatecontext == C_YAO) && gatetype == G_XOR)) || (gatetype == G_MUL))
 #define ComputeDepth(predecessor) ( (predecessor).depth + (predecessor).nrounds )
+#define GATE_LIVE_FOREVER 0xFFFFFFFF //last use of a gate whose value has to be kept until the circuit is reset
 
 #define IsSIMDGate(gatetype) (!!((gatetype)&0x80))
 
+#define CIRC_FILE_MAGIC "ABYC"
+#define CIRC_FILE_VERSION 1 //has to be increased whenever the GATE struct or the layout of the circuit file changes
+
 struct GATE;
 
 struct yao_fields {
@@ -132,6 +137,10 @@ union gate_specific {
 };
 typedef union gate_specific gs_t;
 
+#ifdef USE_PACKED_GATES
+//4-byte packing drops the tail padding of the input list, GATE places it such that the parents pointer stays aligned
+#pragma pack(push, 4)
+#endif
 struct input_gates {
 	union {
 		uint32_t parent;
@@ -143,9 +152,38 @@ struct input_gates {
 	} inputs;
 	uint32_t ningates;
 };
-
+#ifdef USE_PACKED_GATES
+#pragma pack(pop)
+#endif
+
+#ifdef USE_PACKED_GATES
+/*
+ * Packed gate layout: type, context, instantiation state and rounds share one 32-bit word and the fields that are read
+ * when evaluating a layer (type, nvals, input gates, nused) come first, followed by the fields that are only needed
+ * while building the circuit. The input gates start at offset 8 and gs at offset 32, such that all pointers are
+ * naturally aligned. Shrinks a gate from 72 to 48 bytes on 64-bit platforms, see the -g option of bench_operations.
+ */
+struct GATE {
+	e_gatetype type : 8;		// gate type
+	e_sharing context : 4;		// the representation of the value stored in the gate (Public / arithmetic sharing / Boolean sharing / Yao sharing)
+	bool instantiated : 1;
+	bool pooled : 1;			// the value of the gate was allocated from the gate value pool of its sharing
+	bool planned : 1;			// the value of the gate lies in a buffer that was assigned by the gate buffer plan
+	uint32_t nrounds : 8;		// specifies the number of interaction rounds that are required when evaluating this gate (at most 255, checked by ABYCircuit::SetRounds)
+	uint32_t nvals;			// the number of values that are stored in this gate
+	input_gates ingates;		// the number of input gates together with the values of the input gates
+	uint32_t nused;			// number of uses of the gate
+	uint32_t depth;			// number of AND gates to the root
+	uint32_t sharebitlen;	// bitlength of the shares in the context
+	gs_t gs;				// here the differences for the gates come in
+};
+static_assert(offsetof(GATE, ingates) % sizeof(uint32_t*) == 0 && offsetof(GATE, gs) % sizeof(void*) == 0
+		&& sizeof(GATE) % sizeof(void*) == 0, "packed gate layout misaligns a pointer");
+#else
 struct GATE {
 	bool instantiated;
+	bool pooled;			// the value of the gate was allocated from the gate value pool of its sharing
+	bool planned;			// the value of the gate lies in a buffer that was assigned by the gate buffer plan
 	e_sharing context;		// the representation of the value stored in the gate (Public / arithmetic sharing / Boolean sharing / Yao sharing)
 	e_gatetype type;			// gate type
 	uint32_t nrounds;		// specifies the number of interaction rounds that are required when evaluating this gate
@@ -156,6 +194,32 @@ struct GATE {
 	uint32_t sharebitlen;	// bitlength of the shares in the context
 	input_gates ingates;		// the number of input gates together with the values of the input gates
 };
+#endif
+
+/**
+ Handle to the gates of an ABYCircuit. The gates are stored in chunks of GATE_CHUNK_SIZE gates that are allocated as the
+ circuit grows, such that gates never move. Circuits, sharings and the party keep copies of the handle, which all see the
+ chunks that are added later on.
+ */
+class GateTable {
+public:
+	GateTable() :
+			m_pChunks(NULL) {
+	}
+	GateTable(GATE** chunks) :
+			m_pChunks(chunks) {
+	}
+
+	GATE& operator[](uint32_t gateid) const {
+		return m_pChunks[gateid >> GATE_CHUNK_BITS][gateid & (GATE_CHUNK_SIZE - 1)];
+	}
+	GATE* operator+(uint32_t gateid) const {
+		return m_pChunks[gateid >> GATE_CHUNK_BITS] + (gateid & (GATE_CHUNK_SIZE - 1));
+	}
+
+private:
+	GATE** m_pChunks;	// chunk pointers, indexed by the upper bits of the gate id
+};
 
 string GetOpName(e_gatetype op);
 
@@ -164,6 +228,34 @@ struct non_lin_vec_ctx {
 	uint32_t numgates;
 };
 
+/** Result of the circuit optimization, see ABYCircuit::Optimize */
+struct circ_opt_stats {
+	uint32_t nfolded;		// gates that were replaced by one of their inputs or a constant
+	uint32_t nmerged;		// gates that were replaced by an identical gate
+	uint32_t nremoved;		// gates that were removed since their values are never used
+	uint64_t nandsbefore;	// number of AND values in the Boolean circuits before the optimization
+	uint64_t nandsafter;	// number of AND values in the Boolean circuits after the optimization
+	uint32_t nrebalanced;	// AND trees that were rebalanced
+	uint32_t ndepthbefore;	// depth of the rebalanced sharings before the rebalancing
+	uint32_t ndepthafter;	// depth of the rebalanced sharings after the rebalancing
+};
+
+/**
+ Header of a binary circuit file, see ABYCircuit::WriteBinaryCircuit. The gates are stored as they are in memory, with
+ the pointers to their input lists and gate-specific buffers replaced by offsets into the data section.
+ */
+struct circ_file_header {
+	char magic[4];			// CIRC_FILE_MAGIC
+	uint32_t version;		// CIRC_FILE_VERSION
+	uint32_t gatesize;		// sizeof(GATE) of the writer, differs between the default and the packed gate layout
+	uint32_t ngates;
+	uint32_t maxvectorsize;
+	uint32_t reserved;
+	uint64_t gateoffset;	// file offset of the gate array
+	uint64_t dataoffset;	// file offset of the buffers that the gates reference
+	uint64_t stateoffset;	// file offset behind the gates, where ABYParty stores the state of the circuits
+};
+
 struct tt_lens_ctx {
 	uint32_t tt_len;
 	uint32_t numgates;
@@ -175,6 +267,11 @@ uint32_t FindBitLenPositionInVec(uint32_t bitlen, non_lin_vec_ctx* list, uint32_
 
 class ABYCircuit {
 public:
+	/**
+	 Allocates the first chunk of gates, further chunks of GATE_CHUNK_SIZE gates are allocated as the circuit grows.
+	 Gates never move, such that gate ids and gate pointers stay valid. maxgates is no longer a bound on the circuit
+	 size and is only kept for compatibility.
+	 */
 	ABYCircuit(uint32_t maxgates);
 	virtual ~ABYCircuit() {
 		Cleanup();
@@ -182,7 +279,7 @@ public:
 
 	void Cleanup();
 	void Reset();
-	GATE* Gates() {
+	GateTable Gates() {
 		return m_pGates;
 	}
 
@@ -227,6 +324,80 @@ public:
 		return m_nMaxVectorSize;
 	}
 
+	/**
+	 Freezes the gates that were built so far, such that the circuit can be evaluated again on new inputs without
+	 rebuilding it. Has to be called before the circuit is evaluated, since the evaluation consumes the gates.
+	 Circuits with truth-table gates or shared Yao inputs are referenced by the sharings during the setup phase and
+	 cannot be frozen.
+	 \return true if the circuit was frozen
+	 */
+	bool Compile();
+	//Drops the frozen gates, the next Reset clears the circuit again
+	void DiscardCompiled();
+	bool IsCompiled() {
+		return m_pCompiledGates != NULL;
+	}
+	//Restores the frozen gates after an evaluation. Input gates get back the values they had when they were frozen.
+	void RestoreCompiled();
+	/**
+	 Returns the next frozen input gate in the order in which the input gates were built and clears its value from the
+	 previous execution. Is used instead of PutINGate and PutSharedINGate once the circuit is frozen.
+	 */
+	uint32_t RebindINGate(e_gatetype type, e_sharing context, uint32_t nvals, e_role src);
+
+	/**
+	 Collects the wiring and the gate-specific data of a gate as 64-bit words: the ids of its input gates, followed by
+	 its constant, positions, permutation or truth table where it has one. Input values are not included. Has to be
+	 called before the gate is evaluated, since the evaluation frees the input lists.
+	 */
+	void GetGateDescription(uint32_t gateid, vector<uint64_t>& desc);
+
+	/**
+	 Writes the gates in a versioned binary format that MapBinaryCircuit maps into memory. The same restrictions as
+	 for Compile apply and the circuit must not have been evaluated yet.
+	 \return the file offset behind the gates, where further data can be appended, or 0 on failure
+	 */
+	uint64_t WriteBinaryCircuit(ofstream& out);
+	/**
+	 Maps a file that was written by WriteBinaryCircuit into memory and uses its gates as the frozen gates of this
+	 circuit, as if the circuit had been built and compiled. Only the input lists and buffers of the gates are
+	 relocated, the gates themselves are not rebuilt. The circuit has to be empty. DiscardCompiled unmaps the file.
+	 \return the file offset behind the gates, or 0 on failure
+	 */
+	uint64_t MapBinaryCircuit(const char* filename);
+
+	/**
+	 Liveness analysis of the gate values: computes for every gate the last layer on which its value is read, or
+	 GATE_LIVE_FOREVER if the value is needed until the circuit is reset. Has to be called before the circuit is
+	 evaluated, since the evaluation consumes the input gate lists.
+	 \param lastuse	is resized to the number of gates and receives the last layer of every gate
+	 */
+	void ComputeLastUse(vector<uint32_t>& lastuse);
+
+	/**
+	 Optimizes the gates of the Boolean circuits (Boolean, Yao and SP-LUT sharing) before the setup phase: folds XOR
+	 and AND gates with constant inputs, merges structurally identical gates and finds the gates whose values never
+	 reach an output or a gate of another kind. The consumers of folded and merged gates are rewired to the
+	 replacement. The circuits have to take the removed gates out of their queues before RemoveGates is called.
+	 \param removed	is resized to the number of gates and flags the gates that can be removed
+	 \param stats		receives the number of optimized gates
+	 */
+	void Optimize(vector<bool>& removed, circ_opt_stats& stats);
+	//Frees the removed gates and marks them as G_REMOVED
+	void RemoveGates(vector<bool>& removed);
+
+	/**
+	 Rewrites trees of AND gates, as built by chains of PutANDGate or PutORGate calls, into trees of minimal depth and
+	 lowers the depth of the subsequent gates of the same sharings accordingly. Only gates of the selected sharings are
+	 changed; the gates of other sharings keep their depth. The circuits of the selected sharings have to take the
+	 removed gates out of their queues and re-queue their gates before RemoveGates is called. After the rebalancing,
+	 the gate ids within a rebalanced tree are no longer in topological order.
+	 \param contexts	bit mask of the sharings whose gates are rebalanced (bit s for sharing s)
+	 \param removed	is resized to the number of gates and flags the double inversions of OR chains that became unused
+	 \param stats		receives the number of rebalanced trees and the depth before and after
+	 */
+	void Rebalance(uint32_t contexts, vector<bool>& removed, circ_opt_stats& stats);
+
 	//Export the constructed circuit in the Bristol circuit file format
 	void ExportCircuitInBristolFormat(vector<uint32_t> ingates_client, vector<uint32_t> ingates_server,
 			vector<uint32_t> outgates, const char* filename);
@@ -238,6 +409,24 @@ private:
 	inline void InitGate(GATE* gate, e_gatetype type, uint32_t ina, uint32_t inb);
 	inline void InitGate(GATE* gate, e_gatetype type, vector<uint32_t>& inputs);
 
+	inline GATE* NextFreeGate();
+	inline void SetRounds(GATE* gate, uint32_t rounds);
+	bool AllocGateChunks(uint32_t ngates);
+	void FreeGateChunks();
+
+	inline bool HasParentsArray(e_gatetype type);
+	inline bool IsOptimizable(GATE* gate);
+	inline bool IsConstantGate(uint32_t gateid, bool one);
+	uint32_t FoldGate(uint32_t gateid);
+	void RemapInput(uint32_t& input, vector<uint32_t>& replace);
+	inline uint32_t GetMaxInputReady(GATE* gate);
+	inline bool IsTreeNode(uint32_t gateid, GATE* root);
+	uint32_t GetTreeChild(uint32_t input, GATE* root, vector<uint32_t>& invs);
+	void CopyGateData(GATE* dst, GATE* src);
+	void GetGateBuffers(GATE* gate, vector<pair<void**, uint64_t> >& bufs, bool mapped = false);
+	bool CheckMappedGate(GATE* gate, uint32_t ngates, BYTE* data, uint64_t databytes, vector<pair<void**, uint64_t> >& bufs);
+	void FreeGateData(GATE* gate);
+
 	inline uint32_t GetNumRounds(e_gatetype type, e_sharing context);
 	inline void MarkGateAsUsed(uint32_t gateid, uint32_t uses = 1);
 
@@ -246,10 +435,18 @@ private:
 	void CheckAndPropagateConstant(uint32_t gateid, uint32_t& next_gate_id, vector<int>& gate_id_map,
 			vector<int>& constant_map, ofstream& outfile);
 
-	GATE* m_pGates;
+	GateTable m_pGates;
+	GATE** m_pGateChunks;		// chunks of GATE_CHUNK_SIZE gates, only the first m_nGateChunks are allocated
+	uint32_t m_nGateChunks;		// number of allocated chunks
 	uint32_t m_nNextFreeGate;	// points to the current first unused gate
 	uint32_t m_nMaxVectorSize; 	// The maximum vector size in bits, required for correctly instantiating the 0 and 1 gates
-	uint32_t m_nMaxGates; 		// Maximal number of gates that is allowed
+
+	GATE* m_pCompiledGates;					// frozen copy of the gates, NULL if the circuit is not compiled
+	uint32_t m_nCompiledGates;				// number of frozen gates
+	vector<uint32_t> m_vCompiledINGates;	// input gates of the frozen circuit in the order they were built
+	uint32_t m_nNextCompiledINGate;			// next input gate that is bound by RebindINGate
+	BYTE* m_pMappedCircuit;					// mapped circuit file that holds the frozen gates, NULL if not mapped
+	uint64_t m_nMappedBytes;
 };
 
 #endif /* __ABYCIRCUIT_H_ */
@@ -82,6 +82,8 @@ share* ArithmeticCircuit::PutSUBGate(share* ina, share* inb) {
 	return shr;
 }
 uint32_t ArithmeticCircuit::PutINGate(e_role src) {
+	if (IsCompiled())
+		return m_cCircuit->RebindINGate(G_IN, m_eContext, 1, src);
 	uint32_t gateid = m_cCircuit->PutINGate(m_eContext, 1, m_nShareBitLen, src, m_nRoundsIN[src]);
 	UpdateInteractiveQueue(gateid);
 	switch (src) {
@@ -108,12 +110,16 @@ uint32_t ArithmeticCircuit::PutINGate(e_role src) {
 }
 
 uint32_t ArithmeticCircuit::PutSharedINGate() {
+	if (IsCompiled())
+		return m_cCircuit->RebindINGate(G_SHARED_IN, m_eContext, 1, ALL);
 	uint32_t gateid = m_cCircuit->PutSharedINGate(m_eContext, 1, m_nShareBitLen);
 	UpdateLocalQueue(gateid);
 	return gateid;
 }
 
 uint32_t ArithmeticCircuit::PutSIMDINGate(uint32_t ninvals, e_role src) {
+	if (IsCompiled())
+		return m_cCircuit->RebindINGate(G_IN, m_eContext, ninvals, src);
 	uint32_t gateid = m_cCircuit->PutINGate(m_eContext, ninvals, m_nShareBitLen, src, m_nRoundsIN[src]);
 	UpdateInteractiveQueue(gateid);
 	switch (src) {
@@ -141,6 +147,8 @@ uint32_t ArithmeticCircuit::PutSIMDINGate(uint32_t ninvals, e_role src) {
 
 
 uint32_t ArithmeticCircuit::PutSharedSIMDINGate(uint32_t ninvals) {
+	if (IsCompiled())
+		return m_cCircuit->RebindINGate(G_SHARED_IN, m_eContext, ninvals, ALL);
 	uint32_t gateid = m_cCircuit->PutSharedINGate(m_eContext, ninvals, m_nShareBitLen);
 	UpdateLocalQueue(gateid);
 	return gateid;
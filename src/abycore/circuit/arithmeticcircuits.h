@@ -268,9 +268,6 @@ public:
 private:
 	void UpdateInteractiveQueue(uint32_t gateid);
 	void UpdateLocalQueue(uint32_t gateid);
-
-	uint32_t m_nMULs; //number of AND gates in the circuit
-	uint32_t m_nCONVGates; //number of Boolean to arithmetic conversion gates
 };
 
 #endif /* __ARITHMETICCIRCUITS_H_ */
@@ -188,6 +188,8 @@ vector<uint32_t> BooleanCircuit::PutXORGate(vector<uint32_t> inleft, vector<uint
 }
 
 uint32_t BooleanCircuit::PutINGate(e_role src) {
+	if (IsCompiled())
+		return m_cCircuit->RebindINGate(G_IN, m_eContext, 1, src);
 	uint32_t gateid = m_cCircuit->PutINGate(m_eContext, 1, m_nShareBitLen, src, m_nRoundsIN[src]);
 	UpdateInteractiveQueue(gateid);
 	switch (src) {
@@ -214,6 +216,8 @@ uint32_t BooleanCircuit::PutINGate(e_role src) {
 }
 
 uint32_t BooleanCircuit::PutSIMDINGate(uint32_t ninvals, e_role src) {
+	if (IsCompiled())
+		return m_cCircuit->RebindINGate(G_IN, m_eContext, ninvals, src);
 	uint32_t gateid = m_cCircuit->PutINGate(m_eContext, ninvals, m_nShareBitLen, src, m_nRoundsIN[src]);
 	UpdateInteractiveQueue(gateid);
 	switch (src) {
@@ -257,12 +261,16 @@ share* BooleanCircuit::PutDummySIMDINGate(uint32_t nvals, uint32_t bitlen) {
 
 
 uint32_t BooleanCircuit::PutSharedINGate() {
+	if (IsCompiled())
+		return m_cCircuit->RebindINGate(G_SHARED_IN, m_eContext, 1, ALL);
 	uint32_t gateid = m_cCircuit->PutSharedINGate(m_eContext, 1, m_nShareBitLen);
 	UpdateLocalQueue(gateid);
 	return gateid;
 }
 
 uint32_t BooleanCircuit::PutSharedSIMDINGate(uint32_t ninvals) {
+	if (IsCompiled())
+		return m_cCircuit->RebindINGate(G_SHARED_IN, m_eContext, ninvals, ALL);
 	uint32_t gateid = m_cCircuit->PutSharedINGate(m_eContext, ninvals, m_nShareBitLen);
 	UpdateLocalQueue(gateid);
 	return gateid;
@@ -2415,93 +2423,115 @@ vector<uint32_t> BooleanCircuit::PutFPGate(const string func, vector<uint32_t> i
 }
 
 
+//The file is parsed once per process, see CircuitFile, and its netlist is replayed into the gates of this circuit
 vector<uint32_t> BooleanCircuit::PutGateFromFile(const string filename, vector<uint32_t> inputs, uint32_t nvals){
-	string line;
-	vector<uint32_t> tokens, outputs;
-	map<uint32_t, uint32_t> wires;
-
-	ifstream myfile;
-
-	//cout << "opening " << filename <<  endl;
-	myfile.open(filename.c_str());
-
-	uint32_t file_input_size = 0;
-
-	if (myfile.is_open()) {
-		while (getline(myfile, line)) {
-
-			if (line != "") {
-
-				tokenize_verilog(line, tokens);
+	shared_ptr<CircuitFile> file = CircuitFile::Get(filename);
+	if (!file) {
+		cerr << "Error: Unable to open circuit file " << filename << endl;
+		return vector<uint32_t>();
+	}
 
-				switch (line.at(0)) {
+	assert(inputs.size() >= file->GetInputs().size());
+	if (file->GetInputs().size() < inputs.size()) {
+		cerr << "Warning: Input sizes didn't match! Less inputs read from circuit file than passed to it!" << endl;
+	}
 
-				case 'S': // Server input wire ids
-					assert(inputs.size() >= tokens.size() + file_input_size);
+	return PutCircuitFileGates(file.get(), inputs, nvals);
+}
 
-					for (uint32_t i = 0; i < tokens.size(); i++) {
-						wires[tokens[i]] = inputs[i + file_input_size];
-					}
-					file_input_size += tokens.size();
-					break;
+vector<uint32_t> BooleanCircuit::PutBristolFashionGate(const string filename, vector<uint32_t> inputs, uint32_t nvals){
+	shared_ptr<CircuitFile> file = CircuitFile::Get(filename, CIRC_FILE_BRISTOL_FASHION);
+	if (!file) {
+		cerr << "Error: Unable to open circuit file " << filename << endl;
+		return vector<uint32_t>();
+	}
 
-				case 'C': // Client input wire ids
-					assert(inputs.size() >= tokens.size() + file_input_size);
+	if (inputs.size() != file->GetInputs().size()) {
+		cerr << "Error: Circuit file " << filename << " expects " << file->GetInputs().size() << " input wires, but " <<
+				inputs.size() << " were given" << endl;
+		assert(inputs.size() == file->GetInputs().size());
+	}
 
-					for (uint32_t i = 0; i < tokens.size(); i++) {
-						wires[tokens[i]] = inputs[i + file_input_size];
-					}
-					file_input_size += tokens.size();
-					break;
+	return PutCircuitFileGates(file.get(), inputs, nvals);
+}
 
-				case '0': // Constant Zero Gate
-					wires[tokens[0]] = PutConstantGate(0, nvals);
-					break;
+share* BooleanCircuit::PutBristolFashionGate(const string filename, share* input) {
+	return new boolshare(PutBristolFashionGate(filename, input->get_wires(), input->get_nvals_on_wire(input->get_wires()[0])), this);
+}
 
-				case '1': // Constant Zero Gate
-					wires[tokens[0]] = PutConstantGate((1 << nvals) - 1, nvals);
-					break;
+vector<uint32_t> BooleanCircuit::PutCircuitFileGates(CircuitFile* file, vector<uint32_t>& inputs, uint32_t nvals) {
+	vector<uint32_t>& fileinputs = file->GetInputs();
+	vector<circ_file_gate>& gates = file->GetGates();
+	vector<uint32_t> wires(file->GetNumWires());
 
-				case 'A': // AND Gate
-					wires[tokens[2]] = PutANDGate(wires[tokens[0]], wires[tokens[1]]);
-					break;
+	for (uint32_t i = 0; i < fileinputs.size(); i++) {
+		wires[fileinputs[i]] = inputs[i];
+	}
 
-				case 'X': // XOR Gate
-					wires[tokens[2]] = PutXORGate(wires[tokens[0]], wires[tokens[1]]);
-					break;
+	for (uint32_t i = 0; i < gates.size(); i++) {
+		circ_file_gate& gate = gates[i];
+		switch (gate.type) {
+		case '0': // Constant Zero Gate
+			wires[gate.out] = PutConstantGate(0, nvals);
+			break;
+		case '1': // Constant One Gate
+			//the constant of a Yao gate holds one bit per SIMD value, an inverted zero is one for every value in all sharings
+			wires[gate.out] = PutINVGate(PutConstantGate(0, nvals));
+			break;
+		case 'A': // AND Gate
+			wires[gate.out] = PutANDGate(wires[gate.in[0]], wires[gate.in[1]]);
+			break;
+		case 'X': // XOR Gate
+			wires[gate.out] = PutXORGate(wires[gate.in[0]], wires[gate.in[1]]);
+			break;
+		case 'M': // MUX Gate
+			wires[gate.out] = PutVecANDMUXGate(wires[gate.in[1]], wires[gate.in[0]], wires[gate.in[2]]);
+			break;
+		case 'I': // INV Gate
+			wires[gate.out] = PutINVGate(wires[gate.in[0]]);
+			break;
+		case 'E': // Copied wire
+			wires[gate.out] = wires[gate.in[0]];
+			break;
+		case 'N': // Multiple independent AND Gates
+			PutMANDGate(&(file->GetMultiWires()[gate.in[0]]), gate.in[1], wires);
+			break;
+		}
+	}
 
-				case 'M': // MUX Gate
-					wires[tokens[3]] = PutVecANDMUXGate(wires[tokens[1]], wires[tokens[0]], wires[tokens[2]]);
-					break;
+	vector<uint32_t>& fileoutputs = file->GetOutputs();
+	vector<uint32_t> outputs(fileoutputs.size());
+	for (uint32_t i = 0; i < fileoutputs.size(); i++) {
+		outputs[i] = wires[fileoutputs[i]];
+	}
+	return outputs;
+}
 
-				case 'I': // INV Gate
-					wires[tokens[1]] = PutINVGate(tokens[0]);
-					break;
+//The k ANDs of a MAND gate are combined into a single SIMD AND gate, such that the sharing processes them as one batch
+void BooleanCircuit::PutMANDGate(uint32_t* multiwires, uint32_t nands, vector<uint32_t>& wires) {
+	vector<uint32_t> left(nands), right(nands);
+	uint32_t nvals = m_pGates[wires[multiwires[0]]].nvals;
+	bool combine = nands > 1;
 
-				case 'O': // List of output wires
-					for (uint32_t i = 0; i < tokens.size(); i++) {
-						outputs.push_back(wires[tokens[i]]);
-					}
-					cout << endl;
-					break;
-				}
-			}
-		}
-		myfile.close();
+	for (uint32_t i = 0; i < nands; i++) {
+		left[i] = wires[multiwires[i]];
+		right[i] = wires[multiwires[nands + i]];
+		combine &= (m_pGates[left[i]].nvals == nvals && m_pGates[right[i]].nvals == nvals);
+	}
 
-		if (file_input_size < inputs.size()) {
-			cerr << "Warning: Input sizes didn't match! Less inputs read from circuit file than passed to it!" << endl;
+	if (!combine) {
+		for (uint32_t i = 0; i < nands; i++) {
+			wires[multiwires[2 * nands + i]] = PutANDGate(left[i], right[i]);
 		}
+		return;
 	}
 
-	else {
-		cerr << "Error: Unable to open circuit file " << filename << endl;
+	uint32_t andgate = PutANDGate(PutCombinerGate(left), PutCombinerGate(right));
+	vector<uint32_t> out = m_cCircuit->PutSplitterGate(andgate, vector<uint32_t>(nands, nvals));
+	for (uint32_t i = 0; i < nands; i++) {
+		UpdateLocalQueue(out[i]);
+		wires[multiwires[2 * nands + i]] = out[i];
 	}
-
-	wires.clear();
-	tokens.clear();
-
-	return outputs;
 }
 
 share* BooleanCircuit::PutLUTGateFromFile(const string filename, share* input) {
@@ -2630,44 +2660,12 @@ vector<uint32_t> BooleanCircuit::PutLUTGateFromFile(const string filename, vecto
 
 
 uint32_t BooleanCircuit::GetInputLengthFromFile(const string filename){
-	string line;
-	vector<uint32_t> tokens;
-	ifstream myfile;
-
-	//cout << "opening " << filename <<  endl;
-	myfile.open(filename.c_str());
-
-	uint32_t file_input_size = 0;
-
-	if (myfile.is_open()) {
-		while (getline(myfile, line)) {
-
-			if (line != "") {
-
-				tokenize_verilog(line, tokens);
-
-				switch (line.at(0)) {
-
-				case 'S': // Server input wire ids
-					file_input_size += tokens.size();
-					break;
-
-				case 'C': // Client input wire ids
-					file_input_size += tokens.size();
-					break;
-				}
-			}
-		}
-		myfile.close();
-	}
-
-	else {
+	shared_ptr<CircuitFile> file = CircuitFile::Get(filename);
+	if (!file) {
 		cerr << "Error: Unable to open circuit file " << filename << endl;
+		return 0;
 	}
-
-	tokens.clear();
-
-	return file_input_size;
+	return file->GetInputs().size();
 }
 
 uint32_t BooleanCircuit::PutIdxGate(uint32_t r, uint32_t maxidx) {
@@ -2762,6 +2760,53 @@ void BooleanCircuit::Reset() {
 	m_vTTlens[0][0][0].ttable_values.clear();
 }
 
+//The removed XOR and AND gates are no longer counted, such that no multiplication triples or garbled tables are created for them
+void BooleanCircuit::RemoveGates(vector<bool>& removed) {
+	for (uint32_t i = 0; i < removed.size(); i++) {
+		if (!removed[i] || m_pGates[i].context != m_eContext) {
+			continue;
+		}
+		if (m_pGates[i].type == G_NON_LIN) {
+			m_vANDs[0].numgates -= m_pGates[i].nvals;
+		} else if (m_pGates[i].type == G_LIN) {
+			m_nNumXORVals -= m_pGates[i].nvals;
+			m_nNumXORGates--;
+		}
+	}
+	Circuit::RemoveGates(removed);
+}
+
+//The gates of truth tables are not stored, hence only the AND sizes are added to the state
+void BooleanCircuit::WriteState(ofstream& out) {
+	Circuit::WriteState(out);
+
+	uint32_t counters[] = { m_nB2YGates, m_nA2YGates, m_nYSwitchGates, m_nNumXORVals, m_nNumXORGates, m_nNumANDSizes };
+	out.write((char*) counters, sizeof(counters));
+	out.write((char*) m_vANDs, sizeof(non_lin_vec_ctx) * m_nNumANDSizes);
+}
+
+BOOL BooleanCircuit::ReadState(ifstream& in) {
+	if (!Circuit::ReadState(in)) {
+		return FALSE;
+	}
+
+	uint32_t counters[6];
+	in.read((char*) counters, sizeof(counters));
+	if (!in.good() || counters[5] == 0) {
+		return FALSE;
+	}
+	m_nB2YGates = counters[0];
+	m_nA2YGates = counters[1];
+	m_nYSwitchGates = counters[2];
+	m_nNumXORVals = counters[3];
+	m_nNumXORGates = counters[4];
+	m_nNumANDSizes = counters[5];
+	m_vANDs = (non_lin_vec_ctx*) realloc(m_vANDs, sizeof(non_lin_vec_ctx) * m_nNumANDSizes);
+	in.read((char*) m_vANDs, sizeof(non_lin_vec_ctx) * m_nNumANDSizes);
+
+	return in.good();
+}
+
 void BooleanCircuit::PadWithLeadingZeros(vector<uint32_t> &a, vector<uint32_t> &b) {
 	uint32_t maxlen = max(a.size(), b.size());
 	if(a.size() != b.size()) {
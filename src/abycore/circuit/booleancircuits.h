@@ -23,6 +23,7 @@
 #include "abycircuit.h"
 #include <assert.h>
 #include "circuit.h"
+#include "circuitfile.h"
 #include <map>
 #include <fstream>
 #include <algorithm>
@@ -46,6 +47,11 @@ public:
 	void Cleanup();
 	void Reset();
 
+	void RemoveGates(vector<bool>& removed);
+
+	void WriteState(ofstream& out);
+	BOOL ReadState(ifstream& in);
+
 	uint32_t PutANDGate(uint32_t left, uint32_t right);
 	vector<uint32_t> PutANDGate(vector<uint32_t> inleft, vector<uint32_t> inright);
 	share* PutANDGate(share* ina, share* inb);
@@ -372,6 +378,17 @@ public:
 	 */
 	vector<uint32_t> PutGateFromFile(const string filename, vector<uint32_t> inputs, uint32_t nvals = 1);
 
+	/**
+	 * \brief Add gate from a circuit file in Bristol Fashion. The netlist is instantiated once on SIMD wires, i.e., it
+	 * 		  processes as many values in parallel as the input wires hold. Wire i of the file is the i-th input wire, the
+	 * 		  outputs are the last wires of the file. MAND gates are evaluated as a single AND gate on combined wires.
+	 * \param inputs input wire IDs of all input values of the file, in order
+	 * \param nvals parallel instantiation, needs to match the number of values on the input wires
+	 * \return output wire IDs of all output values of the file, in order
+	 */
+	vector<uint32_t> PutBristolFashionGate(const string filename, vector<uint32_t> inputs, uint32_t nvals = 1);
+	share* PutBristolFashionGate(const string filename, share* input);
+
 	/**
 	 * \brief Get the number of input bits for both parties that a given circuit file expects
 	 * \param the file name of the circuit
@@ -545,6 +562,9 @@ public:
         share * PutFPGate(share * in_a, share * in_b, op_t op, fp_op_setting s = no_status);
 
 private:
+	vector<uint32_t> PutCircuitFileGates(CircuitFile* file, vector<uint32_t>& inputs, uint32_t nvals);
+	void PutMANDGate(uint32_t* multiwires, uint32_t nands, vector<uint32_t>& wires);
+
 	void UpdateInteractiveQueue(uint32_t);
 	void UpdateLocalQueue(uint32_t gateid);
 
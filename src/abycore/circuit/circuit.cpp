@@ -92,6 +92,89 @@ void Circuit::Reset() {
 	//m_vNonLinOnLayer.min_depth = 0;
 }
 
+void Circuit::WriteQueues(ofstream& out, vector<deque<uint32_t> >& queues) {
+	uint32_t nqueues = queues.size();
+	out.write((char*) &nqueues, sizeof(uint32_t));
+	for (uint32_t i = 0; i < nqueues; i++) {
+		uint32_t ngates = queues[i].size();
+		out.write((char*) &ngates, sizeof(uint32_t));
+		for (uint32_t j = 0; j < ngates; j++) {
+			out.write((char*) &(queues[i][j]), sizeof(uint32_t));
+		}
+	}
+}
+
+void Circuit::ReadQueues(ifstream& in, vector<deque<uint32_t> >& queues) {
+	uint32_t nqueues = 0, ngates = 0, gateid;
+	in.read((char*) &nqueues, sizeof(uint32_t));
+	queues.clear();
+	queues.resize(in.good() ? nqueues : 0);
+	for (uint32_t i = 0; i < queues.size() && in.good(); i++) {
+		in.read((char*) &ngates, sizeof(uint32_t));
+		for (uint32_t j = 0; j < ngates && in.good(); j++) {
+			in.read((char*) &gateid, sizeof(uint32_t));
+			queues[i].push_back(gateid);
+		}
+	}
+}
+
+void Circuit::WriteState(ofstream& out) {
+	uint32_t head[] = { m_eContext, m_nShareBitLen, m_nMaxDepth, m_nGates, ncombgates, npermgates, nsubsetgates,
+			nsplitgates, nstructcombgates, m_nMULs, m_nCONVGates };
+	out.write((char*) head, sizeof(head));
+
+	WriteQueues(out, m_vLocalQueueOnLvl);
+	WriteQueues(out, m_vInteractiveQueueOnLvl);
+	WriteQueues(out, m_vInputGates);
+	WriteQueues(out, m_vOutputGates);
+	for (uint32_t i = 0; i < m_vInputBits.size(); i++) {
+		out.write((char*) &(m_vInputBits[i]), sizeof(uint32_t));
+		out.write((char*) &(m_vOutputBits[i]), sizeof(uint32_t));
+	}
+}
+
+BOOL Circuit::ReadState(ifstream& in) {
+	uint32_t head[11];
+	in.read((char*) head, sizeof(head));
+	if (!in.good() || head[0] != (uint32_t) m_eContext || head[1] != m_nShareBitLen) {
+		cerr << "Circuit state does not belong to the " << get_sharing_name(m_eContext) << " circuit" << endl;
+		return FALSE;
+	}
+	m_nMaxDepth = head[2];
+	m_nGates = head[3];
+	ncombgates = head[4];
+	npermgates = head[5];
+	nsubsetgates = head[6];
+	nsplitgates = head[7];
+	nstructcombgates = head[8];
+	m_nMULs = head[9];
+	m_nCONVGates = head[10];
+
+	ReadQueues(in, m_vLocalQueueOnLvl);
+	ReadQueues(in, m_vInteractiveQueueOnLvl);
+	ReadQueues(in, m_vInputGates);
+	ReadQueues(in, m_vOutputGates);
+	for (uint32_t i = 0; i < m_vInputBits.size(); i++) {
+		in.read((char*) &(m_vInputBits[i]), sizeof(uint32_t));
+		in.read((char*) &(m_vOutputBits[i]), sizeof(uint32_t));
+	}
+
+	//the gates of the queues have to lie in the mapped circuit
+	uint32_t ngates = m_cCircuit->GetGateHead();
+	vector<deque<uint32_t> >* lists[] = { &m_vLocalQueueOnLvl, &m_vInteractiveQueueOnLvl, &m_vInputGates, &m_vOutputGates };
+	for (uint32_t l = 0; l < 4; l++) {
+		for (uint32_t i = 0; i < lists[l]->size(); i++) {
+			for (uint32_t j = 0; j < (*lists[l])[i].size(); j++) {
+				if ((*lists[l])[i][j] >= ngates) {
+					cerr << "Circuit state references gate " << (*lists[l])[i][j] << " that does not exist" << endl;
+					return FALSE;
+				}
+			}
+		}
+	}
+	return in.good();
+}
+
 gate_specific Circuit::GetGateSpecificOutput(uint32_t gateid) {
 	assert(m_pGates[gateid].instantiated);
 	return m_pGates[gateid].gs;
@@ -235,6 +318,86 @@ share* Circuit::PutRepeaterGate(uint32_t nvals, share* input) {
 	return out;
 }
 
+uint32_t Circuit::GetForeignInputSharingsOnLvl(uint32_t lvl) {
+	uint32_t sharings = 0;
+	deque<uint32_t>* queues[2];
+	queues[0] = lvl < m_vLocalQueueOnLvl.size() ? &(m_vLocalQueueOnLvl[lvl]) : NULL;
+	queues[1] = lvl < m_vInteractiveQueueOnLvl.size() ? &(m_vInteractiveQueueOnLvl[lvl]) : NULL;
+
+	for (uint32_t q = 0; q < 2; q++) {
+		if (queues[q] == NULL)
+			continue;
+		for (uint32_t i = 0; i < queues[q]->size(); i++) {
+			GATE* gate = m_pGates + (*queues[q])[i];
+			switch (gate->type) {
+			case G_CALLBACK:
+				//callbacks are defined by the developer and may access anything
+				sharings |= ((1 << S_LAST) - 1) & ~(1 << m_eContext);
+				break;
+			case G_COMBINE:
+			case G_COMBINEPOS:
+			case G_STRUCT_COMBINE:
+			case G_PERM:
+			case G_CONV:
+			case G_TT:
+			case G_PRINT_VAL:
+			case G_ASSERT:
+				for (uint32_t j = 0; j < gate->ingates.ningates; j++) {
+					e_sharing context = m_pGates[gate->ingates.inputs.parents[j]].context;
+					if (context != m_eContext) {
+						sharings |= (1 << context);
+					}
+				}
+				break;
+			default:
+				//gates with one or two inputs always have the sharing of their inputs
+				break;
+			}
+		}
+	}
+	return sharings;
+}
+
+void Circuit::RemoveGates(vector<bool>& removed) {
+	vector<deque<uint32_t> >* queues[2] = { &m_vLocalQueueOnLvl, &m_vInteractiveQueueOnLvl };
+
+	for (uint32_t q = 0; q < 2; q++) {
+		for (uint32_t lvl = 0; lvl < queues[q]->size(); lvl++) {
+			deque<uint32_t>& queue = (*queues[q])[lvl];
+			uint32_t kept = 0;
+			for (uint32_t i = 0; i < queue.size(); i++) {
+				if (!removed[queue[i]]) {
+					queue[kept++] = queue[i];
+				}
+			}
+			m_nGates -= queue.size() - kept;
+			queue.resize(kept);
+		}
+	}
+}
+
+void Circuit::RequeueGates() {
+	vector<deque<uint32_t> >* queues[2] = { &m_vLocalQueueOnLvl, &m_vInteractiveQueueOnLvl };
+
+	m_nMaxDepth = 0;
+	for (uint32_t q = 0; q < 2; q++) {
+		//the depths only decrease, such that a gate never moves behind a gate that is taken from a later level
+		vector<deque<uint32_t> > old;
+		old.swap(*queues[q]);
+		queues[q]->resize(old.size());
+		for (uint32_t lvl = 0; lvl < old.size(); lvl++) {
+			for (uint32_t i = 0; i < old[lvl].size(); i++) {
+				uint32_t depth = m_pGates[old[lvl][i]].depth;
+				(*queues[q])[depth].push_back(old[lvl][i]);
+				m_nMaxDepth = max(m_nMaxDepth, depth + 1);
+			}
+		}
+		while (queues[q]->size() > 0 && queues[q]->back().size() == 0) {
+			queues[q]->pop_back();
+		}
+	}
+}
+
 void Circuit::UpdateInteractiveQueue(share* gateids) {
 	for (uint32_t i = 0; i < gateids->get_bitlength(); i++) {
 		UpdateInteractiveQueue(gateids->get_wire_id(i));
@@ -104,6 +104,70 @@ public:
 	}
 	;
 
+	/**
+		Returns the number of gates in the Local queue on the inputed level without copying the queue.
+	*/
+	uint32_t GetNumLocalGatesOnLvl(uint32_t lvl) {
+		return lvl < m_vLocalQueueOnLvl.size() ? m_vLocalQueueOnLvl[lvl].size() : 0;
+	}
+
+	/**
+		Returns the number of gates in the Interactive queue on the inputed level without copying the queue.
+	*/
+	uint32_t GetNumInteractiveGatesOnLvl(uint32_t lvl) {
+		return lvl < m_vInteractiveQueueOnLvl.size() ? m_vInteractiveQueueOnLvl[lvl].size() : 0;
+	}
+
+	/**
+		Checks whether the underlying gates were frozen by ABYCircuit::Compile. Input gates of a compiled circuit are
+		bound to the frozen gates instead of creating new ones and the queues are kept when the sharings are reset.
+	*/
+	BOOL IsCompiled() {
+		return m_cCircuit->IsCompiled();
+	}
+
+	/**
+		Checks whether there are any local or interactive gates on the inputed level.
+		\param lvl Required level.
+		\return TRUE if the local or the interactive queue on the level is non-empty
+	*/
+	BOOL HasGatesOnLvl(uint32_t lvl) {
+		return (lvl < m_vLocalQueueOnLvl.size() && m_vLocalQueueOnLvl[lvl].size() > 0) ||
+				(lvl < m_vInteractiveQueueOnLvl.size() && m_vInteractiveQueueOnLvl[lvl].size() > 0);
+	}
+
+	/**
+		Finds the sharings whose gates are read by the gates on the inputed level, besides the own sharing. Only gates with
+		a list of parents, such as conversion gates, can have inputs from another sharing.
+		\param lvl Required level.
+		\return Bit mask in which bit s is set if a gate on the level reads a gate of sharing s
+	*/
+	uint32_t GetForeignInputSharingsOnLvl(uint32_t lvl);
+
+	/**
+		Takes the gates of this circuit that were removed by the circuit optimization out of the queues.
+		\param removed Flags the removed gates, indexed by the gate id, see ABYCircuit::Optimize
+	*/
+	virtual void RemoveGates(vector<bool>& removed);
+
+	/**
+		Moves the queued gates to the level of their current depth and recomputes the maximal depth, after the depths
+		were changed by ABYCircuit::Rebalance. Gates that end up on the same level keep their relative order.
+	*/
+	void RequeueGates();
+
+	/**
+		Writes the queues, the input and output gates and the gate counters of this circuit, such that a circuit that
+		was mapped by ABYCircuit::MapBinaryCircuit can be evaluated without being built again.
+		\param out Stream behind the gates written by ABYCircuit::WriteBinaryCircuit
+	*/
+	virtual void WriteState(ofstream& out);
+	/**
+		Reads the state written by WriteState into an empty circuit.
+		\return FALSE if the state does not belong to a circuit with the same sharing and share bit length
+	*/
+	virtual BOOL ReadState(ifstream& in);
+
 	/**
 		It is a getter method which returns the number of levels/layers in the Local queue.
 		\return Number of layers in the Local Queue.
@@ -446,9 +510,12 @@ protected:
 
 	share* EnsureOutputGate(share* in);
 
+	static void WriteQueues(ofstream& out, vector<deque<uint32_t> >& queues);
+	static void ReadQueues(ifstream& in, vector<deque<uint32_t> >& queues);
+
 
 	ABYCircuit* m_cCircuit; /** ABYCircuit Object  */
-	GATE* m_pGates;			/** Gates vector which stores the */
+	GateTable m_pGates;			/** Gates vector which stores the */
 	e_sharing m_eContext;
 	e_role m_eMyRole;
 	uint32_t m_nShareBitLen;
@@ -0,0 +1,309 @@
+/**
+ \file 		circuitfile.cpp
+ \author	michael.zohner@ec-spride.de
+ \copyright	ABY - A Framework for Efficient Mixed-protocol Secure Two-party Computation
+			Copyright (C) 2015 Engineering Cryptographic Protocols Group, TU Darmstadt
+			This program is free software: you can redistribute it and/or modify
+			it under the terms of the GNU Affero General Public License as published
+			by the Free Software Foundation, either version 3 of the License, or
+			(at your option) any later version.
+			This program is distributed in the hope that it will be useful,
+			but WITHOUT ANY WARRANTY; without even the implied warranty of
+			MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+			GNU Affero General Public License for more details.
+			You should have received a copy of the GNU Affero General Public License
+			along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief		Parser and process-wide cache for netlists in the .aby circuit format and in Bristol Fashion.
+ */
+
+#include "circuitfile.h"
+#include <iostream>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+map<string, shared_ptr<CircuitFile> > CircuitFile::m_mCache;
+CLock CircuitFile::m_lCacheLock;
+
+shared_ptr<CircuitFile> CircuitFile::Get(const string& filename, e_circ_file_format format) {
+	shared_ptr<CircuitFile> file;
+	string key = filename + (format == CIRC_FILE_ABY ? ":aby" : ":bristol");
+
+	m_lCacheLock.Lock();
+	map<string, shared_ptr<CircuitFile> >::iterator it = m_mCache.find(key);
+	if (it != m_mCache.end()) {
+		file = it->second;
+	} else {
+		file.reset(new CircuitFile());
+		if (!file->Parse(filename, format)) {
+			file.reset();
+		} else {
+			m_mCache[key] = file;
+		}
+	}
+	m_lCacheLock.Unlock();
+
+	return file;
+}
+
+//the netlists that are still in use by a caller of Get() are freed when it releases them
+void CircuitFile::ClearCache() {
+	m_lCacheLock.Lock();
+	m_mCache.clear();
+	m_lCacheLock.Unlock();
+}
+
+BOOL CircuitFile::GetWire(int64_t id, BOOL define, uint32_t& wire) {
+	uint32_t* idx;
+	if (id >= 0) {
+		if ((uint64_t) id >= m_vWireIdx.size()) {
+			if (!define) {
+				return FALSE;
+			}
+			m_vWireIdx.resize(max((uint64_t) id + 1, (uint64_t) m_vWireIdx.size() * 2), UINT_MAX);
+		}
+		idx = &m_vWireIdx[id];
+	} else {
+		if (!define && m_mNegWireIdx.find(id) == m_mNegWireIdx.end()) {
+			return FALSE;
+		}
+		idx = &m_mNegWireIdx[id];
+	}
+
+	//a wire that is written again gets a new index, such that later gates read the new value
+	if (define) {
+		*idx = m_nWires++;
+	}
+	wire = *idx;
+	return wire != UINT_MAX;
+}
+
+void CircuitFile::ScanLine(const char* pos, const char* eol, vector<int64_t>& nums, string& word) {
+	nums.clear();
+	word.clear();
+	for (const char* p = pos; p < eol;) {
+		BOOL neg = (*p == '-');
+		const char* digits = neg ? p + 1 : p;
+		if (digits < eol && *digits >= '0' && *digits <= '9') {
+			int64_t val = 0;
+			for (p = digits; p < eol && *p >= '0' && *p <= '9'; p++) {
+				val = val * 10 + (*p - '0');
+			}
+			nums.push_back(neg ? -val : val);
+		} else if ((*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z')) {
+			const char* start = p;
+			for (; p < eol && *p != ' ' && *p != '\t' && *p != '\r'; p++)
+				;
+			word.assign(start, p - start);
+		} else {
+			p++;
+		}
+	}
+}
+
+BOOL CircuitFile::Parse(const string& filename, e_circ_file_format format) {
+	struct stat filestat;
+	uint32_t line = 0;
+	BOOL success;
+
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0 || fstat(fd, &filestat) != 0 || filestat.st_size == 0) {
+		if (fd >= 0) {
+			close(fd);
+		}
+		return FALSE;
+	}
+	const char* buf = (const char*) mmap(NULL, filestat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (buf == MAP_FAILED) {
+		return FALSE;
+	}
+
+	if (format == CIRC_FILE_ABY) {
+		success = ParseABY(buf, buf + filestat.st_size, line);
+	} else {
+		success = ParseBristolFashion(buf, buf + filestat.st_size, line);
+	}
+	munmap((void*) buf, filestat.st_size);
+
+	if (!success) {
+		cerr << "Error: Circuit file " << filename << " is malformed in line " << line << endl;
+	}
+#ifdef DEBUG_CIRCUIT_FILE
+	cout << "Parsed " << filename << ": " << m_vGates.size() << " gates, " << m_nWires << " wires, " << m_vInputs.size() <<
+			" inputs, " << m_vOutputs.size() << " outputs" << endl;
+#endif
+
+	//the wire ids of the file are only needed while parsing
+	vector<uint32_t>().swap(m_vWireIdx);
+	m_mNegWireIdx.clear();
+
+	return success;
+}
+
+BOOL CircuitFile::ParseABY(const char* pos, const char* end, uint32_t& line) {
+	vector<int64_t> tokens;
+	string word;
+	circ_file_gate gate;
+	uint32_t nins;
+	BOOL success = TRUE;
+
+	while (pos < end && success) {
+		char type = *pos;
+		const char* eol = (const char*) memchr(pos, '\n', end - pos);
+		if (eol == NULL) {
+			eol = end;
+		}
+		//the numbers behind the gate character, as read by tokenize_verilog
+		ScanLine(pos + 1, eol, tokens, word);
+		pos = eol + 1;
+		line++;
+
+		switch (type) {
+		case 'S': // Server input wires
+		case 'C': // Client input wires
+			for (uint32_t i = 0; i < tokens.size(); i++) {
+				GetWire(tokens[i], TRUE, gate.out);
+				m_vInputs.push_back(gate.out);
+			}
+			break;
+		case 'O': // Output wires
+			for (uint32_t i = 0; i < tokens.size() && success; i++) {
+				success = GetWire(tokens[i], FALSE, gate.out);
+				m_vOutputs.push_back(gate.out);
+			}
+			break;
+		case '0': // Constant zero
+		case '1': // Constant one
+		case 'A': // AND
+		case 'X': // XOR
+		case 'M': // MUX
+		case 'I': // INV
+			nins = (type == '0' || type == '1') ? 0 : (type == 'I') ? 1 : (type == 'M') ? 3 : 2;
+			if (tokens.size() != nins + 1) {
+				success = FALSE;
+				break;
+			}
+			gate.type = type;
+			for (uint32_t i = 0; i < nins && success; i++) {
+				success = GetWire(tokens[i], FALSE, gate.in[i]);
+			}
+			GetWire(tokens[nins], TRUE, gate.out);
+			m_vGates.push_back(gate);
+			break;
+		default: // Comments
+			break;
+		}
+	}
+	return success;
+}
+
+//Header lines "ngates nwires", "niv n_1 ... n_niv" and "nov m_1 ... m_nov", followed by one gate per line in the form
+//"nin nout in_1 ... in_nin out_1 ... out_nout TYPE". The input values are the first wires, the output values the last.
+BOOL CircuitFile::ParseBristolFashion(const char* pos, const char* end, uint32_t& line) {
+	vector<int64_t> tokens;
+	vector<bool> defined;
+	string word;
+	circ_file_gate gate;
+	uint64_t ngates = 0, nin, nout, ninbits = 0, noutbits = 0;
+	uint32_t header = 0;
+
+	while (pos < end) {
+		const char* eol = (const char*) memchr(pos, '\n', end - pos);
+		if (eol == NULL) {
+			eol = end;
+		}
+		ScanLine(pos, eol, tokens, word);
+		pos = eol + 1;
+		line++;
+		if (tokens.size() == 0 && word.empty()) {
+			continue;
+		}
+
+		if (header < 3) {
+			if (!word.empty() || tokens.size() == 0 || (header == 0 && tokens.size() != 2)
+					|| (header > 0 && tokens.size() != (uint64_t) tokens[0] + 1)) {
+				return FALSE;
+			}
+			for (uint32_t i = 0; i < tokens.size(); i++) {
+				if (tokens[i] < 0 || tokens[i] > UINT_MAX) {
+					return FALSE;
+				}
+			}
+			if (header == 0) {
+				ngates = tokens[0];
+				m_nWires = tokens[1];
+				defined.resize(m_nWires, false);
+			} else {
+				vector<uint32_t>& lens = (header == 1) ? m_vInputLens : m_vOutputLens;
+				uint64_t& nbits = (header == 1) ? ninbits : noutbits;
+				for (uint32_t i = 1; i < tokens.size(); i++) {
+					lens.push_back(tokens[i]);
+					nbits += tokens[i];
+				}
+				if (ninbits + noutbits > m_nWires) {
+					return FALSE;
+				}
+			}
+			if (++header == 3) {
+				for (uint32_t i = 0; i < ninbits; i++) {
+					m_vInputs.push_back(i);
+					defined[i] = true;
+				}
+			}
+			continue;
+		}
+
+		if (tokens.size() < 2 || tokens[0] < 0 || tokens[1] < 0 || tokens.size() != 2 + (uint64_t) tokens[0] + tokens[1]) {
+			return FALSE;
+		}
+		nin = tokens[0];
+		nout = tokens[1];
+		//the wires that are read have to be defined before, EQ reads a constant instead of a wire
+		for (uint32_t i = 2; i < tokens.size(); i++) {
+			if (tokens[i] < 0 || tokens[i] >= m_nWires || (i < 2 + nin && word != "EQ" && !defined[tokens[i]])) {
+				return FALSE;
+			}
+		}
+		for (uint32_t i = 2 + nin; i < tokens.size(); i++) {
+			defined[tokens[i]] = true;
+		}
+
+		gate.out = tokens[2 + nin];
+		if ((word == "AND" || word == "XOR") && nin == 2 && nout == 1) {
+			gate.type = (word == "AND") ? 'A' : 'X';
+			gate.in[0] = tokens[2];
+			gate.in[1] = tokens[3];
+		} else if ((word == "INV" || word == "EQW") && nin == 1 && nout == 1) {
+			gate.type = (word == "INV") ? 'I' : 'E';
+			gate.in[0] = tokens[2];
+		} else if (word == "EQ" && nin == 1 && nout == 1 && tokens[2] <= 1) {
+			gate.type = (tokens[2] == 0) ? '0' : '1';
+		} else if (word == "MAND" && nin == 2 * nout && nout > 0) {
+			gate.type = 'N';
+			gate.in[0] = m_vMultiWires.size();
+			gate.in[1] = nout;
+			for (uint32_t i = 2; i < tokens.size(); i++) {
+				m_vMultiWires.push_back(tokens[i]);
+			}
+		} else {
+			return FALSE;
+		}
+		m_vGates.push_back(gate);
+	}
+
+	if (header < 3 || m_vGates.size() != ngates) {
+		return FALSE;
+	}
+	for (uint32_t i = m_nWires - noutbits; i < m_nWires; i++) {
+		if (!defined[i]) {
+			return FALSE;
+		}
+		m_vOutputs.push_back(i);
+	}
+	return TRUE;
+}
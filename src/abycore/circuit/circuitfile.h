@@ -0,0 +1,121 @@
+/**
+ \file 		circuitfile.h
+ \author	michael.zohner@ec-spride.de
+ \copyright	ABY - A Framework for Efficient Mixed-protocol Secure Two-party Computation
+			Copyright (C) 2015 Engineering Cryptographic Protocols Group, TU Darmstadt
+			This program is free software: you can redistribute it and/or modify
+			it under the terms of the GNU Affero General Public License as published
+			by the Free Software Foundation, either version 3 of the License, or
+			(at your option) any later version.
+			This program is distributed in the hope that it will be useful,
+			but WITHOUT ANY WARRANTY; without even the implied warranty of
+			MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+			GNU Affero General Public License for more details.
+			You should have received a copy of the GNU Affero General Public License
+			along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief		Parser and process-wide cache for netlists in the .aby circuit format (see bin/circ/circuitformat.md) and in
+ 			Bristol Fashion.
+ */
+
+#ifndef __CIRCUITFILE_H__
+#define __CIRCUITFILE_H__
+
+#include "../ENCRYPTO_utils/typedefs.h"
+#include "../ENCRYPTO_utils/thread.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+
+using namespace std;
+
+//#define DEBUG_CIRCUIT_FILE
+
+enum e_circ_file_format {
+	CIRC_FILE_ABY,				// .aby format of the floating-point circuits
+	CIRC_FILE_BRISTOL_FASHION	// Bristol Fashion, with multi-bit input and output values and the MAND gate
+};
+
+/**
+ Gate of a parsed netlist. The wires of .aby files are numbered densely from 0 in the order in which they are defined,
+ the wires of Bristol Fashion files keep their ids.
+ */
+typedef struct circ_file_gate_ctx {
+	char type;		// '0', '1', 'A', 'X', 'M', 'I' as in the .aby format, 'E' for a copied wire (EQW), 'N' for MAND
+	uint32_t in[3];	// input wires, M: in[0] if in[2] is 0, in[1] otherwise, N: in[0] is the position of the wires in
+					// GetMultiWires() and in[1] the number k of AND gates, the wires are k left, k right and k output wires
+	uint32_t out;	// output wire
+} circ_file_gate;
+
+/**
+ Netlist of a circuit file, parsed once per process. The gates are stored in file order with wire indices below
+ GetNumWires(), such that instantiating the netlist only replays the gate list with a vector as wire table.
+ */
+class CircuitFile {
+public:
+	/**
+	 Returns the parsed netlist of the file. The file is parsed on the first request and cached for the lifetime of the
+	 process, all later requests for the same file name and format return the cached netlist. Thread-safe.
+	 \return the netlist, or an empty pointer if the file could not be opened or is malformed
+	 */
+	static shared_ptr<CircuitFile> Get(const string& filename, e_circ_file_format format = CIRC_FILE_ABY);
+	/**
+	 Drops all cached netlists, e.g. after circuit files were changed on disk. A netlist that was returned by Get()
+	 before stays valid until its last reference is released.
+	 */
+	static void ClearCache();
+
+	uint32_t GetNumWires() {
+		return m_nWires;
+	}
+	/**
+	 Input wires of the server (S) followed by the input wires of the client (C) for .aby files, the input wires of
+	 all values in order for Bristol Fashion files
+	 */
+	vector<uint32_t>& GetInputs() {
+		return m_vInputs;
+	}
+	vector<uint32_t>& GetOutputs() {
+		return m_vOutputs;
+	}
+	/** Bit lengths of the input and output values of a Bristol Fashion file, empty for .aby files */
+	vector<uint32_t>& GetInputLens() {
+		return m_vInputLens;
+	}
+	vector<uint32_t>& GetOutputLens() {
+		return m_vOutputLens;
+	}
+	vector<circ_file_gate>& GetGates() {
+		return m_vGates;
+	}
+	vector<uint32_t>& GetMultiWires() {
+		return m_vMultiWires;
+	}
+
+private:
+	CircuitFile() : m_nWires(0) {
+	}
+	BOOL Parse(const string& filename, e_circ_file_format format);
+	BOOL ParseABY(const char* pos, const char* end, uint32_t& line);
+	BOOL ParseBristolFashion(const char* pos, const char* end, uint32_t& line);
+	//reads the numbers and the last word of a line
+	static void ScanLine(const char* pos, const char* eol, vector<int64_t>& nums, string& word);
+	//returns the dense index of a wire id of the file, defines a new wire if the id is written
+	BOOL GetWire(int64_t id, BOOL define, uint32_t& wire);
+
+	uint32_t m_nWires;
+	vector<uint32_t> m_vInputs;
+	vector<uint32_t> m_vOutputs;
+	vector<uint32_t> m_vInputLens;
+	vector<uint32_t> m_vOutputLens;
+	vector<circ_file_gate> m_vGates;
+	vector<uint32_t> m_vMultiWires;
+
+	vector<uint32_t> m_vWireIdx;		// dense index of the non-negative wire ids, used during parsing
+	map<int64_t, uint32_t> m_mNegWireIdx;	// dense index of the negative wire ids, i.e., the constants
+
+	static map<string, shared_ptr<CircuitFile> > m_mCache;
+	static CLock m_lCacheLock;
+};
+
+#endif /* __CIRCUITFILE_H__ */
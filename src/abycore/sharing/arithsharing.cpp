@@ -77,8 +77,34 @@ void ArithSharing<T>::PrepareSetupPhase(ABYSetup* setup) {
 
 	InitMTs();
 
-	if (m_nMTs > 0) {
-		if (m_eMTGenAlg == MT_PAILLIER || m_eMTGenAlg == MT_DGK) {
+	m_nNumCONVs = m_cArithCircuit->GetNumCONVGates();
+	if (m_nNumCONVs > 0) {
+		if ((m_eRole) == SERVER) {
+			m_vConversionMasks[0].Create(m_nNumCONVs * m_nTypeBitLen, m_nTypeBitLen);
+			m_vConversionMasks[1].Create(m_nNumCONVs * m_nTypeBitLen, m_nTypeBitLen);
+		} else {
+			m_vConversionMasks[0].Create((int) m_nNumCONVs * m_nTypeBitLen, m_cCrypto); //the choice bits of the receiver
+			m_vConversionMasks[1].Create((int) m_nNumCONVs * m_nTypeBitLen * m_nTypeBitLen); //the resulting masks
+		}
+
+		//Pre-create the buffer
+		m_vConvShareSndBuf.Create(2 * m_nNumCONVs * m_nTypeBitLen, m_nTypeBitLen);
+		m_vConvShareRcvBuf.Create(2 * m_nNumCONVs * m_nTypeBitLen, m_nTypeBitLen);
+		m_vConversionRandomness.Create(m_nNumCONVs * m_nTypeBitLen, m_nTypeBitLen, m_cCrypto);
+	}
+
+	//in the pool mode, the multiplication triples are taken from the triple pool of the party if it holds enough of them
+	m_bPoolMTs = m_nMTs > 0 && GetPreCompPhaseValue() == ePreCompPool && TakePoolMTs(setup);
+
+	//the multiplication triples and conversion masks were precomputed by an earlier execution
+	m_bPreCompRead = (m_nMTs > 0 || m_nNumCONVs > 0) && GetPreCompPhaseValue() == ePreCompRead && ReadPreCompValues(setup);
+	if (m_bPreCompRead) {
+		return;
+	}
+
+	if (m_nMTs > 0 && !m_bPoolMTs) {
+		e_mt_gen_alg mtgenalg = GetMTGenAlg();
+		if (mtgenalg == MT_PAILLIER || mtgenalg == MT_DGK || mtgenalg == MT_OLE) {
 			PKMTGenVals* pgentask = (PKMTGenVals*) malloc(sizeof(PKMTGenVals));
 			pgentask->A = &(m_vA[0]);
 			pgentask->B = &(m_vB[0]);
@@ -111,7 +137,6 @@ void ArithSharing<T>::PrepareSetupPhase(ABYSetup* setup) {
 		}
 	}
 
-	m_nNumCONVs = m_cArithCircuit->GetNumCONVGates();
 	if (m_nNumCONVs > 0) {
 		XORMasking* fXORMaskFct = new XORMasking(m_nTypeBitLen); //TODO to implement the vector multiplication change first argument
 
@@ -123,13 +148,9 @@ void ArithSharing<T>::PrepareSetupPhase(ABYSetup* setup) {
 		task->mskfct = fXORMaskFct;
 		task->delete_mskfct = TRUE;
 		if ((m_eRole) == SERVER) {
-			m_vConversionMasks[0].Create(m_nNumCONVs * m_nTypeBitLen, m_nTypeBitLen);
-			m_vConversionMasks[1].Create(m_nNumCONVs * m_nTypeBitLen, m_nTypeBitLen);
 			task->pval.sndval.X0 = &(m_vConversionMasks[0]);
 			task->pval.sndval.X1 = &(m_vConversionMasks[1]);
 		} else {
-			m_vConversionMasks[0].Create((int) m_nNumCONVs * m_nTypeBitLen, m_cCrypto); //the choice bits of the receiver
-			m_vConversionMasks[1].Create((int) m_nNumCONVs * m_nTypeBitLen * m_nTypeBitLen); //the resulting masks
 			task->pval.rcvval.C = &(m_vConversionMasks[0]);
 			task->pval.rcvval.R = &(m_vConversionMasks[1]);
 		}
@@ -137,11 +158,6 @@ void ArithSharing<T>::PrepareSetupPhase(ABYSetup* setup) {
 		cout << "Conv: Adding a OT task which is supposed to perform " << task->numOTs << " OTs on " << m_nTypeBitLen << " bits for B2A" << endl;
 #endif
 		setup->AddOTTask(task, 0);
-
-		//Pre-create the buffer
-		m_vConvShareSndBuf.Create(2 * m_nNumCONVs * m_nTypeBitLen, m_nTypeBitLen);
-		m_vConvShareRcvBuf.Create(2 * m_nNumCONVs * m_nTypeBitLen, m_nTypeBitLen);
-		m_vConversionRandomness.Create(m_nNumCONVs * m_nTypeBitLen, m_nTypeBitLen, m_cCrypto);
 	}
 }
 
@@ -158,10 +174,13 @@ void ArithSharing<T>::FinishSetupPhase(ABYSetup* setup) {
 		<< ", C: " << (UINT64_T) m_vC[0].template Get<T>(i * m_nTypeBitLen, m_nTypeBitLen) << ", S: " << (UINT64_T) m_vS[0].template Get<T>(i * m_nTypeBitLen, m_nTypeBitLen) << endl;
 	}
 #endif
-	if (m_eMTGenAlg == MT_OT) {
+	if (GetMTGenAlg() == MT_OT && !m_bPreCompRead && !m_bPoolMTs) {
 		//Compute Multiplication Triples
 		ComputeMTsFromOTs();
 	}
+	if (GetPreCompPhaseValue() == ePreCompStore && (m_nMTs > 0 || m_nNumCONVs > 0)) {
+		StorePreCompValues();
+	}
 
 	FinishMTGeneration();
 #ifdef VERIFY_ARITH_MT
@@ -174,6 +193,24 @@ void ArithSharing<T>::FinishSetupPhase(ABYSetup* setup) {
 #endif
 }
 
+template<typename T>
+BOOL ArithSharing<T>::PreCompValues() {
+	return PreCompBuf(m_vA[0]) && PreCompBuf(m_vB[0]) && PreCompBuf(m_vC[0]) && PreCompBuf(m_vConversionMasks[0])
+			&& PreCompBuf(m_vConversionMasks[1]);
+}
+
+template<typename T>
+BOOL ArithSharing<T>::TakePoolMTs(ABYSetup* setup) {
+	BOOL ready = m_pTriplePool != NULL && m_pTriplePool->CanTakeMTs(S_ARITH, m_nTypeBitLen, m_nMTs);
+#ifndef BATCH
+	if (!ready) {
+		cout << "The triple pool holds too few MTs on " << m_nTypeBitLen << " bits, computing the MTs in the setup phase" << endl;
+	}
+#endif
+	//the pools of the parties may differ in size, MTs that only one party takes would no longer match
+	return BothPartiesReady(setup, ready) && m_pTriplePool->TakeMTs(S_ARITH, m_nTypeBitLen, m_nMTs, &(m_vA[0]), &(m_vB[0]), &(m_vC[0]));
+}
+
 template<typename T>
 void ArithSharing<T>::InitMTs() {
 	m_vMTIdx.resize(1, 0);
@@ -280,15 +317,15 @@ void ArithSharing<T>::EvaluateLocalOperations(uint32_t depth) {
 #ifdef DEBUGARITH
 			cout << " which is an ADD gate" << endl;
 #endif
-			EvaluateADDGate(gate);
+			EvaluateADDGate(localops[i]);
 		} else if (gate->type == G_INV) {
 #ifdef DEBUGARITH
 			cout << " which is an INV gate" << endl;
 #endif
-			EvaluateINVGate(gate);
+			EvaluateINVGate(localops[i]);
 		} else if (gate->type == G_CONSTANT) {
 			UGATE_T value = gate->gs.constval;
-			InstantiateGate(gate);
+			InstantiateGate(gate, localops[i]);
 			if (value > 0 && m_eRole == CLIENT)
 				value = 0;
 			for (uint32_t i = 0; i < gate->nvals; i++)
@@ -299,7 +336,7 @@ void ArithSharing<T>::EvaluateLocalOperations(uint32_t depth) {
 			// nothing to do here
 		} else if (gate->type == G_SHARED_OUT) {
 			GATE* parent = m_pGates + gate->ingates.inputs.parent;
-			InstantiateGate(gate);
+			InstantiateGate(gate, localops[i]);
 			memcpy(gate->gs.val, parent->gs.val, gate->nvals * sizeof(T));
 			UsedGate(gate->ingates.inputs.parent);
 		} else if (gate->type == G_PRINT_VAL) {
@@ -324,18 +361,18 @@ void ArithSharing<T>::EvaluateInteractiveOperations(uint32_t depth) {
 #ifdef DEBUGARITH
 			cout << " which is an MUL gate" << endl;
 #endif
-			SelectiveOpen(gate);
+			SelectiveOpen(interactiveops[i]);
 		} else if (gate->type == G_IN) {
 			if (gate->gs.ishare.src == m_eRole) {
 #ifdef DEBUGARITH
 				cout << " which is my input gate" << endl;
 #endif
-				ShareValues(gate);
+				ShareValues(interactiveops[i]);
 			} else {
 #ifdef DEBUGARITH
 				cout << " which is the other parties input gate" << endl;
 #endif
-				m_vInputShareGates.push_back(gate);
+				m_vInputShareGates.push_back(interactiveops[i]);
 				m_nInputShareRcvCtr += gate->nvals;
 			}
 		} else if (gate->type == G_OUT) {
@@ -343,14 +380,14 @@ void ArithSharing<T>::EvaluateInteractiveOperations(uint32_t depth) {
 #ifdef DEBUGARITH
 				cout << " which is my output gate" << endl;
 #endif
-				m_vOutputShareGates.push_back(gate);
+				m_vOutputShareGates.push_back(interactiveops[i]);
 				m_nOutputShareRcvCtr += gate->nvals;
 			} else if (gate->gs.oshare.dst == ALL) {
 #ifdef DEBUGARITH
 				cout << " which is an output gate for both of us" << endl;
 #endif
 				ReconstructValue(gate);
-				m_vOutputShareGates.push_back(gate);
+				m_vOutputShareGates.push_back(interactiveops[i]);
 				m_nOutputShareRcvCtr += gate->nvals;
 			} else {
 #ifdef DEBUGARITH
@@ -362,7 +399,7 @@ void ArithSharing<T>::EvaluateInteractiveOperations(uint32_t depth) {
 #ifdef DEBUGARITH
 			cout << " which is a conversion gate" << endl;
 #endif
-			EvaluateCONVGate(gate);
+			EvaluateCONVGate(interactiveops[i]);
 		} else if (gate->type == G_CALLBACK) {
 			EvaluateCallbackGate(interactiveops[i]);
 		} else {
@@ -372,11 +409,12 @@ void ArithSharing<T>::EvaluateInteractiveOperations(uint32_t depth) {
 }
 
 template<typename T>
-void ArithSharing<T>::EvaluateADDGate(GATE* gate) {
+void ArithSharing<T>::EvaluateADDGate(uint32_t gateid) {
+	GATE* gate = m_pGates + gateid;
 	uint32_t nvals = gate->nvals;
 	uint32_t idleft = gate->ingates.inputs.twin.left;
 	uint32_t idright = gate->ingates.inputs.twin.right;
-	InstantiateGate(gate);
+	InstantiateGate(gate, gateid);
 
 	for (uint32_t i = 0; i < nvals; i++) {
 		((T*) gate->gs.aval)[i] = ((T*) m_pGates[idleft].gs.aval)[i] + ((T*) m_pGates[idright].gs.aval)[i];
@@ -390,7 +428,8 @@ void ArithSharing<T>::EvaluateADDGate(GATE* gate) {
 }
 
 template<typename T>
-void ArithSharing<T>::ShareValues(GATE* gate) {
+void ArithSharing<T>::ShareValues(uint32_t gateid) {
+	GATE* gate = m_pGates + gateid;
 	T* input = (T*) gate->gs.ishare.inval;
 	T tmpval;
 
@@ -399,7 +438,7 @@ void ArithSharing<T>::ShareValues(GATE* gate) {
 	m_vInputShareSndBuf.PrintHex();
 #endif
 
-	InstantiateGate(gate);
+	InstantiateGate(gate, gateid);
 
 	for (uint32_t i = 0; i < gate->nvals; i++, m_nInputShareSndCtr++) {
 		tmpval = m_vInputShareSndBuf.template Get<T>(m_nInputShareSndCtr);
@@ -415,12 +454,13 @@ void ArithSharing<T>::ShareValues(GATE* gate) {
 }
 
 template<typename T>
-void ArithSharing<T>::EvaluateCONVGate(GATE* gate) {
+void ArithSharing<T>::EvaluateCONVGate(uint32_t gateid) {
+	GATE* gate = m_pGates + gateid;
 	uint32_t* parentids = gate->ingates.inputs.parents; //gate->gs.parentgate;
 	uint32_t nparents = gate->ingates.ningates;
 
 #ifdef DEBUGARITH
-	cout << "Values of B2A gates with id " << ((((uint64_t) gate)-((uint64_t)m_pGates))/sizeof(GATE)) << ": ";
+	cout << "Values of B2A gates with id " << gateid << ": ";
 #endif
 	for (uint32_t i = 0; i < nparents; i++) {
 		if (m_pGates[parentids[i]].context == S_YAO)
@@ -435,7 +475,7 @@ void ArithSharing<T>::EvaluateCONVGate(GATE* gate) {
 	cout << "Evaluating conv gate which has " << gate->nvals << " values, current number of conv gates: " << m_vCONVGates.size() << endl;
 #endif
 
-	m_vCONVGates.push_back(gate);
+	m_vCONVGates.push_back(gateid);
 	if (m_eRole == SERVER) {
 		m_nConvShareRcvCtr += gate->nvals;
 	} else {
@@ -471,7 +511,8 @@ void ArithSharing<T>::ReconstructValue(GATE* gate) {
 }
 
 template<typename T>
-void ArithSharing<T>::SelectiveOpen(GATE* gate) {
+void ArithSharing<T>::SelectiveOpen(uint32_t gateid) {
+	GATE* gate = m_pGates + gateid;
 	uint32_t idleft = gate->ingates.inputs.twin.left;
 	uint32_t idright = gate->ingates.inputs.twin.right;
 
@@ -486,7 +527,7 @@ void ArithSharing<T>::SelectiveOpen(GATE* gate) {
 		e = MOD_SUB(y, b, m_nTypeBitMask); //b > y ? m_nTypeBitMask - (b - 1) + y : y - b;
 		m_vE_snd[0].template Set<T>(e, m_vMTIdx[0]);
 	}
-	m_vMULGates.push_back(gate);
+	m_vMULGates.push_back(gateid);
 
 	UsedGate(idleft);
 	UsedGate(idright);
@@ -556,8 +597,8 @@ template<typename T>
 void ArithSharing<T>::EvaluateMULGate() {
 	GATE* gate;
 	for (uint32_t i = 0, idx = m_vMTStartIdx[0]; i < m_vMULGates.size() && idx < m_vMTIdx[0]; i++) {
-		gate = m_vMULGates[i];
-		InstantiateGate(gate);
+		gate = m_pGates + m_vMULGates[i];
+		InstantiateGate(gate, m_vMULGates[i]);
 
 		for (uint32_t j = 0; j < gate->nvals; j++, idx++) {
 			((T*) gate->gs.aval)[j] = m_vResA[0].template Get<T>(idx);
@@ -571,8 +612,8 @@ template<typename T>
 void ArithSharing<T>::AssignInputShares() {
 	GATE* gate;
 	for (uint32_t i = 0, rcvshareidx = 0; i < m_vInputShareGates.size(); i++) {
-		gate = m_vInputShareGates[i];
-		InstantiateGate(gate);
+		gate = m_pGates + m_vInputShareGates[i];
+		InstantiateGate(gate, m_vInputShareGates[i]);
 
 		for (uint32_t j = 0; j < gate->nvals; j++, rcvshareidx++) {
 			((T*) gate->gs.aval)[j] = m_vInputShareRcvBuf.template Get<T>(rcvshareidx);
@@ -587,9 +628,9 @@ template<typename T>
 void ArithSharing<T>::AssignOutputShares() {
 	GATE* gate;
 	for (uint32_t i = 0, rcvshareidx = 0, parentid; i < m_vOutputShareGates.size(); i++) {
-		gate = m_vOutputShareGates[i];
+		gate = m_pGates + m_vOutputShareGates[i];
 		parentid = gate->ingates.inputs.parent;
-		InstantiateGate(gate);
+		InstantiateGate(gate, m_vOutputShareGates[i]);
 
 		for (uint32_t j = 0; j < gate->nvals; j++, rcvshareidx++) {
 			((T*) gate->gs.val)[j] = ((T*) m_pGates[parentid].gs.aval)[j] + m_vOutputShareRcvBuf.template Get<T>(rcvshareidx) & m_nTypeBitMask;
@@ -636,7 +677,7 @@ void ArithSharing<T>::AssignServerConversionShares() {
 	tmpsum = (T*) malloc(sizeof(T) * maxvectorsize);
 
 	for (uint32_t i = 0, lctr = 0, gctr = m_nConvShareIdx * m_nTypeBitLen; i < m_vCONVGates.size(); i++) {
-		gate = m_vCONVGates[i];
+		gate = m_pGates + m_vCONVGates[i];
 		parentids = gate->ingates.inputs.parents;
 		nparents = gate->ingates.ningates;
 		memset(tmpsum, 0, sizeof(T) * maxvectorsize);
@@ -667,7 +708,7 @@ void ArithSharing<T>::AssignServerConversionShares() {
 			}
 			UsedGate(parentids[j]);
 		}
-		InstantiateGate(gate);
+		InstantiateGate(gate, m_vCONVGates[i]);
 #ifdef DEBUGARITH
 		cout << "Result for conversion gate: ";
 #endif
@@ -701,7 +742,7 @@ void ArithSharing<T>::AssignClientConversionShares() {
 	tmpsum = (T*) malloc(sizeof(T) * maxvectorsize);
 	//Take the masks from the pre-computed OTs down from the received string
 	for (uint32_t i = 0, lctr = 0, gctr = m_nConvShareIdx*m_nTypeBitLen; i < m_vCONVGates.size(); i++, m_nConvShareIdx++) {
-		gate = m_vCONVGates[i];
+		gate = m_pGates + m_vCONVGates[i];
 		parentids = gate->ingates.inputs.parents;
 		nparents = gate->ingates.ningates;
 		memset(tmpsum, 0, sizeof(T) * maxvectorsize);
@@ -720,7 +761,7 @@ void ArithSharing<T>::AssignClientConversionShares() {
 			UsedGate(parentids[j]);
 		}
 
-		InstantiateGate(gate);
+		InstantiateGate(gate, m_vCONVGates[i]);
 #ifdef DEBUGARITH
 		cout << "Result for conversion gate: ";
 #endif
@@ -741,9 +782,10 @@ void ArithSharing<T>::AssignClientConversionShares() {
 }
 
 template<typename T>
-void ArithSharing<T>::EvaluateINVGate(GATE* gate) {
+void ArithSharing<T>::EvaluateINVGate(uint32_t gateid) {
+	GATE* gate = m_pGates + gateid;
 	uint32_t parentid = gate->ingates.inputs.parent;
-	InstantiateGate(gate);
+	InstantiateGate(gate, gateid);
 	for (uint32_t i = 0; i < gate->nvals; i++) {
 //			((T*) gate->gs.aval)[i] = MOD_SUB(0, ((T*) m_pGates[parentid].gs.aval)[i], m_nTypeBitMask);//0 - ((T*) m_pGates[parentid].gs.aval)[i];
 		((T*) gate->gs.aval)[i] = -((T*) m_pGates[parentid].gs.aval)[i];
@@ -861,9 +903,9 @@ void ArithSharing<T>::GetBuffersToReceive(vector<BYTE*>& rcvbuf, vector<uint64_t
 }
 
 template<typename T>
-void ArithSharing<T>::InstantiateGate(GATE* gate) {
+void ArithSharing<T>::InstantiateGate(GATE* gate, uint32_t gateid) {
 	gate->instantiated = true;
-	gate->gs.aval = (UGATE_T*) calloc(sizeof(T), gate->nvals);
+	gate->gs.aval = (UGATE_T*) AllocGateValue(gate, gateid, GetGateValueBytes(gate));
 }
 
 template<typename T>
@@ -877,7 +919,7 @@ void ArithSharing<T>::EvaluateSIMDGate(uint32_t gateid) {
 #endif
 		uint32_t* input = gate->ingates.inputs.parents;
 		uint32_t nparents = gate->ingates.ningates;
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 
 		T* valptr = ((T*) gate->gs.aval);
 		for(uint32_t k = 0; k < nparents; k++) {
@@ -893,7 +935,7 @@ void ArithSharing<T>::EvaluateSIMDGate(uint32_t gateid) {
 #endif
 		uint32_t pos = gate->gs.sinput.pos;
 		uint32_t idparent = gate->ingates.inputs.parent;
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 
 		for (uint32_t i = 0; i < vsize; i++) {
 			((T*) gate->gs.aval)[i] = ((T*) m_pGates[idparent].gs.aval)[pos + i];
@@ -906,7 +948,7 @@ void ArithSharing<T>::EvaluateSIMDGate(uint32_t gateid) {
 		cout << " which is a REPEATER gate" << endl;
 #endif
 		uint32_t idparent = gate->ingates.inputs.parent; //gate->gs.rinput;
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 
 		for (uint32_t i = 0; i < vsize; i++) {
 			((T*) gate->gs.aval)[i] = ((T*) m_pGates[idparent].gs.aval)[0];
@@ -919,7 +961,7 @@ void ArithSharing<T>::EvaluateSIMDGate(uint32_t gateid) {
 		uint32_t* perm = gate->ingates.inputs.parents;
 		uint32_t* pos = gate->gs.perm.posids;
 
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 
 		//TODO: there might be a problem here since some bits might not be set to zero
 		//memset(gate->gs.val, 0x00, ceil_divide(vsize, 8));
@@ -937,7 +979,7 @@ void ArithSharing<T>::EvaluateSIMDGate(uint32_t gateid) {
 #endif
 		uint32_t* combinepos = gate->ingates.inputs.parents;
 		uint32_t arraypos = gate->gs.combinepos.pos;
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 		//TODO: there might be a problem here since some bits might not be set to zero
 		//memset(gate->gs.val, 0x00, ceil_divide(vsize, 8));
 		//TODO: Optimize
@@ -955,7 +997,7 @@ void ArithSharing<T>::EvaluateSIMDGate(uint32_t gateid) {
 		uint32_t* positions = gate->gs.sub_pos.posids; //gate->gs.combinepos.input;
 		bool del_pos = gate->gs.sub_pos.copy_posids;
 
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 
 		for (uint32_t i = 0; i < vsize; i++) {
 			gate->gs.aval[i] = ((T*) m_pGates[idparent].gs.aval)[positions[i]];
@@ -1094,7 +1136,8 @@ void ArithSharing<T>::Reset() {
 	m_vInputShareRcvBuf.delCBitVector();
 	m_vOutputShareRcvBuf.delCBitVector();
 
-	m_cArithCircuit->Reset();
+	if (!m_cArithCircuit->IsCompiled())
+		m_cArithCircuit->Reset();
 
 	m_nConvShareIdx = 0;
 	m_nConvShareSndCtr = 0;
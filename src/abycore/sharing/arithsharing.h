@@ -61,7 +61,10 @@ public:
 		return;
 	}
 
-	void InstantiateGate(GATE* gate);
+	void InstantiateGate(GATE* gate, uint32_t gateid);
+	uint64_t GetGateValueBytes(GATE* gate) {
+		return sizeof(T) * gate->nvals;
+	}
 
 	void GetDataToSend(vector<BYTE*>& sendbuf, vector<uint64_t>& bytesize);
 	void GetBuffersToReceive(vector<BYTE*>& rcvbuf, vector<uint64_t>& rcvbytes);
@@ -100,12 +103,19 @@ public:
 	 Evaluating Inversion Gate.
 	 \param 	gate 	Object of the gate to be evaluated.
 	 */
-	void EvaluateINVGate(GATE* gate);
+	void EvaluateINVGate(uint32_t gateid);
 	/**
 	 Evaluating Conversion Gate.
 	 \param 	gate 	Object of the gate to be evaluated.
 	 */
-	void EvaluateCONVGate(GATE* gate);
+	void EvaluateCONVGate(uint32_t gateid);
+	/**
+	 Returns the method that generates the MTs of this execution. MT_OLE falls back to MT_OT if the OLEs need fewer than
+	 SILENT_OT_MIN_OTS random OTs, since a single silent OT expansion yields about 10^7 of them.
+	 */
+	e_mt_gen_alg GetMTGenAlg() {
+		return (m_eMTGenAlg == MT_OLE && (uint64_t) m_nMTs * m_nTypeBitLen < SILENT_OT_MIN_OTS) ? MT_OT : m_eMTGenAlg;
+	}
 
 private:
 
@@ -120,10 +130,10 @@ private:
 
 	vector<uint32_t> m_vMTStartIdx;
 	vector<uint32_t> m_vMTIdx;
-	vector<GATE*> m_vMULGates;
-	vector<GATE*> m_vInputShareGates;
-	vector<GATE*> m_vOutputShareGates;
-	vector<GATE*> m_vCONVGates;
+	vector<uint32_t> m_vMULGates;
+	vector<uint32_t> m_vInputShareGates;
+	vector<uint32_t> m_vOutputShareGates;
+	vector<uint32_t> m_vCONVGates;
 
 	uint32_t m_nInputShareSndCtr;
 	uint32_t m_nOutputShareSndCtr;
@@ -162,7 +172,7 @@ private:
 	 Share Values
 	 \param 	gate 	Object of class Gate
 	 */
-	void ShareValues(GATE* gate);
+	void ShareValues(uint32_t gateid);
 	/**
 	 Reconstruct Values
 	 \param 	gate 	Object of class Gate
@@ -182,7 +192,7 @@ private:
 	 Method for selective open of the given gate.
 	 \param gate 	Gate Object
 	 */
-	void SelectiveOpen(GATE* gate);
+	void SelectiveOpen(uint32_t gateid);
 	/**
 	 Method for Evaluating MTs.
 	 */
@@ -191,7 +201,7 @@ private:
 	 Method for evaluating Add Gate using the gate object.
 	 \param 	gate 	Gate Object.
 	 */
-	void EvaluateADDGate(GATE* gate);
+	void EvaluateADDGate(uint32_t gateid);
 	/**
 	 Method for evaluating Sub Gate using the gate object.
 	 \param 	gate 	Gate Object.
@@ -235,6 +245,15 @@ private:
 	 Method for Finish MT Generation.
 	 */
 	void FinishMTGeneration();
+	/**
+	 Transfers the multiplication triples and conversion masks to or from the precomputation file.
+	 */
+	BOOL PreCompValues();
+	/**
+	 Takes the multiplication triples from the triple pool. Both parties only take them if both pools hold enough of
+	 them, returns FALSE otherwise.
+	 */
+	BOOL TakePoolMTs(ABYSetup* setup);
 	/**
 	 Method for initialising.
 	 */
@@ -32,6 +32,16 @@ void BoolSharing::Init() {
 
 	m_cBoolCircuit = new BooleanCircuit(m_pCircuit, m_eRole, m_eContext);
 
+	//the main thread takes part in the parallel evaluation, hence one thread less is started
+	m_nWorkingThreads = 0;
+	m_nNextWaveTask = 0;
+	m_nWaveWords = 0;
+	m_nWaveMinGateId = 0;
+	for (uint32_t i = 1; i < m_nNumThreads; i++) {
+		m_vWorkerThreads.push_back(new CBoolWorkerThread(this));
+		m_vWorkerThreads.back()->Start();
+	}
+
 #ifdef BENCHBOOLTIME
 	m_nCombTime = 0;
 	m_nSubsetTime = 0;
@@ -79,17 +89,6 @@ void BoolSharing::PrepareSetupPhase(ABYSetup* setup) {
 	m_nNumANDSizes = m_cBoolCircuit->GetANDs(m_vANDs);
 
 
-	/**Checking the role of the executor. Based on the role a specific file is selected.*/
-	//TODO use strings
-	char filename[21];
-	if(m_eRole == SERVER) {
-		strcpy(filename, "pre_comp_server.dump");
-	}
-	else {
-		strcpy(filename, "pre_comp_client.dump");
-	}
-
-
 	m_nTotalNumMTs = 0;
 	m_nNumMTs.resize(m_nNumANDSizes);
 	for (uint32_t i = 0; i < m_nNumANDSizes; i++) {
@@ -105,13 +104,14 @@ void BoolSharing::PrepareSetupPhase(ABYSetup* setup) {
 	InitializeMTs();
 
 	/**
-		Checking if the precomputation mode is READ. If so, checking if the circuit size configured is
-		within the provided specification of the precomputation values stored in the file.
-		If it not within the spec, reverting to default mode.
+		Checking if the precomputation mode is READ. If so, the MTs are taken from the precomputation
+		store if it holds MTs for this circuit, otherwise they are computed as in the default mode.
 	*/
-	if((GetPreCompPhaseValue()==ePreCompRead)&&(!isCircuitSizeLessThanOrEqualWithValueFromFile(filename, m_nNumANDSizes))) {
-			SetPreCompPhaseValue(ePreCompDefault);
-	}
+	m_bPreCompRead = (m_nTotalNumMTs > 0) && (GetPreCompPhaseValue() == ePreCompRead) && ReadPreCompValues(setup);
+	/**
+		In the pool mode, the MTs are taken from the triple pool of the party if it holds enough MTs for all AND sizes.
+	*/
+	m_bPoolMTs = (m_nTotalNumMTs > 0) && (GetPreCompPhaseValue() == ePreCompPool) && TakePoolMTs(setup);
 
 
 
@@ -137,10 +137,10 @@ void BoolSharing::PrepareSetupPhase(ABYSetup* setup) {
 
 void BoolSharing::PrepareSetupPhaseMTs(ABYSetup* setup) {
 	/**
-		   If the precomputation is READ or in Reading phase when in RAM mode, the MTs doesn't need to be
-		   computed again and therefore following check is done.
+		   If the precomputation is READ or in Reading phase when in RAM mode, or the MTs were taken from the
+		   triple pool, the MTs doesn't need to be computed again and therefore following check is done.
 	 */
-	if((GetPreCompPhaseValue() != ePreCompRead)&&(GetPreCompPhaseValue() != ePreCompRAMRead)) {
+	if((!m_bPreCompRead)&&(!m_bPoolMTs)&&(GetPreCompPhaseValue() != ePreCompRAMRead)) {
 
 #ifdef USE_KK_OT_FOR_MT
 		for (uint32_t j = 0; j < 2; j++) {
@@ -167,6 +167,26 @@ void BoolSharing::PrepareSetupPhaseMTs(ABYSetup* setup) {
 #else
 		for (uint32_t i = 0; i < m_nNumANDSizes; i++) {
 #endif
+			if (setup->UseSilentOT(m_nNumMTs[i], m_vANDs[i].bitlen)) {
+				//the random choice bits of the silent OTs replace the random A
+				for (uint32_t j = 0; j < 2; j++) {
+					SilentOTTask* task = (SilentOTTask*) malloc(sizeof(SilentOTTask));
+					task->bitlen = m_vANDs[i].bitlen;
+					task->numOTs = m_nNumMTs[i];
+					if ((m_eRole ^ j) == SERVER) {
+						task->pval.sndval.X0 = &(m_vC[i]);
+						task->pval.sndval.X1 = &(m_vB[i]);
+					} else {
+						task->pval.rcvval.C = &(m_vA[i]);
+						task->pval.rcvval.R = &(m_vS[i]);
+					}
+#ifndef BATCH
+					cout << "Adding new silent OT task for " << task->numOTs << " OTs on " << task->bitlen << " bit-strings" << endl;
+#endif
+					setup->AddSilentOTTask(task, j);
+				}
+				continue;
+			}
 			for (uint32_t j = 0; j < 2; j++) {
 				IKNP_OTTask* task = (IKNP_OTTask*) malloc(sizeof(IKNP_OTTask));
 				task->bitlen = m_vANDs[i].bitlen;
@@ -568,6 +588,10 @@ void BoolSharing::EvaluateLocalOperations(uint32_t depth) {
 #ifdef BENCHBOOLTIME
 	timespec tstart, tend;
 #endif
+	if (m_vWorkerThreads.size() > 0) {
+		EvaluateLocalOperationsParallel(localops);
+		return;
+	}
 	for (uint32_t i = 0; i < localops.size(); i++) {
 		gate = m_pGates + localops[i];
 
@@ -596,8 +620,58 @@ void BoolSharing::EvaluateLocalOperations(uint32_t depth) {
 			EvaluateCONVGate(localops[i]);
 			break;
 		case G_SHARED_OUT:
-			InstantiateGate(gate);
-			memcpy(gate->gs.val, ((GATE*) m_pGates + gate->ingates.inputs.parent)->gs.val, bits_in_bytes(gate->nvals));
+			InstantiateGate(gate, localops[i]);
+			memcpy(gate->gs.val, (m_pGates + gate->ingates.inputs.parent)->gs.val, bits_in_bytes(gate->nvals));
+			UsedGate(gate->ingates.inputs.parent);
+			break;
+		case G_SHARED_IN:
+			break;
+		case G_CALLBACK:
+			EvaluateCallbackGate(localops[i]);
+			break;
+		case G_PRINT_VAL:
+			EvaluatePrintValGate(localops[i], C_BOOLEAN);
+			break;
+		case G_ASSERT:
+			EvaluateAssertGate(localops[i], C_BOOLEAN);
+			break;
+		default:
+			if (IsSIMDGate(gate->type)) {
+				EvaluateSIMDGate(localops[i]);
+			} else {
+				cerr << "Boolsharing: Non-interactive Operation not recognized: " << (uint32_t) gate->type
+						<< "(" << get_gate_type_name(gate->type) << "), stopping execution" << endl;
+				exit(0);
+			}
+			break;
+		}
+	}
+}
+
+void BoolSharing::EvaluateLocalOperationsParallel(deque<uint32_t>& localops) {
+	for (uint32_t i = 0; i < localops.size(); i++) {
+		GATE* gate = m_pGates + localops[i];
+
+		if (IsWaveGate(gate)) {
+			if (DependsOnWave(gate)) {
+				EvaluateWave();
+			}
+			AddToWave(localops[i]);
+			continue;
+		}
+
+		//all other gates are evaluated in the order of the queue by the main thread
+		EvaluateWave();
+		switch (gate->type) {
+		case G_CONSTANT:
+			EvaluateConstantGate(localops[i]);
+			break;
+		case G_CONV:
+			EvaluateCONVGate(localops[i]);
+			break;
+		case G_SHARED_OUT:
+			InstantiateGate(gate, localops[i]);
+			memcpy(gate->gs.val, (m_pGates + gate->ingates.inputs.parent)->gs.val, bits_in_bytes(gate->nvals));
 			UsedGate(gate->ingates.inputs.parent);
 			break;
 		case G_SHARED_IN:
@@ -622,6 +696,229 @@ void BoolSharing::EvaluateLocalOperations(uint32_t depth) {
 			break;
 		}
 	}
+	EvaluateWave();
+}
+
+BOOL BoolSharing::IsWaveGate(GATE* gate) {
+	return gate->type == G_LIN || gate->type == G_INV || gate->type == G_COMBINE || gate->type == G_SPLIT || gate->type == G_SUBSET;
+}
+
+//Gates are numbered in the order of their creation, hence a gate can only depend on a gate of the current wave if one
+//of its inputs has an id that is at least as large as the smallest id in the wave
+BOOL BoolSharing::DependsOnWave(GATE* gate) {
+	if (m_vWaveGates.size() == 0) {
+		return FALSE;
+	}
+	switch (gate->type) {
+	case G_LIN:
+		return gate->ingates.inputs.twin.left >= m_nWaveMinGateId || gate->ingates.inputs.twin.right >= m_nWaveMinGateId;
+	case G_COMBINE:
+		for (uint32_t i = 0; i < gate->ingates.ningates; i++) {
+			if (gate->ingates.inputs.parents[i] >= m_nWaveMinGateId) {
+				return TRUE;
+			}
+		}
+		return FALSE;
+	default:
+		return gate->ingates.inputs.parent >= m_nWaveMinGateId;
+	}
+}
+
+void BoolSharing::AddToWave(uint32_t gateid) {
+	GATE* gate = m_pGates + gateid;
+	wave_gate wgate;
+
+	//the gate specific fields are overwritten when the gate is instantiated
+	wgate.gateid = gateid;
+	wgate.nwords = ceil_divide(gate->nvals, GATE_T_BITS);
+	wgate.pos = 0;
+	wgate.posids = NULL;
+	wgate.free_posids = FALSE;
+	if (gate->type == G_SPLIT) {
+		wgate.pos = gate->gs.sinput.pos;
+	} else if (gate->type == G_SUBSET) {
+		wgate.posids = gate->gs.sub_pos.posids;
+		wgate.free_posids = gate->gs.sub_pos.copy_posids;
+	}
+	InstantiateGate(gate, gateid);
+
+	if (m_vWaveGates.size() == 0 || gateid < m_nWaveMinGateId) {
+		m_nWaveMinGateId = gateid;
+	}
+	m_vWaveGates.push_back(wgate);
+	m_nWaveWords += wgate.nwords;
+}
+
+void BoolSharing::EvaluateWave() {
+	if (m_vWaveGates.size() == 0) {
+		return;
+	}
+
+	//Split the wave into tasks of roughly BOOL_WAVE_TASK_WORDS words. Combiner gates can only be evaluated as a whole.
+	m_vWaveTasks.clear();
+	for (uint32_t i = 0; i < m_vWaveGates.size();) {
+		wave_task task;
+		task.gatestart = i;
+		task.wordstart = 0;
+		task.wordend = m_vWaveGates[i].nwords;
+		if (m_vWaveGates[i].nwords > BOOL_WAVE_TASK_WORDS && m_pGates[m_vWaveGates[i].gateid].type != G_COMBINE) {
+			task.gateend = i + 1;
+			for (uint64_t w = 0; w < m_vWaveGates[i].nwords; w += BOOL_WAVE_TASK_WORDS) {
+				task.wordstart = w;
+				task.wordend = min(w + BOOL_WAVE_TASK_WORDS, m_vWaveGates[i].nwords);
+				m_vWaveTasks.push_back(task);
+			}
+			i++;
+		} else {
+			uint64_t words = 0;
+			for (; i < m_vWaveGates.size() && (words == 0 || words + m_vWaveGates[i].nwords <= BOOL_WAVE_TASK_WORDS); i++) {
+				words += m_vWaveGates[i].nwords;
+			}
+			task.gateend = i;
+			m_vWaveTasks.push_back(task);
+		}
+	}
+
+	m_nNextWaveTask = 0;
+	if (m_nWaveWords >= BOOL_WAVE_PARALLEL_WORDS && m_vWaveTasks.size() > 1) {
+		m_lWaveLock.Lock();
+		m_nWorkingThreads = m_vWorkerThreads.size();
+		m_lWaveLock.Unlock();
+		for (uint32_t i = 0; i < m_vWorkerThreads.size(); i++) {
+			m_vWorkerThreads[i]->PutJob(FALSE);
+		}
+		ProcessWaveTasks();
+		for (;;) {
+			m_lWaveLock.Lock();
+			uint32_t n = m_nWorkingThreads;
+			m_lWaveLock.Unlock();
+			if (!n)
+				break;
+			m_evtWaveDone.Wait();
+		}
+	} else {
+		ProcessWaveTasks();
+	}
+
+	//inputs are released in queue order after all gates of the wave have been computed, since the use counters and
+	//the freeing of the gates are not thread-safe
+	for (uint32_t i = 0; i < m_vWaveGates.size(); i++) {
+		ReleaseWaveGate(&(m_vWaveGates[i]));
+	}
+	m_vWaveGates.clear();
+	m_nWaveWords = 0;
+}
+
+void BoolSharing::ProcessWaveTasks() {
+	for (;;) {
+		m_lWaveLock.Lock();
+		uint32_t t = m_nNextWaveTask++;
+		m_lWaveLock.Unlock();
+		if (t >= m_vWaveTasks.size()) {
+			return;
+		}
+		wave_task* task = &(m_vWaveTasks[t]);
+		if (task->gateend - task->gatestart == 1) {
+			EvaluateWaveGate(&(m_vWaveGates[task->gatestart]), task->wordstart, task->wordend);
+		} else {
+			for (uint32_t i = task->gatestart; i < task->gateend; i++) {
+				EvaluateWaveGate(&(m_vWaveGates[i]), 0, m_vWaveGates[i].nwords);
+			}
+		}
+	}
+}
+
+void BoolSharing::EvaluateWaveGate(wave_gate* wgate, uint64_t wordstart, uint64_t wordend) {
+	GATE* gate = m_pGates + wgate->gateid;
+	uint32_t nvals = gate->nvals;
+	UGATE_T* val = gate->gs.val;
+
+	if (gate->type == G_LIN) {
+		UGATE_T* left = m_pGates[gate->ingates.inputs.twin.left].gs.val;
+		UGATE_T* right = m_pGates[gate->ingates.inputs.twin.right].gs.val;
+		for (uint64_t i = wordstart; i < wordend; i++) {
+			val[i] = left[i] ^ right[i];
+		}
+	} else if (gate->type == G_INV) {
+		UGATE_T* parent = m_pGates[gate->ingates.inputs.parent].gs.val;
+		UGATE_T tmpval = (m_eRole == SERVER) ? ~((UGATE_T) 0) : 0;
+		for (uint64_t i = wordstart; i < wordend; i++) {
+			if (i < nvals / GATE_T_BITS) {
+				val[i] = parent[i] ^ tmpval;
+			} else {
+				//set only the remaining nvals%GATE_T_BITS
+				val[i] = (parent[i] ^ tmpval) & ((((UGATE_T) 1) << (nvals % GATE_T_BITS)) - 1);
+			}
+		}
+	} else if (gate->type == G_SPLIT) {
+		UGATE_T* parent = m_pGates[gate->ingates.inputs.parent].gs.val;
+		uint32_t pos = wgate->pos;
+		uint64_t end = min((uint64_t) nvals, wordend * GATE_T_BITS);
+		for (uint64_t i = wordstart * GATE_T_BITS; i < end; i++) {
+			val[i / GATE_T_BITS] |= ((parent[(pos + i) / GATE_T_BITS] >> ((pos + i) % GATE_T_BITS)) & 0x1) << (i % GATE_T_BITS);
+		}
+	} else if (gate->type == G_SUBSET) {
+		UGATE_T* parent = m_pGates[gate->ingates.inputs.parent].gs.val;
+		uint32_t* positions = wgate->posids;
+		uint64_t end = min((uint64_t) nvals, wordend * GATE_T_BITS);
+		for (uint64_t i = wordstart * GATE_T_BITS; i < end; i++) {
+			val[i >> 6] |= (((parent[positions[i] >> 6] >> (positions[i] & 0x3F)) & 0x1) << (i & 0x3F));
+		}
+	} else if (gate->type == G_COMBINE) {
+		uint32_t* input = gate->ingates.inputs.parents;
+		CBitVector tmp;
+		tmp.AttachBuf((uint8_t*) val, (int) ceil_divide(nvals, 8));
+		for (uint64_t i = 0, bit_ctr = 0; i < gate->ingates.ningates; i++) {
+			uint64_t in_size = m_pGates[input[i]].nvals;
+			tmp.SetBits((uint8_t*) m_pGates[input[i]].gs.val, bit_ctr, in_size);
+			bit_ctr += in_size;
+		}
+		tmp.DetachBuf();
+	}
+}
+
+void BoolSharing::ReleaseWaveGate(wave_gate* wgate) {
+	GATE* gate = m_pGates + wgate->gateid;
+
+	if (gate->type == G_LIN) {
+		UsedGate(gate->ingates.inputs.twin.left);
+		UsedGate(gate->ingates.inputs.twin.right);
+	} else if (gate->type == G_COMBINE) {
+		for (uint32_t i = 0; i < gate->ingates.ningates; i++) {
+			UsedGate(gate->ingates.inputs.parents[i]);
+		}
+		free(gate->ingates.inputs.parents);
+	} else {
+		UsedGate(gate->ingates.inputs.parent);
+		if (wgate->free_posids) {
+			free(wgate->posids);
+		}
+	}
+}
+
+void BoolSharing::StopWorkerThreads() {
+	for (uint32_t i = 0; i < m_vWorkerThreads.size(); i++) {
+		m_vWorkerThreads[i]->PutJob(TRUE);
+		m_vWorkerThreads[i]->Wait();
+		delete m_vWorkerThreads[i];
+	}
+	m_vWorkerThreads.clear();
+}
+
+void BoolSharing::CBoolWorkerThread::ThreadMain() {
+	for (;;) {
+		m_evt.Wait();
+		if (m_bStop) {
+			return;
+		}
+		m_pCallback->ProcessWaveTasks();
+
+		m_pCallback->m_lWaveLock.Lock();
+		uint32_t n = --(m_pCallback->m_nWorkingThreads);
+		m_pCallback->m_lWaveLock.Unlock();
+		if (!n)
+			m_pCallback->m_evtWaveDone.Set();
+	}
 }
 
 void BoolSharing::EvaluateInteractiveOperations(uint32_t depth) {
@@ -679,7 +976,7 @@ inline void BoolSharing::EvaluateXORGate(uint32_t gateid) {
 	uint32_t nvals = gate->nvals;
 	uint32_t idleft = gate->ingates.inputs.twin.left;
 	uint32_t idright = gate->ingates.inputs.twin.right;
-	InstantiateGate(gate);
+	InstantiateGate(gate, gateid);
 
 	for (uint32_t i = 0; i < ceil_divide(nvals, GATE_T_BITS); i++) {
 		gate->gs.val[i] = m_pGates[idleft].gs.val[i] ^ m_pGates[idright].gs.val[i];
@@ -692,7 +989,7 @@ inline void BoolSharing::EvaluateXORGate(uint32_t gateid) {
 inline void BoolSharing::EvaluateConstantGate(uint32_t gateid) {
 	GATE* gate = m_pGates + gateid;
 	UGATE_T value = gate->gs.constval;
-	InstantiateGate(gate);
+	InstantiateGate(gate, gateid);
 	value = value * (m_eRole != CLIENT);
 
 	for (uint32_t i = 0; i < ceil_divide(gate->nvals, GATE_T_BITS); i++) {
@@ -711,7 +1008,7 @@ inline void BoolSharing::EvaluateConstantGate(uint32_t gateid) {
 inline void BoolSharing::ShareValues(uint32_t gateid) {
 	GATE* gate = m_pGates + gateid;
 	UGATE_T* input = gate->gs.ishare.inval;
-	InstantiateGate(gate);
+	InstantiateGate(gate, gateid);
 
 	for (uint32_t i = 0, bitstocopy = gate->nvals, len; i < ceil_divide(gate->nvals, GATE_T_BITS); i++, bitstocopy -= GATE_T_BITS) {
 		len = min(bitstocopy, (uint32_t) GATE_T_BITS);
@@ -729,7 +1026,7 @@ inline void BoolSharing::EvaluateINVGate(uint32_t gateid) {
 	GATE* gate = m_pGates + gateid;
 	uint32_t parentid = gate->ingates.inputs.parent;
 	uint32_t i;
-	InstantiateGate(gate);
+	InstantiateGate(gate, gateid);
 	UGATE_T tmpval;
 	if (m_eRole == SERVER) {
 		memset(&tmpval, 0xFF, sizeof(UGATE_T));
@@ -756,7 +1053,7 @@ inline void BoolSharing::EvaluateCONVGate(uint32_t gateid) {
 	if (m_pGates[parentid].context == S_ARITH)
 		cerr << "can't convert from arithmetic representation directly into Boolean" << endl;
 	assert(m_pGates[parentid].context == S_YAO);
-	InstantiateGate(gate);
+	InstantiateGate(gate, gateid);
 
 	memset(gate->gs.val, 0, ceil_divide(gate->nvals, 8));
 	if (m_eRole == SERVER) {
@@ -1054,7 +1351,7 @@ void BoolSharing::EvaluateANDGate() {
 	for (uint32_t k = 0; k < m_nNumANDSizes; k++) {
 		for (uint32_t i = 0, j, bitstocopy, len, idx = m_vMTStartIdx[k]*m_vANDs[k].bitlen; i < m_vANDGates[k].size(); i++) {
 			gate = m_pGates + m_vANDGates[k][i];
-			InstantiateGate(gate);
+			InstantiateGate(gate, m_vANDGates[k][i]);
 
 			bitstocopy = gate->nvals;
 
@@ -1113,7 +1410,7 @@ void BoolSharing::EvaluateOPLUTGates() {
 			nvals = m_pGates[inputs[0]].nvals;
 			outbits = (uint64_t) gate->nvals / nvals;
 
-			InstantiateGate(gate);
+			InstantiateGate(gate, it->second[i]);
 
 			for(uint32_t n = 0; n < nvals; n++) {
 				tableid = m_vOP_LUT_RecSelOpeningBuf[op_lut_id]->Get<uint64_t>(gatectr, nparents);
@@ -1143,7 +1440,7 @@ void BoolSharing::AssignInputShares() {
 	GATE* gate;
 	for (uint32_t i = 0, j, rcvshareidx = 0, bitstocopy, len; i < m_vInputShareGates.size(); i++) {
 		gate = m_pGates + m_vInputShareGates[i];
-		InstantiateGate(gate);
+		InstantiateGate(gate, m_vInputShareGates[i]);
 
 		bitstocopy = gate->nvals;
 		for (j = 0; j < ceil_divide(gate->nvals, GATE_T_BITS); j++, bitstocopy -= GATE_T_BITS) {
@@ -1162,7 +1459,7 @@ void BoolSharing::AssignOutputShares() {
 	for (uint32_t i = 0, j, rcvshareidx = 0, bitstocopy, len, parentid; i < m_vOutputShareGates.size(); i++) {
 		gate = m_pGates + m_vOutputShareGates[i];
 		parentid = gate->ingates.inputs.parent;
-		InstantiateGate(gate);
+		InstantiateGate(gate, m_vOutputShareGates[i]);
 
 		bitstocopy = gate->nvals;
 		for (j = 0; j < ceil_divide(gate->nvals, GATE_T_BITS); j++, bitstocopy -= GATE_T_BITS) {
@@ -1266,8 +1563,8 @@ void BoolSharing::GetBuffersToReceive(vector<BYTE*>& rcvbuf, vector<uint64_t>& r
 	}
 }
 
-inline void BoolSharing::InstantiateGate(GATE* gate) {
-	gate->gs.val = (UGATE_T*) calloc((ceil_divide(gate->nvals, GATE_T_BITS)), sizeof(UGATE_T));
+inline void BoolSharing::InstantiateGate(GATE* gate, uint32_t gateid) {
+	gate->gs.val = (UGATE_T*) AllocGateValue(gate, gateid, GetGateValueBytes(gate));
 	gate->instantiated = true;
 }
 
@@ -1287,7 +1584,7 @@ void BoolSharing::EvaluateSIMDGate(uint32_t gateid) {
 
 		uint32_t* input = gate->ingates.inputs.parents;
 		uint32_t nparents = gate->ingates.ningates;
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 		CBitVector tmp;
 
 		tmp.AttachBuf((uint8_t*) gate->gs.val, (int) ceil_divide(vsize, 8));
@@ -1329,7 +1626,7 @@ void BoolSharing::EvaluateSIMDGate(uint32_t gateid) {
 #endif
 		uint32_t pos = gate->gs.sinput.pos;
 		uint32_t idparent = gate->ingates.inputs.parent;
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 		//TODO optimize
 		for (uint32_t i = 0; i < vsize; i++) {
 			gate->gs.val[i / GATE_T_BITS] |= ((m_pGates[idparent].gs.val[(pos + i) / GATE_T_BITS] >> ((pos + i) % GATE_T_BITS)) & 0x1) << (i % GATE_T_BITS);
@@ -1341,7 +1638,7 @@ void BoolSharing::EvaluateSIMDGate(uint32_t gateid) {
 		cout << " which is a REPEATER gate" << endl;
 #endif
 		uint32_t idparent = gate->ingates.inputs.parent;
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 
 		BYTE byte_val = m_pGates[idparent].gs.val[0] ? MAX_BYTE : ZERO_BYTE;
 		memset(gate->gs.val, byte_val, sizeof(UGATE_T) * ceil_divide(vsize, GATE_T_BITS));
@@ -1354,7 +1651,7 @@ void BoolSharing::EvaluateSIMDGate(uint32_t gateid) {
 		uint32_t* inputs = gate->ingates.inputs.parents;
 		uint32_t* posids = gate->gs.perm.posids;
 
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 
 		//TODO: there might be a problem here since some bits might not be set to zero
 		memset(gate->gs.val, 0x00, ceil_divide(vsize, 8));
@@ -1373,7 +1670,7 @@ void BoolSharing::EvaluateSIMDGate(uint32_t gateid) {
 		uint32_t* combinepos = gate->ingates.inputs.parents; //gate->gs.combinepos.input;
 		uint32_t arraypos = gate->gs.combinepos.pos / GATE_T_BITS;
 		uint32_t bitpos = gate->gs.combinepos.pos % GATE_T_BITS;
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 		//TODO: there might be a problem here since some bits might not be set to zero
 		memset(gate->gs.val, 0x00, ceil_divide(vsize, 8));
 		//TODO: Optimize
@@ -1392,7 +1689,7 @@ void BoolSharing::EvaluateSIMDGate(uint32_t gateid) {
 		bool del_pos = gate->gs.sub_pos.copy_posids;
 		uint32_t arraypos;
 		uint32_t bitpos;
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 		memset(gate->gs.val, 0x00, ceil_divide(vsize, 8));
 		UGATE_T* valptr = m_pGates[idparent].gs.val;
 		for (uint32_t i = 0; i < vsize; i++) {
@@ -1417,7 +1714,7 @@ void BoolSharing::EvaluateSIMDGate(uint32_t gateid) {
 		uint32_t pos_incr = gate->gs.struct_comb.pos_incr;
 		uint32_t ninputs = gate->gs.struct_comb.num_in_gates;
 
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 
 		//TODO: there might be a problem here since some bits might not be set to zero
 		memset(gate->gs.val, 0x00, ceil_divide(vsize, 8));
@@ -1573,7 +1870,8 @@ void BoolSharing::Reset() {
 	m_vInputShareRcvBuf.delCBitVector();
 	m_vOutputShareRcvBuf.delCBitVector();
 
-	m_cBoolCircuit->Reset();
+	if (!m_cBoolCircuit->IsCompiled())
+		m_cBoolCircuit->Reset();
 
 	//Reset the OP-LUT data structures
 	if(!m_vOP_LUT_data.empty()) {
@@ -1598,23 +1896,6 @@ void BoolSharing::Reset() {
 	if(!m_vOP_LUT_SelOpeningBitCtr.empty()) {
 		m_vOP_LUT_SelOpeningBitCtr.clear();
 	}
-
-	/**Checking the role and and deciding upon the file to be deleted if the precomputation values are
-	  completely used up in a Precomputation READ mode.*/
-	if(m_eRole == SERVER) {
-		if((FileExists((char*)"pre_comp_server.dump"))&&(m_nFilePos >=
-                        FileSize((char*)"pre_comp_server.dump"))&&(GetPreCompPhaseValue() == ePreCompRead)) {
-			remove((char*)"pre_comp_server.dump");
-			m_nFilePos = -1;
-		}
-	}
-	else  {
-		if((FileExists((char*)"pre_comp_client.dump"))&&(m_nFilePos >=
-                        FileSize((char*)"pre_comp_client.dump"))&&(GetPreCompPhaseValue() == ePreCompRead)) {
-			remove((char*)"pre_comp_client.dump");
-			m_nFilePos = -1;
-		}
-	}
 }
 
 /**Pre-computations*/
@@ -1623,26 +1904,24 @@ void BoolSharing::PreComputationPhase() {
 	/**Obtaining the precomputation mode value*/
 	ePreCompPhase phase_value = GetPreCompPhaseValue();
 
-	/**Decision of the precomputation file based on the role of executor.*/
-	char filename[50];
-	if(m_eRole == SERVER) {
-		strcpy(filename, "pre_comp_server.dump");
-	}
-	else {
-		strcpy(filename, "pre_comp_client.dump");
-	}
-
 	/**Check if the precomputation mode is in RAM Reading phase*/
 	if(phase_value == ePreCompRAMRead) {
 		return;
 	}
-	/**Check if the execution is non-Read mode or if the file to be used in READ mode doesn't exist*/
-	else if((phase_value != ePreCompRead)||(!FileExists(filename))) {
+	/**Check if the MTs were read from the precomputation store or taken from the triple pool in the PrepareSetupPhase.*/
+	else if(m_bPreCompRead || m_bPoolMTs) {
+		/**Pre-store the values in A and B in D_snd and E_snd, as ComputeMTs does.*/
+		for (uint32_t i = 0; i < m_nNumANDSizes; i++) {
+			m_vD_snd[i].Copy(m_vA[i].GetArr(), 0, ceil_divide(m_nNumMTs[i], 8));
+			m_vE_snd[i].Copy(m_vB[i].GetArr(), 0, ceil_divide(m_nNumMTs[i] * m_vANDs[i].bitlen, 8));
+		}
+	}
+	else {
 		/**Compute the MTs normally*/
 		ComputeMTs();
-		/**Check if the mode of precomputation is store. If so store it to respective file.*/
-		if(phase_value == ePreCompStore) {
-			StoreMTsToFile(filename);
+		/**Check if the mode of precomputation is store. If so store it to the precomputation store.*/
+		if(phase_value == ePreCompStore && m_nTotalNumMTs > 0) {
+			StorePreCompValues();
 		}
 		/**
 			Check if precompution mode is in RAM writing phase. If so, change it to RAM reading phase
@@ -1652,163 +1931,34 @@ void BoolSharing::PreComputationPhase() {
 			SetPreCompPhaseValue(ePreCompRAMRead);
 		}
 	}
-	/**This condition is activated once READ mode is persistent and execution of the mode is possible.*/
-	else {
-		ReadMTsFromFile(filename);
-	}
 }
 
-void BoolSharing::StoreMTsToFile(char *filename) {
-
-
-	FILE *fp;
-
-	/**
-		Condition to check if the file already exists. If so then, the mode of write would
-		be file append.
-	*/
-	if(FileExists(filename)) {
-		fp = fopen(filename, "a+b");
-	}
-	else {
-		fp = fopen(filename, "wb");
-	}
-
-	/**Initially writing the NUMANDSizes corresponding to the number of AND gate Vectors.*/
-	fwrite(&m_nNumANDSizes, sizeof(uint32_t), 1, fp);
-
-	/**Writing the MTs and bytelen of the MTs o the file.*/
-	for (uint32_t i = 0; i < m_nNumANDSizes; i++) {
-		uint32_t andbytelen = ceil_divide(m_nNumMTs[i], 8);
-		uint32_t stringbytelen = ceil_divide(m_nNumMTs[i] * m_vANDs[i].bitlen, 8);
-		fwrite(&andbytelen, sizeof(uint32_t), 1, fp);
-		fwrite(m_vA[i].GetArr(), andbytelen, 1, fp);
-		fwrite(m_vB[i].GetArr(), andbytelen, 1, fp);
-		fwrite(m_vC[i].GetArr(), andbytelen, 1, fp);
-
-	}
-	/**Closing the file pointer.*/
-	fclose(fp);
-}
-
-void BoolSharing::ReadMTsFromFile(char *filename) {
-
-	FILE *fp;
-	/**Calculate the file size*/
-	uint64_t file_size = FileSize(filename);
-
-	/**Variable for the storing the NUMANDSizes value from the file.*/
-	uint32_t num_and_sizes;
-
-	/**Opening the file in read mode.*/
-	fp = fopen(filename, "rb");
-	/**BYTE pointer used as a buffer to read from the file.*/
-	BYTE *ptr;
-	/**Seek the file pointer to the location of the last read position.*/
-	if(fseek(fp, m_nFilePos, SEEK_SET))
-            cout << "Error occured in fseek" << endl;
-	/**Reading the num and sizes from the file.*/
-	if(!fread(&num_and_sizes, sizeof(uint32_t), 1, fp))
-            cout << "Error occured in fread" << endl;;
-	for (uint32_t i = 0; i < m_nNumANDSizes; i++) {
-
-		/**Calculating the required ANDGatelength in bytes for the provided circuit configuration.*/
-		uint32_t andbytelen = ceil_divide(m_nNumMTs[i], 8);
-		uint32_t org_andbytelen;
-		uint32_t stringbytelen = ceil_divide(m_nNumMTs[i] * m_vANDs[i].bitlen, 8);
-
-		/**Reading the ANDGate length in bytes from file.*/
-		if(!fread(&org_andbytelen, sizeof(uint32_t), 1, fp))
-                    cout << "Error occured in fread" << endl;
-
-		/**Allocating the memory for the BYTE pointer with the read ANDGate lenght size from the file.*/
-		ptr = (BYTE*)malloc(org_andbytelen*sizeof(BYTE));
-
-		/**
-			If unequal means the bytes should be read from the file with original byte size else if
-			the configured size.
-		*/
-		if(org_andbytelen != andbytelen) {
-
-			if(!fread(ptr, org_andbytelen, 1, fp))
-                            cout << "Error occured in fread" << endl;
-			m_vA[i].Copy(ptr, 0, andbytelen);
-			if(!fread(ptr, org_andbytelen, 1, fp))
-                            cout << "Error occured in fread" << endl;
-			m_vB[i].Copy(ptr, 0, andbytelen);
-			if(!fread(ptr, org_andbytelen, 1, fp))
-                                cout << "Error occured in fread" << endl;
-			m_vC[i].Copy(ptr, 0, andbytelen);
-		}
-		else {
-			if(!fread(ptr, andbytelen, 1, fp))
-                            cout << "Error occured in fread" << endl;
-			m_vA[i].Copy(ptr, 0, andbytelen);
-			if(!fread(ptr, andbytelen, 1, fp))
-                                cout << "Error occured in fread" << endl;
-			m_vB[i].Copy(ptr, 0, andbytelen);
-			if(!fread(ptr, andbytelen, 1, fp))
-                            cout << "Error occured in fread" << endl;
-			m_vC[i].Copy(ptr, 0, andbytelen);
+BOOL BoolSharing::TakePoolMTs(ABYSetup* setup) {
+	BOOL ready = m_pTriplePool != NULL;
+	for (uint32_t i = 0; i < m_nNumANDSizes && ready; i++) {
+		ready = m_nNumMTs[i] == 0 || m_pTriplePool->CanTakeMTs(S_BOOL, m_vANDs[i].bitlen, m_nNumMTs[i]);
+#ifndef BATCH
+		if (!ready) {
+			cout << "The triple pool holds too few MTs on " << m_vANDs[i].bitlen << " bits, computing the MTs in the setup phase" << endl;
 		}
-		m_vD_snd[i].Copy(m_vA[i].GetArr(), 0, andbytelen);
-		m_vE_snd[i].Copy(m_vB[i].GetArr(), 0, stringbytelen);
-
-	}
-
-	/**Storing the current file pointer position for next iteration use of the circuit setup.*/
-	m_nFilePos = ftell(fp);
-	/**Closing the file.*/
-	fclose(fp);
-}
-
-BOOL BoolSharing::isCircuitSizeLessThanOrEqualWithValueFromFile(char *filename, uint32_t in_circ_size) {
-
-	/**Check if the file already exists and if the existing is empty. If so, return false.*/
-	if(!FileExists(filename)||FileEmpty(filename)) {
-		/**Returning false and reverting the precomputation mode to default.*/
-		return FALSE;
+#endif
 	}
-
-	/**Opening the precomputation file in read mode.*/
-	FILE *fp = fopen(filename, "rb");
-
-	uint32_t circ_size_in_file, andbytelen_in_file;
-
-	/**Reading the circuit size mainly the NUMAndGate vector size*/
-	if(!fread(&circ_size_in_file, sizeof(uint32_t), 1, fp))
-            cout << "Error occured in fread" << endl;
-	/**Checking if they are unequal.*/
-	if(circ_size_in_file != in_circ_size) {
-		/**Returning false and reverting the precomputation mode to default.*/
+	//the pools of the parties may differ in size, MTs that only one party takes would no longer match
+	if (!BothPartiesReady(setup, ready)) {
 		return FALSE;
 	}
-	/**
-	 Checking the byte length of the MTs in the file with the required size.
-	 If it is value in the file is less than the required then, the precomputation
-	 mode is reverted to defaut.
-	*/
-	for (uint32_t i = 0; i < circ_size_in_file; i++) {
-		/**Calculating the AND gate length in bytes for the provided circuit configuration.*/
-		uint32_t andbytelen = ceil_divide(m_nNumMTs[i], 8);
-		/**Reading the AND gate length in bytes from the file.*/
-		if(!fread(&andbytelen_in_file, sizeof(uint32_t), 1, fp))
-                    cout << "Error occured in fread" << endl;
-		uint32_t traverseMT_size_in_file = andbytelen_in_file*3;
-
-		/**Shifting through the MTs based on the ANDGate size in byte length.*/
-		fseek(fp, (ftell(fp) + traverseMT_size_in_file), SEEK_SET);
-
-		/**Checking if the condition of size of byte length in file is lower than byte length required.*/
-		if(andbytelen > andbytelen_in_file) {
-
-			/**Close the file*/
-			fclose(fp);
-			/**Returning false and reverting the precomputation mode to default.*/
+	for (uint32_t i = 0; i < m_nNumANDSizes; i++) {
+		if (m_nNumMTs[i] > 0 && !m_pTriplePool->TakeMTs(S_BOOL, m_vANDs[i].bitlen, m_nNumMTs[i], &(m_vA[i]), &(m_vB[i]), &(m_vC[i]))) {
 			return FALSE;
 		}
 	}
-	/**Close the file*/
-	fclose(fp);
 	return TRUE;
 }
+
+BOOL BoolSharing::PreCompValues() {
+	BOOL success = TRUE;
+	for (uint32_t i = 0; i < m_nNumANDSizes && success; i++) {
+		success = PreCompBuf(m_vA[i]) && PreCompBuf(m_vB[i]) && PreCompBuf(m_vC[i]);
+	}
+	return success;
+}
@@ -26,6 +26,11 @@
 
 //#define DEBUGBOOL
 //#define BENCHBOOLTIME
+
+//number of UGATE_T words that are evaluated in one task of the parallel local evaluation
+#define BOOL_WAVE_TASK_WORDS 2048
+//minimum number of UGATE_T words in a wave for the worker threads to be woken up
+#define BOOL_WAVE_PARALLEL_WORDS 8192
 /**
  BOOL SHARING - <DETAILED EXPLANATION PLEASE>
  */
@@ -46,9 +51,10 @@ class BoolSharing: public Sharing {
 
 public:
 	/** Constructor of the class.*/
-	BoolSharing(e_sharing context, e_role role, uint32_t sharebitlen, ABYCircuit* circuit, crypto* crypt) :\
+	BoolSharing(e_sharing context, e_role role, uint32_t sharebitlen, ABYCircuit* circuit, crypto* crypt, uint32_t nthreads = 1) :\
 
 			Sharing(context, role, sharebitlen, circuit, crypt) {
+		m_nNumThreads = nthreads;
 		Init();
 	}
 	;
@@ -56,6 +62,7 @@ public:
 	~BoolSharing() {
 		Reset();
 		delete m_cBoolCircuit;
+		StopWorkerThreads();
 	}
 	;
 
@@ -72,7 +79,10 @@ public:
 
 	void PreComputationPhase();
 
-	inline void InstantiateGate(GATE* gate);
+	inline void InstantiateGate(GATE* gate, uint32_t gateid);
+	uint64_t GetGateValueBytes(GATE* gate) {
+		return ceil_divide(gate->nvals, GATE_T_BITS) * sizeof(UGATE_T);
+	}
 
 	void GetDataToSend(vector<BYTE*>& sendbuf, vector<uint64_t>& bytesize);
 	void GetBuffersToReceive(vector<BYTE*>& rcvbuf, vector<uint64_t>& rcvbytes);
@@ -168,6 +178,52 @@ private:
 
 	BooleanCircuit* m_cBoolCircuit;
 
+	/* Parallel evaluation of the local gates of a layer. Consecutive gates of the local queue that do not depend on
+	 * each other are collected in a wave. The wave is split into tasks of either several small gates or a word range of
+	 * one large gate, which the worker threads and the main thread take from a common task list until it is empty. */
+	typedef struct local_wave_gate {
+		uint32_t gateid;
+		uint64_t nwords;
+		uint32_t pos; //split position of a G_SPLIT gate
+		uint32_t* posids; //positions of a G_SUBSET gate
+		BOOL free_posids;
+	} wave_gate;
+
+	typedef struct local_wave_task {
+		uint32_t gatestart;
+		uint32_t gateend;
+		uint64_t wordstart; //word range, only used if the task covers a single gate
+		uint64_t wordend;
+	} wave_task;
+
+	class CBoolWorkerThread: public CThread {
+	public:
+		CBoolWorkerThread(BoolSharing* callback) :
+				m_pCallback(callback) {
+			m_bStop = FALSE;
+		}
+		;
+		void PutJob(BOOL stop) {
+			m_bStop = stop;
+			m_evt.Set();
+		}
+		void ThreadMain();
+		BoolSharing* m_pCallback;
+		CEvent m_evt;
+		BOOL m_bStop;
+	};
+
+	uint32_t m_nNumThreads;
+	vector<CBoolWorkerThread*> m_vWorkerThreads;
+	vector<wave_gate> m_vWaveGates;
+	vector<wave_task> m_vWaveTasks;
+	uint32_t m_nWaveMinGateId;
+	uint64_t m_nWaveWords;
+	uint32_t m_nNextWaveTask;
+	uint32_t m_nWorkingThreads;
+	CLock m_lWaveLock;
+	CEvent m_evtWaveDone;
+
 #ifdef BENCHBOOLTIME
 	double m_nCombTime;
 	double m_nSubsetTime;
@@ -249,6 +305,43 @@ private:
 	 \param gateid		Gate identifier
 	 */
 	inline void EvaluateCONVGate(uint32_t gateid);
+	/**
+	 Evaluate the local gates of a layer with the help of the worker threads.
+	 \param localops	Local queue of the layer
+	 */
+	void EvaluateLocalOperationsParallel(deque<uint32_t>& localops);
+	/**
+	 Check whether a local gate can be evaluated as part of a wave.
+	 */
+	BOOL IsWaveGate(GATE* gate);
+	/**
+	 Check whether one of the inputs of the gate may be computed in the current wave.
+	 */
+	BOOL DependsOnWave(GATE* gate);
+	/**
+	 Instantiate a gate and add it to the current wave.
+	 */
+	void AddToWave(uint32_t gateid);
+	/**
+	 Evaluate all gates of the current wave and release their inputs afterwards.
+	 */
+	void EvaluateWave();
+	/**
+	 Take tasks from the task list of the current wave until it is empty. Called by the main and the worker threads.
+	 */
+	void ProcessWaveTasks();
+	/**
+	 Evaluate the words [wordstart, wordend) of a gate of the current wave.
+	 */
+	void EvaluateWaveGate(wave_gate* wgate, uint64_t wordstart, uint64_t wordend);
+	/**
+	 Release the inputs of a gate of the current wave.
+	 */
+	void ReleaseWaveGate(wave_gate* wgate);
+	/**
+	 Stop and delete the worker threads.
+	 */
+	void StopWorkerThreads();
 	/**
 	 Method for evaluating Constant gate for the inputted
 	 gate object.
@@ -269,18 +362,14 @@ private:
 	void ComputeMTs();
 
 	/**
-	 Method for store MTs to File
-	*/
-	void StoreMTsToFile(char *filename);
-
-	/**
-	 Method for read MTs from file
+	 Method for transferring the MTs to or from the precomputation store
 	*/
-	void ReadMTsFromFile(char *filename);
+	BOOL PreCompValues();
 	/**
-	Method to check if it is the right nvals or the circuit size.
+	 Method for taking the MTs of all AND sizes from the triple pool. Both parties only take them if both pools hold
+	 enough of them, returns FALSE otherwise.
 	*/
-	BOOL isCircuitSizeLessThanOrEqualWithValueFromFile(char *filename, uint32_t in_circ_size);
+	BOOL TakePoolMTs(ABYSetup* setup);
 
 
 	/**
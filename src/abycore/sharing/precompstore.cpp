@@ -0,0 +1,243 @@
+/**
+ \file 		precompstore.cpp
+ \author	michael.zohner@ec-spride.de
+ \copyright	ABY - A Framework for Efficient Mixed-protocol Secure Two-party Computation
+			Copyright (C) 2015 Engineering Cryptographic Protocols Group, TU Darmstadt
+			This program is free software: you can redistribute it and/or modify
+			it under the terms of the GNU Affero General Public License as published
+			by the Free Software Foundation, either version 3 of the License, or
+			(at your option) any later version.
+			This program is distributed in the hope that it will be useful,
+			but WITHOUT ANY WARRANTY; without even the implied warranty of
+			MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+			GNU Affero General Public License for more details.
+			You should have received a copy of the GNU Affero General Public License
+			along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief		File that holds the values of precomputed setup phases until an execution consumes them.
+ */
+
+#include "precompstore.h"
+#include <iostream>
+#include <cstring>
+#include <cstddef>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <assert.h>
+
+static inline uint64_t precomp_record_size(uint64_t len) {
+	return sizeof(precomp_record_header) + ((len + 7) / 8) * 8;
+}
+
+//reads the header of the record at offset, FALSE if no complete record starts there
+static BOOL read_record_header(int fd, uint64_t offset, uint64_t size, precomp_record_header& rec) {
+	return offset + sizeof(precomp_record_header) <= size && pread(fd, &rec, sizeof(rec), offset) == (ssize_t) sizeof(rec)
+			&& rec.len <= size && offset + precomp_record_size(rec.len) <= size;
+}
+
+PreCompStore::PreCompStore(const string& filename, e_role role) {
+	m_sFileName = filename;
+	m_eRole = role;
+	m_pMapped = NULL;
+	m_nMappedBytes = 0;
+}
+
+PreCompStore::~PreCompStore() {
+	Release();
+}
+
+int PreCompStore::LockFile(BOOL create) {
+	struct stat fdstat, pathstat;
+
+	for (;;) {
+		int fd = open(m_sFileName.c_str(), O_RDWR | (create ? O_CREAT : 0), 0600);
+		if (fd < 0) {
+			return -1;
+		}
+		if (flock(fd, LOCK_EX) != 0) {
+			close(fd);
+			return -1;
+		}
+		//the last consumer removes the file, possibly while this process waited for the lock
+		if (fstat(fd, &fdstat) == 0 && stat(m_sFileName.c_str(), &pathstat) == 0 && fdstat.st_ino == pathstat.st_ino
+				&& fdstat.st_dev == pathstat.st_dev) {
+			return fd;
+		}
+		UnlockFile(fd);
+	}
+}
+
+void PreCompStore::UnlockFile(int fd) {
+	flock(fd, LOCK_UN);
+	close(fd);
+}
+
+BOOL PreCompStore::CheckHeader(const BYTE* buf, uint64_t size) {
+	const precomp_store_header* head = (const precomp_store_header*) buf;
+	if (size < sizeof(precomp_store_header) || memcmp(head->magic, PRECOMP_STORE_MAGIC, sizeof(head->magic)) != 0
+			|| head->version != PRECOMP_STORE_VERSION) {
+		cerr << "Error: " << m_sFileName << " is not a precomputation store of this version" << endl;
+		return FALSE;
+	}
+	if (head->role != (uint32_t) m_eRole) {
+		cerr << "Error: " << m_sFileName << " holds the precomputed values of the " << get_role_name((e_role) head->role) << endl;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+BOOL PreCompStore::MatchRecord(const precomp_record_header* rec, const string& slot, uint64_t fingerprint) {
+	return rec->state == PRECOMP_RECORD_VALID && rec->fingerprint == fingerprint
+			&& strncmp(rec->slot, slot.c_str(), PRECOMP_SLOT_NAME_LEN) == 0;
+}
+
+BOOL PreCompStore::Append(const string& slot, uint64_t fingerprint, const BYTE* values, uint64_t len) {
+	precomp_store_header head;
+	precomp_record_header rec;
+	struct stat filestat;
+	BYTE padding[8] = { 0 };
+	uint64_t offset;
+	BOOL success;
+
+	assert(slot.size() < PRECOMP_SLOT_NAME_LEN);
+	int fd = LockFile(TRUE);
+	if (fd < 0 || fstat(fd, &filestat) != 0) {
+		cerr << "Error: Unable to open the precomputation store " << m_sFileName << endl;
+		if (fd >= 0) {
+			UnlockFile(fd);
+		}
+		return FALSE;
+	}
+
+	if (filestat.st_size == 0) {
+		memcpy(head.magic, PRECOMP_STORE_MAGIC, sizeof(head.magic));
+		head.version = PRECOMP_STORE_VERSION;
+		head.role = (uint32_t) m_eRole;
+		success = pwrite(fd, &head, sizeof(head), 0) == (ssize_t) sizeof(head);
+	} else {
+		success = pread(fd, &head, sizeof(head), 0) == (ssize_t) sizeof(head) && CheckHeader((BYTE*) &head, filestat.st_size);
+	}
+
+	//a writer that crashed may have left an incomplete record at the end, which is overwritten
+	offset = sizeof(precomp_store_header);
+	while (success && read_record_header(fd, offset, filestat.st_size, rec)) {
+		offset += precomp_record_size(rec.len);
+	}
+
+	memset(&rec, 0, sizeof(rec));
+	strncpy(rec.slot, slot.c_str(), PRECOMP_SLOT_NAME_LEN - 1);
+	rec.fingerprint = fingerprint;
+	rec.len = len;
+	rec.state = PRECOMP_RECORD_PENDING;
+
+	success = success && ftruncate(fd, offset) == 0 && pwrite(fd, &rec, sizeof(rec), offset) == (ssize_t) sizeof(rec)
+			&& (len == 0 || pwrite(fd, values, len, offset + sizeof(rec)) == (ssize_t) len)
+			&& pwrite(fd, padding, precomp_record_size(len) - sizeof(rec) - len, offset + sizeof(rec) + len) >= 0;
+	//the record only becomes valid once all of its values are on disk, and is only reported as stored once its state is
+	rec.state = PRECOMP_RECORD_VALID;
+	success = success && fsync(fd) == 0
+			&& pwrite(fd, &rec.state, sizeof(rec.state), offset + offsetof(precomp_record_header, state)) == (ssize_t) sizeof(rec.state)
+			&& fsync(fd) == 0;
+	UnlockFile(fd);
+
+	if (!success) {
+		cerr << "Error: Unable to append to the precomputation store " << m_sFileName << endl;
+	}
+#ifdef DEBUG_PRECOMP_STORE
+	cout << "Appended " << len << " bytes for " << slot << " (" << fingerprint << ") at offset " << offset << endl;
+#endif
+	return success;
+}
+
+const BYTE* PreCompStore::Consume(const string& slot, uint64_t fingerprint, uint64_t& len) {
+	precomp_record_header *rec, *found = NULL;
+	struct stat filestat;
+	uint32_t nvalid = 0;
+
+	Release();
+	int fd = LockFile(FALSE);
+	if (fd < 0) {
+		return NULL;
+	}
+	if (fstat(fd, &filestat) != 0 || (uint64_t) filestat.st_size < sizeof(precomp_store_header)) {
+		UnlockFile(fd);
+		return NULL;
+	}
+	BYTE* base = (BYTE*) mmap(NULL, filestat.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (base == MAP_FAILED || !CheckHeader(base, filestat.st_size)) {
+		if (base != MAP_FAILED) {
+			munmap(base, filestat.st_size);
+		}
+		UnlockFile(fd);
+		return NULL;
+	}
+
+	for (uint64_t offset = sizeof(precomp_store_header); offset + sizeof(precomp_record_header) <= (uint64_t) filestat.st_size;
+			offset += precomp_record_size(rec->len)) {
+		rec = (precomp_record_header*) (base + offset);
+		if (rec->len > (uint64_t) filestat.st_size || offset + precomp_record_size(rec->len) > (uint64_t) filestat.st_size) {
+			break;
+		}
+		if (found == NULL && MatchRecord(rec, slot, fingerprint)) {
+			found = rec;
+		} else if (rec->state == PRECOMP_RECORD_VALID) {
+			nvalid++;
+		}
+	}
+
+	if (found == NULL) {
+		munmap(base, filestat.st_size);
+		UnlockFile(fd);
+		return NULL;
+	}
+
+	//the record is consumed on disk before any of its values are used
+	found->state = PRECOMP_RECORD_CONSUMED;
+	uint64_t pagesize = sysconf(_SC_PAGESIZE);
+	uint64_t pagestart = (((BYTE*) &(found->state)) - base) / pagesize * pagesize;
+	msync(base + pagestart, ((BYTE*) &(found->state)) - base - pagestart + sizeof(found->state), MS_SYNC);
+	if (nvalid == 0) {
+		unlink(m_sFileName.c_str());
+	}
+	//the mapping stays valid after the file was closed or removed
+	UnlockFile(fd);
+
+#ifdef DEBUG_PRECOMP_STORE
+	cout << "Consumed " << found->len << " bytes for " << slot << " (" << fingerprint << "), " << nvalid << " records left" << endl;
+#endif
+	m_pMapped = base;
+	m_nMappedBytes = filestat.st_size;
+	len = found->len;
+	return (const BYTE*) (found + 1);
+}
+
+void PreCompStore::Release() {
+	if (m_pMapped) {
+		munmap(m_pMapped, m_nMappedBytes);
+		m_pMapped = NULL;
+		m_nMappedBytes = 0;
+	}
+}
+
+uint32_t PreCompStore::GetNumRecords(const string& slot, uint64_t fingerprint) {
+	precomp_store_header head;
+	precomp_record_header rec;
+	struct stat filestat;
+	uint32_t nrecords = 0;
+
+	int fd = LockFile(FALSE);
+	if (fd < 0) {
+		return 0;
+	}
+	if (fstat(fd, &filestat) == 0 && pread(fd, &head, sizeof(head), 0) == (ssize_t) sizeof(head)
+			&& CheckHeader((BYTE*) &head, filestat.st_size)) {
+		for (uint64_t offset = sizeof(precomp_store_header); read_record_header(fd, offset, filestat.st_size, rec);
+				offset += precomp_record_size(rec.len)) {
+			nrecords += MatchRecord(&rec, slot, fingerprint);
+		}
+	}
+	UnlockFile(fd);
+	return nrecords;
+}
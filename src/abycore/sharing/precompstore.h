@@ -0,0 +1,108 @@
+/**
+ \file 		precompstore.h
+ \author	michael.zohner@ec-spride.de
+ \copyright	ABY - A Framework for Efficient Mixed-protocol Secure Two-party Computation
+			Copyright (C) 2015 Engineering Cryptographic Protocols Group, TU Darmstadt
+			This program is free software: you can redistribute it and/or modify
+			it under the terms of the GNU Affero General Public License as published
+			by the Free Software Foundation, either version 3 of the License, or
+			(at your option) any later version.
+			This program is distributed in the hope that it will be useful,
+			but WITHOUT ANY WARRANTY; without even the implied warranty of
+			MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+			GNU Affero General Public License for more details.
+			You should have received a copy of the GNU Affero General Public License
+			along with this program. If not, see <http://www.gnu.org/licenses/>.
+ \brief		File that holds the values of precomputed setup phases until an execution consumes them.
+ */
+
+#ifndef __PRECOMPSTORE_H__
+#define __PRECOMPSTORE_H__
+
+#include "../ENCRYPTO_utils/typedefs.h"
+#include "../ABY_utils/ABYconstants.h"
+#include <string>
+
+using namespace std;
+
+//#define DEBUG_PRECOMP_STORE
+
+#define PRECOMP_STORE_MAGIC "ABYPRECS"
+#define PRECOMP_STORE_VERSION 1
+#define PRECOMP_SLOT_NAME_LEN 24
+
+/** Header at the start of a store file */
+struct precomp_store_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t role;		// role of the party that wrote the values
+};
+
+/** State of a record, records are never removed from the file but only marked */
+enum e_precomp_record_state {
+	PRECOMP_RECORD_PENDING = 0, // the values are still being written, or the writer crashed
+	PRECOMP_RECORD_VALID = 1,
+	PRECOMP_RECORD_CONSUMED = 2
+};
+
+/** Header of each record, the values of the record follow, padded to 8 bytes */
+struct precomp_record_header {
+	char slot[PRECOMP_SLOT_NAME_LEN];
+	uint64_t fingerprint;	// fingerprint of the circuit the values were computed for
+	uint64_t len;			// bytes of the values without padding
+	uint32_t state;			// e_precomp_record_state
+	uint32_t reserved;
+};
+
+/**
+ Store for the values of setup phases that are computed ahead of the executions that use them. The values of one setup
+ phase are a record of a named slot, e.g. a sharing, and carry the fingerprint of the circuit they were computed for.
+ Records are only handed to executions of the same slot and circuit, in the order in which they were appended.
+
+ All accesses lock the file, such that several processes can append to and consume from the same store. A record is
+ marked as consumed on disk before its values are returned, such that no values are ever used twice, even if the
+ consuming process crashes. A record whose writer crashed is never marked as valid. The file is removed as soon as all
+ of its records are consumed.
+ */
+class PreCompStore {
+public:
+	PreCompStore(const string& filename, e_role role);
+	~PreCompStore();
+
+	/** Appends the values as the last record of the slot */
+	BOOL Append(const string& slot, uint64_t fingerprint, const BYTE* values, uint64_t len);
+	/**
+	 Takes the first valid record of the slot and circuit and marks it as consumed. The values are read from the mapped
+	 file in place and stay valid until Release is called or the store is deleted.
+	 \return the values, or NULL if the store has no valid record for the slot and circuit
+	 */
+	const BYTE* Consume(const string& slot, uint64_t fingerprint, uint64_t& len);
+	/** Unmaps the values that were returned by Consume */
+	void Release();
+	/** Number of valid records of the slot and circuit */
+	uint32_t GetNumRecords(const string& slot, uint64_t fingerprint);
+
+private:
+	//opens and locks the file, a file that was removed while waiting for the lock is opened again
+	int LockFile(BOOL create);
+	void UnlockFile(int fd);
+	BOOL CheckHeader(const BYTE* buf, uint64_t size);
+	BOOL MatchRecord(const precomp_record_header* rec, const string& slot, uint64_t fingerprint);
+
+	string m_sFileName;
+	e_role m_eRole;
+	BYTE* m_pMapped;
+	uint64_t m_nMappedBytes;
+};
+
+/** FNV-1a hash that is used for circuit fingerprints */
+inline uint64_t precomp_fingerprint(uint64_t hash, uint64_t value) {
+	for (uint32_t i = 0; i < sizeof(uint64_t); i++) {
+		hash = (hash ^ ((value >> (8 * i)) & 0xFF)) * 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+#define PRECOMP_FINGERPRINT_INIT 0xCBF29CE484222325ULL
+
+#endif /* __PRECOMPSTORE_H__ */
@@ -16,12 +16,16 @@
  \brief		Sharing class implementation.
  */
 #include "sharing.h"
+#include <map>
+#include <queue>
+
+#define NO_GATE_BUF 0xFFFFFFFF
 
 void Sharing::EvaluateCallbackGate(uint32_t gateid) {
 	GATE* gate = m_pGates + gateid;
 	void (*callback)(GATE*, void*) = gate->gs.cbgate.callback;
 	void* infos = gate->gs.cbgate.infos;
-	InstantiateGate(gate);
+	InstantiateGate(gate, gateid);
 
 	callback(gate, infos);
 
@@ -39,29 +43,136 @@ void Sharing::SetPreCompPhaseValue(ePreCompPhase in_phase_value) {
 ePreCompPhase Sharing::GetPreCompPhaseValue() {
 	return m_ePhaseValue;
 }
-void Sharing::PreCompFileDelete() {
-	char filename[21];
-	uint64_t truncation_size;
-	if(m_eRole == SERVER) {
-		strcpy(filename, "pre_comp_server.dump");
-	}
-	else {
-		strcpy(filename, "pre_comp_client.dump");
-	}
 
-	if((FileExists(filename))&&(GetPreCompPhaseValue() == ePreCompRead)) {
+string Sharing::GetPreCompFileName() {
+	return m_eRole == SERVER ? "pre_comp_server.store" : "pre_comp_client.store";
+}
 
-		if(m_nFilePos >= FileSize(filename)) {
-			remove(filename);
+//Covers the layers, the sizes and the wiring of the gates, such that values are never read for a differently wired circuit
+uint64_t Sharing::GetCircuitFingerprint() {
+	Circuit* circ = GetCircuitBuildRoutine();
+	uint64_t fingerprint = precomp_fingerprint(PRECOMP_FINGERPRINT_INIT, m_nTypeBitLen);
+	vector<uint64_t> desc;
+	GATE* gate;
+
+	for (uint32_t i = 0; i < circ->GetMaxDepth(); i++) {
+		for (uint32_t j = 0; j < 2; j++) {
+			deque<uint32_t> queue = j == 0 ? circ->GetLocalQueueOnLvl(i) : circ->GetInteractiveQueueOnLvl(i);
+			fingerprint = precomp_fingerprint(fingerprint, queue.size());
+			for (uint32_t k = 0; k < queue.size(); k++) {
+				gate = m_pGates + queue[k];
+				fingerprint = precomp_fingerprint(fingerprint, queue[k]);
+				fingerprint = precomp_fingerprint(fingerprint, ((uint64_t) gate->type << 32) | gate->sharebitlen);
+				fingerprint = precomp_fingerprint(fingerprint, gate->nvals);
+				m_pCircuit->GetGateDescription(queue[k], desc);
+				fingerprint = precomp_fingerprint(fingerprint, desc.size());
+				for (uint32_t l = 0; l < desc.size(); l++) {
+					fingerprint = precomp_fingerprint(fingerprint, desc[l]);
+				}
+			}
 		}
-		else {
-			truncation_size = FileSize(filename) - m_nFilePos;
-			if(truncate(filename, truncation_size))
-                        cout << "Error occured in truncate" << endl;
+	}
+	return fingerprint;
+}
+
+BOOL Sharing::StorePreCompValues() {
+	PreCompStore store(GetPreCompFileName(), m_eRole);
+	BOOL success;
+
+	m_ePreCompDir = PRECOMP_WRITE;
+	m_vPreCompBuf.clear();
+	success = PreCompValues() && store.Append(get_sharing_name(m_eContext), GetCircuitFingerprint(), m_vPreCompBuf.data(), m_vPreCompBuf.size());
+	vector<BYTE>().swap(m_vPreCompBuf);
+
+	if (!success) {
+		cerr << "Error: Unable to store the precomputed values of the " << get_sharing_name(m_eContext) << " sharing" << endl;
+	}
+	return success;
+}
+
+//The values are checked before they are read, such that a malformed record does not leave the sharing half-initialized
+BOOL Sharing::ReadPreCompValues(ABYSetup* setup) {
+	PreCompStore store(GetPreCompFileName(), m_eRole);
+	uint64_t len;
+	BYTE valid = 0, othervalid = 0;
+
+	const BYTE* values = store.Consume(get_sharing_name(m_eContext), GetCircuitFingerprint(), len);
+	if (values == NULL) {
+#ifndef BATCH
+		cout << "No precomputed values left for the " << get_sharing_name(m_eContext) << " sharing of this circuit, running the setup phase" << endl;
+#endif
+	} else {
+		m_ePreCompDir = PRECOMP_CHECK;
+		m_pPreCompPos = values;
+		m_pPreCompEnd = values + len;
+		valid = PreCompValues() && m_pPreCompPos == m_pPreCompEnd;
+		if (!valid) {
+			cerr << "Error: The precomputed values of the " << get_sharing_name(m_eContext) << " sharing are malformed, running the setup phase" << endl;
 		}
 	}
+
+	//a party that reads its values while the other one runs the setup phase would wait for messages that are never sent
+	othervalid = BothPartiesReady(setup, valid);
+
+	if (valid && !othervalid) {
+#ifndef BATCH
+		cout << "The other party has no precomputed values for the " << get_sharing_name(m_eContext) << " sharing of this circuit, running the setup phase" << endl;
+#endif
+	}
+	if (valid && othervalid) {
+		m_ePreCompDir = PRECOMP_READ;
+		m_pPreCompPos = values;
+		valid = PreCompValues();
+	}
+	m_pPreCompPos = NULL;
+	m_pPreCompEnd = NULL;
+	store.Release();
+
+	return valid && othervalid;
+}
+
+BOOL Sharing::BothPartiesReady(ABYSetup* setup, BOOL ready) {
+	BYTE mine = ready ? 1 : 0, other = 0;
+	setup->AddSendTask(&mine, 1);
+	setup->AddReceiveTask(&other, 1);
+	setup->WaitForTransmissionEnd();
+	return mine && other;
 }
 
+//Each buffer is preceded by its size, such that values that were stored for a different buffer layout are detected
+BOOL Sharing::PreCompBuf(BYTE* buf, uint64_t bytes) {
+	uint64_t len;
+
+	if (m_ePreCompDir == PRECOMP_WRITE) {
+		m_vPreCompBuf.insert(m_vPreCompBuf.end(), (BYTE*) &bytes, ((BYTE*) &bytes) + sizeof(uint64_t));
+		m_vPreCompBuf.insert(m_vPreCompBuf.end(), buf, buf + bytes);
+		return TRUE;
+	}
+	if ((uint64_t) (m_pPreCompEnd - m_pPreCompPos) < sizeof(uint64_t)) {
+		return FALSE;
+	}
+	memcpy(&len, m_pPreCompPos, sizeof(uint64_t));
+	if (len != bytes || (uint64_t) (m_pPreCompEnd - m_pPreCompPos) - sizeof(uint64_t) < bytes) {
+		return FALSE;
+	}
+	if (m_ePreCompDir == PRECOMP_READ && bytes > 0) {
+		memcpy(buf, m_pPreCompPos + sizeof(uint64_t), bytes);
+	}
+	m_pPreCompPos += sizeof(uint64_t) + bytes;
+	return TRUE;
+}
+
+BOOL Sharing::PreCompNum(uint32_t& num) {
+	uint32_t val = num;
+
+	if (!PreCompBuf((BYTE*) &val, sizeof(uint32_t))) {
+		return FALSE;
+	}
+	if (m_ePreCompDir != PRECOMP_WRITE) {
+		memcpy(&num, m_pPreCompPos - sizeof(uint32_t), sizeof(uint32_t));
+	}
+	return TRUE;
+}
 
 
 /*
@@ -185,6 +296,18 @@ void Sharing::EvaluatePrintValGate(uint32_t gateid, e_circuit circ_type) {
 	free((char*) m_pGates[gateid].gs.infostr);
 }
 
+// Values that were not instantiated by a sharing, e.g., those of shared input gates, were allocated with malloc
+static inline void FreeGateValue(GATE* gate, void* val) {
+	if(gate->planned) {
+		//planned buffers are handed on to the next gate by the buffer plan
+		return;
+	} else if(gate->pooled) {
+		GateValuePool::Free(val);
+	} else {
+		free(val);
+	}
+}
+
 // Delete dynamically allocated gate contents depending on gate type
 void Sharing::FreeGate(GATE *gate) {
 	e_sharing context = gate->context;
@@ -197,19 +320,21 @@ void Sharing::FreeGate(GATE *gate) {
 	case S_BOOL:
 	case S_ARITH:
 	case S_SPLUT:
-		free(gate->gs.val);
+		FreeGateValue(gate, gate->gs.val);
 		break;
 	case S_YAO:
 		if(role == SERVER) {
 			if(gate->type = G_IN) { break; } // input gates are freed before
-			free(gate->gs.yinput.outKey);
-			free(gate->gs.yinput.pi);
+			FreeGateValue(gate, gate->gs.yinput.outKey);
+			FreeGateValue(gate, gate->gs.yinput.pi);
 		} else {
-			free(gate->gs.yval);
+			FreeGateValue(gate, gate->gs.yval);
 		}
 		break;
 	}
 	gate->instantiated = false;
+	gate->pooled = false;
+	gate->planned = false;
 }
 
 // Mark gate as used. If it is no longer needed, free it.
@@ -221,3 +346,103 @@ void Sharing::UsedGate(uint32_t gateid) {
 		FreeGate(gate);
 	}
 }
+
+BYTE* Sharing::AllocGateValue(GATE* gate, uint32_t gateid, uint64_t bytes, bool clear) {
+	if (gateid < m_vGateBufSlot.size() && m_vGateBufSlot[gateid] != NO_GATE_BUF) {
+		uint32_t slot = m_vGateBufSlot[gateid];
+		if (bytes <= m_vGateBufSize[slot]) {
+			BYTE* val = m_pGateBuf + m_vGateBufOffset[slot];
+			if (clear) {
+				memset(val, 0, bytes);
+			}
+			gate->planned = true;
+			return val;
+		}
+	}
+	gate->pooled = true;
+	return (BYTE*) m_cGateValPool.Alloc(bytes, clear);
+}
+
+/*
+ * Linear scan over the layers, as in register allocation: the value of a gate is live from the layer on which the gate
+ * is evaluated until its last use. Buffers whose gate is no longer live are reused for gates on later layers, where a
+ * free buffer is only taken if it is at most twice as large as the gate value.
+ */
+uint64_t Sharing::PlanGateBuffers(vector<uint32_t>& lastuse) {
+	DiscardGateBufferPlan();
+
+	uint32_t ngates = lastuse.size();
+	vector<vector<uint32_t> > gatesonlvl;
+	for (uint32_t i = 0; i < ngates; i++) {
+		GATE* gate = m_pGates + i;
+		//the values of shared input gates are assigned when the circuit is built
+		if (gate->context != m_eContext || gate->type == G_SHARED_IN || gate->type == G_REMOVED || GetGateValueBytes(gate) == 0) {
+			continue;
+		}
+		if (gate->depth >= gatesonlvl.size()) {
+			gatesonlvl.resize(gate->depth + 1);
+		}
+		gatesonlvl[gate->depth].push_back(i);
+	}
+	if (gatesonlvl.size() == 0) {
+		return 0;
+	}
+
+	m_vGateBufSlot.assign(ngates, NO_GATE_BUF);
+	multimap<uint64_t, uint32_t> freebufs;
+	//buffers in use together with the last layer of their current gate, the buffer that becomes free first on top
+	priority_queue<pair<uint32_t, uint32_t>, vector<pair<uint32_t, uint32_t> >, greater<pair<uint32_t, uint32_t> > > busybufs;
+
+	for (uint32_t d = 0; d < gatesonlvl.size(); d++) {
+		while (!busybufs.empty() && busybufs.top().first < d) {
+			uint32_t slot = busybufs.top().second;
+			freebufs.insert(make_pair(m_vGateBufSize[slot], slot));
+			busybufs.pop();
+		}
+		for (uint32_t i = 0; i < gatesonlvl[d].size(); i++) {
+			uint32_t gateid = gatesonlvl[d][i];
+			uint64_t bytes = PadToMultiple(GetGateValueBytes(m_pGates + gateid), 16);
+			uint32_t slot;
+			multimap<uint64_t, uint32_t>::iterator it = freebufs.lower_bound(bytes);
+			if (it != freebufs.end() && it->first <= 2 * bytes) {
+				slot = it->second;
+				freebufs.erase(it);
+			} else {
+				slot = m_vGateBufSize.size();
+				m_vGateBufSize.push_back(bytes);
+			}
+			m_vGateBufSlot[gateid] = slot;
+			m_nUnplannedBytes += bytes;
+			if (lastuse[gateid] != GATE_LIVE_FOREVER) {
+				busybufs.push(make_pair(lastuse[gateid], slot));
+			}
+		}
+	}
+
+	m_vGateBufOffset.resize(m_vGateBufSize.size());
+	for (uint32_t i = 0; i < m_vGateBufSize.size(); i++) {
+		m_vGateBufOffset[i] = m_nPlannedBytes;
+		m_nPlannedBytes += m_vGateBufSize[i];
+	}
+	m_pGateBuf = (BYTE*) malloc(m_nPlannedBytes);
+	if (m_pGateBuf == NULL) {
+		cerr << "Memory allocation not successful for the planned gate buffers of " << m_nPlannedBytes << " bytes" << endl;
+		exit(0);
+	}
+
+#ifdef DEBUGSHARING
+	cout << "Planned " << m_vGateBufSize.size() << " buffers with " << m_nPlannedBytes << " bytes for the gates of sharing "
+			<< get_sharing_name(m_eContext) << endl;
+#endif
+	return m_nPlannedBytes;
+}
+
+void Sharing::DiscardGateBufferPlan() {
+	free(m_pGateBuf);
+	m_pGateBuf = NULL;
+	m_nPlannedBytes = 0;
+	m_nUnplannedBytes = 0;
+	m_vGateBufSlot.clear();
+	m_vGateBufOffset.clear();
+	m_vGateBufSize.clear();
+}
@@ -26,13 +26,23 @@
 #include "../circuit/circuit.h"
 #include "../ENCRYPTO_utils/cbitvector.h"
 #include "../aby/abysetup.h"
+#include "../aby/abytriplepool.h"
 #include "../ENCRYPTO_utils/constants.h"
 #include "../ENCRYPTO_utils/crypto/crypto.h"
 #include "../ENCRYPTO_utils/fileops.h"
+#include "../ABY_utils/gatevalpool.h"
+#include "precompstore.h"
 #include <assert.h>
 //#define DEBUGSHARING
 
 
+/** Direction of Sharing::PreCompValues */
+enum e_precomp_dir {
+	PRECOMP_WRITE, // append the values to the record
+	PRECOMP_CHECK, // only check that the values in the record have the expected sizes
+	PRECOMP_READ   // read the values from the record
+};
+
 /**
  Generic class for specifying different types of sharing.
  */
@@ -55,14 +65,23 @@ public:
 		m_cCrypto = crypt;
 		m_nSecParamBytes = ceil_divide(m_cCrypto->get_seclvl().symbits, 8);
 		m_ePhaseValue = ePreCompDefault;
-		m_nFilePos = -1;
+		m_pPreCompPos = NULL;
+		m_pPreCompEnd = NULL;
+		m_ePreCompDir = PRECOMP_WRITE;
+		m_bPreCompRead = FALSE;
+		m_pTriplePool = NULL;
+		m_bPoolMTs = FALSE;
 		m_nTypeBitLen = sharebitlen;
+		m_pGateBuf = NULL;
+		m_nPlannedBytes = 0;
+		m_nUnplannedBytes = 0;
 	}
 	;
 	/**
 	 Destructor of class.
 	 */
 	virtual ~Sharing() {
+		DiscardGateBufferPlan();
 	}
 	;
 
@@ -129,8 +148,9 @@ public:
 	/**
 	 Method for Instantiating a gate
 	 \param gate 		Input gate
+	 \param gateid 	Id of the gate
 	 */
-	virtual void InstantiateGate(GATE* gate) = 0;
+	virtual void InstantiateGate(GATE* gate, uint32_t gateid) = 0;
 	/**
 	 Method for finding the used gate with the gateid.
 	 \param gateid		Id of the used gate.
@@ -143,6 +163,33 @@ public:
 	 */
 	void FreeGate(GATE* gate);
 
+	/**
+	 Method for handing back all gate values that were allocated from the gate value pool of this sharing. Must only be
+	 called after the instantiated gates of all sharings were freed.
+	 */
+	void ResetGateValuePool() {
+		m_cGateValPool.Reset();
+	}
+
+	/**
+	 Assigns the values of the gates of this sharing to a bounded set of buffers before the circuit is evaluated. Gates
+	 whose values are never live at the same time share a buffer, such that the memory for the gate values is bounded
+	 by the maximal width of the live gates instead of the number of gates.
+	 \param lastuse	the last layer on which each gate value is read, see ABYCircuit::ComputeLastUse
+	 \return number of bytes that were reserved for the planned gate values
+	 */
+	uint64_t PlanGateBuffers(vector<uint32_t>& lastuse);
+	/** Drops the buffer plan, gate values are taken from the gate value pool again */
+	void DiscardGateBufferPlan();
+	/** \return number of bytes that are reserved for the planned gate values */
+	uint64_t GetPlannedGateBufferBytes() {
+		return m_nPlannedBytes;
+	}
+	/** \return number of bytes that the planned gate values would take if every gate had its own buffer */
+	uint64_t GetUnplannedGateBufferBytes() {
+		return m_nUnplannedBytes;
+	}
+
 	/**
 	 Method for assigning the input
 	 \param 	input 		Input
@@ -181,8 +228,10 @@ public:
 			In setup phase the implementation uses the baseOTs to compute OTs and use the OTs
 			to communicate and compute the MTs. Online phase primarily deals with the rest of
 			the circuit execution where the circuit evaluation is performed.
-			Currently Precomputation scheme is only implemented for BoolSharing circuits or
-	 	 	GMW based circuits. The implementation involves the use of 4 different modes of
+			The RAM modes are only implemented for BoolSharing circuits or GMW based circuits,
+			the Boolean, Yao, arithmetic and SP-LUT sharings implement the store and read modes
+			with a record each in the precomputation store of the role, see StorePreCompValues
+			and PreCompStore. The implementation involves the use of 4 different modes of
 	 	 	operation: PrecomputationStore, PrecomputationRead, PrecomputeInRAM and finally
 	 	 	the default. In precomputationStore:  the MTs are computed for the specified
 	 	 	circuit design and stored in a specific file(depending on the role) and the online
@@ -207,10 +256,14 @@ public:
 	 Getting precomputation phase value
 	*/
 	ePreCompPhase GetPreCompPhaseValue();
+
 	/**
-	Method to delete the File which stores the precomputation values.
+	 Sets the pool of multiplication triples of the party, from which the Boolean and the arithmetic sharing draw
+	 their MTs in the ePreCompPool mode
 	*/
-	void PreCompFileDelete();
+	void SetTriplePool(ABYTriplePool* pool) {
+		m_pTriplePool = pool;
+	}
 
 
 protected:
@@ -244,18 +297,89 @@ protected:
 	 \returns	The value of the gate in a standardized format
 	 */
 	UGATE_T* ReadOutputValue(uint32_t gateid, e_circuit circ_type, uint32_t* bitlen);
+	/**
+	 Allocates a gate value from the buffer that was planned for the gate or, if there is none, from the gate value
+	 pool. Marks the gate accordingly, such that FreeGate() knows how to release the value.
+	 \param gate		Gate that the value is allocated for
+	 \param gateid		Id of the gate, selects the planned buffer
+	 \param bytes		Number of bytes of the value
+	 \param clear		Zero the value
+	 */
+	BYTE* AllocGateValue(GATE* gate, uint32_t gateid, uint64_t bytes, bool clear = true);
+	/**
+	 Number of bytes that InstantiateGate() allocates for the value of a gate. Sharings that return 0, which is the
+	 default, do not take part in the gate buffer planning.
+	 */
+	virtual uint64_t GetGateValueBytes(GATE* gate) {
+		return 0;
+	}
+
+	/**
+	 Writes, checks or reads each buffer that the online phase needs from the setup phase with PreCompBuf, always in the
+	 same order, see m_ePreCompDir. Sharings that support the precomputation store and read modes override it.
+	 \return FALSE if a buffer could not be transferred or did not have the expected size
+	 */
+	virtual BOOL PreCompValues() {
+		return FALSE;
+	}
+	/**
+	 Appends the values of the setup phase of this execution as a record of the sharing to the precomputation store of
+	 the role. Called at the end of the setup phase in the precomputation store mode.
+	 */
+	BOOL StorePreCompValues();
+	/**
+	 Replaces the setup phase of this execution by the next record of the sharing and the circuit in the precomputation
+	 store. The record is consumed even if its values turn out to be malformed, in which case nothing is overwritten.
+	 Both parties have to call it at the same point of the setup phase: they exchange whether they can read their values
+	 on the setup channel and only read them if both can, otherwise both run the setup phase.
+	 \return FALSE if this or the other party has no valid values for this circuit, the setup phase has to be run then
+	 */
+	BOOL ReadPreCompValues(ABYSetup* setup);
+	/**
+	 Exchanges whether the party is ready to skip a part of the setup phase with the other party on the setup channel.
+	 Both parties have to call it at the same point of the setup phase.
+	 \return TRUE if both parties are ready
+	 */
+	BOOL BothPartiesReady(ABYSetup* setup, BOOL ready);
+	/** Transfers a single buffer in PreCompValues */
+	BOOL PreCompBuf(BYTE* buf, uint64_t bytes);
+	/** Transfers a number in PreCompValues, which is also read in the check pass, since the sizes of the following buffers may depend on it */
+	BOOL PreCompNum(uint32_t& num);
+	BOOL PreCompBuf(CBitVector& vec) {
+		return PreCompBuf(vec.GetArr(), vec.GetSize());
+	}
+	/** Name of the precomputation store of the role, which holds the records of all sharings */
+	string GetPreCompFileName();
+	/**
+	 Fingerprint of the gates of the sharing, which identifies the circuit that precomputed values belong to. Equal
+	 for circuits that were built by the same sequence of calls.
+	 */
+	uint64_t GetCircuitFingerprint();
 
 
 	uint32_t m_nShareBitLen; /**< Bit length of shared item. */
-	GATE* m_pGates; /**< Pointer to array of Logical Gates. */
+	GateTable m_pGates; /**< Handle to the table of Logical Gates. */
 	ABYCircuit* m_pCircuit; /**< Circuit pointer. */
 	e_role m_eRole; /**< Role object. */
 	uint32_t m_nSecParamBytes; /**< Number of security param bytes. */
 	crypto* m_cCrypto; /**< Class that contains cryptographic routines */
 	e_sharing m_eContext; /** Which sharing is executed */
 	uint32_t m_nTypeBitLen; /** Bit-length of the arithmetic shares in arithsharing */
-	uint64_t m_nFilePos;/**< Variable which stores the position of the file pointer. */
 	ePreCompPhase m_ePhaseValue;/**< Variable storing the current Precomputation Mode */
+	vector<BYTE> m_vPreCompBuf; /**< Values that are appended to the precomputation store */
+	const BYTE* m_pPreCompPos; /**< Next value of the record that is read, in the mapped store */
+	const BYTE* m_pPreCompEnd; /**< End of the record that is read */
+	e_precomp_dir m_ePreCompDir; /**< Direction of the current PreCompValues call */
+	BOOL m_bPreCompRead; /**< The setup values of the current execution were read from the precomputation file */
+	ABYTriplePool* m_pTriplePool; /**< Pool of multiplication triples of the party, NULL if the party has none */
+	BOOL m_bPoolMTs; /**< The MTs of the current execution were taken from the triple pool */
+	GateValuePool m_cGateValPool; /**< Pool for the values of the gates that are instantiated by this sharing */
+	vector<uint32_t> m_vGateBufSlot; /**< Planned buffer of every gate, indexed by the gate id */
+	vector<uint64_t> m_vGateBufOffset; /**< Offset of each planned buffer in m_pGateBuf */
+	vector<uint64_t> m_vGateBufSize; /**< Size of each planned buffer */
+	BYTE* m_pGateBuf; /**< Memory of all planned buffers */
+	uint64_t m_nPlannedBytes; /**< Size of m_pGateBuf */
+	uint64_t m_nUnplannedBytes; /**< Sum of the buffer sizes of all planned gates */
 
 };
 
@@ -134,6 +134,7 @@ void SetupLUT::InitNewLayer() {
 }
 
 void SetupLUT::PrepareSetupPhase(ABYSetup* setup) {
+	m_bPreCompRead = FALSE;
 	//tt_lens_ctx* tmplens;
 	vector<vector<vector<tt_lens_ctx> > > tmplens = m_cBoolCircuit->GetTTLens();
 
@@ -286,6 +287,12 @@ void SetupLUT::PrepareSetupPhase(ABYSetup* setup) {
 	if (m_nTotalTTs == 0)
 		return;
 
+	//the OTs were computed by an earlier execution
+	m_bPreCompRead = GetPreCompPhaseValue() == ePreCompRead && ReadPreCompValues(setup);
+	if (m_bPreCompRead) {
+		return;
+	}
+
 	for (uint32_t i = 1; i < m_vPreCompOTX.size(); i++) {
 		for(uint32_t k = 0; k < m_vPreCompOTX[i].size(); k++) {
 			for (uint32_t j = 0; j < 2; j++) {
@@ -326,7 +333,7 @@ void SetupLUT::PerformSetupPhase(ABYSetup* setup) {
 	//Do nothing
 }
 void SetupLUT::FinishSetupPhase(ABYSetup* setup) {
-	if (m_nTotalTTs == 0)
+	if (m_nTotalTTs == 0 || m_bPreCompRead)
 		return;
 
 	//TODO Reformat PreComputed OTs for the sender to have a faster online phase
@@ -378,6 +385,22 @@ void SetupLUT::FinishSetupPhase(ABYSetup* setup) {
 			free(buf);
 		}
 	}
+
+	if (GetPreCompPhaseValue() == ePreCompStore) {
+		StorePreCompValues();
+	}
+}
+
+//The sender values of the OTs are only needed in the form of m_vPreCompOTMasks
+BOOL SetupLUT::PreCompValues() {
+	BOOL success = TRUE;
+	for(uint32_t i = 0; i < m_vPreCompOTMasks.size(); i++) {
+		for(uint32_t k = 0; k < m_vPreCompOTMasks[i].size() && success; k++) {
+			success = PreCompBuf(*m_vPreCompOTMasks[i][k]) && PreCompBuf(*m_vPreCompOTC[i][k]) && PreCompBuf(*m_vPreCompOTR[i][k])
+					&& PreCompBuf(*m_vTableRnd[i][k]);
+		}
+	}
+	return success;
 }
 
 void SetupLUT::PrepareOnlinePhase() {
@@ -440,8 +463,8 @@ void SetupLUT::EvaluateLocalOperations(uint32_t depth) {
 			EvaluateAssertGate(localops[i], C_BOOLEAN);
 			break;
 		case G_SHARED_OUT:
-			InstantiateGate(gate);
-			memcpy(gate->gs.val, ((GATE*) m_pGates + gate->ingates.inputs.parent)->gs.val, bits_in_bytes(gate->nvals));
+			InstantiateGate(gate, localops[i]);
+			memcpy(gate->gs.val, (m_pGates + gate->ingates.inputs.parent)->gs.val, bits_in_bytes(gate->nvals));
 			UsedGate(gate->ingates.inputs.parent);
 			break;
 		case G_SHARED_IN:
@@ -588,7 +611,7 @@ inline void SetupLUT::EvaluateXORGate(uint32_t gateid) {
 	uint32_t nvals = gate->nvals;
 	uint32_t idleft = gate->ingates.inputs.twin.left;
 	uint32_t idright = gate->ingates.inputs.twin.right;
-	InstantiateGate(gate);
+	InstantiateGate(gate, gateid);
 
 	for (uint32_t i = 0; i < ceil_divide(nvals, GATE_T_BITS); i++) {
 		gate->gs.val[i] = m_pGates[idleft].gs.val[i] ^ m_pGates[idright].gs.val[i];
@@ -602,7 +625,7 @@ inline void SetupLUT::EvaluateXORGate(uint32_t gateid) {
 inline void SetupLUT::EvaluateConstantGate(uint32_t gateid) {
 	GATE* gate = m_pGates + gateid;
 	UGATE_T value = gate->gs.constval;
-	InstantiateGate(gate);
+	InstantiateGate(gate, gateid);
 	value = value * (m_eRole != CLIENT);
 
 	for (uint32_t i = 0; i < ceil_divide(gate->nvals, GATE_T_BITS); i++) {
@@ -617,7 +640,7 @@ inline void SetupLUT::EvaluateConstantGate(uint32_t gateid) {
 inline void SetupLUT::ShareValues(uint32_t gateid) {
 	GATE* gate = m_pGates + gateid;
 	UGATE_T* input = gate->gs.ishare.inval;
-	InstantiateGate(gate);
+	InstantiateGate(gate, gateid);
 
 	for (uint32_t i = 0, bitstocopy = gate->nvals, len; i < ceil_divide(gate->nvals, GATE_T_BITS); i++, bitstocopy -= GATE_T_BITS) {
 		len = min(bitstocopy, (uint32_t) GATE_T_BITS);
@@ -636,7 +659,7 @@ inline void SetupLUT::EvaluateINVGate(uint32_t gateid) {
 	GATE* gate = m_pGates + gateid;
 	uint32_t parentid = gate->ingates.inputs.parent;
 	uint32_t i;
-	InstantiateGate(gate);
+	InstantiateGate(gate, gateid);
 	UGATE_T tmpval;
 	if (m_eRole == SERVER) {
 		memset(&tmpval, 0xFF, sizeof(UGATE_T));
@@ -662,7 +685,7 @@ inline void SetupLUT::EvaluateCONVGate(uint32_t gateid) {
 	uint32_t parentid = gate->ingates.inputs.parents[0];
 	if (m_pGates[parentid].context == S_ARITH)
 		cerr << "can't convert from arithmetic representation directly into Boolean" << endl;
-	InstantiateGate(gate);
+	InstantiateGate(gate, gateid);
 
 	memset(gate->gs.val, 0, ceil_divide(gate->nvals, 8));
 	if (m_eRole == SERVER) {
@@ -781,7 +804,7 @@ void SetupLUT::SenderEvaluateTTGates() {
 #endif
 
 			//First step: instantiate gate and assign random masks to it
-			InstantiateGate(gate);
+			InstantiateGate(gate, m_vTTGates[i][g]);
 			m_vTableRnd[i][outs_id]->GetBits((uint8_t*) gate->gs.val, m_nTableRndIdx[i][outs_id], gate->nvals);
 			m_nTableRndIdx[i][outs_id] += (gate->nvals);
 
@@ -937,7 +960,7 @@ void SetupLUT::SenderEvaluateTTGates() {
 
 			//TODO can not handle nvals > 64 yet. Use byte* for tmp_mask instead routine
 			//First step: instantiate gate and assign random masks to it
-			InstantiateGate(gate);
+			InstantiateGate(gate, m_vTTGates[i][g]);
 			m_vTableRnd[i][outs_id]->GetBits((uint8_t*) gate->gs.val, m_nTableRndIdx[i][outs_id], gate->nvals);
 			m_nTableRndIdx[i][outs_id] += (gate->nvals);
 
@@ -1125,7 +1148,7 @@ void SetupLUT::ReceiverEvaluateTTGates() {
 
 			uint32_t outs_id = m_vOutBitMapping[nparents][out_bits];
 
-			InstantiateGate(gate);
+			InstantiateGate(gate, m_vTTGates[i][g]);
 
 			//Form the choice from the input values
 			for(uint32_t n = 0; n < nvals; n++) {
@@ -1192,7 +1215,7 @@ void SetupLUT::AssignInputShares() {
 	GATE* gate;
 	for (uint32_t i = 0, j, rcvshareidx = 0, bitstocopy, len; i < m_vInputShareGates.size(); i++) {
 		gate = m_pGates + m_vInputShareGates[i];
-		InstantiateGate(gate);
+		InstantiateGate(gate, m_vInputShareGates[i]);
 
 		bitstocopy = gate->nvals;
 		for (j = 0; j < ceil_divide(gate->nvals, GATE_T_BITS); j++, bitstocopy -= GATE_T_BITS) {
@@ -1211,7 +1234,7 @@ void SetupLUT::AssignOutputShares() {
 	for (uint32_t i = 0, j, rcvshareidx = 0, bitstocopy, len, parentid; i < m_vOutputShareGates.size(); i++) {
 		gate = m_pGates + m_vOutputShareGates[i];
 		parentid = gate->ingates.inputs.parent;
-		InstantiateGate(gate);
+		InstantiateGate(gate, m_vOutputShareGates[i]);
 
 		bitstocopy = gate->nvals;
 		for (j = 0; j < ceil_divide(gate->nvals, GATE_T_BITS); j++, bitstocopy -= GATE_T_BITS) {
@@ -1416,8 +1439,8 @@ void SetupLUT::GetBuffersToReceive(vector<BYTE*>& rcvbuf, vector<uint64_t>& rcvb
 	}
 }
 
-inline void SetupLUT::InstantiateGate(GATE* gate) {
-	gate->gs.val = (UGATE_T*) calloc((ceil_divide(gate->nvals, GATE_T_BITS)), sizeof(UGATE_T));
+inline void SetupLUT::InstantiateGate(GATE* gate, uint32_t gateid) {
+	gate->gs.val = (UGATE_T*) AllocGateValue(gate, gateid, GetGateValueBytes(gate));
 	gate->instantiated = true;
 }
 
@@ -1437,7 +1460,7 @@ void SetupLUT::EvaluateSIMDGate(uint32_t gateid) {
 
 		uint32_t* input = gate->ingates.inputs.parents;
 		uint32_t nparents = gate->ingates.ningates;
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 		CBitVector tmp;
 
 		tmp.AttachBuf((uint8_t*) gate->gs.val, (int) ceil_divide(vsize, 8));
@@ -1462,7 +1485,7 @@ void SetupLUT::EvaluateSIMDGate(uint32_t gateid) {
 #endif
 		uint32_t pos = gate->gs.sinput.pos;
 		uint32_t idparent = gate->ingates.inputs.parent;
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 		//TODO: optimize
 		for (uint32_t i = 0; i < vsize; i++) {
 			gate->gs.val[i / GATE_T_BITS] |= ((m_pGates[idparent].gs.val[(pos + i) / GATE_T_BITS] >> ((pos + i) % GATE_T_BITS)) & 0x1) << (i % GATE_T_BITS);
@@ -1474,7 +1497,7 @@ void SetupLUT::EvaluateSIMDGate(uint32_t gateid) {
 		cout << " which is a REPEATER gate" << endl;
 #endif
 		uint32_t idparent = gate->ingates.inputs.parent;
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 
 		BYTE byte_val = m_pGates[idparent].gs.val[0] ? MAX_BYTE : ZERO_BYTE;
 		memset(gate->gs.val, byte_val, sizeof(UGATE_T) * ceil_divide(vsize, GATE_T_BITS));
@@ -1487,7 +1510,7 @@ void SetupLUT::EvaluateSIMDGate(uint32_t gateid) {
 		uint32_t* inputs = gate->ingates.inputs.parents;
 		uint32_t* posids = gate->gs.perm.posids;
 
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 
 		//TODO: there might be a problem here since some bits might not be set to zero
 		memset(gate->gs.val, 0x00, ceil_divide(vsize, 8));
@@ -1506,7 +1529,7 @@ void SetupLUT::EvaluateSIMDGate(uint32_t gateid) {
 		uint32_t* combinepos = gate->ingates.inputs.parents; //gate->gs.combinepos.input;
 		uint32_t arraypos = gate->gs.combinepos.pos / GATE_T_BITS;
 		uint32_t bitpos = gate->gs.combinepos.pos % GATE_T_BITS;
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 		//TODO: there might be a problem here since some bits might not be set to zero
 		memset(gate->gs.val, 0x00, ceil_divide(vsize, 8));
 		//TODO: Optimize
@@ -1525,7 +1548,7 @@ void SetupLUT::EvaluateSIMDGate(uint32_t gateid) {
 		bool del_pos = gate->gs.sub_pos.copy_posids;
 		uint32_t arraypos;
 		uint32_t bitpos;
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 		memset(gate->gs.val, 0x00, ceil_divide(vsize, 8));
 		UGATE_T* valptr = m_pGates[idparent].gs.val;
 		for (uint32_t i = 0; i < vsize; i++) {
@@ -1553,7 +1576,7 @@ void SetupLUT::EvaluateSIMDGate(uint32_t gateid) {
 		uint32_t pos_incr = gate->gs.struct_comb.pos_incr;
 		uint32_t ninputs = gate->gs.struct_comb.num_in_gates;
 
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 
 		//TODO: there might be a problem here since some bits might not be set to zero
 		memset(gate->gs.val, 0x00, ceil_divide(vsize, 8));
@@ -1735,7 +1758,8 @@ void SetupLUT::Reset() {
 	m_vInputShareRcvBuf.delCBitVector();
 	m_vOutputShareRcvBuf.delCBitVector();
 
-	m_cBoolCircuit->Reset();
+	if (!m_cBoolCircuit->IsCompiled())
+		m_cBoolCircuit->Reset();
 
 	for(uint32_t i = 0; i < m_vTTGates.size(); i++) {
 		m_vTTGates[i].clear();
@@ -83,7 +83,10 @@ public:
 		return;
 	}
 
-	inline void InstantiateGate(GATE* gate);
+	inline void InstantiateGate(GATE* gate, uint32_t gateid);
+	uint64_t GetGateValueBytes(GATE* gate) {
+		return ceil_divide(gate->nvals, GATE_T_BITS) * sizeof(UGATE_T);
+	}
 
 	void GetDataToSend(vector<BYTE*>& sendbuf, vector<uint64_t>& bytesize);
 	void GetBuffersToReceive(vector<BYTE*>& rcvbuf, vector<uint64_t>& rcvbytes);
@@ -287,6 +290,10 @@ private:
 	 * Receiver routine for evaluating truth-table gates
 	 */
 	inline void ReceiverEvaluateTTGates();
+	/**
+	 Transfers the precomputed OTs and the table randomness to or from the precomputation file.
+	 */
+	BOOL PreCompValues();
 	/**
 	 Method for initialising.
 	 */
@@ -91,6 +91,12 @@ void YaoClientSharing::PrepareSetupPhase(ABYSetup* setup) {
 	cout << "OT Choice bits: " << endl;
 	m_vChoiceBits.Print(0, m_nClientInputBits + m_nConversionInputBits);
 #endif
+	//the garbled circuit was received by an earlier execution
+	m_bPreCompRead = GetPreCompPhaseValue() == ePreCompRead && ReadPreCompValues(setup);
+	if (m_bPreCompRead) {
+		return;
+	}
+
 	/* Use the standard XORMasking function */
 
 	/* Define the new OT tasks that will be done when the setup phase is performed*/
@@ -109,7 +115,7 @@ void YaoClientSharing::PrepareSetupPhase(ABYSetup* setup) {
 
 /* If played as server send the garbled table, if played as client receive the garbled table */
 void YaoClientSharing::PerformSetupPhase(ABYSetup* setup) {
-	if (m_cBoolCircuit->GetMaxDepth() == 0)
+	if (m_cBoolCircuit->GetMaxDepth() == 0 || m_bPreCompRead)
 		return;
 	ReceiveGarbledCircuitAndOutputShares(setup);
 }
@@ -147,6 +153,14 @@ void YaoClientSharing::FinishSetupPhase(ABYSetup* setup) {
 	cout << "Resulting R from OT: ";
 	m_vROTMasks.PrintHex();
 #endif
+	if (GetPreCompPhaseValue() == ePreCompStore && m_cBoolCircuit->GetMaxDepth() > 0) {
+		StorePreCompValues();
+	}
+}
+
+BOOL YaoClientSharing::PreCompValues() {
+	return PreCompBuf(m_vGarbledCircuit.GetArr(), ((uint64_t) m_nANDGates) * m_nSecParamBytes * KEYS_PER_GATE_IN_TABLE)
+			&& PreCompBuf(m_vOutputShareRcvBuf) && PreCompBuf(m_vChoiceBits) && PreCompBuf(m_vROTMasks);
 }
 void YaoClientSharing::EvaluateLocalOperations(uint32_t depth) {
 
@@ -157,11 +171,11 @@ void YaoClientSharing::EvaluateLocalOperations(uint32_t depth) {
 		GATE* gate = m_pGates + localops[i];
 		//cout << "Evaluating gate " << localops[i] << " with context = " << gate->context << endl;
 		if (gate->type == G_LIN) {
-			EvaluateXORGate(gate);
+			EvaluateXORGate(localops[i]);
 		} else if (gate->type == G_NON_LIN) {
-			EvaluateANDGate(gate);
+			EvaluateANDGate(localops[i]);
 		} else if (gate->type == G_CONSTANT) {
-			InstantiateGate(gate);
+			InstantiateGate(gate, localops[i]);
 			memset(gate->gs.yval, 0, m_nSecParamBytes * gate->nvals);
 		} else if (IsSIMDGate(gate->type)) {
 			//cout << "Evaluating SIMD gate" << endl;
@@ -169,12 +183,12 @@ void YaoClientSharing::EvaluateLocalOperations(uint32_t depth) {
 		} else if (gate->type == G_INV) {
 			//only copy values, SERVER did the inversion
 			uint32_t parentid = gate->ingates.inputs.parent; // gate->gs.invinput;
-			InstantiateGate(gate);
+			InstantiateGate(gate, localops[i]);
 			memcpy(gate->gs.yval, m_pGates[parentid].gs.yval, m_nSecParamBytes * gate->nvals);
 			UsedGate(parentid);
 		} else if (gate->type == G_SHARED_OUT) {
 			GATE* parent = m_pGates + gate->ingates.inputs.parent;
-			InstantiateGate(gate);
+			InstantiateGate(gate, localops[i]);
 			memcpy(gate->gs.yval, parent->gs.yval, gate->nvals * m_nSecParamBytes);
 			UsedGate(gate->ingates.inputs.parent);
 			// TODO this currently copies both keys and bits and getclearvalue will probably fail.
@@ -241,12 +255,13 @@ void YaoClientSharing::EvaluateInteractiveOperations(uint32_t depth) {
 	}
 }
 
-void YaoClientSharing::EvaluateXORGate(GATE* gate) {
+void YaoClientSharing::EvaluateXORGate(uint32_t gateid) {
+	GATE* gate = m_pGates + gateid;
 	uint32_t nvals = gate->nvals;
 	uint32_t idleft = gate->ingates.inputs.twin.left; //gate->gs.ginput.left;
 	uint32_t idright = gate->ingates.inputs.twin.right; //gate->gs.ginput.right;
 
-	InstantiateGate(gate);
+	InstantiateGate(gate, gateid);
 	//TODO: optimize for UINT64_T pointers, there might be some problems here, code is untested
 	/*for(uint32_t i = 0; i < m_nSecParamBytes * nvals; i++) {
 	 gate->gs.yval[i] = m_pGates[idleft].gs.yval[i] ^ m_pGates[idright].gs.yval[i];
@@ -270,14 +285,15 @@ void YaoClientSharing::EvaluateXORGate(GATE* gate) {
 	UsedGate(idright);
 }
 
-void YaoClientSharing::EvaluateANDGate(GATE* gate) {
+void YaoClientSharing::EvaluateANDGate(uint32_t gateid) {
+	GATE* gate = m_pGates + gateid;
 	uint32_t idleft = gate->ingates.inputs.twin.left; //gate->gs.ginput.left;
 	uint32_t idright = gate->ingates.inputs.twin.right; //gate->gs.ginput.right;
 	GATE* gleft = m_pGates + idleft;
 	GATE* gright = m_pGates + idright;
 
 	//evaluate garbled table
-	InstantiateGate(gate);
+	InstantiateGate(gate, gateid);
 	for (uint32_t g = 0; g < gate->nvals; g++) {
 		EvaluateGarbledTable(gate, g, gleft, gright);
 		m_nGarbledTableCtr++;
@@ -352,7 +368,7 @@ void YaoClientSharing::EvaluateClientOutputGate(uint32_t gateid) {
 	GATE* gate = m_pGates + gateid;
 	uint32_t parentid = gate->ingates.inputs.parent; //gate->gs.oshare.parentgate;
 	uint32_t in;
-	InstantiateGate(gate);
+	InstantiateGate(gate, gateid);
 
 #ifdef DEBUGYAOCLIENT
 	cout << "ClientOutput: ";
@@ -543,7 +559,7 @@ void YaoClientSharing::AssignServerInputKeys() {
 	GATE* gate;
 	for (uint32_t i = 0, offset = 0; i < m_vServerInputGates.size(); i++) {
 		gate = m_pGates + m_vServerInputGates[i];
-		InstantiateGate(gate);
+		InstantiateGate(gate, m_vServerInputGates[i]);
 		//Assign the keys to the gate
 		memcpy(gate->gs.yval, m_vServerInputKeys.GetArr() + offset, m_nSecParamBytes * gate->nvals);
 		offset += (m_nSecParamBytes * gate->nvals);
@@ -565,7 +581,7 @@ void YaoClientSharing::AssignClientInputKeys() {
 		gate = m_pGates + m_vClientRcvInputKeyGates[i];
 		//input = ;
 
-		InstantiateGate(gate);
+		InstantiateGate(gate, m_vClientRcvInputKeyGates[i]);
 		//Assign the keys to the gate, TODO XOR with R-OT masks
 		for (uint32_t j = 0; j < gate->nvals; j++, m_nKeyInputRcvIdx++, offset++) {
 			m_pKeyOps->XOR(gate->gs.yval + j * m_nSecParamBytes,
@@ -594,9 +610,9 @@ void YaoClientSharing::AssignClientInputKeys() {
 	m_nClientRcvKeyCtr = 0;
 }
 
-void YaoClientSharing::InstantiateGate(GATE* gate) {
+void YaoClientSharing::InstantiateGate(GATE* gate, uint32_t gateid) {
 	gate->instantiated = true;
-	gate->gs.yval = (BYTE*) calloc(m_nSecParamIters * gate->nvals, sizeof(UGATE_T));
+	gate->gs.yval = AllocGateValue(gate, gateid, m_nSecParamIters * gate->nvals * sizeof(UGATE_T));
 }
 
 void YaoClientSharing::EvaluateSIMDGate(uint32_t gateid) {
@@ -606,7 +622,7 @@ void YaoClientSharing::EvaluateSIMDGate(uint32_t gateid) {
 		uint32_t nparents = gate->ingates.ningates;
 		uint32_t parent_nvals;
 
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 		BYTE* keyptr = gate->gs.yval;
 		for (uint32_t g = 0; g < nparents; g++) {
 			parent_nvals = m_pGates[inptr[g]].nvals;
@@ -618,12 +634,12 @@ void YaoClientSharing::EvaluateSIMDGate(uint32_t gateid) {
 	} else if (gate->type == G_SPLIT) {
 		uint32_t pos = gate->gs.sinput.pos;
 		uint32_t idleft = gate->ingates.inputs.parent; // gate->gs.sinput.input;
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 		memcpy(gate->gs.yval, m_pGates[idleft].gs.yval + pos * m_nSecParamBytes, m_nSecParamBytes * gate->nvals);
 		UsedGate(idleft);
 	} else if (gate->type == G_REPEAT) {
 		uint32_t idleft = gate->ingates.inputs.parent; //gate->gs.rinput;
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 		BYTE* keyptr = gate->gs.yval;
 		for (uint32_t g = 0; g < gate->nvals; g++, keyptr += m_nSecParamBytes) {
 			memcpy(keyptr, m_pGates[idleft].gs.yval, m_nSecParamBytes);
@@ -632,7 +648,7 @@ void YaoClientSharing::EvaluateSIMDGate(uint32_t gateid) {
 	} else if (gate->type == G_COMBINEPOS) {
 		uint32_t* combinepos = gate->ingates.inputs.parents; //gate->gs.combinepos.input;
 		uint32_t pos = gate->gs.combinepos.pos;
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 		BYTE* keyptr = gate->gs.yval;
 		for (uint32_t g = 0; g < gate->nvals; g++, keyptr += m_nSecParamBytes) {
 			uint32_t idleft = combinepos[g];
@@ -651,7 +667,7 @@ void YaoClientSharing::EvaluateSIMDGate(uint32_t gateid) {
 		uint32_t* positions = gate->gs.sub_pos.posids; //gate->gs.combinepos.input;
 		bool del_pos = gate->gs.sub_pos.copy_posids;
 
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 		BYTE* keyptr = gate->gs.yval;
 		for (uint32_t g = 0; g < gate->nvals; g++, keyptr += m_nSecParamBytes) {
 			memcpy(keyptr, m_pGates[idparent].gs.yval + positions[g] * m_nSecParamBytes, m_nSecParamBytes);
@@ -758,5 +774,6 @@ void YaoClientSharing::Reset() {
 	m_vGarbledCircuit.delCBitVector();
 	m_nGarbledTableCtr = 0;
 
-	m_cBoolCircuit->Reset();
+	if (!m_cBoolCircuit->IsCompiled())
+		m_cBoolCircuit->Reset();
 }
@@ -52,7 +52,7 @@ public:
 
 	void PrepareOnlinePhase();
 
-	void InstantiateGate(GATE* gate);
+	void InstantiateGate(GATE* gate, uint32_t gateid);
 
 	void GetDataToSend(vector<BYTE*>& sendbuf, vector<uint64_t>& bytesize);
 	void GetBuffersToReceive(vector<BYTE*>& rcvbuf, vector<uint64_t>& rcvbytes);
@@ -121,16 +121,16 @@ private:
 
 	/**
 	 Method for evaluating XOR gate for the inputted
-	 gate object.
-	 \param gate		Gate Object
+	 gateid.
+	 \param gateid		Gate identifier
 	 */
-	void EvaluateXORGate(GATE* gate);
+	void EvaluateXORGate(uint32_t gateid);
 	/**
 	 Method for evaluating AND gate for the inputted
-	 gate object.
-	 \param gate		Gate Object
+	 gateid.
+	 \param gateid		Gate identifier
 	 */
-	void EvaluateANDGate(GATE* gate);
+	void EvaluateANDGate(uint32_t gateid);
 	/**
 	 Method for evaluating garbled table.
 	 \param gate	gate Object.
@@ -172,6 +172,10 @@ private:
 	 \param setup 	ABYSetup Object.
 	 */
 	void ReceiveGarbledCircuitAndOutputShares(ABYSetup* setup);
+	/**
+	 Transfers the garbled circuit, the output shares and the random OTs to or from the precomputation file.
+	 */
+	BOOL PreCompValues();
 };
 
 #endif /* __YAOCLIENTSHARING_H__ */
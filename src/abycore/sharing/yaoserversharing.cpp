@@ -128,6 +128,12 @@ void YaoServerSharing::PrepareSetupPhase(ABYSetup* setup) {
 	m_nOutputDestionationsCtr = 0;
 	//deque<uint32_t> out = m_cBoolCircuit->GetOutputGatesForParty(CLIENT);
 
+	//the circuit was garbled by an earlier execution and the client holds the garbled tables
+	m_bPreCompRead = GetPreCompPhaseValue() == ePreCompRead && ReadPreCompValues(setup);
+	if (m_bPreCompRead) {
+		return;
+	}
+
 	IKNP_OTTask* task = (IKNP_OTTask*) malloc(sizeof(IKNP_OTTask));
 	task->bitlen = symbits;
 	task->snd_flavor = Snd_R_OT;
@@ -144,7 +150,7 @@ void YaoServerSharing::PrepareSetupPhase(ABYSetup* setup) {
 /*  send the garbled table */
 void YaoServerSharing::PerformSetupPhase(ABYSetup* setup) {
 	/* If no gates were built, return */
-	if (m_cBoolCircuit->GetMaxDepth() == 0)
+	if (m_cBoolCircuit->GetMaxDepth() == 0 || m_bPreCompRead)
 		return;
 
 	CreateAndSendGarbledCircuit(setup);
@@ -183,6 +189,9 @@ void YaoServerSharing::FinishSetupPhase(ABYSetup* setup) {
 		m_pGates[incligates[i]].gs.ishare.src = CLIENT;
 	}
 
+	if (GetPreCompPhaseValue() == ePreCompStore) {
+		StorePreCompValues();
+	}
 
 
 #ifdef DEBUGYAOSERVER
@@ -362,9 +371,9 @@ void YaoServerSharing::PrecomputeGC(deque<uint32_t>& queue, ABYSetup* setup) {
 		assert(gate->nvals > 0 && gate->sharebitlen == 1);
 
 		if (gate->type == G_LIN) {
-			EvaluateXORGate(gate);
+			EvaluateXORGate(queue[i]);
 		} else if (gate->type == G_NON_LIN) {
-			EvaluateANDGate(gate, setup);
+			EvaluateANDGate(queue[i], setup);
 		} else if (gate->type == G_IN) {
 			EvaluateInputGate(queue[i]);
 		} else if (gate->type == G_OUT) {
@@ -383,7 +392,7 @@ void YaoServerSharing::PrecomputeGC(deque<uint32_t>& queue, ABYSetup* setup) {
 		} else if (gate->type == G_CONSTANT) {
 			//assign 0 and 1 gates
 			UGATE_T constval = gate->gs.constval;
-			InstantiateGate(gate);
+			InstantiateGate(gate, queue[i]);
 			memset(gate->gs.yinput.outKey, 0, m_nSecParamBytes * gate->nvals);
 			for(uint32_t i = 0; i < gate->nvals; i++) {
 				gate->gs.yinput.pi[i] = (constval>>i) & 0x01;
@@ -396,12 +405,12 @@ void YaoServerSharing::PrecomputeGC(deque<uint32_t>& queue, ABYSetup* setup) {
 		} else if (IsSIMDGate(gate->type)) {
 			EvaluateSIMDGate(queue[i]);
 		} else if (gate->type == G_INV) {
-			EvaluateInversionGate(gate);
+			EvaluateInversionGate(queue[i]);
 		} else if (gate->type == G_CALLBACK) {
 			EvaluateCallbackGate(queue[i]);
 		} else if (gate->type == G_SHARED_OUT) {
 			GATE* parent = m_pGates + gate->ingates.inputs.parent;
-			InstantiateGate(gate);
+			InstantiateGate(gate, queue[i]);
 			memcpy(gate->gs.yinput.outKey, parent->gs.yinput.outKey, gate->nvals * m_nSecParamBytes);
 			memcpy(gate->gs.yinput.pi, parent->gs.yinput.pi, gate->nvals);
 			UsedGate(gate->ingates.inputs.parent);
@@ -420,10 +429,11 @@ void YaoServerSharing::PrecomputeGC(deque<uint32_t>& queue, ABYSetup* setup) {
 	}
 }
 
-void YaoServerSharing::EvaluateInversionGate(GATE* gate) {
+void YaoServerSharing::EvaluateInversionGate(uint32_t gateid) {
+	GATE* gate = m_pGates + gateid;
 	uint32_t parentid = gate->ingates.inputs.parent;
-	InstantiateGate(gate);
-	assert((gate - m_pGates) > parentid);
+	InstantiateGate(gate, gateid);
+	assert(gateid > parentid);
 	memcpy(gate->gs.yinput.outKey, m_pGates[parentid].gs.yinput.outKey, m_nSecParamBytes * gate->nvals);
 	for (uint32_t i = 0; i < gate->nvals; i++) {
 		gate->gs.yinput.pi[i] = m_pGates[parentid].gs.yinput.pi[i] ^ 0x01;
@@ -444,7 +454,7 @@ void YaoServerSharing::EvaluateInputGate(uint32_t gateid) {
 			ingatevals.inval = gate->gs.ishare.inval;
 			m_vPreSetInputGates.push_back(ingatevals);
 		}
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 
 		memcpy(gate->gs.yinput.outKey, m_vServerInputKeys.GetArr() + m_nPermBitCtr * m_nSecParamBytes, m_nSecParamBytes * gate->nvals);
 		for (uint32_t i = 0; i < gate->nvals; i++) {
@@ -452,7 +462,7 @@ void YaoServerSharing::EvaluateInputGate(uint32_t gateid) {
 			m_nPermBitCtr++;
 		}
 	} else {
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 
 		memcpy(gate->gs.yinput.outKey, m_vClientInputKeys.GetArr() + m_nClientInBitCtr * m_nSecParamBytes, m_nSecParamBytes * gate->nvals);
 		memset(gate->gs.yinput.pi, 0, gate->nvals);
@@ -473,7 +483,7 @@ void YaoServerSharing::EvaluateConversionGate(uint32_t gateid) {
 	GATE* gate = m_pGates + gateid;
 	GATE* parent = m_pGates + gate->ingates.inputs.parents[0];
 	uint32_t pos = gate->gs.pos;
-	InstantiateGate(gate);
+	InstantiateGate(gate, gateid);
 
 	if (parent->context == S_BOOL) {
 		memcpy(gate->gs.yinput.outKey, m_vClientInputKeys.GetArr() + m_nClientInBitCtr * m_nSecParamBytes, m_nSecParamBytes * gate->nvals);
@@ -535,7 +545,8 @@ void YaoServerSharing::EvaluateConversionGate(uint32_t gateid) {
 }
 
 //TODO: optimize for UINT64_T pointers
-void YaoServerSharing::EvaluateXORGate(GATE* gate) {
+void YaoServerSharing::EvaluateXORGate(uint32_t gateid) {
+	GATE* gate = m_pGates + gateid;
 	uint32_t idleft = gate->ingates.inputs.twin.left; //gate->gs.ginput.left;
 	uint32_t idright = gate->ingates.inputs.twin.right; //gate->gs.ginput.right;
 
@@ -544,7 +555,7 @@ void YaoServerSharing::EvaluateXORGate(GATE* gate) {
 
 	BYTE* lkey = (m_pGates + idleft)->gs.yinput.outKey;
 	BYTE* rkey = (m_pGates + idright)->gs.yinput.outKey;
-	InstantiateGate(gate);
+	InstantiateGate(gate, gateid);
 
 	BYTE* gpi = gate->gs.yinput.pi;
 	BYTE* gkey = gate->gs.yinput.outKey;
@@ -574,14 +585,15 @@ void YaoServerSharing::EvaluateXORGate(GATE* gate) {
 }
 
 //Evaluate an AND gate
-void YaoServerSharing::EvaluateANDGate(GATE* gate, ABYSetup* setup) {
+void YaoServerSharing::EvaluateANDGate(uint32_t gateid, ABYSetup* setup) {
+	GATE* gate = m_pGates + gateid;
 	uint32_t idleft = gate->ingates.inputs.twin.left;//gate->gs.ginput.left;
 	uint32_t idright = gate->ingates.inputs.twin.right;//gate->gs.ginput.right;
 
 	GATE* gleft = m_pGates + idleft;
 	GATE* gright = m_pGates + idright;
 
-	InstantiateGate(gate);
+	InstantiateGate(gate, gateid);
 
 	for(uint32_t g = 0; g < gate->nvals; g++) {
 		CreateGarbledTable(gate, g, gleft, gright);
@@ -712,6 +724,59 @@ void YaoServerSharing::CollectClientOutputShares() {
 	}
 }
 
+//Besides the keys, the online phase needs the output shares of the server and the keys of all gates that are still in use
+//after garbling, which are the gates that are converted into another sharing. Their ids are stored in the file.
+BOOL YaoServerSharing::PreCompValues() {
+	uint32_t noutgates = m_cBoolCircuit->GetOutputGatesForParty(CLIENT).size() + m_cBoolCircuit->GetOutputGatesForParty(SERVER).size();
+	uint32_t maxdepth = m_cBoolCircuit->GetMaxDepth();
+	vector<uint32_t> outgates, livegates;
+	uint32_t nlive;
+	GATE* gate;
+
+	BOOL success = PreCompBuf(m_vR) && PreCompBuf(m_vPermBits) && PreCompBuf(m_vROTMasks[0]) && PreCompBuf(m_vROTMasks[1])
+			&& PreCompBuf(m_vServerInputKeys) && PreCompBuf(m_vClientInputKeys)
+			&& PreCompBuf((BYTE*) m_vOutputDestionations, sizeof(e_role) * noutgates);
+
+	for (uint32_t i = 0; i < maxdepth; i++) {
+		for (uint32_t j = 0; j < 2; j++) {
+			deque<uint32_t> queue = j == 0 ? m_cBoolCircuit->GetLocalQueueOnLvl(i) : m_cBoolCircuit->GetInteractiveQueueOnLvl(i);
+			for (uint32_t k = 0; k < queue.size(); k++) {
+				gate = m_pGates + queue[k];
+				if (gate->type == G_OUT) {
+					outgates.push_back(queue[k]);
+				} else if (m_ePreCompDir == PRECOMP_WRITE && gate->instantiated && gate->nused > 0 && gate->type != G_IN
+						&& gate->type != G_CONV) {
+					livegates.push_back(queue[k]);
+				}
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < outgates.size() && success; i++) {
+		gate = m_pGates + outgates[i];
+		if (m_ePreCompDir == PRECOMP_READ) {
+			gate->gs.val = (UGATE_T*) calloc(ceil_divide(gate->nvals, GATE_T_BITS), sizeof(UGATE_T));
+			gate->instantiated = true;
+		}
+		success = PreCompBuf((BYTE*) gate->gs.val, ceil_divide(gate->nvals, GATE_T_BITS) * sizeof(UGATE_T));
+	}
+
+	nlive = livegates.size();
+	success = success && PreCompNum(nlive);
+	livegates.resize(success ? nlive : 0);
+	for (uint32_t i = 0; i < livegates.size() && success; i++) {
+		success = PreCompNum(livegates[i]) && livegates[i] < m_pCircuit->GetGateHead();
+		gate = m_pGates + livegates[i];
+		success = success && gate->context == m_eContext;
+		if (success && m_ePreCompDir == PRECOMP_READ) {
+			InstantiateGate(gate, livegates[i]);
+		}
+		success = success && PreCompBuf((BYTE*) &(gate->nused), sizeof(uint32_t))
+				&& PreCompBuf(gate->gs.yinput.outKey, m_nSecParamBytes * gate->nvals) && PreCompBuf(gate->gs.yinput.pi, gate->nvals);
+	}
+	return success;
+}
+
 void YaoServerSharing::EvaluateOutputGate(GATE* gate) {
 	uint32_t parentid = gate->ingates.inputs.parent;
 
@@ -924,13 +989,10 @@ void YaoServerSharing::CreateRandomWireKeys(CBitVector& vec, uint32_t numkeys) {
 #endif
 }
 
-void YaoServerSharing::InstantiateGate(GATE* gate) {
-	gate->gs.yinput.outKey = (BYTE*) malloc(sizeof(UGATE_T) * m_nSecParamIters * gate->nvals);
-	gate->gs.yinput.pi = (BYTE*) malloc(sizeof(BYTE) * gate->nvals);
-	if (gate->gs.yinput.outKey == NULL) {
-		cerr << "Memory allocation not successful at Yao gate instantiation" << endl;
-		exit(0);
-	}
+void YaoServerSharing::InstantiateGate(GATE* gate, uint32_t gateid) {
+	//the keys are overwritten when the gate is evaluated
+	gate->gs.yinput.outKey = AllocGateValue(gate, gateid, sizeof(UGATE_T) * m_nSecParamIters * gate->nvals, false);
+	gate->gs.yinput.pi = AllocGateValue(gate, gateid, sizeof(BYTE) * gate->nvals, false);
 	gate->instantiated = true;
 }
 
@@ -940,7 +1002,7 @@ void YaoServerSharing::EvaluateSIMDGate(uint32_t gateid) {
 		uint32_t* inptr = gate->ingates.inputs.parents; //gate->gs.cinput;
 		uint32_t nparents = gate->ingates.ningates;
 		uint32_t parent_nvals;
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 		BYTE* keyptr = gate->gs.yinput.outKey;
 		BYTE* piptr = gate->gs.yinput.pi;
 		for(uint32_t g = 0; g < nparents; g++) {
@@ -957,13 +1019,13 @@ void YaoServerSharing::EvaluateSIMDGate(uint32_t gateid) {
 	} else if (gate->type == G_SPLIT) {
 		uint32_t pos = gate->gs.sinput.pos;
 		uint32_t idleft = gate->ingates.inputs.parent; //gate->gs.sinput.input;
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 		memcpy(gate->gs.yinput.outKey, m_pGates[idleft].gs.yinput.outKey + pos * m_nSecParamBytes, m_nSecParamBytes * gate->nvals);
 		memcpy(gate->gs.yinput.pi, m_pGates[idleft].gs.yinput.pi + pos, gate->nvals);
 		UsedGate(idleft);
 	} else if (gate->type == G_REPEAT) {
 		uint32_t idleft = gate->ingates.inputs.parent; //gate->gs.rinput;
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 		BYTE* keyptr = gate->gs.yinput.outKey;
 		for (uint32_t g = 0; g < gate->nvals; g++, keyptr += m_nSecParamBytes) {
 			memcpy(keyptr, m_pGates[idleft].gs.yinput.outKey, m_nSecParamBytes);
@@ -974,7 +1036,7 @@ void YaoServerSharing::EvaluateSIMDGate(uint32_t gateid) {
 	} else if (gate->type == G_COMBINEPOS) {
 		uint32_t* combinepos = gate->ingates.inputs.parents; //gate->gs.combinepos.input;
 		uint32_t pos = gate->gs.combinepos.pos;
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 		BYTE* keyptr = gate->gs.yinput.outKey;
 		for (uint32_t g = 0; g < gate->nvals; g++, keyptr += m_nSecParamBytes) {
 			uint32_t idleft = combinepos[g];
@@ -989,7 +1051,7 @@ void YaoServerSharing::EvaluateSIMDGate(uint32_t gateid) {
 		uint32_t* positions = gate->gs.sub_pos.posids; //gate->gs.combinepos.input;
 		bool del_pos = gate->gs.sub_pos.copy_posids;
 
-		InstantiateGate(gate);
+		InstantiateGate(gate, gateid);
 		BYTE* keyptr = gate->gs.yinput.outKey;
 		for (uint32_t g = 0; g < gate->nvals; g++, keyptr += m_nSecParamBytes) {
 			memcpy(keyptr, m_pGates[idparent].gs.yinput.outKey + positions[g] * m_nSecParamBytes, m_nSecParamBytes);
@@ -1102,5 +1164,6 @@ void YaoServerSharing::Reset() {
 	m_nGarbledTableSndCtr = 0L;
 
 
-	m_cBoolCircuit->Reset();
+	if (!m_cBoolCircuit->IsCompiled())
+		m_cBoolCircuit->Reset();
 }
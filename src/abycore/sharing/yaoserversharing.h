@@ -57,7 +57,7 @@ public:
 
 	void PrepareOnlinePhase();
 
-	void InstantiateGate(GATE* gate);
+	void InstantiateGate(GATE* gate, uint32_t gateid);
 
 	void GetDataToSend(vector<BYTE*>& sendbuf, vector<uint64_t>& bytesize);
 	void GetBuffersToReceive(vector<BYTE*>& rcvbuf, vector<uint64_t>& rcvbytes);
@@ -147,16 +147,16 @@ private:
 	void EvaluateInputGate(uint32_t gateid);
 	/**
 	 Method for evaluating XOR gate for the inputted
-	 gate object.
-	 \param gate		Gate Object
+	 gateid.
+	 \param gateid		Gate identifier
 	 */
-	void EvaluateXORGate(GATE* gate);
+	void EvaluateXORGate(uint32_t gateid);
 	/**
 	 Method for evaluating AND gate for the inputted
-	 gate object.
-	 \param gate		Gate Object
+	 gateid.
+	 \param gateid		Gate identifier
 	 */
-	void EvaluateANDGate(GATE* gate, ABYSetup* setup);
+	void EvaluateANDGate(uint32_t gateid, ABYSetup* setup);
 	/**
 	 Method for evaluating SIMD gate for the inputted
 	 gateid.
@@ -165,10 +165,10 @@ private:
 	void EvaluateSIMDGate(uint32_t gateid);
 	/**
 	 Method for evaluating Inversion gate for the inputted
-	 gate object.
-	 \param gate		Gate Object
+	 gateid.
+	 \param gateid		Gate identifier
 	 */
-	void EvaluateInversionGate(GATE* gate);
+	void EvaluateInversionGate(uint32_t gateid);
 	/**
 	 Method for evaluating conversion gate for the inputted
 	 gateid.
@@ -192,6 +192,11 @@ private:
 
 	//void EvaluateClientOutputGate(GATE* gate);
 	void CollectClientOutputShares();
+	/**
+	 Transfers the keys, the output shares of the server and the keys of the gates that are converted into another
+	 sharing to or from the precomputation file.
+	 */
+	BOOL PreCompValues();
 	/**
 	 Method for evaluating Output gate for the inputted
 	 gate object.
@@ -22,6 +22,11 @@
 #include "../aes/common/aescircuit.h"
 //ABY Party class
 #include "../../abycore/aby/abyparty.h"
+#include "../../abycore/aby/protocolplanner.h"
+#include <sys/resource.h>
+
+//number of gates that the gate layout benchmark builds if no number of operations is given
+#define BENCH_LAYOUT_GATES 4194304
 
 static const uint32_t m_vBitLens[] = {8, 16, 32, 64};
 
@@ -34,11 +39,15 @@ static const aby_ops_t m_tBenchOps[] = { { OP_XOR, S_BOOL, "xorbool" }, { OP_AND
 		{ OP_B2Y, S_BOOL, "b2y" }, { OP_A2Y, S_ARITH, "a2y" }, { OP_ADD, S_YAO_REV, "addyaoipp" }, { OP_MUL, S_YAO_REV, "mulyaoipp" },
 		{ OP_ADD, S_SPLUT, "addsplut"}, { OP_CMP, S_SPLUT, "cmpsplut"}, { OP_EQ, S_SPLUT, "eqsplut"},	{ OP_SBOX, S_SPLUT, "sboxlut" }};
 
+//operations that are built with the same gates as the ProtocolPlanner uses and thus go into the cost model
+static const string m_vCostModelOps[] = { "xorbool", "andbool", "adddobool", "mulsobool", "cmpdobool", "eqbool", "muxbool",
+		"xoryao", "andyao", "addyao", "mulyao", "cmpyao", "eqyao", "muxyao", "addarith", "mularith", "y2b", "b2a", "b2y", "a2y" };
+
 int32_t read_test_options(int32_t* argcp, char*** argvp, e_role* role, int32_t* bitlen, uint32_t* secparam,
 		string* address, uint16_t* port, int32_t* operation, bool* verbose, uint32_t* nops, uint32_t* nruns,
-		uint32_t* threads, bool* no_verify, bool* detailed) {
+		uint32_t* threads, bool* no_verify, bool* detailed, string* costmodel, e_mt_gen_alg* mt_alg, bool* gatelayout) {
 
-	uint32_t int_role = 0, int_port = 0;
+	uint32_t int_role = 0, int_port = 0, int_mtalg = 0;
 	bool useffc = false;
 	bool oplist = false;
 	bool success = false;
@@ -56,7 +65,10 @@ int32_t read_test_options(int32_t* argcp, char*** argvp, e_role* role, int32_t*
 			{ (void*) no_verify, T_FLAG, "t", "No output verification (default: false)",	false, false },
 			{ (void*) detailed, T_FLAG, "d", "Give detailed online/setup time and communication (default: false)",	false, false },
 			{ (void*) nops, T_NUM, "n", "Number of parallel operations, default: 1", false, false },
-			{ (void*) threads, T_NUM, "h", "Number of threads, default: 1", false, false }
+			{ (void*) threads, T_NUM, "h", "Number of threads, default: 1", false, false },
+			{ (void*) &int_mtalg, T_NUM, "m", "Arithmetic MT gen algo [0: OT, 1: Paillier, 2: DGK, 3: OLE], default: 0", false, false },
+			{ (void*) costmodel, T_STR, "c", "Write the measured costs per value to a cost model file for the ProtocolPlanner", false, false },
+			{ (void*) gatelayout, T_FLAG, "g", "Benchmark the memory layout of the gates locally, -n gives the number of gates (default: off)", false, false }
 	};
 
 	success = parse_options(argcp, argvp, options, sizeof(options) / sizeof(parsing_ctx));
@@ -85,15 +97,75 @@ int32_t read_test_options(int32_t* argcp, char*** argvp, e_role* role, int32_t*
 
 	assert(*bitlen <= 64);
 
+	assert(int_mtalg < MT_LAST);
+	*mt_alg = (e_mt_gen_alg) int_mtalg;
+
 	return 1;
 }
 
 
 
 
+/**
+ Benchmarks the gate layout without the other party: builds a circuit of ngates gates and walks it the way the online phase
+ does, i.e., reads the type, number of values and inputs of each gate and releases one use of each input. Compare a build
+ with and a build without USE_PACKED_GATES to get the memory and speed difference of the packed layout.
+ */
+void bench_gate_layout(uint32_t ngates, uint32_t nruns) {
+	ABYCircuit* circ = new ABYCircuit(ngates);
+	GateTable gates = circ->Gates();
+	uint32_t ninputs = min(ngates, (uint32_t) 1024);
+	double build_time = 0, walk_time = 0;
+	uint64_t checksum = 0;
+	timespec tstart, tend;
+	rusage usage;
+
+	srand(0);
+	for (uint32_t r = 0; r < nruns; r++) {
+		clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &tstart);
+		for (uint32_t i = 0; i < ninputs; i++) {
+			circ->PutINGate(S_BOOL, 1, 1, SERVER, 0);
+		}
+		//every gate reads its predecessor and a gate from anywhere in the circuit, every fourth gate is an AND
+		for (uint32_t i = ninputs; i < ngates; i++) {
+			circ->PutPrimitiveGate((i & 0x03) ? G_LIN : G_NON_LIN, i - 1, rand() % i, (i & 0x03) ? 0 : 1);
+		}
+		clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &tend);
+		build_time += getMillies(tstart, tend);
+
+		clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &tstart);
+		for (uint32_t i = ninputs; i < ngates; i++) {
+			GATE* gate = gates + i;
+			GATE* left = gates + gate->ingates.inputs.twin.left;
+			GATE* right = gates + gate->ingates.inputs.twin.right;
+			checksum += gate->type + gate->nvals + left->nvals + right->nvals;
+			left->nused--;
+			right->nused--;
+		}
+		clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &tend);
+		walk_time += getMillies(tstart, tend);
+
+		circ->Reset();
+	}
+	getrusage(RUSAGE_SELF, &usage);
+
+#ifdef USE_PACKED_GATES
+	cout << "Packed gate layout: ";
+#else
+	cout << "Default gate layout: ";
+#endif
+	cout << sizeof(GATE) << " bytes per gate, " << ngates << " gates take " << ((uint64_t) ngates * sizeof(GATE)) / (1 << 20)
+			<< " MB" << endl;
+	cout << "Build time per gate: " << build_time * 1000000 / ((double) nruns * ngates) << " ns, walk time per gate: "
+			<< walk_time * 1000000 / ((double) nruns * ngates) << " ns, peak resident memory: " << usage.ru_maxrss / 1024
+			<< " MB (checksum " << checksum << ")" << endl;
+
+	delete circ;
+}
+
 int32_t bench_operations(aby_ops_t* bench_ops, uint32_t nops, ABYParty* party, uint32_t* bitlens,
 		uint32_t nbitlens, uint32_t nvals, uint32_t nruns, e_role role, uint32_t symsecbits, bool verbose,
-		bool no_verify,	bool detailed) {
+		bool no_verify,	bool detailed, ProtocolCostModel* costmodel) {
 	uint64_t *avec, *bvec, *cvec, *verifyvec, typebitmask = 0;
 	uint32_t tmpbitlen, tmpnvals;
 	uint8_t *sa, *sb;
@@ -102,7 +174,8 @@ int32_t bench_operations(aby_ops_t* bench_ops, uint32_t nops, ABYParty* party, u
 	share *shray, *shrayr, *shrby, *shrbyr, *shrresy, *shrresyr, *shrouty, *shroutyr;
 	vector<Sharing*>& sharings = party->GetSharings();
 	Circuit *bc, *yc, *ac, *ycr;
-	double op_time, o_time, s_time, o_comm, s_comm;
+	double op_time, o_time, s_time, o_comm, s_comm, cpu_time;
+	timespec cpustart, cpuend;
 	uint32_t non_linears, depth, ynvals, yrnvals;
 
 	uint8_t *buf_shrd_out_a, *buf_shrd_out_b;
@@ -153,11 +226,13 @@ int32_t bench_operations(aby_ops_t* bench_ops, uint32_t nops, ABYParty* party, u
 		for (uint32_t b = 0; b < nbitlens; b++) {
 			uint32_t bitlen = bitlens[b];
 			op_time = 0;
+			cpu_time = 0;
 			o_time = 0;
 			s_time = 0;
 			o_comm = 0;
 			s_comm = 0;
 			non_linears = 0;
+			depth = 0;
 
 			typebitmask = 0;
 
@@ -352,7 +427,11 @@ int32_t bench_operations(aby_ops_t* bench_ops, uint32_t nops, ABYParty* party, u
 					shrout = circ->PutOUTGate(shrres, ALL);
 				}
 
+				//the cost model only takes the local computation, the planner adds the network terms itself
+				clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpustart);
 				party->ExecCircuit();
+				clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpuend);
+				cpu_time += getMillies(cpustart, cpuend);
 
 				//cout << "Size of output: " << shrout->size() << endl;
 				if(bench_ops[i].sharing == S_YAO_REV) {
@@ -409,6 +488,14 @@ int32_t bench_operations(aby_ops_t* bench_ops, uint32_t nops, ABYParty* party, u
 			}
 			free(sa);
 			free(sb);
+			if (costmodel && find(m_vCostModelOps, m_vCostModelOps + sizeof(m_vCostModelOps) / sizeof(string), bench_ops[i].opname)
+					!= m_vCostModelOps + sizeof(m_vCostModelOps) / sizeof(string)) {
+				op_cost cost;
+				cost.bytes = (o_comm + s_comm) / (nruns * nvals);
+				cost.rounds = ((double) depth) / nruns;
+				cost.time = cpu_time / (nruns * nvals);
+				costmodel->SetCost(bench_ops[i].op, bench_ops[i].sharing, bitlen, cost);
+			}
 			if(!detailed) {
 				cout << op_time/nruns << "\t";
 			}
@@ -430,7 +517,7 @@ int32_t bench_operations(aby_ops_t* bench_ops, uint32_t nops, ABYParty* party, u
 
 
 bool run_bench(e_role role, char* address, uint16_t port, seclvl seclvl, int32_t operation, int32_t bitlen, uint32_t nvals,
-		uint32_t nruns, e_mt_gen_alg mt_alg, uint32_t nthreads, bool verbose, bool no_verify, bool detailed) {
+		uint32_t nruns, e_mt_gen_alg mt_alg, uint32_t nthreads, bool verbose, bool no_verify, bool detailed, string costmodelfile) {
 
 	uint32_t nops, nbitlens;
 	uint64_t seed = 0xAAAAAAAAAAAAAAAA;
@@ -471,7 +558,14 @@ bool run_bench(e_role role, char* address, uint16_t port, seclvl seclvl, int32_t
 
 	srand(seed);
 
-	bench_operations(op, nops, party, bitlens, nbitlens, nvals, nruns, role, seclvl.symbits, verbose, no_verify, detailed);
+	ProtocolCostModel* costmodel = costmodelfile.size() > 0 ? new ProtocolCostModel(seclvl.symbits) : NULL;
+
+	bench_operations(op, nops, party, bitlens, nbitlens, nvals, nruns, role, seclvl.symbits, verbose, no_verify, detailed, costmodel);
+
+	if (costmodel) {
+		costmodel->WriteToFile(costmodelfile.c_str());
+		delete costmodel;
+	}
 
 	delete party;
 
@@ -485,18 +579,25 @@ int main(int argc, char** argv) {
 	uint32_t secparam = 128, nvals = 1, nruns = 1;
 	uint16_t port = 7766;
 	string address = "127.0.0.1";
+	string costmodel = "";
 	int32_t operation = -1, bitlen = -1;
 	bool verbose = false;
 	bool no_verify = false;
 	bool detailed = false;
 	uint32_t nthreads = 1;
 	e_mt_gen_alg mt_alg = MT_OT;
+	bool gatelayout = false;
 
-	read_test_options(&argc, &argv, &role, &bitlen, &secparam, &address, &port, &operation, &verbose, &nvals, &nruns, &nthreads, &no_verify, &detailed);
+	read_test_options(&argc, &argv, &role, &bitlen, &secparam, &address, &port, &operation, &verbose, &nvals, &nruns, &nthreads, &no_verify, &detailed, &costmodel, &mt_alg, &gatelayout);
+
+	if (gatelayout) {
+		bench_gate_layout(nvals > 1 ? nvals : BENCH_LAYOUT_GATES, nruns);
+		return 0;
+	}
 
 	seclvl seclvl = get_sec_lvl(secparam);
 
-	run_bench(role, (char*) address.c_str(), port, seclvl, operation, bitlen, nvals, nruns, mt_alg, nthreads, verbose, no_verify, detailed);
+	run_bench(role, (char*) address.c_str(), port, seclvl, operation, bitlen, nvals, nruns, mt_alg, nthreads, verbose, no_verify, detailed, costmodel);
 
 	return 0;
 }
@@ -43,6 +43,12 @@ int main(int argc, char** argv) {
 
 	run_tests(role, (char*) address.c_str(), port, seclvl, bitlen, nvals, nthreads, mt_alg, test_op, num_test_runs, verbose);
 
+	cout << "Testing arithmetic operations with MTs from OLE" << endl;
+	test_ole_mts(role, (char*) address.c_str(), port, seclvl, bitlen, nthreads, num_test_runs, verbose);
+
+	cout << "Testing sessions of a session server" << endl;
+	test_session_server(role, (char*) address.c_str(), port, seclvl, bitlen, nthreads, mt_alg, num_test_runs, verbose);
+
 	//Test the AES circuit
 	cout << "Testing AES circuit in Boolean sharing" << endl;
 	test_aes_circuit(role, (char*) address.c_str(), port, seclvl, nvals, nthreads, mt_alg, S_BOOL);
@@ -116,6 +122,40 @@ bool run_tests(e_role role, char* address, uint16_t port, seclvl seclvl, uint32_
 	test_standard_ops(test_ops, party, bitlen, num_test_runs, nops, role, verbose);
 	test_vector_ops(test_ops, party, bitlen, nvals, num_test_runs, nops, role, verbose);
 
+	//Re-run the operations with the pipelined online phase
+	party->SetPipelinedOnlinePhase(TRUE);
+	test_standard_ops(test_ops, party, bitlen, num_test_runs, nops, role, verbose);
+	test_vector_ops(test_ops, party, bitlen, nvals, num_test_runs, nops, role, verbose);
+	party->SetPipelinedOnlinePhase(FALSE);
+
+	//Re-run the operations on optimized circuits
+	party->SetCircuitOptimization(TRUE);
+	test_standard_ops(test_ops, party, bitlen, num_test_runs, nops, role, verbose);
+	test_vector_ops(test_ops, party, bitlen, nvals, num_test_runs, nops, role, verbose);
+	test_circuit_optimization(party, bitlen, num_test_runs, role, verbose);
+	party->SetCircuitOptimization(FALSE);
+
+	//Re-run the operations with rebalanced AND trees in the Boolean sharing
+	party->SetDepthRebalancing(S_BOOL, TRUE);
+	test_standard_ops(test_ops, party, bitlen, num_test_runs, nops, role, verbose);
+	test_vector_ops(test_ops, party, bitlen, nvals, num_test_runs, nops, role, verbose);
+	test_depth_rebalancing(party, bitlen, num_test_runs, role, verbose);
+	party->SetDepthRebalancing(S_BOOL, FALSE);
+
+	test_compiled_circuit(party, bitlen, num_test_runs, role, verbose);
+	test_stored_circuit(party, bitlen, num_test_runs, role, verbose);
+	test_circuit_file(party, num_test_runs, role, verbose);
+	test_bristol_fashion_file(party, nvals, num_test_runs, role, verbose);
+	test_planned_gate_buffers(party, bitlen, num_test_runs, role, verbose);
+	test_protocol_planner(party, bitlen, num_test_runs, role, verbose);
+	test_batch_jobs(party, bitlen, num_test_runs, role, verbose);
+	test_precomp_store(role, verbose);
+	test_gate_layout(role, verbose);
+	test_precomputed_setup(party, bitlen, num_test_runs, role, verbose);
+	//before the triple pool is created, whose thread would otherwise run OT extensions on the same setup
+	test_silent_ot(party, num_test_runs, role, verbose);
+	test_triple_pool(party, bitlen, num_test_runs, role, verbose);
+
 	delete party;
 
 	return true;
@@ -473,6 +513,874 @@ int32_t test_vector_ops(aby_ops_t* test_ops, ABYParty* party, uint32_t bitlen, u
 
 }
 
+int32_t test_circuit_optimization(ABYParty* party, uint32_t bitlen, uint32_t num_test_runs, e_role role, bool verbose) {
+	uint32_t a, b, c, verify;
+	uint64_t nandsbefore, nandsafter;
+	share *shra, *shrb, *shrout;
+	Circuit* circ = party->GetSharings()[S_BOOL]->GetCircuitBuildRoutine();
+
+	for (uint32_t r = 0; r < num_test_runs; r++) {
+		a = (uint32_t) rand() % ((uint64_t) 1<<bitlen);
+		b = (uint32_t) rand() % ((uint64_t) 1<<bitlen);
+		verify = a & b;
+
+		//the second AND gate is merged with the first one, which turns the third one into an AND of a value with itself
+		shra = circ->PutINGate(a, bitlen, SERVER);
+		shrb = circ->PutINGate(b, bitlen, CLIENT);
+		shrout = circ->PutANDGate(circ->PutANDGate(shra, shrb), circ->PutANDGate(shrb, shra));
+		shrout = circ->PutOUTGate(shrout, ALL);
+
+		if (!verbose)
+			cout << "Running circuit optimization test no. " << r << endl;
+		party->ExecCircuit();
+
+		c = shrout->get_clear_value<uint32_t>();
+		nandsbefore = party->GetStats().GetNumANDsBeforeOptimization();
+		nandsafter = party->GetStats().GetNumANDsAfterOptimization();
+		if (!verbose)
+			cout << get_role_name(role) << " optimization: values: a = " << a << ", b = " << b << ", c = " << c <<
+			", verify = " << verify << ", AND gates: " << nandsbefore << " -> " << nandsafter << endl;
+		party->Reset();
+		assert(nandsafter < nandsbefore);
+		assert(verify == c);
+	}
+	return 1;
+}
+
+int32_t test_depth_rebalancing(ABYParty* party, uint32_t bitlen, uint32_t num_test_runs, e_role role, bool verbose) {
+	uint32_t a, c, verify;
+	uint32_t depthbefore, depthafter;
+	share *shrout;
+	uint32_t nleaves = 16;
+	Circuit* circ = party->GetSharings()[S_BOOL]->GetCircuitBuildRoutine();
+
+	for (uint32_t r = 0; r < num_test_runs; r++) {
+		//a linear chain of AND gates, which can be evaluated in logarithmic depth
+		a = (uint32_t) rand() % ((uint64_t) 1<<bitlen);
+		verify = a;
+		shrout = circ->PutINGate(a, bitlen, SERVER);
+		for (uint32_t j = 1; j < nleaves; j++) {
+			a = (uint32_t) rand() % ((uint64_t) 1<<bitlen);
+			verify &= a;
+			shrout = circ->PutANDGate(shrout, circ->PutINGate(a, bitlen, (j & 0x01) ? CLIENT : SERVER));
+		}
+		shrout = circ->PutOUTGate(shrout, ALL);
+
+		if (!verbose)
+			cout << "Running depth rebalancing test no. " << r << endl;
+		party->ExecCircuit();
+
+		c = shrout->get_clear_value<uint32_t>();
+		depthbefore = party->GetStats().GetDepthBeforeRebalancing();
+		depthafter = party->GetStats().GetDepthAfterRebalancing();
+		if (!verbose)
+			cout << get_role_name(role) << " rebalancing: values: c = " << c << ", verify = " << verify << ", depth: " <<
+			depthbefore << " -> " << depthafter << endl;
+		party->Reset();
+		assert(depthafter < depthbefore);
+		assert(verify == c);
+	}
+	return 1;
+}
+
+int32_t test_compiled_circuit(ABYParty* party, uint32_t bitlen, uint32_t num_test_runs, e_role role, bool verbose) {
+	uint32_t a, b, c, verify;
+	share *shra, *shrb, *shrmul, *shradd, *shrout;
+	BOOL compiled;
+	vector<Sharing*>& sharings = party->GetSharings();
+	e_sharing testsharings[] = { S_BOOL, S_YAO, S_ARITH };
+
+	for (uint32_t i = 0; i < sizeof(testsharings) / sizeof(e_sharing); i++) {
+		Circuit* circ = sharings[testsharings[i]]->GetCircuitBuildRoutine();
+
+		//build the circuit once and evaluate it on new inputs in every run
+		shra = circ->PutINGate((uint32_t) 0, bitlen, SERVER);
+		shrb = circ->PutINGate((uint32_t) 0, bitlen, CLIENT);
+		shrmul = circ->PutMULGate(shra, shrb);
+		shradd = circ->PutADDGate(shrmul, shra);
+		shrout = circ->PutOUTGate(shradd, ALL);
+		compiled = party->CompileCircuit();
+		assert(compiled);
+
+		for (uint32_t r = 0; r < num_test_runs; r++) {
+			a = (uint32_t) rand() % ((uint64_t) 1<<bitlen);
+			b = (uint32_t) rand() % ((uint64_t) 1<<bitlen);
+			verify = (a * b) + a;
+
+			delete circ->PutINGate(a, bitlen, SERVER);
+			delete circ->PutINGate(b, bitlen, CLIENT);
+
+			if (!verbose)
+				cout << "Running compiled circuit test no. " << r << " in " << get_sharing_name(testsharings[i]) << endl;
+			party->ExecCircuit();
+
+			c = shrout->get_clear_value<uint32_t>();
+			if (!verbose)
+				cout << get_role_name(role) << " compiled: values: a = " << a << ", b = " << b << ", c = " << c <<
+				", verify = " << verify << endl;
+			party->Reset();
+			assert(verify == c);
+		}
+
+		party->DiscardCompiledCircuit();
+		party->Reset();
+		delete shra;
+		delete shrb;
+		delete shrmul;
+		delete shradd;
+		delete shrout;
+	}
+	return 1;
+}
+
+int32_t test_stored_circuit(ABYParty* party, uint32_t bitlen, uint32_t num_test_runs, e_role role, bool verbose) {
+	uint32_t a, b, c, verify, nmuls;
+	share *shra, *shrb, *shrmul, *shradd, *shrout;
+	BOOL stored, loaded;
+	vector<Sharing*>& sharings = party->GetSharings();
+	e_sharing testsharings[] = { S_BOOL, S_YAO, S_ARITH };
+	string filename = "abytest_" + get_role_name(role) + ".circ";
+
+	for (uint32_t i = 0; i < sizeof(testsharings) / sizeof(e_sharing); i++) {
+		Circuit* circ = sharings[testsharings[i]]->GetCircuitBuildRoutine();
+
+		shra = circ->PutINGate((uint32_t) 0, bitlen, SERVER);
+		shrb = circ->PutINGate((uint32_t) 0, bitlen, CLIENT);
+		shrmul = circ->PutMULGate(shra, shrb);
+		shradd = circ->PutADDGate(shrmul, shrb);
+		shrout = circ->PutOUTGate(shradd, ALL);
+		nmuls = testsharings[i] == S_ARITH ? ((ArithmeticCircuit*) circ)->GetNumMULGates() : 0;
+		stored = party->SaveCompiledCircuit(filename.c_str());
+		assert(stored);
+		party->Reset();
+
+		//the loaded circuit keeps the gate ids, hence shrout still refers to its output gates
+		loaded = party->LoadCompiledCircuit(filename.c_str());
+		assert(loaded);
+		assert(circ->GetMaxDepth() > 0);
+		//the arithmetic sharing derives the number of MTs from the restored counter
+		assert(testsharings[i] != S_ARITH || (nmuls > 0 && ((ArithmeticCircuit*) circ)->GetNumMULGates() == nmuls));
+
+		for (uint32_t r = 0; r < num_test_runs; r++) {
+			a = (uint32_t) rand() % ((uint64_t) 1<<bitlen);
+			b = (uint32_t) rand() % ((uint64_t) 1<<bitlen);
+			verify = (a * b) + b;
+
+			delete circ->PutINGate(a, bitlen, SERVER);
+			delete circ->PutINGate(b, bitlen, CLIENT);
+
+			if (!verbose)
+				cout << "Running stored circuit test no. " << r << " in " << get_sharing_name(testsharings[i]) << endl;
+			party->ExecCircuit();
+
+			c = shrout->get_clear_value<uint32_t>();
+			if (!verbose)
+				cout << get_role_name(role) << " stored: values: a = " << a << ", b = " << b << ", c = " << c <<
+				", verify = " << verify << endl;
+			party->Reset();
+			assert(verify == c);
+		}
+
+		party->DiscardCompiledCircuit();
+		party->Reset();
+		delete shra;
+		delete shrb;
+		delete shrmul;
+		delete shradd;
+		delete shrout;
+	}
+	remove(filename.c_str());
+	return 1;
+}
+
+int32_t test_circuit_file(ABYParty* party, uint32_t num_test_runs, e_role role, bool verbose) {
+	uint32_t a, b, c, verify, s0, s1, c0;
+	vector<Sharing*>& sharings = party->GetSharings();
+	e_sharing testsharings[] = { S_BOOL, S_YAO };
+	string filename = "abytest_" + get_role_name(role) + ".aby";
+
+	//2-bit adder that uses every gate type of the .aby format
+	ofstream file(filename.c_str());
+	file << "#test circuit" << endl << "S 0 1" << endl << "C 2 3" << endl << "0 -2" << endl << "1 -3" << endl;
+	file << "X 0 2 4" << endl << "A 0 2 5" << endl << "X 1 3 6" << endl << "X 6 5 7" << endl << "I 7 8" << endl;
+	file << "M 4 8 5 9" << endl << "X 9 -3 10" << endl << "O 4 7 10 -2" << endl;
+	file.close();
+
+	for (uint32_t r = 0; r < num_test_runs; r++) {
+		for (uint32_t i = 0; i < sizeof(testsharings) / sizeof(e_sharing); i++) {
+			BooleanCircuit* circ = (BooleanCircuit*) sharings[testsharings[i]]->GetCircuitBuildRoutine();
+			a = (uint32_t) rand() % 4;
+			b = (uint32_t) rand() % 4;
+			s0 = (a ^ b) & 1;
+			c0 = a & b & 1;
+			s1 = ((a ^ b) >> 1) ^ c0;
+			verify = s0 | (s1 << 1) | ((c0 ? s1 : s0 ^ 1) << 2);
+
+			//the second instantiation replays the cached netlist
+			vector<uint32_t> in = circ->PutINGate(a, 2, SERVER)->get_wires();
+			vector<uint32_t> inb = circ->PutINGate(b, 2, CLIENT)->get_wires();
+			in.insert(in.end(), inb.begin(), inb.end());
+			vector<uint32_t> out = circ->PutGateFromFile(filename, in);
+			out = circ->PutGateFromFile(filename, in);
+			share* shrout = circ->PutOUTGate(new boolshare(out, circ), ALL);
+
+			if (!verbose)
+				cout << "Running circuit file test no. " << r << " in " << get_sharing_name(testsharings[i]) << endl;
+			party->ExecCircuit();
+
+			c = shrout->get_clear_value<uint32_t>();
+			if (!verbose)
+				cout << get_role_name(role) << " circuit file: values: a = " << a << ", b = " << b << ", c = " << c <<
+				", verify = " << verify << endl;
+			party->Reset();
+			assert(verify == c);
+		}
+	}
+	remove(filename.c_str());
+	return 1;
+}
+
+int32_t test_bristol_fashion_file(ABYParty* party, uint32_t nvals, uint32_t num_test_runs, e_role role, bool verbose) {
+	uint32_t *avec, *bvec, *cvec, tmpbitlen, tmpnvals;
+	vector<Sharing*>& sharings = party->GetSharings();
+	e_sharing testsharings[] = { S_BOOL, S_YAO };
+	//the constant one wire (EQ) has to be one for every SIMD value, also beyond the 64 bits of a Yao constant
+	nvals = max(nvals, (uint32_t) 65);
+	string filename = "abytest_" + get_role_name(role) + ".bristol";
+
+	//2-bit adder with a 3-bit sum that uses every gate type of Bristol Fashion
+	ofstream file(filename.c_str());
+	file << "12 17" << endl << "2 2 2" << endl << "1 3" << endl << endl;
+	file << "2 1 0 2 4 XOR" << endl << "2 1 1 3 5 XOR" << endl << "4 2 0 1 2 3 6 7 MAND" << endl << "2 1 5 6 8 XOR" << endl;
+	file << "1 1 1 9 EQ" << endl << "2 1 7 9 10 AND" << endl << "2 1 5 6 11 AND" << endl << "2 1 10 11 12 XOR" << endl;
+	file << "1 1 8 13 INV" << endl << "1 1 4 14 EQW" << endl << "1 1 13 15 INV" << endl << "1 1 12 16 EQW" << endl;
+	file.close();
+
+	avec = (uint32_t*) malloc(nvals * sizeof(uint32_t));
+	bvec = (uint32_t*) malloc(nvals * sizeof(uint32_t));
+
+	for (uint32_t r = 0; r < num_test_runs; r++) {
+		for (uint32_t i = 0; i < sizeof(testsharings) / sizeof(e_sharing); i++) {
+			BooleanCircuit* circ = (BooleanCircuit*) sharings[testsharings[i]]->GetCircuitBuildRoutine();
+			for (uint32_t j = 0; j < nvals; j++) {
+				avec[j] = rand() % 4;
+				bvec[j] = rand() % 4;
+			}
+
+			//the netlist is instantiated once for all SIMD values
+			vector<uint32_t> in = circ->PutSIMDINGate(nvals, avec, 2, SERVER)->get_wires();
+			vector<uint32_t> inb = circ->PutSIMDINGate(nvals, bvec, 2, CLIENT)->get_wires();
+			in.insert(in.end(), inb.begin(), inb.end());
+			share* shrout = circ->PutOUTGate(new boolshare(circ->PutBristolFashionGate(filename, in, nvals), circ), ALL);
+
+			if (!verbose)
+				cout << "Running Bristol Fashion test no. " << r << " in " << get_sharing_name(testsharings[i]) << endl;
+			party->ExecCircuit();
+
+			shrout->get_clear_value_vec(&cvec, &tmpbitlen, &tmpnvals);
+			assert(tmpnvals == nvals);
+			for (uint32_t j = 0; j < nvals; j++) {
+				if (!verbose)
+					cout << get_role_name(role) << " Bristol Fashion: values[" << j << "]: a = " << avec[j] << ", b = " <<
+					bvec[j] << ", c = " << cvec[j] << ", verify = " << avec[j] + bvec[j] << endl;
+				assert(avec[j] + bvec[j] == cvec[j]);
+			}
+			free(cvec);
+			party->Reset();
+		}
+	}
+	free(avec);
+	free(bvec);
+	remove(filename.c_str());
+	return 1;
+}
+
+int32_t test_planned_gate_buffers(ABYParty* party, uint32_t bitlen, uint32_t num_test_runs, e_role role, bool verbose) {
+	uint32_t a, b, c, verify;
+	uint64_t plannedbytes, unplannedbytes;
+	share *shra, *shrb, *shrx;
+	uint32_t nrounds = 16;
+	vector<Sharing*>& sharings = party->GetSharings();
+	e_sharing testsharings[] = { S_BOOL, S_ARITH };
+
+	for (uint32_t i = 0; i < sizeof(testsharings) / sizeof(e_sharing); i++) {
+		Circuit* circ = sharings[testsharings[i]]->GetCircuitBuildRoutine();
+
+		for (uint32_t r = 0; r < num_test_runs; r++) {
+			a = (uint32_t) rand() % ((uint64_t) 1<<bitlen);
+			b = (uint32_t) rand() % ((uint64_t) 1<<bitlen);
+
+			//a deep chain of operations, where only few values are live on each layer
+			shra = circ->PutINGate(a, bitlen, SERVER);
+			shrb = circ->PutINGate(b, bitlen, CLIENT);
+			shrx = shra;
+			verify = a;
+			for (uint32_t j = 0; j < nrounds; j++) {
+				shrx = circ->PutADDGate(circ->PutMULGate(shrx, shrb), shra);
+				verify = verify * b + a;
+			}
+			shrx = circ->PutOUTGate(shrx, ALL);
+
+			plannedbytes = party->PlanGateBuffers();
+			//without the plan, every gate value would have its own buffer
+			unplannedbytes = 0;
+			for (uint32_t s = 0; s < sharings.size(); s++) {
+				unplannedbytes += sharings[s]->GetUnplannedGateBufferBytes();
+			}
+			if (!verbose)
+				cout << "Running planned gate buffer test no. " << r << " in " << get_sharing_name(testsharings[i]) <<
+				" with " << plannedbytes << " planned bytes instead of " << unplannedbytes << endl;
+			party->ExecCircuit();
+
+			c = shrx->get_clear_value<uint32_t>();
+			if (!verbose)
+				cout << get_role_name(role) << " planned: values: a = " << a << ", b = " << b << ", c = " << c <<
+				", verify = " << verify << endl;
+			party->Reset();
+			assert(plannedbytes > 0 && plannedbytes < unplannedbytes);
+			assert(verify == c);
+		}
+	}
+	return 1;
+}
+
+int32_t test_protocol_planner(ABYParty* party, uint32_t bitlen, uint32_t num_test_runs, e_role role, bool verbose) {
+	uint64_t a, b, c, s, mask, verify;
+	vector<Sharing*>& sharings = party->GetSharings();
+	ProtocolCostModel model;
+	//a LAN and a WAN, which should lead to different assignments
+	network_profile nets[] = { { 0.2, 1000 }, { 100, 100 } };
+	vector<e_sharing> netassignment[sizeof(nets) / sizeof(network_profile)];
+
+	mask = bitlen < 64 ? (((uint64_t) 1) << bitlen) - 1 : ~((uint64_t) 0);
+	for (uint32_t n = 0; n < sizeof(nets) / sizeof(network_profile); n++) {
+		ProtocolPlanner planner(&model, nets[n], sharings[S_ARITH]->GetCircuitBuildRoutine()->GetShareBitLen());
+
+		for (uint32_t r = 0; r < num_test_runs; r++) {
+			a = (((uint64_t) rand() << 32) + rand()) & mask;
+			b = (((uint64_t) rand() << 32) + rand()) & mask;
+			c = (((uint64_t) rand() << 32) + rand()) & mask;
+
+			//(a * b + c) > a ? a * b + c : b
+			OperationGraph graph;
+			uint32_t ina = graph.PutINNode(1, &a, bitlen, SERVER);
+			uint32_t inb = graph.PutINNode(1, &b, bitlen, CLIENT);
+			uint32_t inc = graph.PutINNode(1, &c, bitlen, SERVER);
+			uint32_t sum = graph.PutOpNode(OP_ADD, graph.PutOpNode(OP_MUL, ina, inb), inc);
+			graph.PutOUTNode(graph.PutMUXNode(sum, inb, graph.PutOpNode(OP_CMP, sum, ina)), ALL);
+
+			vector<e_sharing> assignment;
+			double predicted = planner.Plan(graph, assignment);
+			netassignment[n] = assignment;
+			vector<share*> out = planner.Build(graph, assignment, party);
+			if (!verbose) {
+				cout << "Running protocol planner test no. " << r << " with rtt " << nets[n].rtt << " ms, predicted " << predicted
+						<< " ms, sharings:";
+				for (uint32_t i = 0; i < assignment.size(); i++) {
+					cout << " " << get_sharing_name(assignment[i]);
+				}
+				cout << endl;
+			}
+			party->ExecCircuit();
+
+			s = out[0]->get_clear_value<uint64_t>();
+			verify = (a * b + c) & mask;
+			verify = verify > a ? verify : b;
+			if (!verbose)
+				cout << get_role_name(role) << " planner: values: a = " << a << ", b = " << b << ", c = " << c << ", s = " << s
+						<< ", verify = " << verify << endl;
+			party->Reset();
+			delete out[0];
+			assert(verify == s);
+		}
+	}
+	assert(num_test_runs == 0 || netassignment[0] != netassignment[1]);
+	return 1;
+}
+
+//Computes a * b + c in the arithmetic sharing, where the server inputs a and c and the client inputs b
+class MulAddJob: public ABYBatchJob {
+public:
+	MulAddJob(uint32_t bitlen, e_role role, bool verbose) :
+			m_nBitLen(bitlen), m_eRole(role), m_bVerbose(verbose), m_nFinished(0) {
+	}
+	void BuildCircuit(ABYParty* party) {
+		Circuit* circ = party->GetSharings()[S_ARITH]->GetCircuitBuildRoutine();
+		uint64_t mask = m_nBitLen < 64 ? (((uint64_t) 1) << m_nBitLen) - 1 : ~((uint64_t) 0);
+		uint64_t a = (((uint64_t) rand() << 32) + rand()) & mask;
+		uint64_t b = (((uint64_t) rand() << 32) + rand()) & mask;
+		uint64_t c = (((uint64_t) rand() << 32) + rand()) & mask;
+
+		share* shra = circ->PutINGate(a, m_nBitLen, SERVER);
+		share* shrb = circ->PutINGate(b, m_nBitLen, CLIENT);
+		share* shrc = circ->PutINGate(c, m_nBitLen, SERVER);
+		m_vOut.push_back(circ->PutOUTGate(circ->PutADDGate(circ->PutMULGate(shra, shrb), shrc), ALL));
+		//each party only knows its own inputs, the inputs are revealed to check the result
+		m_vOut.push_back(circ->PutOUTGate(shra, ALL));
+		m_vOut.push_back(circ->PutOUTGate(shrb, ALL));
+		m_vOut.push_back(circ->PutOUTGate(shrc, ALL));
+		delete shra;
+		delete shrb;
+		delete shrc;
+	}
+	void Finish(ABYParty* party) {
+		uint64_t mask = m_nBitLen < 64 ? (((uint64_t) 1) << m_nBitLen) - 1 : ~((uint64_t) 0);
+		uint64_t s = m_vOut[0]->get_clear_value<uint64_t>();
+		uint64_t a = m_vOut[1]->get_clear_value<uint64_t>();
+		uint64_t b = m_vOut[2]->get_clear_value<uint64_t>();
+		uint64_t c = m_vOut[3]->get_clear_value<uint64_t>();
+		uint64_t verify = (a * b + c) & mask;
+		if (!m_bVerbose)
+			cout << get_role_name(m_eRole) << " batch job: values: a = " << a << ", b = " << b << ", c = " << c << ", s = " <<
+					s << ", verify = " << verify << endl;
+		for (uint32_t i = 0; i < m_vOut.size(); i++) {
+			delete m_vOut[i];
+		}
+		m_vOut.clear();
+		m_nFinished++;
+		assert(verify == s);
+	}
+	uint32_t GetNumFinished() {
+		return m_nFinished;
+	}
+
+private:
+	uint32_t m_nBitLen;
+	e_role m_eRole;
+	bool m_bVerbose;
+	uint32_t m_nFinished;
+	vector<share*> m_vOut;
+};
+
+int32_t test_batch_jobs(ABYParty* party, uint32_t bitlen, uint32_t num_test_runs, e_role role, bool verbose) {
+	uint32_t njobs = 8, maxjobs = 3;
+	vector<MulAddJob*> jobs(njobs);
+	vector<ABYBatchJob*> batch(njobs);
+
+	for (uint32_t r = 0; r < num_test_runs; r++) {
+		for (uint32_t i = 0; i < njobs; i++) {
+			jobs[i] = new MulAddJob(bitlen, role, verbose);
+			batch[i] = jobs[i];
+		}
+		if (!verbose)
+			cout << "Running batch test no. " << r << " with " << njobs << " jobs, at most " << maxjobs << " per execution" << endl;
+		uint32_t nexecs = party->ExecBatch(batch, maxjobs);
+		assert(nexecs == (njobs + maxjobs - 1) / maxjobs);
+		//all jobs were submitted to a single execution
+		nexecs = party->ExecBatch(batch);
+		assert(nexecs == 1);
+		for (uint32_t i = 0; i < njobs; i++) {
+			assert(jobs[i]->GetNumFinished() == 2);
+			delete jobs[i];
+		}
+	}
+	return 1;
+}
+
+//Checks the fields and pointer alignment of the gates in the configured layout, run once with USE_PACKED_GATES as well
+int32_t test_gate_layout(e_role role, bool verbose) {
+	ABYCircuit* circ = new ABYCircuit(1);
+	GateTable gates = circ->Gates();
+	uint32_t ngates = GATE_CHUNK_SIZE + 64;
+	vector<uint32_t> combids;
+
+	uint32_t in = circ->PutINGate(S_SPLUT, 1, 1, SERVER, 0);
+	vector<uint32_t> inputs(2, in);
+	for (uint32_t i = circ->GetGateHead(); i < ngates; i++) {
+		if (i % 3 == 0) {
+			inputs[1] = i - 1;
+			combids.push_back(circ->PutCombinerGate(inputs));
+		} else {
+			circ->PutPrimitiveGate(G_NON_LIN, i - 1, in, 255);
+		}
+	}
+
+	for (uint32_t i = 0; i < ngates; i++) {
+		assert(((uint64_t) &gates[i].ingates.inputs.parents) % sizeof(uint32_t*) == 0);
+		assert(((uint64_t) &gates[i].gs) % sizeof(void*) == 0);
+	}
+	for (uint32_t i = 0; i < combids.size(); i++) {
+		GATE* gate = gates + combids[i];
+		assert(gate->type == G_COMBINE && gate->context == S_SPLUT && gate->ingates.ningates == 2);
+		assert(gate->ingates.inputs.parents[0] == in && gate->ingates.inputs.parents[1] == combids[i] - 1);
+	}
+	GATE* gate = gates + (ngates - 1);
+	assert(gate->type == G_NON_LIN && gate->nrounds == 255 && gate->ingates.inputs.twin.right == in);
+	gate->instantiated = true;
+	gate->planned = true;
+	assert(gate->instantiated && !gate->pooled && gate->planned && gate->type == G_NON_LIN && gate->context == S_SPLUT);
+
+	delete circ;
+	if (!verbose)
+		cout << get_role_name(role) << " gate layout test with " << sizeof(GATE) << " bytes per gate passed" << endl;
+	return 1;
+}
+
+//Records are only consumed by their slot and circuit, each of them once, and the file is removed with the last record
+int32_t test_precomp_store(e_role role, bool verbose) {
+	string filename = string("precomp_store_test_") + get_role_name(role) + ".store";
+	BYTE vals[3][13];
+	const BYTE* rec;
+	uint64_t len;
+
+	for (uint32_t i = 0; i < 3; i++) {
+		memset(vals[i], i + 1, sizeof(vals[i]));
+	}
+	remove(filename.c_str());
+	PreCompStore store(filename, role);
+	BOOL appended = store.Append("a", 1, vals[0], 13);
+	appended &= store.Append("a", 1, vals[1], 7);
+	appended &= store.Append("b", 1, vals[2], 13);
+	assert(appended);
+	uint32_t nrecs[] = { store.GetNumRecords("a", 1), store.GetNumRecords("b", 1), store.GetNumRecords("a", 2) };
+	assert(nrecs[0] == 2 && nrecs[1] == 1 && nrecs[2] == 0);
+	rec = store.Consume("a", 2, len);
+	assert(rec == NULL);
+
+	rec = store.Consume("a", 1, len);
+	assert(rec != NULL && len == 13 && memcmp(rec, vals[0], len) == 0);
+	rec = store.Consume("a", 1, len);
+	assert(rec != NULL && len == 7 && memcmp(rec, vals[1], len) == 0);
+	rec = store.Consume("a", 1, len);
+	nrecs[1] = store.GetNumRecords("b", 1);
+	assert(rec == NULL && nrecs[1] == 1);
+
+	rec = store.Consume("b", 1, len);
+	assert(rec != NULL && len == 13 && memcmp(rec, vals[2], len) == 0);
+	store.Release();
+	FILE* file = fopen(filename.c_str(), "rb");
+	if (file != NULL) {
+		fclose(file);
+	}
+	assert(file == NULL);
+	if (!verbose)
+		cout << get_role_name(role) << " precomputation store test passed" << endl;
+	return 1;
+}
+
+//The setup values of all runs are stored first, the runs then read them and execute only their online phase
+int32_t test_precomputed_setup(ABYParty* party, uint32_t bitlen, uint32_t num_test_runs, e_role role, bool verbose) {
+	uint64_t mask, a, b, c, d, s, sconv, smul, sand, verify;
+	vector<Sharing*>& sharings = party->GetSharings();
+	Circuit* ac = sharings[S_ARITH]->GetCircuitBuildRoutine();
+	Circuit* yc = sharings[S_YAO]->GetCircuitBuildRoutine();
+	Circuit* bc = sharings[S_BOOL]->GetCircuitBuildRoutine();
+
+	mask = bitlen < 64 ? (((uint64_t) 1) << bitlen) - 1 : ~((uint64_t) 0);
+	for (uint32_t phase = 0; phase < 2; phase++) {
+		party->SetPreCompPhaseValue(phase == 0 ? ePreCompStore : ePreCompRead);
+		for (uint32_t r = 0; r < num_test_runs; r++) {
+			//both parties know all inputs, such that the results can be checked
+			a = (0x9E3779B97F4A7C15ULL * (r + 1)) & mask;
+			b = (0xC2B2AE3D27D4EB4FULL * (r + 1)) & mask;
+			c = (0x165667B19E3779F9ULL * (r + 1)) & mask;
+			d = (0x27D4EB2F165667C5ULL * (r + 1)) & mask;
+
+			share* shra = ac->PutINGate(a, bitlen, SERVER);
+			share* shrb = ac->PutINGate(b, bitlen, CLIENT);
+			share* shrmul = ac->PutMULGate(shra, shrb);
+			share* shrc = yc->PutINGate(c, bitlen, SERVER);
+			share* shrd = bc->PutINGate(d, bitlen, CLIENT);
+			share* shrsum = yc->PutADDGate(yc->PutADDGate(yc->PutA2YGate(shrmul), shrc), yc->PutB2YGate(shrd));
+			share* outsum = yc->PutOUTGate(shrsum, ALL);
+			share* outconv = bc->PutOUTGate(bc->PutY2BGate(shrsum), ALL);
+			share* outmul = ac->PutOUTGate(shrmul, ALL);
+			share* shrba = bc->PutINGate(a, bitlen, SERVER);
+			share* shrbb = bc->PutINGate(b, bitlen, CLIENT);
+			share* outbmul = bc->PutOUTGate(bc->PutMULGate(shrba, shrbb), ALL);
+			share* outand = bc->PutOUTGate(bc->PutANDGate(shrba, shrbb), ALL);
+
+			party->ExecCircuit();
+
+			if (phase == 1) {
+				s = outsum->get_clear_value<uint64_t>();
+				sconv = outconv->get_clear_value<uint64_t>();
+				smul = outmul->get_clear_value<uint64_t>();
+				verify = (a * b + c + d) & mask;
+				if (!verbose)
+					cout << get_role_name(role) << " precomputed run " << r << ": a = " << a << ", b = " << b << ", c = " << c <<
+							", d = " << d << ", s = " << s << ", verify = " << verify << endl;
+				assert(s == verify && sconv == verify);
+				assert(smul == ((a * b) & mask) && outbmul->get_clear_value<uint64_t>() == smul);
+				sand = outand->get_clear_value<uint64_t>();
+				assert(sand == (a & b));
+			}
+			party->Reset();
+			delete shra;
+			delete shrb;
+			delete shrmul;
+			delete shrc;
+			delete shrd;
+			delete shrsum;
+			delete outsum;
+			delete outconv;
+			delete outmul;
+			delete shrba;
+			delete shrbb;
+			delete outbmul;
+			delete outand;
+		}
+	}
+	party->SetPreCompPhaseValue(ePreCompDefault);
+	return 1;
+}
+
+//The executions take their MTs from the filled triple pool, of which half is spilled to a file
+int32_t test_triple_pool(ABYParty* party, uint32_t bitlen, uint32_t num_test_runs, e_role role, bool verbose) {
+	uint64_t mask, a, b, nbool, narith;
+	vector<Sharing*>& sharings = party->GetSharings();
+	Circuit* ac = sharings[S_ARITH]->GetCircuitBuildRoutine();
+	Circuit* bc = sharings[S_BOOL]->GetCircuitBuildRoutine();
+	ABYTriplePool* pool = party->GetTriplePool();
+
+	pool->AddReservoir(S_BOOL, 1, 16384);
+	pool->AddReservoir(S_ARITH, bitlen, 1024);
+	pool->SetChunkSize(4096);
+	pool->SetSpillFile("triple_pool_test", 8192);
+	pool->Start();
+	party->SetPreCompPhaseValue(ePreCompPool);
+
+	mask = bitlen < 64 ? (((uint64_t) 1) << bitlen) - 1 : ~((uint64_t) 0);
+	for (uint32_t r = 0; r < num_test_runs; r++) {
+		pool->Fill();
+		nbool = pool->GetNumMTs(S_BOOL, 1);
+		narith = pool->GetNumMTs(S_ARITH, bitlen);
+		assert(nbool >= 16384 && narith >= 1024);
+
+		//both parties know all inputs, such that the results can be checked
+		a = (0x9E3779B97F4A7C15ULL * (r + 1)) & mask;
+		b = (0xC2B2AE3D27D4EB4FULL * (r + 1)) & mask;
+		share* shra = ac->PutINGate(a, bitlen, SERVER);
+		share* shrb = ac->PutINGate(b, bitlen, CLIENT);
+		share* outmul = ac->PutOUTGate(ac->PutMULGate(shra, shrb), ALL);
+		share* shrba = bc->PutINGate(a, bitlen, SERVER);
+		share* shrbb = bc->PutINGate(b, bitlen, CLIENT);
+		share* outbmul = bc->PutOUTGate(bc->PutMULGate(shrba, shrbb), ALL);
+		share* outand = bc->PutOUTGate(bc->PutANDGate(shrba, shrbb), ALL);
+
+		party->ExecCircuit();
+		//the pool stays paused until the reset, such that the taken MTs are not yet refilled
+		assert(pool->GetNumMTs(S_BOOL, 1) < nbool && pool->GetNumMTs(S_ARITH, bitlen) == narith - 1);
+
+		if (!verbose)
+			cout << get_role_name(role) << " triple pool run " << r << ": a = " << a << ", b = " << b << ", a * b = " <<
+					outmul->get_clear_value<uint64_t>() << ", " << pool->GetNumMTs(S_BOOL, 1) << " Boolean MTs left" << endl;
+		assert(outmul->get_clear_value<uint64_t>() == ((a * b) & mask));
+		assert(outbmul->get_clear_value<uint64_t>() == ((a * b) & mask));
+		assert(outand->get_clear_value<uint64_t>() == (a & b));
+
+		party->Reset();
+		delete shra;
+		delete shrb;
+		delete outmul;
+		delete shrba;
+		delete shrbb;
+		delete outbmul;
+		delete outand;
+	}
+	party->SetPreCompPhaseValue(ePreCompDefault);
+	//the later tests run without the pool, whose thread would otherwise keep generating MTs on the party's ABYSetup
+	pool->Stop();
+	return 1;
+}
+
+//AND gates on SILENT_OT_MIN_OTS values, whose MTs are generated with silent OT instead of IKNP. The runs consume more
+//OTs than one expansion yields, such that the following expansion is bootstrapped from the previous one, and the last
+//run adds vector AND gates, whose MTs are random OTs on SILENT_TEST_VEC_BITLEN bit strings
+#define SILENT_TEST_VEC_BITLEN 8
+int32_t test_silent_ot(ABYParty* party, uint32_t num_test_runs, e_role role, bool verbose) {
+	uint32_t nvals = SILENT_OT_MIN_OTS, veclen = SILENT_TEST_VEC_BITLEN;
+	uint32_t nruns = max(num_test_runs, (uint32_t) ((SILENT_OT_N - SILENT_OT_K) / nvals + 1));
+	uint32_t *avec, *bvec, *cvec, tmpbitlen, tmpnvals;
+	BooleanCircuit* bc = (BooleanCircuit*) party->GetSharings()[S_BOOL]->GetCircuitBuildRoutine();
+
+	avec = (uint32_t*) malloc(nvals * sizeof(uint32_t));
+	bvec = (uint32_t*) malloc(nvals * veclen * sizeof(uint32_t));
+	party->SetRandomOTGenAlg(ROT_SILENT);
+
+	for (uint32_t r = 0; r <= nruns; r++) {
+		bool vecand = r == nruns;
+		uint32_t noutvals = vecand ? nvals * veclen : nvals;
+		//both parties know all inputs, such that the results can be checked
+		for (uint32_t j = 0; j < nvals; j++) {
+			avec[j] = ((0x9E3779B9 * (j + r)) >> 7) & 0x01;
+		}
+		for (uint32_t j = 0; j < noutvals; j++) {
+			bvec[j] = ((0x85EBCA6B * (j + 2 * r)) >> 11) & 0x01;
+		}
+		share* shra = bc->PutSIMDINGate(nvals, avec, 1, SERVER);
+		share* shrb = bc->PutSIMDINGate(noutvals, bvec, 1, CLIENT);
+		share* shrand;
+		if (vecand) {
+			//each bit of avec selects veclen consecutive bits of bvec
+			vector<uint32_t> vecgate(1, bc->PutVectorANDGate(shra->get_wire_id(0), shrb->get_wire_id(0)));
+			shrand = new boolshare(vecgate, bc);
+		} else {
+			shrand = bc->PutANDGate(shra, shrb);
+		}
+		share* shrout = bc->PutOUTGate(shrand, ALL);
+
+		party->ExecCircuit();
+
+		shrout->get_clear_value_vec(&cvec, &tmpbitlen, &tmpnvals);
+		assert(tmpnvals == noutvals);
+		if (!verbose)
+			cout << get_role_name(role) << " silent OT run " << r << " on " << nvals << (vecand ? " vector" : "") << " AND gates" << endl;
+		for (uint32_t j = 0; j < noutvals; j++) {
+			assert(cvec[j] == (avec[vecand ? j / veclen : j] & bvec[j]));
+		}
+
+		party->Reset();
+		free(cvec);
+		delete shra;
+		delete shrb;
+		delete shrand;
+		delete shrout;
+	}
+	party->SetRandomOTGenAlg(ROT_IKNP);
+	free(avec);
+	free(bvec);
+	return 1;
+}
+
+//Small circuits generate their MTs with OT extension, while the SIMD multiplications of the vector test are large enough
+//for OLEs on silent random OTs
+int32_t test_ole_mts(e_role role, char* address, uint16_t port, seclvl seclvl, uint32_t bitlen, uint32_t nthreads,
+		uint32_t num_test_runs, bool verbose) {
+	ABYParty* party = new ABYParty(role, address, port, seclvl, bitlen, nthreads, MT_OLE);
+	vector<aby_ops_t> arithops, mulops;
+
+	for (uint32_t i = 0; i < sizeof(m_tAllOps) / sizeof(aby_ops_t); i++) {
+		if (m_tAllOps[i].sharing == S_ARITH) {
+			arithops.push_back(m_tAllOps[i]);
+			if (m_tAllOps[i].op == OP_MUL) {
+				mulops.push_back(m_tAllOps[i]);
+			}
+		}
+	}
+	test_standard_ops(arithops.data(), party, bitlen, num_test_runs, arithops.size(), role, verbose);
+	test_vector_ops(mulops.data(), party, bitlen, SILENT_OT_MIN_OTS / bitlen, num_test_runs, mulops.size(), role, verbose);
+
+	delete party;
+	return 1;
+}
+
+struct session_test_ctx {
+	char* address;
+	uint16_t port;
+	seclvl sec;
+	uint32_t bitlen;
+	uint32_t nthreads;
+	e_mt_gen_alg mt_alg;
+	uint32_t num_test_runs;
+	bool verbose;
+};
+
+static void session_test_fn(ABYParty* party, uint32_t sessionid, void* arg) {
+	session_test_ctx* ctx = (session_test_ctx*) arg;
+	if (!ctx->verbose)
+		cout << "Server runs session " << sessionid << endl;
+	test_session_circuit(party, ctx->bitlen, ctx->num_test_runs, SERVER, ctx->verbose);
+}
+
+//A client that connects its own session, several of them run concurrently
+class SessionClientThread: public CThread {
+public:
+	SessionClientThread(session_test_ctx* ctx) :
+			m_pCtx(ctx) {
+	}
+	void ThreadMain() {
+		ABYParty* party = ABYSessionServer::ConnectSession(m_pCtx->address, m_pCtx->port, m_pCtx->sec, m_pCtx->bitlen,
+				m_pCtx->nthreads, m_pCtx->mt_alg);
+		assert(party != NULL);
+		test_session_circuit(party, m_pCtx->bitlen, m_pCtx->num_test_runs, CLIENT, m_pCtx->verbose);
+		delete party;
+	}
+
+	session_test_ctx* m_pCtx;
+};
+
+//Clients connect their sessions at the same time, such that the server matches interleaved connections by their tokens
+//and executes the sessions on two workers with one setup phase at a time. Before, idle connections that never send
+//their header occupy all handshake threads, which the server has to drop once their header is overdue.
+int32_t test_session_server(e_role role, char* address, uint16_t port, seclvl seclvl, uint32_t bitlen, uint32_t nthreads,
+		e_mt_gen_alg mt_alg, uint32_t num_test_runs, bool verbose) {
+	uint32_t nsessions = 3;
+	session_test_ctx ctx = { address, port, seclvl, bitlen, nthreads, mt_alg, num_test_runs, verbose };
+
+	if (role == SERVER) {
+		ABYSessionServer server(address, port, 2, seclvl, bitlen, nthreads, mt_alg);
+		server.SetPhaseLimits(1, 0);
+		BOOL success = server.Run(session_test_fn, &ctx, nsessions);
+		assert(success && server.GetNumServedSessions() == nsessions);
+	} else {
+		vector<CSocket*> idle(SESSION_MAX_HANDSHAKES);
+		for (uint32_t i = 0; i < idle.size(); i++) {
+			idle[i] = new CSocket();
+			BOOL connected = FALSE;
+			//the server might not be listening yet
+			for (uint32_t j = 0; j < SESSION_CONNECT_RETRIES && !connected; j++) {
+				connected = idle[i]->Socket() && idle[i]->Connect(address, port);
+				if (!connected) {
+					idle[i]->Close();
+					usleep(SESSION_RETRY_WAIT_MS * 1000);
+				}
+			}
+			assert(connected);
+		}
+		usleep((SESSION_HANDSHAKE_TIMEOUT_MS + 1000) * 1000);
+
+		vector<SessionClientThread*> clients(nsessions);
+		for (uint32_t i = 0; i < nsessions; i++) {
+			clients[i] = new SessionClientThread(&ctx);
+			clients[i]->Start();
+		}
+		for (uint32_t i = 0; i < nsessions; i++) {
+			clients[i]->Wait();
+			delete clients[i];
+		}
+		for (uint32_t i = 0; i < idle.size(); i++) {
+			idle[i]->Close();
+			delete idle[i];
+		}
+	}
+	return 1;
+}
+
+int32_t test_session_circuit(ABYParty* party, uint32_t bitlen, uint32_t num_test_runs, e_role role, bool verbose) {
+	uint64_t mask, val, s, verify;
+	vector<Sharing*>& sharings = party->GetSharings();
+	Circuit* circ = sharings[S_BOOL]->GetCircuitBuildRoutine();
+
+	mask = bitlen < 64 ? (((uint64_t) 1) << bitlen) - 1 : ~((uint64_t) 0);
+	for (uint32_t r = 0; r < num_test_runs; r++) {
+		//each party only knows its own input, both are revealed to check the result
+		val = (((uint64_t) rand() << 32) + rand()) & mask;
+		share* shra = circ->PutINGate(val, bitlen, SERVER);
+		share* shrb = circ->PutINGate(val, bitlen, CLIENT);
+		share* shrres = circ->PutADDGate(circ->PutMULGate(shra, shrb), shra);
+		share* outa = circ->PutOUTGate(shra, ALL);
+		share* outb = circ->PutOUTGate(shrb, ALL);
+		shrres = circ->PutOUTGate(shrres, ALL);
+
+		party->ExecCircuit();
+
+		s = shrres->get_clear_value<uint64_t>();
+		verify = (outa->get_clear_value<uint64_t>() * outb->get_clear_value<uint64_t>() + outa->get_clear_value<uint64_t>()) & mask;
+		if (!verbose)
+			cout << get_role_name(role) << " session: values: a = " << outa->get_clear_value<uint64_t>() << ", b = " <<
+					outb->get_clear_value<uint64_t>() << ", s = " << s << ", verify = " << verify << endl;
+		party->Reset();
+		delete shra;
+		delete shrb;
+		delete shrres;
+		delete outa;
+		delete outb;
+		assert(verify == s);
+	}
+	return 1;
+}
+
 int32_t read_test_options(int32_t* argcp, char*** argvp, e_role* role, uint32_t* bitlen, uint32_t* nvals, uint32_t* secparam,
 		string* address, uint16_t* port, int32_t* test_op, uint32_t* num_test_runs, e_mt_gen_alg *mt_alg, bool* verbose) {
 
@@ -484,7 +1392,7 @@ int32_t read_test_options(int32_t* argcp, char*** argvp, e_role* role, uint32_t*
 			(void*) address, T_STR, "a", "IP-address, default: localhost", false, false }, { (void*) &int_port, T_NUM, "p", "Port, default: 7766", false, false }, {
 			(void*) test_op, T_NUM, "t", "Single test (leave out for all operations), default: off", false, false }, { (void*) verbose, T_FLAG, "v",
 			"Do not print computation results, default: off", false, false }, {(void*) num_test_runs, T_NUM, "i", "Number of test runs for operation tests, default: 5",
-					false, false }, { (void*) &int_mtalg, T_NUM, "m", "Arithmetic MT gen algo [0: OT, 1: Paillier, 2: DGK], default: 0", false, false } };
+					false, false }, { (void*) &int_mtalg, T_NUM, "m", "Arithmetic MT gen algo [0: OT, 1: Paillier, 2: DGK, 3: OLE], default: 0", false, false } };
 
 	if (!parse_options(argcp, argvp, options, sizeof(options) / sizeof(parsing_ctx))) {
 		print_usage(*argvp[0], options, sizeof(options) / sizeof(parsing_ctx));
@@ -25,6 +25,8 @@
 #include "../abycore/ENCRYPTO_utils/typedefs.h"
 #include "../abycore/ENCRYPTO_utils/crypto/crypto.h"
 #include "../abycore/aby/abyparty.h"
+#include "../abycore/aby/protocolplanner.h"
+#include "../abycore/aby/abysessionserver.h"
 #include "../abycore/circuit/circuit.h"
 #include "../abycore/ENCRYPTO_utils/timer.h"
 #include "../abycore/ENCRYPTO_utils/parse_options.h"
@@ -49,6 +51,28 @@ int32_t test_standard_ops(aby_ops_t* test_ops, ABYParty* party, uint32_t bitlen,
 int32_t test_vector_ops(aby_ops_t* test_ops, ABYParty* party, uint32_t bitlen, uint32_t nvals, uint32_t num_test_runs,
 		uint32_t nops, e_role role, bool verbose);
 
+int32_t test_circuit_optimization(ABYParty* party, uint32_t bitlen, uint32_t num_test_runs, e_role role, bool verbose);
+int32_t test_depth_rebalancing(ABYParty* party, uint32_t bitlen, uint32_t num_test_runs, e_role role, bool verbose);
+int32_t test_compiled_circuit(ABYParty* party, uint32_t bitlen, uint32_t num_test_runs, e_role role, bool verbose);
+int32_t test_stored_circuit(ABYParty* party, uint32_t bitlen, uint32_t num_test_runs, e_role role, bool verbose);
+int32_t test_circuit_file(ABYParty* party, uint32_t num_test_runs, e_role role, bool verbose);
+int32_t test_bristol_fashion_file(ABYParty* party, uint32_t nvals, uint32_t num_test_runs, e_role role, bool verbose);
+
+int32_t test_planned_gate_buffers(ABYParty* party, uint32_t bitlen, uint32_t num_test_runs, e_role role, bool verbose);
+int32_t test_protocol_planner(ABYParty* party, uint32_t bitlen, uint32_t num_test_runs, e_role role, bool verbose);
+int32_t test_batch_jobs(ABYParty* party, uint32_t bitlen, uint32_t num_test_runs, e_role role, bool verbose);
+int32_t test_precomp_store(e_role role, bool verbose);
+int32_t test_gate_layout(e_role role, bool verbose);
+int32_t test_precomputed_setup(ABYParty* party, uint32_t bitlen, uint32_t num_test_runs, e_role role, bool verbose);
+int32_t test_triple_pool(ABYParty* party, uint32_t bitlen, uint32_t num_test_runs, e_role role, bool verbose);
+int32_t test_silent_ot(ABYParty* party, uint32_t num_test_runs, e_role role, bool verbose);
+int32_t test_ole_mts(e_role role, char* address, uint16_t port, seclvl seclvl, uint32_t bitlen, uint32_t nthreads,
+		uint32_t num_test_runs, bool verbose);
+
+int32_t test_session_server(e_role role, char* address, uint16_t port, seclvl seclvl, uint32_t bitlen, uint32_t nthreads,
+		e_mt_gen_alg mt_alg, uint32_t num_test_runs, bool verbose);
+int32_t test_session_circuit(ABYParty* party, uint32_t bitlen, uint32_t num_test_runs, e_role role, bool verbose);
+
 string get_op_name(e_operation op);
 
 #endif /* MAINS_ABYTEST_H_ */